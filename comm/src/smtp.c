@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dictionary.h"
 #include "base64.h"
 #include "mail.h"
+#include "datetime.h"
 
 #include <memory.h>
 #include <netdb.h>
@@ -79,15 +80,8 @@ static void smtp_get_rfc2822_date(char* out, size_t out_size)
     }
 
     time_t now = time(NULL);
-    struct tm local_tm;
 
-    if (now == (time_t)-1 || localtime_r(&now, &local_tm) == NULL)
-    {
-        out[0] = 0;
-        return;
-    }
-
-    if (strftime(out, out_size, "%a, %d %b %Y %H:%M:%S %z", &local_tm) == 0)
+    if (now == (time_t)-1 || date_time_format_rfc2822(now, date_time_get_local_offset(now), out, out_size) == 0)
     {
         out[0] = 0;
     }
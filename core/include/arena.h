@@ -0,0 +1,57 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ARENA_C
+#define ARENA_C
+
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct arena_t arena_t;
+
+// Bump allocator for objects that share a lifetime. Memory handed out by an
+// arena is never freed individually; arena_release frees every block at once.
+extern LIBRARY_EXPORT arena_t* arena_allocate(size_t block_size);
+extern LIBRARY_EXPORT void arena_release(arena_t* ptr);
+extern LIBRARY_EXPORT void arena_clear(arena_t* ptr);
+
+extern LIBRARY_EXPORT void* arena_alloc(arena_t* ptr, size_t sz);
+extern LIBRARY_EXPORT void* arena_calloc(arena_t* ptr, size_t sz);
+extern LIBRARY_EXPORT char* arena_strndup(arena_t* ptr, const char* str, size_t len);
+extern LIBRARY_EXPORT char* arena_strdup(arena_t* ptr, const char* str);
+
+extern LIBRARY_EXPORT size_t arena_get_size(const arena_t* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
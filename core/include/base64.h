@@ -35,9 +35,46 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 extern "C" {
 #endif
 
+typedef enum base64_kernel_t
+{
+	BASE64_KERNEL_SCALAR = 0,
+	BASE64_KERNEL_SSSE3 = 1,
+	BASE64_KERNEL_AVX2 = 2
+}base64_kernel_t;
+
+typedef struct base64_encoder_t base64_encoder_t;
+typedef struct base64_decoder_t base64_decoder_t;
+
+// When encodedString/decodedData is NULL the result is calloc'd and must be freed by the caller.
+// Otherwise the result is written into the caller's buffer, which must hold at least
+// base64_encoded_length(inputlength) + 1 bytes (encode) or base64_decoded_length(inputlength) bytes (decode).
 extern LIBRARY_EXPORT char* base64_encode(const unsigned char *data, unsigned long inputlength, char *encodedString, unsigned long *outputlength);
 extern LIBRARY_EXPORT unsigned char* base64_decode(const char *encodedString, unsigned long inputlength, unsigned char *decodedData, unsigned long *outputlength);
 
+extern LIBRARY_EXPORT unsigned long base64_encoded_length(unsigned long inputlength);
+extern LIBRARY_EXPORT unsigned long base64_decoded_length(unsigned long inputlength);
+
+// Streaming codecs carry partial groups across calls. The output buffer passed to
+// update/finish must hold base64_encoder_max_output/base64_decoder_max_output bytes.
+// line_length wraps the encoded text with CRLF (76 for MIME, 0 for no wrapping) and is
+// rounded down to a multiple of 4. The decoder skips line breaks and other characters
+// outside the alphabet; finish returns false if the stream ended on a dangling character.
+extern LIBRARY_EXPORT base64_encoder_t* base64_encoder_allocate(unsigned long line_length);
+extern LIBRARY_EXPORT void base64_encoder_free(base64_encoder_t* ptr);
+extern LIBRARY_EXPORT unsigned long base64_encoder_max_output(const base64_encoder_t* ptr, unsigned long inputlength);
+extern LIBRARY_EXPORT unsigned long base64_encoder_update(base64_encoder_t* ptr, const unsigned char* data, unsigned long inputlength, char* out);
+extern LIBRARY_EXPORT unsigned long base64_encoder_finish(base64_encoder_t* ptr, char* out);
+
+extern LIBRARY_EXPORT base64_decoder_t* base64_decoder_allocate(void);
+extern LIBRARY_EXPORT void base64_decoder_free(base64_decoder_t* ptr);
+extern LIBRARY_EXPORT unsigned long base64_decoder_max_output(const base64_decoder_t* ptr, unsigned long inputlength);
+extern LIBRARY_EXPORT unsigned long base64_decoder_update(base64_decoder_t* ptr, const char* data, unsigned long inputlength, unsigned char* out);
+extern LIBRARY_EXPORT bool base64_decoder_finish(base64_decoder_t* ptr, unsigned char* out, unsigned long* outputlength);
+
+// The fastest kernel supported by the CPU is selected on first use
+extern LIBRARY_EXPORT base64_kernel_t base64_get_kernel(void);
+extern LIBRARY_EXPORT bool base64_set_kernel(base64_kernel_t kernel);
+
 #ifdef __cplusplus
 }
 #endif
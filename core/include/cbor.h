@@ -0,0 +1,176 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  CBOR (RFC 8949) encoder and decoder.
+  The decoder is a pull reader over a buffer in memory: it allocates
+  nothing and hands out strings as views into the input. It can also drive
+  a json_sax_handler_t, so code written against the JSON SAX interface
+  reads CBOR unchanged. The encoder mirrors the JSON writer and produces
+  the preferred (shortest) serialization.
+  Conversion to JSON writes byte strings as base64url text and non string
+  map keys as their decimal text; conversion from JSON keeps integers
+  exact up to 64 bits.
+*/
+
+#ifndef CBOR_C
+#define CBOR_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "buffer.h"
+#include "json.h"
+#include "jsonsax.h"
+#include "jsonwriter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Count of an indefinite length array or map */
+#define CBOR_INDEFINITE UINT64_MAX
+#define CBOR_MAX_DEPTH 128
+
+typedef enum
+{
+    CBOR_ITEM_UNSIGNED,      /* value */
+    CBOR_ITEM_NEGATIVE,      /* -1 - value */
+    CBOR_ITEM_BYTES,         /* data, length */
+    CBOR_ITEM_TEXT,          /* data, length; UTF-8, not NUL terminated */
+    CBOR_ITEM_ARRAY,         /* value is the count, or CBOR_INDEFINITE */
+    CBOR_ITEM_MAP,           /* value is the number of pairs, or CBOR_INDEFINITE */
+    CBOR_ITEM_TAG,           /* value is the tag; the tagged item follows */
+    CBOR_ITEM_FALSE,
+    CBOR_ITEM_TRUE,
+    CBOR_ITEM_NULL,
+    CBOR_ITEM_UNDEFINED,
+    CBOR_ITEM_SIMPLE,        /* value is any other simple value */
+    CBOR_ITEM_FLOAT,         /* real; half, single and double precision */
+    CBOR_ITEM_END            /* End of the innermost array or map */
+} cbor_item_type_t;
+
+typedef struct cbor_item_t
+{
+    cbor_item_type_t type;
+    uint64_t value;
+    double real;
+    const uint8_t *data;     /* Points into the reader's input */
+    size_t length;
+} cbor_item_t;
+
+/* Reader state; small enough for the stack and needs no cleanup */
+typedef struct cbor_reader_t
+{
+    const uint8_t *data;
+    size_t length;
+    size_t offset;
+    bool error;
+    bool after_tag;
+    size_t depth;
+    struct
+    {
+        uint64_t remaining;  /* Items left, CBOR_INDEFINITE if streaming */
+        bool map;
+        bool odd;            /* Indefinite map with a key awaiting its value */
+    } stack[CBOR_MAX_DEPTH];
+} cbor_reader_t;
+
+/* The input may hold a sequence of top level items (RFC 8742) */
+void cbor_reader_init(cbor_reader_t *reader, const uint8_t *data, size_t length);
+/* Returns false at the end of the input or on malformed input. Arrays
+   and maps are followed by their items and then a CBOR_ITEM_END, whether
+   or not they have a length. Indefinite length strings are rejected as
+   they cannot be viewed in place. */
+bool cbor_reader_next(cbor_reader_t *reader, cbor_item_t *item);
+/* Skips the rest of the value that 'item' started, if it is a container
+   or tag */
+bool cbor_reader_skip(cbor_reader_t *reader, const cbor_item_t *item);
+bool cbor_reader_has_error(const cbor_reader_t *reader);
+/* Offset of the next item; after an error, of the offending one */
+size_t cbor_reader_get_offset(const cbor_reader_t *reader);
+
+/* Fails for anything but an integer in int64 range */
+bool cbor_item_get_int64(const cbor_item_t *item, int64_t *value);
+
+/* Delivers the items as JSON SAX events. Numbers are passed as JSON
+   number text, byte strings as base64url strings, undefined and other
+   simple values as null; tags are dropped. */
+json_sax_status_t cbor_parse_sax(const uint8_t *data, size_t length, const json_sax_handler_t *handler, void *context);
+
+typedef struct cbor_writer_t cbor_writer_t;
+
+/* Appends to 'buffer'. Output is staged internally; call
+   cbor_writer_flush before reading the buffer. */
+cbor_writer_t *cbor_writer_allocate(buffer_t *buffer);
+/* Writes into out[0 .. capacity-1]. On overflow the writer fails but keeps
+   counting, so cbor_writer_get_length reports the size needed. */
+cbor_writer_t *cbor_writer_allocate_fixed(uint8_t *out, size_t capacity);
+/* Flushes, then frees the writer (not the buffer) */
+void cbor_writer_free(cbor_writer_t *writer);
+void cbor_writer_reset(cbor_writer_t *writer);
+
+/* Pass CBOR_INDEFINITE to stream items and finish with cbor_writer_end.
+   Definite containers close themselves after their last item; map counts
+   are pairs. */
+bool cbor_writer_begin_array(cbor_writer_t *writer, uint64_t count);
+bool cbor_writer_begin_map(cbor_writer_t *writer, uint64_t count);
+bool cbor_writer_end(cbor_writer_t *writer);
+
+bool cbor_writer_uint64(cbor_writer_t *writer, uint64_t value);
+bool cbor_writer_int64(cbor_writer_t *writer, int64_t value);
+/* Writes -1 - value, the full negative range of CBOR */
+bool cbor_writer_negative(cbor_writer_t *writer, uint64_t value);
+/* Shortest of half, single or double precision that is exact */
+bool cbor_writer_double(cbor_writer_t *writer, double value);
+bool cbor_writer_boolean(cbor_writer_t *writer, bool value);
+bool cbor_writer_null(cbor_writer_t *writer);
+bool cbor_writer_text(cbor_writer_t *writer, const char *text);
+bool cbor_writer_text_length(cbor_writer_t *writer, const char *text, size_t len);
+bool cbor_writer_bytes(cbor_writer_t *writer, const void *data, size_t len);
+/* The next item is the tagged one */
+bool cbor_writer_tag(cbor_writer_t *writer, uint64_t tag);
+
+/* Encodes a parsed JSON node (a document node writes its value) */
+bool cbor_writer_json_node(cbor_writer_t *writer, json_node_t *node);
+
+bool cbor_writer_flush(cbor_writer_t *writer);
+/* Bytes produced since allocation or reset, including unflushed ones */
+size_t cbor_writer_get_length(const cbor_writer_t *writer);
+bool cbor_writer_has_error(const cbor_writer_t *writer);
+
+/* JSON text to CBOR, appended to 'out' */
+bool cbor_from_json(const char *json, size_t length, buffer_t *out);
+/* Every top level item becomes a JSON value */
+bool cbor_to_json(const uint8_t *data, size_t length, json_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
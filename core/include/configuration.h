@@ -32,16 +32,51 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "defines.h"
 #include "stringex.h"
 
+#include <stdint.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+  The parsed file is held in an immutable, hash indexed snapshot. Readers
+  pick up the current snapshot with a single atomic load, so lookups are
+  O(1) and never block, even while a reload publishes a new snapshot.
+  Strings returned by configuration_get_value_as_string and the string
+  value getters stay valid until configuration_release, however often the
+  file is reloaded. Every reload that changes the content keeps the
+  previous snapshot alive for that reason, so memory grows with the number
+  of changed reloads, never with the number of reads or unchanged rewrites.
+*/
+
 typedef struct configuration_t configuration_t;
 
+/* Called from the watcher thread after a changed file has been published */
+typedef void (*configuration_reload_callback)(const configuration_t* config, void* context);
+
 extern LIBRARY_EXPORT configuration_t* configuration_allocate_default(void);
 extern LIBRARY_EXPORT configuration_t* configuration_allocate(const char* filename);
+/* Starts from a compiled image of 'filename' kept at 'cache_filename',
+   mapped without parsing. The image is used only if it was compiled from
+   a file of the same size and modification time; otherwise the file is
+   parsed and the image rewritten. Reloads rewrite the image as well. */
+extern LIBRARY_EXPORT configuration_t* configuration_allocate_cached(const char* filename, const char* cache_filename);
+/* Compiles 'filename' into an image at 'cache_filename', e.g. at build or
+   install time */
+extern LIBRARY_EXPORT bool  configuration_compile(const char* filename, const char* cache_filename);
 extern LIBRARY_EXPORT void  configuration_release(configuration_t* config);
 
+/* Re-reads the file and publishes a new snapshot if the content changed.
+   Returns false (keeping the current snapshot) if the file cannot be read. */
+extern LIBRARY_EXPORT bool  configuration_reload(configuration_t* config);
+/* Starts a thread that reloads the file whenever it is written or replaced
+   (inotify; returns false on platforms without it) */
+extern LIBRARY_EXPORT bool  configuration_watch(configuration_t* config, configuration_reload_callback callback, void* context);
+extern LIBRARY_EXPORT void  configuration_unwatch(configuration_t* config);
+/* Incremented each time a new snapshot is published; starts at 1 */
+extern LIBRARY_EXPORT uint64_t configuration_get_generation(const configuration_t* config);
+
 extern LIBRARY_EXPORT string_list_t*  configuration_get_all_sections(const configuration_t* config);
 extern LIBRARY_EXPORT string_list_t*  configuration_get_all_keys(const configuration_t* config, const char* section);
 
@@ -54,6 +89,39 @@ extern LIBRARY_EXPORT double configuration_get_value_as_real(const configuration
 extern LIBRARY_EXPORT const char *configuration_get_value_as_string(const configuration_t* config, const char* section, const char* key);
 extern LIBRARY_EXPORT char configuration_get_value_as_char(const configuration_t* config, const char* section, const char* key);
 
+/*
+  Bound values. A handle resolves section/key once; every value is converted
+  when its snapshot is built, so reads are a pointer check and a field load
+  with no string parsing. After a reload a handle re-resolves on its first
+  read. Handles must be unbound before the configuration is released.
+  Reads of a missing key, or of a value that does not convert to the
+  requested type, return the default.
+*/
+
+typedef struct configuration_value_t configuration_value_t;
+
+extern LIBRARY_EXPORT configuration_value_t* configuration_bind(configuration_t* config, const char* section, const char* key);
+extern LIBRARY_EXPORT void configuration_unbind(configuration_value_t* value);
+
+extern LIBRARY_EXPORT bool configuration_value_exists(const configuration_value_t* value);
+extern LIBRARY_EXPORT const char* configuration_value_string(const configuration_value_t* value, const char* default_value);
+/* Decimal, or hexadecimal with a 0x prefix */
+extern LIBRARY_EXPORT long configuration_value_integer(const configuration_value_t* value, long default_value);
+extern LIBRARY_EXPORT double configuration_value_real(const configuration_value_t* value, double default_value);
+/* true/false, yes/no, on/off, 1/0 in any case */
+extern LIBRARY_EXPORT bool configuration_value_boolean(const configuration_value_t* value, bool default_value);
+/* Bytes: "4MB", "512 KiB", "1.5G"; units are multiples of 1024, B is optional */
+extern LIBRARY_EXPORT uint64_t configuration_value_size(const configuration_value_t* value, uint64_t default_value);
+/* Nanoseconds: "10ms", "250us", "1h30m"; units ns, us, ms, s, m/min, h, d.
+   A plain number is seconds. */
+extern LIBRARY_EXPORT int64_t configuration_value_duration(const configuration_value_t* value, int64_t default_value);
+
+/* Comma separated elements, trimmed; a value without commas is one element */
+extern LIBRARY_EXPORT size_t configuration_value_array_count(const configuration_value_t* value);
+extern LIBRARY_EXPORT const char* configuration_value_array_string(const configuration_value_t* value, size_t index, const char* default_value);
+extern LIBRARY_EXPORT long configuration_value_array_integer(const configuration_value_t* value, size_t index, long default_value);
+extern LIBRARY_EXPORT double configuration_value_array_real(const configuration_value_t* value, size_t index, double default_value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -48,6 +48,9 @@ extern LIBRARY_EXPORT date_time_t* date_time_allocate_from_time(const time_t tsv
 extern LIBRARY_EXPORT date_time_t* date_time_allocate_from_time_struct(const struct tm* tsval);
 extern LIBRARY_EXPORT char* date_time_get_string(date_time_t* ptr);
 extern LIBRARY_EXPORT char* date_time_get_formatted_string(date_time_t* ptr, const char* strformat);
+// Same tokens as date_time_get_formatted_string, written into 'out';
+// returns the length, or 0 when out_size is too small
+extern LIBRARY_EXPORT size_t date_time_format(date_time_t* ptr, const char* strformat, char* out, size_t out_size);
 extern LIBRARY_EXPORT time_t date_time_get_unix_epoch(date_time_t* ptr);
 extern LIBRARY_EXPORT time_t date_time_get_time(date_time_t* ptr);
 
@@ -85,6 +88,30 @@ extern LIBRARY_EXPORT unsigned long date_time_diff_miliseconds(date_time_t* firs
 extern LIBRARY_EXPORT unsigned long long date_time_to_epoch_ll(date_time_t* ptr);
 extern LIBRARY_EXPORT date_time_t* date_time_from_epoch_ll(unsigned long long epoch);
 
+// Protocol timestamps, without strftime/strptime, locale or heap use.
+// 'offset' is the zone in seconds east of UTC. Formatters write a NUL
+// terminated string into 'out' and return its length, or 0 when out_size
+// is too small. Parsers take the whole of str[0 .. len - 1], fill 't' and,
+// when not NULL, 'offset', and return false on malformed input.
+
+// Offset of local time at 't', cached per thread for a quarter hour
+extern LIBRARY_EXPORT long date_time_get_local_offset(time_t t);
+// 2026-10-18T09:30:00+02:00, or ...Z at offset 0
+extern LIBRARY_EXPORT size_t date_time_format_rfc3339(time_t t, long offset, char* out, size_t out_size);
+// Sun, 18 Oct 2026 09:30:00 +0200
+extern LIBRARY_EXPORT size_t date_time_format_rfc2822(time_t t, long offset, char* out, size_t out_size);
+// 18-Oct-2026, the date form of IMAP SEARCH SINCE/BEFORE
+extern LIBRARY_EXPORT size_t date_time_format_imap_date(time_t t, long offset, char* out, size_t out_size);
+// Extended or basic ISO 8601 (2026-10-18T09:30:00Z, 20261018T0930+0200,
+// 2026-10-18); fractions of a second are dropped and a time without zone
+// is local time
+extern LIBRARY_EXPORT bool date_time_parse_iso8601(const char* str, size_t len, time_t* t, long* offset);
+// RFC 3339: full date, time and zone in the extended form
+extern LIBRARY_EXPORT bool date_time_parse_rfc3339(const char* str, size_t len, time_t* t, long* offset);
+// RFC 5322/2822 date-time, including comments and the obsolete year and
+// zone forms
+extern LIBRARY_EXPORT bool date_time_parse_rfc2822(const char* str, size_t len, time_t* t, long* offset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,18 @@ extern LIBRARY_EXPORT char* file_get_parent_directory(const char* filename);
 extern LIBRARY_EXPORT char* file_get_basename(const char* filename);
 extern LIBRARY_EXPORT char* file_get_extension(const char* filename);
 
+// Read-only view of a whole file. Regular files are memory mapped with
+// MADV_SEQUENTIAL; pipes, devices and files whose size is a multiple of
+// the page size are read into memory instead. The data is always followed
+// by a NUL byte, so text parsers can treat it as a C string.
+typedef struct file_map_t file_map_t;
+
+extern LIBRARY_EXPORT file_map_t* file_map_open(const char* filename);
+extern LIBRARY_EXPORT void file_map_close(file_map_t* ptr);
+extern LIBRARY_EXPORT const char* file_map_get_data(const file_map_t* ptr);
+extern LIBRARY_EXPORT size_t file_map_get_size(const file_map_t* ptr);
+extern LIBRARY_EXPORT bool file_map_is_mapped(const file_map_t* ptr);
+
 #ifdef __cplusplus
 }
 #endif
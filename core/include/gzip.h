@@ -0,0 +1,55 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GZIP_C
+#define GZIP_C
+
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// gzip (RFC 1952) members holding deflate (RFC 1951) data. The encoder finds
+// LZ77 matches over a 32 KB window and codes them with the fixed Huffman
+// code, which suits text such as logs; the decoder reads any deflate stream.
+// Results are malloc'd and must be freed by the caller; NULL on failure.
+extern LIBRARY_EXPORT unsigned char* gzip_compress(const unsigned char* data, unsigned long inputlength, unsigned long* outputlength);
+extern LIBRARY_EXPORT unsigned char* gzip_decompress(const unsigned char* data, unsigned long inputlength, unsigned long* outputlength);
+
+// Compresses 'source' into 'destination', which is replaced atomically
+extern LIBRARY_EXPORT bool gzip_compress_file(const char* source, const char* destination);
+
+// CRC-32 as used by gzip; start with crc 0
+extern LIBRARY_EXPORT unsigned long gzip_crc32(unsigned long crc, const unsigned char* data, unsigned long length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
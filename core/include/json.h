@@ -34,6 +34,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef JSON_C
 #define JSON_C
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,18 +54,43 @@ typedef enum
     JSON_NODE_NULL
 } json_node_type_t;
 
+/* Structural index kernels used by the parser's first pass */
+typedef enum
+{
+    JSON_KERNEL_SCALAR,
+    JSON_KERNEL_AVX2
+} json_kernel_t;
+
 /* Forward declarations */
 typedef struct json_node_t json_node_t;
 typedef struct json_document_t json_document_t;
 
 /* Document management */
 json_document_t *json_parse_string(const char *input);
+/* 'input' need not be NUL terminated; it is copied and may be released */
+json_document_t *json_parse_string_length(const char *input, size_t length);
 json_document_t *json_load_file(const char *path);
+/* In-situ parsing: strings are unescaped inside 'input' and nodes point
+   into it, so only nodes and numbers are allocated. 'input' need not be
+   NUL terminated and is modified. With take_ownership it is freed (with
+   free()) by json_free_document, or right away if parsing fails;
+   otherwise it must outlive the document. */
+json_document_t *json_parse_insitu(char *input, size_t length, bool take_ownership);
 void json_free_document(json_document_t *doc);
+/* Returns the document node; its only child is the top level value */
+json_node_t *json_document_root(json_document_t *doc);
+
+/* The fastest kernel supported by the CPU is selected on first use;
+   json_set_kernel returns false if the CPU lacks the requested one. */
+json_kernel_t json_get_kernel(void);
+bool json_set_kernel(json_kernel_t kernel);
 
 /* Node navigation
    - For objects: name matches the member key
    - For arrays: pass name == NULL to get elements (or pass specific name ignored)
+   Objects with many members are looked up through a hash index built
+   while parsing. Lookups never modify the document, so a parsed document
+   may be read from several threads at once.
 */
 json_node_t *json_node_first_child_element(json_node_t *node, const char *name);
 json_node_t *json_node_next_sibling_element(json_node_t *node, const char *name);
@@ -76,6 +105,18 @@ const char *json_node_name(json_node_t *node);
 const char *json_node_get_attr(json_node_t *node, const char *name);
 /* For scalar nodes returns the textual content (strings are unquoted), otherwise NULL. */
 const char *json_node_get_text(json_node_t *node);
+/* Number of members or elements of an object or array */
+size_t json_node_get_child_count(json_node_t *node);
+/* Child by position; O(1) for arrays with an element index, which the
+   parser builds for large ones */
+json_node_t *json_node_get_child_at(json_node_t *node, size_t index);
+
+/* Numbers are converted once while parsing. Integers that fit int64 are
+   stored exactly, everything else as double. json_node_get_int64 fails
+   for non-numbers and for values that are not integral or do not fit. */
+bool json_node_is_integer(json_node_t *node);
+bool json_node_get_int64(json_node_t *node, int64_t *value);
+bool json_node_get_double(json_node_t *node, double *value);
 
 /* Debugging / output */
 void json_print_node(json_node_t *node, int indent);
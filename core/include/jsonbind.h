@@ -0,0 +1,128 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Declarative binding between JSON objects and C structs.
+  A schema is a table of field descriptors built with the JSON_BIND_*
+  macros below (offsetof based). Decoding runs on the SAX parser and
+  stores values straight into the struct; encoding walks the struct and
+  emits through a json_writer_t. No DOM is built in either direction.
+
+      typedef struct { char id[16]; int64_t seq; double value; } reading_t;
+
+      static const json_bind_field_t reading_fields[] =
+      {
+          JSON_BIND_STRING("id", reading_t, id),
+          JSON_BIND_INT64("seq", reading_t, seq),
+          JSON_BIND_DOUBLE("value", reading_t, value)
+      };
+      static const json_bind_schema_t reading_schema = JSON_BIND_SCHEMA(reading_t, reading_fields);
+*/
+
+#ifndef JSON_BIND_C
+#define JSON_BIND_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsonwriter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    JSON_BIND_TYPE_BOOL,        /* bool */
+    JSON_BIND_TYPE_INT32,       /* int32_t */
+    JSON_BIND_TYPE_INT64,       /* int64_t */
+    JSON_BIND_TYPE_UINT32,      /* uint32_t */
+    JSON_BIND_TYPE_UINT64,      /* uint64_t */
+    JSON_BIND_TYPE_FLOAT,       /* float */
+    JSON_BIND_TYPE_DOUBLE,      /* double */
+    JSON_BIND_TYPE_STRING,      /* char[N], always NUL terminated */
+    JSON_BIND_TYPE_TIMESTAMP,   /* time_t, an ISO 8601 string (written in UTC) */
+    JSON_BIND_TYPE_OBJECT,      /* Nested struct described by a schema */
+    JSON_BIND_TYPE_ARRAY        /* Fixed size C array plus a size_t count */
+} json_bind_type_t;
+
+typedef struct json_bind_schema_t json_bind_schema_t;
+
+typedef struct json_bind_field_t
+{
+    const char *name;
+    json_bind_type_t type;
+    size_t offset;
+    size_t size;                        /* sizeof the member */
+    json_bind_type_t element;           /* Arrays: type of the elements */
+    size_t element_size;                /* Arrays: sizeof one element */
+    size_t count_offset;                /* Arrays: offset of the size_t count */
+    const json_bind_schema_t *schema;   /* Objects and arrays of objects */
+} json_bind_field_t;
+
+struct json_bind_schema_t
+{
+    const json_bind_field_t *fields;
+    size_t field_count;
+    size_t size;                        /* sizeof the struct */
+};
+
+#define JSON_BIND_MEMBER_SIZE(s, m) sizeof(((s *)0)->m)
+#define JSON_BIND_SCALAR(key, t, s, m) { key, t, offsetof(s, m), JSON_BIND_MEMBER_SIZE(s, m), t, 0, 0, NULL }
+
+#define JSON_BIND_BOOL(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_BOOL, s, m)
+#define JSON_BIND_INT32(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_INT32, s, m)
+#define JSON_BIND_INT64(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_INT64, s, m)
+#define JSON_BIND_UINT32(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_UINT32, s, m)
+#define JSON_BIND_UINT64(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_UINT64, s, m)
+#define JSON_BIND_FLOAT(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_FLOAT, s, m)
+#define JSON_BIND_DOUBLE(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_DOUBLE, s, m)
+#define JSON_BIND_STRING(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_STRING, s, m)
+#define JSON_BIND_TIMESTAMP(key, s, m) JSON_BIND_SCALAR(key, JSON_BIND_TYPE_TIMESTAMP, s, m)
+#define JSON_BIND_OBJECT(key, s, m, sub) { key, JSON_BIND_TYPE_OBJECT, offsetof(s, m), JSON_BIND_MEMBER_SIZE(s, m), JSON_BIND_TYPE_OBJECT, 0, 0, &(sub) }
+/* 'm' is an array of scalars or strings (char m[N][LEN]), 'n' its size_t count */
+#define JSON_BIND_ARRAY(key, s, m, t, n) { key, JSON_BIND_TYPE_ARRAY, offsetof(s, m), JSON_BIND_MEMBER_SIZE(s, m), t, JSON_BIND_MEMBER_SIZE(s, m[0]), offsetof(s, n), NULL }
+#define JSON_BIND_OBJECT_ARRAY(key, s, m, sub, n) { key, JSON_BIND_TYPE_ARRAY, offsetof(s, m), JSON_BIND_MEMBER_SIZE(s, m), JSON_BIND_TYPE_OBJECT, JSON_BIND_MEMBER_SIZE(s, m[0]), offsetof(s, n), &(sub) }
+
+#define JSON_BIND_SCHEMA(s, fields) { fields, sizeof(fields) / sizeof((fields)[0]), sizeof(s) }
+
+/* Decodes one JSON object into 'out'. Members without a field are skipped
+   and fields without a member (or with null) are left as they were, so
+   initialize 'out' first. Fails on malformed JSON, a type mismatch, a
+   number out of range, a string or array that does not fit, or nesting
+   deeper than 32 levels. */
+bool json_bind_decode(const json_bind_schema_t *schema, const char *input, size_t length, void *out);
+
+/* Writes 'in' as one JSON object, fields in schema order */
+bool json_bind_encode(const json_bind_schema_t *schema, const void *in, json_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Newline delimited JSON (NDJSON / JSON lines) parsing on several threads.
+  The input is cut into chunks at line boundaries; worker threads parse the
+  chunks while the calling thread hands the documents out in input order.
+  Blank lines are skipped and a trailing '\r' is ignored.
+*/
+
+#ifndef JSON_LINES_C
+#define JSON_LINES_C
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called on the calling thread, once per record and in input order.
+   'record' counts non blank lines from 0. 'doc' is NULL if the line is not
+   valid JSON; otherwise the callback owns it and frees it with
+   json_free_document. Returning false stops the run. */
+typedef bool (*json_lines_callback_t)(void *context, size_t record, json_document_t *doc);
+
+/* 'threads' is the total number of parsing threads including the caller;
+   0 uses one per online CPU. Returns false if the callback stopped the run
+   or memory ran out. */
+bool json_lines_parse(const char *input, size_t length, size_t threads, json_lines_callback_t callback, void *context);
+/* Parses a file through a read-only mapping (see file_map_open) */
+bool json_lines_load_file(const char *path, size_t threads, json_lines_callback_t callback, void *context);
+
+/* Returns every record as an array of 'count' documents (NULL entries for
+   malformed lines), or NULL if memory ran out or there are no records.
+   Release with json_lines_free_all. */
+json_document_t **json_lines_parse_all(const char *input, size_t length, size_t threads, size_t *count);
+void json_lines_free_all(json_document_t **docs, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Compiled JSON Pointer (RFC 6901) queries.
+  A path is parsed once and can then be evaluated against any number of
+  documents. With wildcards enabled, a segment consisting of "*" matches
+  every member of an object or element of an array.
+*/
+
+#ifndef JSON_PATH_C
+#define JSON_PATH_C
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct json_path_t json_path_t;
+
+/* Returns NULL for a malformed pointer (not starting with '/', bad ~ escape).
+   The empty string addresses the whole document. */
+json_path_t *json_path_compile(const char *pointer, bool wildcards);
+void json_path_free(json_path_t *path);
+
+/* 'node' may be a document node or any value inside a document.
+   json_path_find returns the first match in document order. */
+json_node_t *json_path_find(const json_path_t *path, json_node_t *node);
+/* Stores up to 'max' matches and returns the total number of matches */
+size_t json_path_find_all(const json_path_t *path, json_node_t *node, json_node_t **results, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
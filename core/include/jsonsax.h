@@ -0,0 +1,98 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Event driven (SAX style) JSON parser.
+  Input may be fed in chunks of any size; parser state carries over between
+  calls, so a document can be processed as it arrives from a socket or file
+  without holding it in memory.
+*/
+
+#ifndef JSON_SAX_C
+#define JSON_SAX_C
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    JSON_SAX_OK,        /* Input consumed, parser is ready for more */
+    JSON_SAX_ERROR,     /* Malformed input (or out of memory) */
+    JSON_SAX_ABORTED    /* A handler returned false */
+} json_sax_status_t;
+
+/* Event callbacks. Any of them may be NULL. Returning false stops parsing.
+   Text passed to on_key, on_string and on_number is only valid for the
+   duration of the call and is NOT NUL terminated; use the length.
+   Strings are delivered unescaped (UTF-8), numbers as their source text. */
+typedef struct json_sax_handler_t
+{
+    bool (*on_start_object)(void *context);
+    bool (*on_end_object)(void *context);
+    bool (*on_start_array)(void *context);
+    bool (*on_end_array)(void *context);
+    bool (*on_key)(void *context, const char *key, size_t len);
+    bool (*on_string)(void *context, const char *str, size_t len);
+    bool (*on_number)(void *context, const char *num, size_t len);
+    bool (*on_boolean)(void *context, bool value);
+    bool (*on_null)(void *context);
+    /* Called after each complete top level value */
+    bool (*on_document_end)(void *context);
+} json_sax_handler_t;
+
+typedef struct json_sax_parser_t json_sax_parser_t;
+
+/* With multiple_values set, the input is a sequence of top level values
+   separated by whitespace (NDJSON / JSON lines); otherwise exactly one. */
+json_sax_parser_t *json_sax_parser_allocate(const json_sax_handler_t *handler, void *context, bool multiple_values);
+void json_sax_parser_free(json_sax_parser_t *parser);
+void json_sax_parser_reset(json_sax_parser_t *parser);
+
+/* Feeds the next chunk. Once an error or abort is returned, further calls
+   return the same status until the parser is reset. */
+json_sax_status_t json_sax_parser_feed(json_sax_parser_t *parser, const char *data, size_t len);
+/* Signals end of input; reports an error if the input stopped mid value. */
+json_sax_status_t json_sax_parser_finish(json_sax_parser_t *parser);
+
+/* Bytes consumed so far; after an error, the offset of the offending byte */
+size_t json_sax_parser_get_offset(const json_sax_parser_t *parser);
+/* Current object/array nesting depth */
+size_t json_sax_parser_get_depth(const json_sax_parser_t *parser);
+
+/* One shot helper for input that is already in memory */
+json_sax_status_t json_sax_parse(const char *input, size_t len, const json_sax_handler_t *handler, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Streaming JSON writer.
+  Output goes either to a growable buffer_t or to a fixed caller buffer.
+  Commas, colons and (in pretty mode) indentation are inserted
+  automatically; misuse such as a value without a key inside an object
+  puts the writer in an error state.
+*/
+
+#ifndef JSON_WRITER_C
+#define JSON_WRITER_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "buffer.h"
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct json_writer_t json_writer_t;
+
+/* Appends to 'buffer'. Output is staged internally; call
+   json_writer_flush before reading the buffer. */
+json_writer_t *json_writer_allocate(buffer_t *buffer, bool pretty);
+/* Writes into out[0 .. capacity-1] and keeps it NUL terminated after a
+   flush. On overflow the writer fails but keeps counting, so
+   json_writer_get_length reports the size that would have been needed. */
+json_writer_t *json_writer_allocate_fixed(char *out, size_t capacity, bool pretty);
+/* Flushes, then frees the writer (not the buffer) */
+void json_writer_free(json_writer_t *writer);
+/* Starts a new output; a fixed writer starts over at the buffer start */
+void json_writer_reset(json_writer_t *writer);
+
+bool json_writer_begin_object(json_writer_t *writer);
+bool json_writer_end_object(json_writer_t *writer);
+bool json_writer_begin_array(json_writer_t *writer);
+bool json_writer_end_array(json_writer_t *writer);
+
+bool json_writer_key(json_writer_t *writer, const char *key);
+bool json_writer_key_length(json_writer_t *writer, const char *key, size_t len);
+
+bool json_writer_string(json_writer_t *writer, const char *str);
+bool json_writer_string_length(json_writer_t *writer, const char *str, size_t len);
+bool json_writer_int64(json_writer_t *writer, int64_t value);
+bool json_writer_uint64(json_writer_t *writer, uint64_t value);
+/* Shortest text that reads back as the same double; NaN/Inf become null */
+bool json_writer_double(json_writer_t *writer, double value);
+/* Fixed number of decimals (0-9), rounded half away from zero */
+bool json_writer_fixed(json_writer_t *writer, double value, int decimals);
+/* RFC 3339 string; 'offset' is the zone in seconds east of UTC */
+bool json_writer_timestamp(json_writer_t *writer, time_t value, long offset);
+bool json_writer_boolean(json_writer_t *writer, bool value);
+bool json_writer_null(json_writer_t *writer);
+/* Emits an already serialized number, as stored in a parsed document */
+bool json_writer_number_text(json_writer_t *writer, const char *num, size_t len);
+
+/* Serializes a parsed node (a document node writes its value) */
+bool json_writer_node(json_writer_t *writer, json_node_t *node);
+
+bool json_writer_flush(json_writer_t *writer);
+/* Bytes produced since allocation or reset, including unflushed ones */
+size_t json_writer_get_length(const json_writer_t *writer);
+bool json_writer_has_error(const json_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -44,26 +44,133 @@ typedef enum LogLevel
 	LOG_PANIC = 4
 }LogLevel;
 
+typedef enum LoggerOverflow
+{
+	LOGGER_OVERFLOW_BLOCK = 0,
+	LOGGER_OVERFLOW_DROP = 1,
+	LOGGER_OVERFLOW_COUNT = 2
+}LoggerOverflow;
+
 #if defined(_WIN32) || defined(WIN32)
 #define __PRETTY_FUNCTION__ __FUNCTION__
 #endif
 
 typedef struct logger_t logger_t;
 
+/* Sampling and rate limiting state of a call site, see logger_set_rate_limit */
+typedef struct logger_limit_t
+{
+    uint64_t calls;
+    int64_t next_ns;
+    uint64_t suppressed;
+}logger_limit_t;
+
+/* A text logging call site; WriteLog keeps one per call in a static, so the
+   base file name and plain function name are worked out only once */
+typedef struct logger_call_site_t
+{
+    const char* file;
+    const char* func;
+    int line;
+    int ready;
+    const char* file_name;
+    size_t file_name_len;
+    const char* func_name;
+    size_t func_name_len;
+    logger_limit_t limit;
+}logger_call_site_t;
+
+/* A binary logging call site; WriteLogBinary keeps one per call in a static */
+typedef struct logger_site_t
+{
+    LogLevel level;
+    int line;
+    const char* format;
+    const char* file;
+    const char* func;
+    void* registered;
+    logger_limit_t limit;
+}logger_site_t;
+
 extern LIBRARY_EXPORT logger_t*  logger_allocate_default();
 extern LIBRARY_EXPORT logger_t*  logger_allocate(size_t flszmb, const char* dirpath);
 extern LIBRARY_EXPORT logger_t*  logger_allocate_file(size_t flszmb, const char* filename);
 extern LIBRARY_EXPORT const char* logger_filename(logger_t* loggerptr);
 extern LIBRARY_EXPORT void    logger_release(logger_t* loggerptr);
 extern LIBRARY_EXPORT bool    logger_write(logger_t* loggerptr, const char* logentry, LogLevel llevel, const char* func, const char* file, int line);
+extern LIBRARY_EXPORT bool    logger_write_site(logger_t* loggerptr, const char* logentry, LogLevel llevel, logger_call_site_t* site);
 extern LIBRARY_EXPORT void logger_enable_console_out(logger_t* loggerptr, bool consoleout);
 extern LIBRARY_EXPORT void logger_set_log_level(logger_t* loggerptr, LogLevel llevel);
 
+/* Keeps 'generations' old files, name.1 (newest) to name.N, instead of the
+   single name.old. The file rotates once it reaches max_size bytes (0 keeps
+   the size given at allocation) and, when 'interval' is non zero, every
+   'interval' seconds aligned to local midnight. With 'compress' old files
+   become name.N.gz. Shifting and compression run on a background thread;
+   the logging thread only renames the finished file. */
+extern LIBRARY_EXPORT bool logger_set_rotation(logger_t* loggerptr, size_t generations, size_t max_size, time_t interval, bool compress);
+
+/* Limits for entries of one level, kept per call site by WriteLog and
+   WriteLogBinary; logger_write has no call site and is never limited.
+   Sampling keeps the first of every 'one_in' calls (0 or 1 keeps all).
+   The rate limit is a token bucket letting 'burst' entries through at once
+   and 'per_second' on average (0 turns it off); the first entry a site
+   logs after the bucket held some back is preceded by a line saying how
+   many were suppressed. Suppressed calls return false, as filtered levels
+   do, and take no lock. Limits may be changed while other threads log;
+   rates too small to express in nanoseconds saturate. */
+extern LIBRARY_EXPORT bool logger_set_sampling(logger_t* loggerptr, LogLevel llevel, uint32_t one_in);
+extern LIBRARY_EXPORT bool logger_set_rate_limit(logger_t* loggerptr, LogLevel llevel, double per_second, uint32_t burst);
+/* Entries held back by sampling and rate limits since allocation */
+extern LIBRARY_EXPORT uint64_t logger_get_suppressed(logger_t* loggerptr);
+
+/* Asynchronous mode: logger_write only formats the line and queues it in a
+   ring of buffer_size bytes (0 for the default of 1 MB); a writer thread
+   batches queued lines into large writes. When the ring is full, BLOCK waits
+   for room, DROP discards the line and COUNT discards it and later writes a
+   line saying how many were lost. logger_release drains the ring. */
+extern LIBRARY_EXPORT bool logger_start_async(logger_t* loggerptr, size_t buffer_size, LoggerOverflow policy);
+/* Returns once every line queued before the call is in the file */
+extern LIBRARY_EXPORT bool logger_flush(logger_t* loggerptr);
+extern LIBRARY_EXPORT uint64_t logger_get_dropped(logger_t* loggerptr);
+/* Async-signal-safe; writes out what is queued in every asynchronous logger */
+extern LIBRARY_EXPORT void logger_flush_on_crash(void);
+/* Calls logger_flush_on_crash on SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT */
+extern LIBRARY_EXPORT void logger_install_crash_handler(void);
+
+/* Binary mode: each call site's format is written to the file once, and
+   every call only records its id, a raw timestamp and the raw arguments.
+   logger_write still works and stores the finished message.
+   logger_decode_binary renders such a file in the text log layout. */
+extern LIBRARY_EXPORT logger_t*  logger_allocate_binary(size_t flszmb, const char* filename);
+extern LIBRARY_EXPORT bool    logger_write_binary(logger_t* loggerptr, logger_site_t* site, ...);
+extern LIBRARY_EXPORT bool    logger_decode_binary(const char* filename, FILE* out);
+
+#if defined(__GNUC__)
+#define WriteLog(lptr, str, level) \
+    __extension__ ({ \
+        static logger_call_site_t logger_call_site_ = {__FILE__, __PRETTY_FUNCTION__, __LINE__, 0, NULL, 0, NULL, 0, {0, 0, 0}}; \
+        logger_write_site(lptr, str, level, &logger_call_site_); \
+    })
+#else
 #define WriteLog(lptr, str, level) \
     logger_write(lptr, str, level, (char*)__PRETTY_FUNCTION__, (char*)__FILE__, __LINE__)
+#endif
 
 #define WriteInformation(lptr, str) \
-    logger_write(lptr, str, LOG_INFO, (char*)__PRETTY_FUNCTION__, (char*)__FILE__, __LINE__);
+    WriteLog(lptr, str, LOG_INFO);
+
+/* printf style; the format must be a literal and the level a constant */
+#define WriteLogBinary(lptr, level, format, ...) \
+    do \
+    { \
+        static logger_site_t logger_site_ = {level, __LINE__, format, __FILE__, __PRETTY_FUNCTION__, NULL, {0, 0, 0}}; \
+        if (0) \
+        { \
+            printf(format, ##__VA_ARGS__); \
+        } \
+        logger_write_binary(lptr, &logger_site_, ##__VA_ARGS__); \
+    } while (0)
 
 #ifdef __cplusplus
 }
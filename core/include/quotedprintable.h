@@ -0,0 +1,65 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef QUOTED_PRINTABLE_C
+#define QUOTED_PRINTABLE_C
+
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct quoted_printable_encoder_t quoted_printable_encoder_t;
+typedef struct quoted_printable_decoder_t quoted_printable_decoder_t;
+
+// Streaming RFC 2045 quoted-printable codecs. State such as trailing whitespace and
+// partial escapes is carried across calls, so input may be split anywhere.
+// The output buffer passed to update/finish must hold the corresponding max_output bytes.
+
+// line_length is clamped to [8, 76] and 0 selects 76. In text mode line breaks in the
+// input become CRLF hard breaks; in binary mode CR and LF are escaped like any other octet.
+extern LIBRARY_EXPORT quoted_printable_encoder_t* quoted_printable_encoder_allocate(unsigned long line_length, bool binary);
+extern LIBRARY_EXPORT void quoted_printable_encoder_free(quoted_printable_encoder_t* ptr);
+extern LIBRARY_EXPORT unsigned long quoted_printable_encoder_max_output(const quoted_printable_encoder_t* ptr, unsigned long inputlength);
+extern LIBRARY_EXPORT unsigned long quoted_printable_encoder_update(quoted_printable_encoder_t* ptr, const unsigned char* data, unsigned long inputlength, char* out);
+extern LIBRARY_EXPORT unsigned long quoted_printable_encoder_finish(quoted_printable_encoder_t* ptr, char* out);
+
+// Soft line breaks are removed, hard breaks are emitted as CRLF and trailing whitespace is
+// stripped. Malformed escapes are copied through literally and make finish return false.
+extern LIBRARY_EXPORT quoted_printable_decoder_t* quoted_printable_decoder_allocate(void);
+extern LIBRARY_EXPORT void quoted_printable_decoder_free(quoted_printable_decoder_t* ptr);
+extern LIBRARY_EXPORT unsigned long quoted_printable_decoder_max_output(const quoted_printable_decoder_t* ptr, unsigned long inputlength);
+extern LIBRARY_EXPORT unsigned long quoted_printable_decoder_update(quoted_printable_decoder_t* ptr, const char* data, unsigned long inputlength, unsigned char* out);
+extern LIBRARY_EXPORT bool quoted_printable_decoder_finish(quoted_printable_decoder_t* ptr, unsigned char* out, unsigned long* outputlength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -32,7 +32,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include<stdint.h>
 #include<stdbool.h>
 
+#include "arena.h"
 #include "base64.h"
+#include "gzip.h"
+#include "quotedprintable.h"
 #include "buffer.h"
 #include "directory.h"
 #include "dictionary.h"
@@ -29,6 +29,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef TINYXML_C_H
 #define TINYXML_C_H
 
+#include <stddef.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -46,13 +49,24 @@ typedef enum
 /* Forward declarations */
 typedef struct xml_node_t xml_node_t;
 typedef struct xml_document_t xml_document_t;
+typedef struct xml_attribute_t xml_attribute_t;
 
 /* Document management */
 xml_document_t *xml_parse_string(const char *input);
 xml_document_t *xml_load_file(const char *path);
+/* In-situ parsing: text and attribute values are decoded inside 'input'
+   and nodes point into it. 'input' need not be NUL terminated and is
+   modified. With take_ownership it is freed (with free()) by
+   xml_free_document, or right away if parsing fails; otherwise it must
+   outlive the document. */
+xml_document_t *xml_parse_insitu(char *input, size_t length, bool take_ownership);
 void xml_free_document(xml_document_t *doc);
+/* The document node; the root element is its first child element */
+xml_node_t *xml_document_root(xml_document_t *doc);
 
 /* Node navigation */
+xml_node_t *xml_node_first_child(xml_node_t *node);
+xml_node_t *xml_node_next_sibling(xml_node_t *node);
 xml_node_t *xml_node_first_child_element(xml_node_t *node, const char *name);
 xml_node_t *xml_node_next_sibling_element(xml_node_t *node, const char *name);
 xml_node_t *xml_node_parent(xml_node_t *node);
@@ -62,6 +76,16 @@ xml_node_type_t xml_node_type(xml_node_t *node);
 const char *xml_node_name(xml_node_t *node);
 const char *xml_node_get_attr(xml_node_t *node, const char *name);
 const char *xml_node_get_text(xml_node_t *node);
+/* Content of a text, CDATA or comment node itself */
+const char *xml_node_text(xml_node_t *node);
+/* Position of the node in document order; the document node is 0 */
+size_t xml_node_document_order(xml_node_t *node);
+
+/* Attributes in document order */
+xml_attribute_t *xml_node_first_attr(xml_node_t *node);
+xml_attribute_t *xml_attr_next(xml_attribute_t *attr);
+const char *xml_attr_name(xml_attribute_t *attr);
+const char *xml_attr_value(xml_attribute_t *attr);
 
 /* Debugging / output */
 void xml_print_node(xml_node_t *node, int indent);
@@ -0,0 +1,72 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Compiled location paths over the XML DOM (a subset of XPath 1.0).
+  An expression is parsed once and can then be evaluated against any
+  number of documents.
+
+    /a/b          children named b of the root element a
+    //b           b elements anywhere in the document
+    a//b          b elements below the context's a children
+    ./b, *        the context node itself, any element
+    b[2]          the second b child of each parent (1 based)
+    b[@id]        b elements with an id attribute
+    b[@id='7']    ... whose id is 7 (also !=, and "double quotes")
+    b[text()='x'] b elements whose first text child is x
+
+  Predicates apply in order, so b[@id][2] is the second b that has an id.
+*/
+
+#ifndef XML_PATH_C
+#define XML_PATH_C
+
+#include <stddef.h>
+#include "xml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xml_path_t xml_path_t;
+
+/* Returns NULL for a malformed expression */
+xml_path_t *xml_path_compile(const char *expression);
+void xml_path_free(xml_path_t *path);
+
+/* 'node' is the context for relative paths; absolute paths start at its
+   document. Matches are returned in document order without duplicates. */
+xml_node_t *xml_path_find(const xml_path_t *path, xml_node_t *node);
+/* Stores up to 'max' matches and returns the total number of matches */
+size_t xml_path_find_all(const xml_path_t *path, xml_node_t *node, xml_node_t **results, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
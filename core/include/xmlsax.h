@@ -0,0 +1,105 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Event driven (SAX style) XML parser.
+  Input may be fed in chunks of any size; parser state carries over between
+  calls. Memory use depends on the longest tag and the nesting depth, not on
+  the size of the document.
+*/
+
+#ifndef XML_SAX_C
+#define XML_SAX_C
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    XML_SAX_OK,         /* Input consumed, parser is ready for more */
+    XML_SAX_ERROR,      /* Malformed input (or out of memory) */
+    XML_SAX_ABORTED     /* A handler returned false */
+} xml_sax_status_t;
+
+/* Attribute view; values have their entities decoded */
+typedef struct xml_sax_attribute_t
+{
+    const char *name;
+    size_t name_len;
+    const char *value;
+    size_t value_len;
+} xml_sax_attribute_t;
+
+/* Event callbacks. Any of them may be NULL. Returning false stops parsing.
+   Text passed to the callbacks is only valid for the duration of the call
+   and is NOT NUL terminated; use the lengths.
+   Character data has entities (predefined and numeric) decoded. Text made
+   only of whitespace is not reported. Long text, CDATA sections, comments
+   and processing instructions may arrive in several consecutive calls. */
+typedef struct xml_sax_handler_t
+{
+    bool (*on_start_element)(void *context, const char *name, size_t len, const xml_sax_attribute_t *attrs, size_t attr_count);
+    /* Also called right after on_start_element for <empty/> elements */
+    bool (*on_end_element)(void *context, const char *name, size_t len);
+    bool (*on_text)(void *context, const char *text, size_t len);
+    bool (*on_cdata)(void *context, const char *text, size_t len);
+    bool (*on_comment)(void *context, const char *text, size_t len);
+    /* Everything between "<?" and "?>", including the XML declaration */
+    bool (*on_processing_instruction)(void *context, const char *text, size_t len);
+} xml_sax_handler_t;
+
+typedef struct xml_sax_parser_t xml_sax_parser_t;
+
+xml_sax_parser_t *xml_sax_parser_allocate(const xml_sax_handler_t *handler, void *context);
+void xml_sax_parser_free(xml_sax_parser_t *parser);
+void xml_sax_parser_reset(xml_sax_parser_t *parser);
+
+/* Feeds the next chunk. Once an error or abort is returned, further calls
+   return the same status until the parser is reset. */
+xml_sax_status_t xml_sax_parser_feed(xml_sax_parser_t *parser, const char *data, size_t len);
+/* Signals end of input; reports an error unless exactly one root element
+   was closed and no markup was left open. */
+xml_sax_status_t xml_sax_parser_finish(xml_sax_parser_t *parser);
+
+/* Bytes consumed so far; after an error, the offset of the offending byte */
+size_t xml_sax_parser_get_offset(const xml_sax_parser_t *parser);
+/* Number of open elements */
+size_t xml_sax_parser_get_depth(const xml_sax_parser_t *parser);
+
+/* One shot helper for input that is already in memory */
+xml_sax_status_t xml_sax_parse(const char *input, size_t len, const xml_sax_handler_t *handler, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
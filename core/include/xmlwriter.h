@@ -0,0 +1,92 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Streaming XML writer.
+  Output is appended to a growable buffer_t. Text and attribute values are
+  escaped, start tags are closed lazily so an element without content is
+  written as <name/>, and end tags take their name from the element stack.
+  Misuse such as an attribute after content or a second root element puts
+  the writer in an error state.
+*/
+
+#ifndef XML_WRITER_C
+#define XML_WRITER_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "buffer.h"
+#include "xml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xml_writer_t xml_writer_t;
+
+/* Appends to 'buffer'. Output is staged internally; call
+   xml_writer_flush before reading the buffer. Pretty mode indents
+   elements that do not contain text. */
+xml_writer_t *xml_writer_allocate(buffer_t *buffer, bool pretty);
+/* Flushes, then frees the writer (not the buffer) */
+void xml_writer_free(xml_writer_t *writer);
+/* Starts a new document */
+void xml_writer_reset(xml_writer_t *writer);
+
+/* <?xml version="1.0" encoding="UTF-8"?>, only before anything else */
+bool xml_writer_declaration(xml_writer_t *writer);
+
+bool xml_writer_begin_element(xml_writer_t *writer, const char *name);
+bool xml_writer_end_element(xml_writer_t *writer);
+
+/* Only valid directly after xml_writer_begin_element or another attribute */
+bool xml_writer_attribute(xml_writer_t *writer, const char *name, const char *value);
+bool xml_writer_attribute_length(xml_writer_t *writer, const char *name, const char *value, size_t len);
+bool xml_writer_attribute_int64(xml_writer_t *writer, const char *name, int64_t value);
+
+bool xml_writer_text(xml_writer_t *writer, const char *text);
+bool xml_writer_text_length(xml_writer_t *writer, const char *text, size_t len);
+/* Written verbatim; a "]]>" inside is split across two sections */
+bool xml_writer_cdata(xml_writer_t *writer, const char *text, size_t len);
+/* Fails for text containing "--" or ending in '-' */
+bool xml_writer_comment(xml_writer_t *writer, const char *text);
+
+/* Serializes a parsed node; a document node writes all of its children */
+bool xml_writer_node(xml_writer_t *writer, xml_node_t *node);
+
+bool xml_writer_flush(xml_writer_t *writer);
+/* Bytes produced since allocation or reset, including unflushed ones */
+size_t xml_writer_get_length(const xml_writer_t *writer);
+bool xml_writer_has_error(const xml_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,238 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_MIN_BLOCK 256
+#define ARENA_MAX_BLOCK (4 * 1024 * 1024)
+
+typedef struct arena_block_t
+{
+    struct arena_block_t* next;
+    size_t capacity;
+    size_t used;
+    unsigned char data[] __attribute__((aligned(ARENA_ALIGNMENT)));
+}arena_block_t;
+
+typedef struct arena_t
+{
+    arena_block_t* head;
+    size_t block_size;
+    size_t total_size;
+}arena_t;
+
+static arena_block_t* arena_internal_add_block(arena_t* ptr, size_t sz);
+
+arena_t* arena_allocate(size_t block_size)
+{
+    arena_t* ptr = (arena_t*)calloc(1, sizeof(arena_t));
+
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+
+    if (block_size < ARENA_MIN_BLOCK)
+    {
+        block_size = ARENA_MIN_BLOCK;
+    }
+
+    ptr->head = NULL;
+    ptr->block_size = block_size;
+    ptr->total_size = 0;
+
+    return ptr;
+}
+
+void arena_release(arena_t* ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    arena_clear(ptr);
+    free(ptr);
+}
+
+void arena_clear(arena_t* ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    arena_block_t* block = ptr->head;
+
+    while (block != NULL)
+    {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    ptr->head = NULL;
+    ptr->total_size = 0;
+}
+
+void* arena_alloc(arena_t* ptr, size_t sz)
+{
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+
+    if (sz == 0)
+    {
+        sz = 1;
+    }
+
+    if (sz > SIZE_MAX - ARENA_ALIGNMENT)
+    {
+        return NULL;
+    }
+
+    sz = (sz + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+
+    arena_block_t* block = ptr->head;
+
+    if (block == NULL || (block->capacity - block->used) < sz)
+    {
+        block = arena_internal_add_block(ptr, sz);
+
+        if (block == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    void* mem = block->data + block->used;
+    block->used += sz;
+
+    return mem;
+}
+
+void* arena_calloc(arena_t* ptr, size_t sz)
+{
+    void* mem = arena_alloc(ptr, sz);
+
+    if (mem != NULL)
+    {
+        memset(mem, 0, sz);
+    }
+
+    return mem;
+}
+
+char* arena_strndup(arena_t* ptr, const char* str, size_t len)
+{
+    if (str == NULL)
+    {
+        return NULL;
+    }
+
+    char* mem = (char*)arena_alloc(ptr, len + 1);
+
+    if (mem == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(mem, str, len);
+    mem[len] = 0;
+
+    return mem;
+}
+
+char* arena_strdup(arena_t* ptr, const char* str)
+{
+    if (str == NULL)
+    {
+        return NULL;
+    }
+
+    return arena_strndup(ptr, str, strlen(str));
+}
+
+size_t arena_get_size(const arena_t* ptr)
+{
+    if (ptr == NULL)
+    {
+        return 0;
+    }
+
+    return ptr->total_size;
+}
+
+static arena_block_t* arena_internal_add_block(arena_t* ptr, size_t sz)
+{
+    // Blocks double in size so large documents need only a few of them
+    size_t capacity = ptr->block_size;
+
+    if (ptr->head != NULL)
+    {
+        capacity = ptr->head->capacity < ARENA_MAX_BLOCK ? ptr->head->capacity * 2 : ptr->head->capacity;
+    }
+
+    bool dedicated = sz > capacity;
+
+    if (dedicated)
+    {
+        capacity = sz;
+    }
+
+    arena_block_t* block = (arena_block_t*)malloc(sizeof(arena_block_t) + capacity);
+
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    block->capacity = capacity;
+    block->used = 0;
+    ptr->total_size += capacity;
+
+    // An oversized request gets a block of its own behind the current one,
+    // so the space left in the current block is still used
+    if (dedicated && ptr->head != NULL)
+    {
+        block->next = ptr->head->next;
+        ptr->head->next = block;
+        return block;
+    }
+
+    block->next = ptr->head;
+    ptr->head = block;
+
+    return block;
+}
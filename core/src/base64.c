@@ -31,6 +31,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86_SIMD
+#include <immintrin.h>
+#endif
 
 static const char encodingtable[] = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
 								'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
@@ -43,6 +50,407 @@ static const char encodingtable[] = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
 
 static const int modulustable[] = { 0, 2, 1 };
 
+// Characters outside the alphabet are flagged with BASE64_INVALID
+#define BASE64_INVALID 0x80
+
+typedef struct base64_encoder_t
+{
+	unsigned char carry[3];
+	unsigned long carry_length;
+	unsigned long line_length;
+	unsigned long column;
+}base64_encoder_t;
+
+typedef struct base64_decoder_t
+{
+	unsigned char sextets[4];
+	unsigned long pending;
+	bool padding;
+	bool valid;
+}base64_decoder_t;
+
+// Inverse of encodingtable; every other byte maps to BASE64_INVALID
+static const unsigned char decodingtable[256] = {
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+
+static _Atomic base64_kernel_t active_kernel = BASE64_KERNEL_SCALAR;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static bool base64_internal_kernel_supported(base64_kernel_t kernel);
+static base64_kernel_t base64_internal_resolve_kernel(void);
+static void base64_internal_detect_kernel(void);
+static unsigned long base64_internal_encode_groups(const unsigned char* data, unsigned long inputlength, char* out);
+static unsigned long base64_internal_decode_groups(const char* in, unsigned long inputlength, unsigned char* out);
+static void base64_internal_encode_tail(const unsigned char* data, unsigned long inputlength, char* out);
+
+#if defined(BASE64_X86_SIMD)
+
+// Kernels follow the Mula/Lemire layout: each 12 (SSSE3) or 24 (AVX2) input bytes
+// are shuffled into 32 bit lanes, split into sextets with multiplies and mapped to
+// ASCII with a single shuffle lookup. Decoders validate with nibble lookups and stop
+// at the first block that holds padding or a character outside the alphabet, leaving
+// that block to the scalar code so results are identical on every kernel.
+
+__attribute__((target("ssse3")))
+static unsigned long base64_internal_encode_ssse3(const unsigned char* data, unsigned long inputlength, char* out)
+{
+	const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+											'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	unsigned long i = 0;
+	unsigned long j = 0;
+
+	// Each iteration loads 16 bytes but consumes 12
+	while (inputlength - i >= 16)
+	{
+		__m128i in = _mm_loadu_si128((const __m128i*)(data + i));
+		in = _mm_shuffle_epi8(in, shuffle);
+
+		const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+		const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+		const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+		const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+		const __m128i indices = _mm_or_si128(t1, t3);
+
+		__m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+		result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+		result = _mm_add_epi8(_mm_shuffle_epi8(shift_lut, result), indices);
+
+		_mm_storeu_si128((__m128i*)(out + j), result);
+		i += 12;
+		j += 16;
+	}
+
+	return i;
+}
+
+__attribute__((target("avx2")))
+static unsigned long base64_internal_encode_avx2(const unsigned char* data, unsigned long inputlength, char* out)
+{
+	const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+											10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i shift_lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+											'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+											'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+											'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	unsigned long i = 0;
+	unsigned long j = 0;
+
+	// Each iteration reads bytes [i, i + 28) and consumes 24
+	while (inputlength - i >= 28)
+	{
+		const __m128i lo = _mm_loadu_si128((const __m128i*)(data + i));
+		const __m128i hi = _mm_loadu_si128((const __m128i*)(data + i + 12));
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		in = _mm256_shuffle_epi8(in, shuffle);
+
+		const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+		const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+		const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		const __m256i indices = _mm256_or_si256(t1, t3);
+
+		__m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+		result = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, result), indices);
+
+		_mm256_storeu_si256((__m256i*)(out + j), result);
+		i += 24;
+		j += 32;
+	}
+
+	return i;
+}
+
+__attribute__((target("ssse3")))
+static unsigned long base64_internal_decode_ssse3(const char* in, unsigned long inputlength, unsigned char* out)
+{
+	const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+										0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+										0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+										0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i mask_2f = _mm_set1_epi8(0x2F);
+	const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	unsigned long i = 0;
+	unsigned long j = 0;
+
+	// 24 remaining characters decode to at least 16 bytes, so the 16 byte store stays in bounds
+	while (inputlength - i >= 24)
+	{
+		__m128i str = _mm_loadu_si128((const __m128i*)(in + i));
+
+		const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+		const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+		const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+		const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0)
+		{
+			break;
+		}
+
+		const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+		const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+		str = _mm_add_epi8(str, roll);
+
+		const __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+		str = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+		str = _mm_shuffle_epi8(str, pack);
+
+		_mm_storeu_si128((__m128i*)(out + j), str);
+		i += 16;
+		j += 12;
+	}
+
+	return i;
+}
+
+__attribute__((target("avx2")))
+static unsigned long base64_internal_decode_avx2(const char* in, unsigned long inputlength, unsigned char* out)
+{
+	const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+											0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+											0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+											0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+											0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+											0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+											0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+											0, 0, 0, 0, 0, 0, 0, 0,
+											0, 16, 19, 4, -65, -65, -71, -71,
+											0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+	const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+										2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+	unsigned long i = 0;
+	unsigned long j = 0;
+
+	// 48 remaining characters decode to at least 34 bytes, so the 32 byte store stays in bounds
+	while (inputlength - i >= 48)
+	{
+		__m256i str = _mm256_loadu_si256((const __m256i*)(in + i));
+
+		const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+		const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+		const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+		const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+
+		if (!_mm256_testz_si256(lo, hi))
+		{
+			break;
+		}
+
+		const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+		const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+		str = _mm256_add_epi8(str, roll);
+
+		const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+		str = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+		str = _mm256_shuffle_epi8(str, pack);
+		str = _mm256_permutevar8x32_epi32(str, lanes);
+
+		_mm256_storeu_si256((__m256i*)(out + j), str);
+		i += 32;
+		j += 24;
+	}
+
+	return i;
+}
+
+#endif
+
+static bool base64_internal_kernel_supported(base64_kernel_t kernel)
+{
+	switch (kernel)
+	{
+		case BASE64_KERNEL_SCALAR:
+			return true;
+#if defined(BASE64_X86_SIMD)
+		case BASE64_KERNEL_SSSE3:
+			return __builtin_cpu_supports("ssse3");
+		case BASE64_KERNEL_AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+// Runs once, whichever thread gets here first
+static void base64_internal_detect_kernel(void)
+{
+	base64_kernel_t kernel = BASE64_KERNEL_SCALAR;
+
+#if defined(BASE64_X86_SIMD)
+	__builtin_cpu_init();
+#endif
+
+	if (base64_internal_kernel_supported(BASE64_KERNEL_AVX2))
+	{
+		kernel = BASE64_KERNEL_AVX2;
+	}
+	else if (base64_internal_kernel_supported(BASE64_KERNEL_SSSE3))
+	{
+		kernel = BASE64_KERNEL_SSSE3;
+	}
+
+	atomic_store_explicit(&active_kernel, kernel, memory_order_release);
+}
+
+static base64_kernel_t base64_internal_resolve_kernel(void)
+{
+	pthread_once(&kernel_once, base64_internal_detect_kernel);
+
+	return atomic_load_explicit(&active_kernel, memory_order_acquire);
+}
+
+base64_kernel_t base64_get_kernel(void)
+{
+	return base64_internal_resolve_kernel();
+}
+
+bool base64_set_kernel(base64_kernel_t kernel)
+{
+	base64_internal_resolve_kernel();
+
+	if (!base64_internal_kernel_supported(kernel))
+	{
+		return false;
+	}
+
+	atomic_store_explicit(&active_kernel, kernel, memory_order_release);
+
+	return true;
+}
+
+unsigned long base64_encoded_length(unsigned long inputlength)
+{
+	if (inputlength > ((unsigned long)-1 - 2) / 3)
+	{
+		return 0;
+	}
+
+	return 4 * ((inputlength + 2) / 3);
+}
+
+unsigned long base64_decoded_length(unsigned long inputlength)
+{
+	return inputlength / 4 * 3;
+}
+
+// Encodes every complete 3 byte group and returns the number of input bytes consumed
+static unsigned long base64_internal_encode_groups(const unsigned char* data, unsigned long inputlength, char* out)
+{
+	base64_kernel_t kernel = base64_internal_resolve_kernel();
+	unsigned long i = 0;
+
+#if defined(BASE64_X86_SIMD)
+	if (kernel == BASE64_KERNEL_AVX2)
+	{
+		i += base64_internal_encode_avx2(data, inputlength, out);
+	}
+
+	if (kernel != BASE64_KERNEL_SCALAR)
+	{
+		i += base64_internal_encode_ssse3(data + i, inputlength - i, out + (i / 3 * 4));
+	}
+#else
+	(void)kernel;
+#endif
+
+	for (unsigned long j = i / 3 * 4; inputlength - i >= 3; i += 3)
+	{
+		uint32_t triple = ((uint32_t)data[i] << 0x10) + ((uint32_t)data[i + 1] << 0x08) + (uint32_t)data[i + 2];
+
+		out[j++] = encodingtable[(triple >> 3 * 6) & 0x3F];
+		out[j++] = encodingtable[(triple >> 2 * 6) & 0x3F];
+		out[j++] = encodingtable[(triple >> 1 * 6) & 0x3F];
+		out[j++] = encodingtable[(triple >> 0 * 6) & 0x3F];
+	}
+
+	return i;
+}
+
+// Decodes complete 4 character groups made only of alphabet characters and returns the number of characters consumed
+static unsigned long base64_internal_decode_groups(const char* in, unsigned long inputlength, unsigned char* out)
+{
+	base64_kernel_t kernel = base64_internal_resolve_kernel();
+	unsigned long i = 0;
+
+#if defined(BASE64_X86_SIMD)
+	if (kernel == BASE64_KERNEL_AVX2)
+	{
+		i += base64_internal_decode_avx2(in, inputlength, out);
+	}
+
+	if (kernel != BASE64_KERNEL_SCALAR)
+	{
+		i += base64_internal_decode_ssse3(in + i, inputlength - i, out + (i / 4 * 3));
+	}
+#else
+	(void)kernel;
+#endif
+
+	for (unsigned long j = i / 4 * 3; inputlength - i >= 4; i += 4)
+	{
+		unsigned char a = decodingtable[(unsigned char)in[i]];
+		unsigned char b = decodingtable[(unsigned char)in[i + 1]];
+		unsigned char c = decodingtable[(unsigned char)in[i + 2]];
+		unsigned char d = decodingtable[(unsigned char)in[i + 3]];
+
+		if ((a | b | c | d) & BASE64_INVALID)
+		{
+			break;
+		}
+
+		uint32_t triple = ((uint32_t)a << 3 * 6) + ((uint32_t)b << 2 * 6) + ((uint32_t)c << 1 * 6) + ((uint32_t)d << 0 * 6);
+
+		out[j++] = (triple >> 2 * 8) & 0xFF;
+		out[j++] = (triple >> 1 * 8) & 0xFF;
+		out[j++] = (triple >> 0 * 8) & 0xFF;
+	}
+
+	return i;
+}
+
+// Encodes the final 1 or 2 bytes of a stream as one padded group
+static void base64_internal_encode_tail(const unsigned char* data, unsigned long inputlength, char* out)
+{
+	uint32_t octet_a = data[0];
+	uint32_t octet_b = inputlength > 1 ? data[1] : 0;
+	uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08);
+
+	out[0] = encodingtable[(triple >> 3 * 6) & 0x3F];
+	out[1] = encodingtable[(triple >> 2 * 6) & 0x3F];
+	out[2] = encodingtable[(triple >> 1 * 6) & 0x3F];
+	out[3] = encodingtable[(triple >> 0 * 6) & 0x3F];
+
+	for (int k = 0; k < modulustable[inputlength % 3]; k++)
+	{
+		out[3 - k] = '=';
+	}
+}
 
 char *base64_encode(const unsigned char *data, unsigned long inputlength, char *encodedString, unsigned long *outputlength)
 {
@@ -63,44 +471,34 @@ char *base64_encode(const unsigned char *data, unsigned long inputlength, char *
 		return NULL;
 	}
 
-	*outputlength = 4 * ((inputlength + 2) / 3);
-
-	encodedString = (char*)calloc(1, (size_t)(*outputlength) + 1);
+	*outputlength = base64_encoded_length(inputlength);
 
 	if (encodedString == NULL)
 	{
-        *outputlength = 0;
-        return NULL;
-	}
-
-	for (unsigned int i = 0, j = 0; i < inputlength;)
-	{
-
-		uint32_t octet_a = i < inputlength ? (unsigned char)data[i++] : 0;
-		uint32_t octet_b = i < inputlength ? (unsigned char)data[i++] : 0;
-		uint32_t octet_c = i < inputlength ? (unsigned char)data[i++] : 0;
+		encodedString = (char*)calloc(1, (size_t)(*outputlength) + 1);
 
-		uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
-
-		encodedString[j++] = encodingtable[(triple >> 3 * 6) & 0x3F];
-		encodedString[j++] = encodingtable[(triple >> 2 * 6) & 0x3F];
-		encodedString[j++] = encodingtable[(triple >> 1 * 6) & 0x3F];
-		encodedString[j++] = encodingtable[(triple >> 0 * 6) & 0x3F];
+		if (encodedString == NULL)
+		{
+			*outputlength = 0;
+			return NULL;
+		}
 	}
 
-	for (int i = 0; i < modulustable[inputlength % 3]; i++)
+	unsigned long i = base64_internal_encode_groups(data, inputlength, encodedString);
+
+	if (i < inputlength)
 	{
-		encodedString[*outputlength - 1 - i] = '=';
+		base64_internal_encode_tail(data + i, inputlength - i, encodedString + (i / 3 * 4));
 	}
 
-    return encodedString;
+	encodedString[*outputlength] = 0;
+
+	return encodedString;
 }
 
 
 unsigned char *base64_decode(const char *encodedString, unsigned long inputlength, unsigned char *decodedData, unsigned long *outputlength)
 {
-	char decodingtable[256] = { 0 };
-
 	if (outputlength == NULL || encodedString == NULL)
 	{
 		return NULL;
@@ -109,12 +507,7 @@ unsigned char *base64_decode(const char *encodedString, unsigned long inputlengt
 	if (inputlength == 0)
 	{
 		*outputlength = 0;
-		return (unsigned char*)calloc(1, 1);
-	}
-
-	for (int i = 0; i < 64; i++)
-	{
-		decodingtable[(unsigned char)encodingtable[i]] = i;
+		return decodedData != NULL ? decodedData : (unsigned char*)calloc(1, 1);
 	}
 
 	if (inputlength % 4 != 0)
@@ -123,25 +516,31 @@ unsigned char *base64_decode(const char *encodedString, unsigned long inputlengt
 		return NULL;
 	}
 
-	*outputlength = inputlength / 4 * 3;
+	*outputlength = base64_decoded_length(inputlength);
 
 	if (encodedString[inputlength - 1] == '=') (*outputlength)--;
 	if (encodedString[inputlength - 2] == '=') (*outputlength)--;
 
-	decodedData = (unsigned char*)calloc(1, *outputlength == 0 ? 1 : *outputlength);
-
 	if (decodedData == NULL)
 	{
-		*outputlength = 0;
-        return NULL;
+		decodedData = (unsigned char*)calloc(1, *outputlength == 0 ? 1 : *outputlength);
+
+		if (decodedData == NULL)
+		{
+			*outputlength = 0;
+			return NULL;
+		}
 	}
 
-	for (unsigned int i = 0, j = 0; i < inputlength;)
+	unsigned long i = base64_internal_decode_groups(encodedString, inputlength, decodedData);
+
+	// Whatever is left holds padding or stray characters, both of which are treated as zero bits
+	for (unsigned long j = i / 4 * 3; i < inputlength;)
 	{
-		uint32_t sextet_a = encodedString[i] == '=' ? 0 & i++ : decodingtable[(unsigned char)encodedString[i++]];
-		uint32_t sextet_b = encodedString[i] == '=' ? 0 & i++ : decodingtable[(unsigned char)encodedString[i++]];
-		uint32_t sextet_c = encodedString[i] == '=' ? 0 & i++ : decodingtable[(unsigned char)encodedString[i++]];
-		uint32_t sextet_d = encodedString[i] == '=' ? 0 & i++ : decodingtable[(unsigned char)encodedString[i++]];
+		uint32_t sextet_a = decodingtable[(unsigned char)encodedString[i++]] & 0x3F;
+		uint32_t sextet_b = decodingtable[(unsigned char)encodedString[i++]] & 0x3F;
+		uint32_t sextet_c = decodingtable[(unsigned char)encodedString[i++]] & 0x3F;
+		uint32_t sextet_d = decodingtable[(unsigned char)encodedString[i++]] & 0x3F;
 
 		uint32_t triple = (sextet_a << 3 * 6)
 			+ (sextet_b << 2 * 6)
@@ -153,5 +552,309 @@ unsigned char *base64_decode(const char *encodedString, unsigned long inputlengt
 		if (j < *outputlength) decodedData[j++] = (triple >> 0 * 8) & 0xFF;
 	}
 
-    return decodedData;
+	return decodedData;
+}
+
+base64_encoder_t* base64_encoder_allocate(unsigned long line_length)
+{
+	base64_encoder_t* ptr = (base64_encoder_t*)calloc(1, sizeof(base64_encoder_t));
+
+	if (ptr == NULL)
+	{
+		return NULL;
+	}
+
+	// Lines always hold whole 4 character groups
+	ptr->line_length = line_length / 4 * 4;
+	ptr->carry_length = 0;
+	ptr->column = 0;
+
+	return ptr;
+}
+
+void base64_encoder_free(base64_encoder_t* ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	free(ptr);
+}
+
+unsigned long base64_encoder_max_output(const base64_encoder_t* ptr, unsigned long inputlength)
+{
+	if (ptr == NULL)
+	{
+		return 0;
+	}
+
+	unsigned long chars = ((inputlength + ptr->carry_length) / 3 + 1) * 4;
+
+	if (ptr->line_length > 0)
+	{
+		chars += (chars / ptr->line_length + 2) * 2;
+	}
+
+	return chars;
+}
+
+static unsigned long base64_internal_encoder_break_line(base64_encoder_t* ptr, char* out)
+{
+	if (ptr->line_length == 0 || ptr->column < ptr->line_length)
+	{
+		return 0;
+	}
+
+	out[0] = '\r';
+	out[1] = '\n';
+	ptr->column = 0;
+
+	return 2;
+}
+
+unsigned long base64_encoder_update(base64_encoder_t* ptr, const unsigned char* data, unsigned long inputlength, char* out)
+{
+	if (ptr == NULL || out == NULL || (data == NULL && inputlength > 0))
+	{
+		return 0;
+	}
+
+	unsigned long i = 0;
+	unsigned long o = 0;
+
+	// Complete the group left over from the previous chunk
+	if (ptr->carry_length > 0)
+	{
+		while (ptr->carry_length < 3 && i < inputlength)
+		{
+			ptr->carry[ptr->carry_length++] = data[i++];
+		}
+
+		if (ptr->carry_length < 3)
+		{
+			return 0;
+		}
+
+		o += base64_internal_encoder_break_line(ptr, out + o);
+		base64_internal_encode_groups(ptr->carry, 3, out + o);
+		o += 4;
+		ptr->column += 4;
+		ptr->carry_length = 0;
+	}
+
+	while (inputlength - i >= 3)
+	{
+		o += base64_internal_encoder_break_line(ptr, out + o);
+
+		unsigned long take = (inputlength - i) / 3 * 3;
+
+		if (ptr->line_length > 0 && take > (ptr->line_length - ptr->column) / 4 * 3)
+		{
+			take = (ptr->line_length - ptr->column) / 4 * 3;
+		}
+
+		base64_internal_encode_groups(data + i, take, out + o);
+		i += take;
+		o += take / 3 * 4;
+		ptr->column += take / 3 * 4;
+	}
+
+	while (i < inputlength)
+	{
+		ptr->carry[ptr->carry_length++] = data[i++];
+	}
+
+	return o;
+}
+
+unsigned long base64_encoder_finish(base64_encoder_t* ptr, char* out)
+{
+	if (ptr == NULL || out == NULL)
+	{
+		return 0;
+	}
+
+	unsigned long o = 0;
+
+	if (ptr->carry_length > 0)
+	{
+		o += base64_internal_encoder_break_line(ptr, out + o);
+		base64_internal_encode_tail(ptr->carry, ptr->carry_length, out + o);
+		o += 4;
+		ptr->column += 4;
+		ptr->carry_length = 0;
+	}
+
+	// With wrapping enabled every line, including the last, ends in CRLF
+	if (ptr->line_length > 0 && ptr->column > 0)
+	{
+		out[o++] = '\r';
+		out[o++] = '\n';
+	}
+
+	ptr->column = 0;
+
+	return o;
+}
+
+base64_decoder_t* base64_decoder_allocate(void)
+{
+	base64_decoder_t* ptr = (base64_decoder_t*)calloc(1, sizeof(base64_decoder_t));
+
+	if (ptr == NULL)
+	{
+		return NULL;
+	}
+
+	base64_internal_resolve_kernel();
+
+	ptr->pending = 0;
+	ptr->padding = false;
+	ptr->valid = true;
+
+	return ptr;
+}
+
+void base64_decoder_free(base64_decoder_t* ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	free(ptr);
+}
+
+unsigned long base64_decoder_max_output(const base64_decoder_t* ptr, unsigned long inputlength)
+{
+	if (ptr == NULL)
+	{
+		return 0;
+	}
+
+	return (inputlength + ptr->pending) / 4 * 3 + 3;
+}
+
+// Flushes a partial group once padding or the end of the stream is reached
+static unsigned long base64_internal_decoder_flush(base64_decoder_t* ptr, unsigned char* out)
+{
+	unsigned long o = 0;
+
+	if (ptr->pending == 1)
+	{
+		ptr->valid = false;
+	}
+	else if (ptr->pending > 1)
+	{
+		uint32_t triple = ((uint32_t)ptr->sextets[0] << 3 * 6) + ((uint32_t)ptr->sextets[1] << 2 * 6);
+
+		if (ptr->pending == 3)
+		{
+			triple += (uint32_t)ptr->sextets[2] << 1 * 6;
+		}
+
+		out[o++] = (triple >> 2 * 8) & 0xFF;
+
+		if (ptr->pending == 3)
+		{
+			out[o++] = (triple >> 1 * 8) & 0xFF;
+		}
+	}
+
+	ptr->pending = 0;
+
+	return o;
+}
+
+unsigned long base64_decoder_update(base64_decoder_t* ptr, const char* data, unsigned long inputlength, unsigned char* out)
+{
+	if (ptr == NULL || out == NULL || (data == NULL && inputlength > 0))
+	{
+		return 0;
+	}
+
+	unsigned long i = 0;
+	unsigned long o = 0;
+
+	while (i < inputlength)
+	{
+		const char* newline = (const char*)memchr(data + i, '\n', inputlength - i);
+		unsigned long line_end = newline != NULL ? (unsigned long)(newline - data) : inputlength;
+
+		while (i < line_end)
+		{
+			// Runs of clean groups go through the block kernels
+			if (ptr->pending == 0 && !ptr->padding)
+			{
+				unsigned long used = base64_internal_decode_groups(data + i, (line_end - i) / 4 * 4, out + o);
+
+				i += used;
+				o += used / 4 * 3;
+
+				if (i >= line_end)
+				{
+					break;
+				}
+			}
+
+			char ch = data[i++];
+			unsigned char sextet = decodingtable[(unsigned char)ch];
+
+			if (ch == '=')
+			{
+				if (!ptr->padding)
+				{
+					o += base64_internal_decoder_flush(ptr, out + o);
+					ptr->padding = true;
+				}
+
+				continue;
+			}
+
+			// RFC 2045 asks decoders to skip line breaks and anything else outside the alphabet
+			if (sextet & BASE64_INVALID)
+			{
+				continue;
+			}
+
+			ptr->padding = false;
+			ptr->sextets[ptr->pending++] = sextet;
+
+			if (ptr->pending == 4)
+			{
+				uint32_t triple = ((uint32_t)ptr->sextets[0] << 3 * 6) + ((uint32_t)ptr->sextets[1] << 2 * 6)
+					+ ((uint32_t)ptr->sextets[2] << 1 * 6) + (uint32_t)ptr->sextets[3];
+
+				out[o++] = (triple >> 2 * 8) & 0xFF;
+				out[o++] = (triple >> 1 * 8) & 0xFF;
+				out[o++] = (triple >> 0 * 8) & 0xFF;
+				ptr->pending = 0;
+			}
+		}
+
+		if (i < inputlength)
+		{
+			i++;
+		}
+	}
+
+	return o;
+}
+
+bool base64_decoder_finish(base64_decoder_t* ptr, unsigned char* out, unsigned long* outputlength)
+{
+	if (ptr == NULL || out == NULL || outputlength == NULL)
+	{
+		return false;
+	}
+
+	*outputlength = base64_internal_decoder_flush(ptr, out);
+
+	bool valid = ptr->valid;
+
+	ptr->padding = false;
+	ptr->valid = true;
+
+	return valid;
 }
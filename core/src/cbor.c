@@ -0,0 +1,1368 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "cbor.h"
+#include "base64.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define CBOR_WRITER_STAGE_SIZE 4096
+
+#define CBOR_MAJOR_UNSIGNED 0
+#define CBOR_MAJOR_NEGATIVE 1
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+
+#define CBOR_BREAK 0xFF
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef struct cbor_writer_frame_t
+{
+    uint64_t remaining;      /* Items left, CBOR_INDEFINITE if streaming */
+    bool map;
+    bool odd;
+} cbor_writer_frame_t;
+
+struct cbor_writer_t
+{
+    buffer_t *buffer;        /* NULL for a fixed writer */
+    uint8_t *out;            /* Stage for buffer writers, caller memory otherwise */
+    size_t pos;
+    size_t capacity;
+    size_t length;
+
+    bool error;
+    bool after_tag;
+
+    size_t depth;
+    cbor_writer_frame_t stack[CBOR_MAX_DEPTH];
+    uint8_t stage[CBOR_WRITER_STAGE_SIZE];
+};
+
+/* ------------------------------------------------------------------------- */
+/* Numbers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static double cbor_half_to_double(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+
+    if (exponent == 0)
+        value = ldexp(mantissa, -24);
+    else if (exponent != 31)
+        value = ldexp(mantissa + 1024, exponent - 25);
+    else
+        value = mantissa == 0 ? INFINITY : NAN;
+
+    return (half & 0x8000) ? -value : value;
+}
+
+/* Succeeds if 'value' survives the trip through half precision */
+static bool cbor_double_to_half(double value, uint16_t *half)
+{
+    uint16_t sign = signbit(value) ? 0x8000 : 0;
+    double magnitude = fabs(value);
+
+    if (isnan(value))
+    {
+        *half = 0x7E00;
+        return true;
+    }
+
+    if (isinf(value) || magnitude == 0)
+    {
+        *half = sign | (isinf(value) ? 0x7C00 : 0);
+        return true;
+    }
+
+    if (magnitude > 65504.0)
+        return false;
+
+    if (magnitude < ldexp(1, -14))
+    {
+        double fraction = ldexp(magnitude, 24);
+
+        if (fraction != floor(fraction))
+            return false;
+
+        *half = sign | (uint16_t)fraction;
+        return true;
+    }
+
+    int exponent;
+    double fraction = (frexp(magnitude, &exponent) * 2 - 1) * 1024;
+
+    if (fraction != floor(fraction))
+        return false;
+
+    *half = sign | (uint16_t)((exponent + 14) << 10) | (uint16_t)fraction;
+    return true;
+}
+
+/* Writes digits backwards ending at 'end', returns the first digit */
+static char *cbor_format_uint64(char *end, uint64_t value)
+{
+    do
+    {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    return end;
+}
+
+/* Text of -1 - value, which may lie below INT64_MIN */
+static char *cbor_format_negative(char *end, uint64_t value)
+{
+    char *start;
+
+    if (value == UINT64_MAX)
+    {
+        static const char min[] = "18446744073709551616";
+
+        start = end - (sizeof(min) - 1);
+        memcpy(start, min, sizeof(min) - 1);
+    }
+    else
+    {
+        start = cbor_format_uint64(end, value + 1);
+    }
+
+    *--start = '-';
+    return start;
+}
+
+static const double cbor_powers_of_ten[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+/* Shortest text that reads back as the same (finite) double; integral
+   values and short decimals are formatted without printf, as in the JSON
+   writer */
+static size_t cbor_format_double(char *out, size_t capacity, double value)
+{
+    char *end = out + capacity;
+    char *start = NULL;
+
+    if (fabs(value) < 9007199254740992.0 && value == (double)(int64_t)value)
+    {
+        int64_t integer = (int64_t)value;
+
+        start = cbor_format_uint64(end, integer < 0 ? (uint64_t)0 - (uint64_t)integer : (uint64_t)integer);
+        if (integer < 0)
+            *--start = '-';
+    }
+    else if (fabs(value) < 1.0e6)
+    {
+        for (int decimals = 1; decimals <= 9 && !start; decimals++)
+        {
+            int64_t scaled = llround(value * cbor_powers_of_ten[decimals]);
+
+            if ((double)scaled / cbor_powers_of_ten[decimals] != value)
+                continue;
+
+            uint64_t u = scaled < 0 ? (uint64_t)0 - (uint64_t)scaled : (uint64_t)scaled;
+            uint64_t p10 = (uint64_t)cbor_powers_of_ten[decimals];
+            uint64_t fraction = u % p10;
+
+            start = end;
+            for (int k = 0; k < decimals; k++)
+            {
+                *--start = (char)('0' + fraction % 10);
+                fraction /= 10;
+            }
+
+            *--start = '.';
+            start = cbor_format_uint64(start, u / p10);
+            if (scaled < 0)
+                *--start = '-';
+        }
+    }
+
+    if (start)
+    {
+        size_t len = (size_t)(end - start);
+        memmove(out, start, len);
+        return len;
+    }
+
+    int len = snprintf(out, capacity, "%.15g", value);
+
+    if (strtod(out, NULL) != value)
+        len = snprintf(out, capacity, "%.17g", value);
+
+    return (size_t)len;
+}
+
+/* Base64url without padding (RFC 8949 section 6.1); returns the length */
+static size_t cbor_base64url(const uint8_t *data, size_t len, char *out)
+{
+    unsigned long written = 0;
+
+    base64_encode(data, (unsigned long)len, out, &written);
+
+    while (written > 0 && out[written - 1] == '=')
+        written--;
+
+    for (unsigned long i = 0; i < written; i++)
+    {
+        if (out[i] == '+')
+            out[i] = '-';
+        else if (out[i] == '/')
+            out[i] = '_';
+    }
+
+    return (size_t)written;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Reader                                                                    */
+/* ------------------------------------------------------------------------- */
+
+void cbor_reader_init(cbor_reader_t *reader, const uint8_t *data, size_t length)
+{
+    if (!reader)
+        return;
+
+    reader->data = data;
+    reader->length = data ? length : 0;
+    reader->offset = 0;
+    reader->error = false;
+    reader->after_tag = false;
+    reader->depth = 0;
+}
+
+static bool cbor_reader_argument(cbor_reader_t *r, uint8_t info, uint64_t *value)
+{
+    size_t n;
+
+    if (info < 24)
+    {
+        *value = info;
+        return true;
+    }
+
+    switch (info)
+    {
+        case 24: n = 1; break;
+        case 25: n = 2; break;
+        case 26: n = 4; break;
+        case 27: n = 8; break;
+        default: return false;
+    }
+
+    if (r->length - r->offset < n)
+        return false;
+
+    uint64_t v = 0;
+
+    for (size_t i = 0; i < n; i++)
+        v = (v << 8) | r->data[r->offset + i];
+
+    r->offset += n;
+    *value = v;
+    return true;
+}
+
+static bool cbor_reader_fail(cbor_reader_t *r, size_t offset)
+{
+    r->offset = offset;
+    r->error = true;
+    return false;
+}
+
+bool cbor_reader_next(cbor_reader_t *reader, cbor_item_t *item)
+{
+    if (!reader || !item || reader->error)
+        return false;
+
+    cbor_reader_t *r = reader;
+    size_t start = r->offset;
+
+    item->value = 0;
+    item->real = 0;
+    item->data = NULL;
+    item->length = 0;
+
+    /* A definite container ends after its last item */
+    if (r->depth > 0 && r->stack[r->depth - 1].remaining == 0)
+    {
+        if (r->after_tag)
+            return cbor_reader_fail(r, start);
+
+        r->depth--;
+        item->type = CBOR_ITEM_END;
+        return true;
+    }
+
+    if (r->offset == r->length)
+    {
+        if (r->depth > 0 || r->after_tag)
+            return cbor_reader_fail(r, start);
+
+        return false;
+    }
+
+    uint8_t initial = r->data[r->offset++];
+    uint8_t major = initial >> 5;
+    uint8_t info = initial & 0x1F;
+    uint64_t value = 0;
+    bool indefinite = false;
+
+    if (initial == CBOR_BREAK)
+    {
+        if (r->depth == 0 || r->after_tag || r->stack[r->depth - 1].remaining != CBOR_INDEFINITE || r->stack[r->depth - 1].odd)
+            return cbor_reader_fail(r, start);
+
+        r->depth--;
+        item->type = CBOR_ITEM_END;
+        return true;
+    }
+
+    if (info == 31)
+    {
+        if (major != CBOR_MAJOR_ARRAY && major != CBOR_MAJOR_MAP)
+            return cbor_reader_fail(r, start);
+
+        indefinite = true;
+        value = CBOR_INDEFINITE;
+    }
+    else if (major != CBOR_MAJOR_SIMPLE && !cbor_reader_argument(r, info, &value))
+    {
+        return cbor_reader_fail(r, start);
+    }
+
+    size_t left = r->length - r->offset;
+    item->value = value;
+
+    switch (major)
+    {
+        case CBOR_MAJOR_UNSIGNED:
+            item->type = CBOR_ITEM_UNSIGNED;
+            break;
+
+        case CBOR_MAJOR_NEGATIVE:
+            item->type = CBOR_ITEM_NEGATIVE;
+            break;
+
+        case CBOR_MAJOR_BYTES:
+        case CBOR_MAJOR_TEXT:
+            if (value > left)
+                return cbor_reader_fail(r, start);
+
+            item->type = major == CBOR_MAJOR_BYTES ? CBOR_ITEM_BYTES : CBOR_ITEM_TEXT;
+            item->data = r->data + r->offset;
+            item->length = (size_t)value;
+            r->offset += (size_t)value;
+            break;
+
+        case CBOR_MAJOR_ARRAY:
+        case CBOR_MAJOR_MAP:
+            /* Every item takes at least a byte, which bounds the count */
+            if (!indefinite && value > (major == CBOR_MAJOR_MAP ? left / 2 : left))
+                return cbor_reader_fail(r, start);
+
+            item->type = major == CBOR_MAJOR_MAP ? CBOR_ITEM_MAP : CBOR_ITEM_ARRAY;
+            break;
+
+        case CBOR_MAJOR_TAG:
+            item->type = CBOR_ITEM_TAG;
+            r->after_tag = true;
+            return true;
+
+        default:
+            if (info < 20)
+            {
+                item->type = CBOR_ITEM_SIMPLE;
+                item->value = info;
+            }
+            else if (info <= 23)
+            {
+                static const cbor_item_type_t simple[] = { CBOR_ITEM_FALSE, CBOR_ITEM_TRUE, CBOR_ITEM_NULL, CBOR_ITEM_UNDEFINED };
+                item->type = simple[info - 20];
+            }
+            else if (info <= 27 && cbor_reader_argument(r, info, &value))
+            {
+                if (info == 24)
+                {
+                    /* Two byte forms of the values below 32 are not well formed */
+                    if (value < 32)
+                        return cbor_reader_fail(r, start);
+
+                    item->type = CBOR_ITEM_SIMPLE;
+                    item->value = value;
+                    break;
+                }
+
+                item->type = CBOR_ITEM_FLOAT;
+
+                if (info == 25)
+                {
+                    item->real = cbor_half_to_double((uint16_t)value);
+                }
+                else if (info == 26)
+                {
+                    uint32_t bits = (uint32_t)value;
+                    float f;
+                    memcpy(&f, &bits, sizeof(f));
+                    item->real = f;
+                }
+                else
+                {
+                    memcpy(&item->real, &value, sizeof(item->real));
+                }
+
+                item->value = 0;
+            }
+            else
+            {
+                return cbor_reader_fail(r, start);
+            }
+            break;
+    }
+
+    r->after_tag = false;
+
+    if (r->depth > 0)
+    {
+        if (r->stack[r->depth - 1].remaining == CBOR_INDEFINITE)
+            r->stack[r->depth - 1].odd = r->stack[r->depth - 1].map && !r->stack[r->depth - 1].odd;
+        else
+            r->stack[r->depth - 1].remaining--;
+    }
+
+    if (item->type == CBOR_ITEM_ARRAY || item->type == CBOR_ITEM_MAP)
+    {
+        if (r->depth == CBOR_MAX_DEPTH)
+            return cbor_reader_fail(r, start);
+
+        r->stack[r->depth].map = item->type == CBOR_ITEM_MAP;
+        r->stack[r->depth].odd = false;
+        r->stack[r->depth].remaining = indefinite ? CBOR_INDEFINITE : (item->type == CBOR_ITEM_MAP ? value * 2 : value);
+        r->depth++;
+    }
+
+    return true;
+}
+
+bool cbor_reader_skip(cbor_reader_t *reader, const cbor_item_t *item)
+{
+    if (!reader || !item)
+        return false;
+
+    cbor_item_t next = *item;
+
+    while (next.type == CBOR_ITEM_TAG)
+    {
+        if (!cbor_reader_next(reader, &next))
+            return false;
+    }
+
+    if (next.type != CBOR_ITEM_ARRAY && next.type != CBOR_ITEM_MAP)
+        return true;
+
+    size_t depth = reader->depth - 1;
+
+    while (cbor_reader_next(reader, &next))
+    {
+        if (next.type == CBOR_ITEM_END && reader->depth == depth)
+            return true;
+    }
+
+    return false;
+}
+
+bool cbor_reader_has_error(const cbor_reader_t *reader)
+{
+    return !reader || reader->error;
+}
+
+size_t cbor_reader_get_offset(const cbor_reader_t *reader)
+{
+    return reader ? reader->offset : 0;
+}
+
+bool cbor_item_get_int64(const cbor_item_t *item, int64_t *value)
+{
+    if (!item || !value || item->value > (uint64_t)INT64_MAX)
+        return false;
+
+    if (item->type == CBOR_ITEM_UNSIGNED)
+        *value = (int64_t)item->value;
+    else if (item->type == CBOR_ITEM_NEGATIVE)
+        *value = -1 - (int64_t)item->value;
+    else
+        return false;
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* JSON Events                                                               */
+/* ------------------------------------------------------------------------- */
+
+/* Map keys other than text are given as their JSON text */
+static bool cbor_key_text(const cbor_item_t *item, char *tmp, size_t capacity, const char **key, size_t *len)
+{
+    char *end = tmp + capacity;
+    char *start;
+
+    switch (item->type)
+    {
+        case CBOR_ITEM_TEXT:
+            *key = (const char *)item->data;
+            *len = item->length;
+            return true;
+
+        case CBOR_ITEM_UNSIGNED:
+            start = cbor_format_uint64(end, item->value);
+            break;
+
+        case CBOR_ITEM_NEGATIVE:
+            start = cbor_format_negative(end, item->value);
+            break;
+
+        default:
+            return false;
+    }
+
+    *key = start;
+    *len = (size_t)(end - start);
+    return true;
+}
+
+json_sax_status_t cbor_parse_sax(const uint8_t *data, size_t length, const json_sax_handler_t *handler, void *context)
+{
+    cbor_reader_t *reader = (cbor_reader_t *)malloc(sizeof(cbor_reader_t));
+    bool expect_key[CBOR_MAX_DEPTH];
+    json_sax_status_t status = JSON_SAX_OK;
+    char tmp[40];
+    char small[256];
+    cbor_item_t item;
+    bool ok = true;
+
+    if (!reader || !handler)
+    {
+        free(reader);
+        return JSON_SAX_ERROR;
+    }
+
+    cbor_reader_init(reader, data, length);
+
+    while (ok && cbor_reader_next(reader, &item))
+    {
+        size_t depth = reader->depth;
+
+        if (item.type == CBOR_ITEM_TAG)
+            continue;
+
+        if (item.type == CBOR_ITEM_END)
+        {
+            /* The reader has already left the container */
+            if (reader->stack[depth].map)
+                ok = !handler->on_end_object || handler->on_end_object(context);
+            else
+                ok = !handler->on_end_array || handler->on_end_array(context);
+        }
+        else
+        {
+            bool container = item.type == CBOR_ITEM_ARRAY || item.type == CBOR_ITEM_MAP;
+            size_t parent = container ? depth - 1 : depth;
+
+            if (parent > 0 && reader->stack[parent - 1].map && expect_key[parent - 1])
+            {
+                const char *key;
+                size_t len;
+
+                if (container || !cbor_key_text(&item, tmp, sizeof(tmp), &key, &len))
+                {
+                    status = JSON_SAX_ERROR;
+                    break;
+                }
+
+                expect_key[parent - 1] = false;
+                ok = !handler->on_key || handler->on_key(context, key, len);
+                continue;
+            }
+
+            char *end = tmp + sizeof(tmp);
+            char *start;
+
+            switch (item.type)
+            {
+                case CBOR_ITEM_UNSIGNED:
+                    start = cbor_format_uint64(end, item.value);
+                    ok = !handler->on_number || handler->on_number(context, start, (size_t)(end - start));
+                    break;
+
+                case CBOR_ITEM_NEGATIVE:
+                    start = cbor_format_negative(end, item.value);
+                    ok = !handler->on_number || handler->on_number(context, start, (size_t)(end - start));
+                    break;
+
+                case CBOR_ITEM_FLOAT:
+                    if (isfinite(item.real))
+                        ok = !handler->on_number || handler->on_number(context, tmp, cbor_format_double(tmp, sizeof(tmp), item.real));
+                    else
+                        ok = !handler->on_null || handler->on_null(context);
+                    break;
+
+                case CBOR_ITEM_TEXT:
+                    ok = !handler->on_string || handler->on_string(context, (const char *)item.data, item.length);
+                    break;
+
+                case CBOR_ITEM_BYTES:
+                    if (handler->on_string)
+                    {
+                        size_t need = base64_encoded_length((unsigned long)item.length) + 1;
+                        char *text = need <= sizeof(small) ? small : (char *)malloc(need);
+
+                        if (!text)
+                        {
+                            status = JSON_SAX_ERROR;
+                            break;
+                        }
+
+                        ok = handler->on_string(context, text, cbor_base64url(item.data, item.length, text));
+
+                        if (text != small)
+                            free(text);
+                    }
+                    break;
+
+                case CBOR_ITEM_ARRAY:
+                    expect_key[depth - 1] = false;
+                    ok = !handler->on_start_array || handler->on_start_array(context);
+                    break;
+
+                case CBOR_ITEM_MAP:
+                    expect_key[depth - 1] = true;
+                    ok = !handler->on_start_object || handler->on_start_object(context);
+                    break;
+
+                case CBOR_ITEM_FALSE:
+                case CBOR_ITEM_TRUE:
+                    ok = !handler->on_boolean || handler->on_boolean(context, item.type == CBOR_ITEM_TRUE);
+                    break;
+
+                default:
+                    ok = !handler->on_null || handler->on_null(context);
+                    break;
+            }
+
+            if (status != JSON_SAX_OK)
+                break;
+
+            if (container)
+                continue;
+        }
+
+        /* A value is complete: the enclosing map wants a key next */
+        if (reader->depth > 0 && reader->stack[reader->depth - 1].map)
+            expect_key[reader->depth - 1] = true;
+
+        if (ok && reader->depth == 0 && handler->on_document_end)
+            ok = handler->on_document_end(context);
+    }
+
+    if (status == JSON_SAX_OK)
+    {
+        if (!ok)
+            status = JSON_SAX_ABORTED;
+        else if (cbor_reader_has_error(reader))
+            status = JSON_SAX_ERROR;
+    }
+
+    free(reader);
+    return status;
+}
+
+bool cbor_to_json(const uint8_t *data, size_t length, json_writer_t *writer)
+{
+    cbor_reader_t *reader = (cbor_reader_t *)malloc(sizeof(cbor_reader_t));
+    bool expect_key[CBOR_MAX_DEPTH];
+    char tmp[40];
+    char small[256];
+    cbor_item_t item;
+    bool ok = true;
+
+    if (!reader || !writer)
+    {
+        free(reader);
+        return false;
+    }
+
+    cbor_reader_init(reader, data, length);
+
+    while (ok && cbor_reader_next(reader, &item))
+    {
+        size_t depth = reader->depth;
+
+        if (item.type == CBOR_ITEM_TAG)
+            continue;
+
+        if (item.type == CBOR_ITEM_END)
+        {
+            ok = reader->stack[depth].map ? json_writer_end_object(writer) : json_writer_end_array(writer);
+        }
+        else
+        {
+            bool container = item.type == CBOR_ITEM_ARRAY || item.type == CBOR_ITEM_MAP;
+            size_t parent = container ? depth - 1 : depth;
+
+            if (parent > 0 && reader->stack[parent - 1].map && expect_key[parent - 1])
+            {
+                const char *key;
+                size_t len;
+
+                ok = !container && cbor_key_text(&item, tmp, sizeof(tmp), &key, &len) && json_writer_key_length(writer, key, len);
+                expect_key[parent - 1] = false;
+                continue;
+            }
+
+            char *end = tmp + sizeof(tmp);
+            char *start;
+
+            switch (item.type)
+            {
+                case CBOR_ITEM_UNSIGNED:
+                    ok = json_writer_uint64(writer, item.value);
+                    break;
+
+                case CBOR_ITEM_NEGATIVE:
+                    start = cbor_format_negative(end, item.value);
+                    ok = json_writer_number_text(writer, start, (size_t)(end - start));
+                    break;
+
+                case CBOR_ITEM_FLOAT:
+                    ok = json_writer_double(writer, item.real);
+                    break;
+
+                case CBOR_ITEM_TEXT:
+                    ok = json_writer_string_length(writer, (const char *)item.data, item.length);
+                    break;
+
+                case CBOR_ITEM_BYTES:
+                {
+                    size_t need = base64_encoded_length((unsigned long)item.length) + 1;
+                    char *text = need <= sizeof(small) ? small : (char *)malloc(need);
+
+                    ok = text && json_writer_string_length(writer, text, cbor_base64url(item.data, item.length, text));
+
+                    if (text != small)
+                        free(text);
+                    break;
+                }
+
+                case CBOR_ITEM_ARRAY:
+                    expect_key[depth - 1] = false;
+                    ok = json_writer_begin_array(writer);
+                    break;
+
+                case CBOR_ITEM_MAP:
+                    expect_key[depth - 1] = true;
+                    ok = json_writer_begin_object(writer);
+                    break;
+
+                case CBOR_ITEM_FALSE:
+                case CBOR_ITEM_TRUE:
+                    ok = json_writer_boolean(writer, item.type == CBOR_ITEM_TRUE);
+                    break;
+
+                default:
+                    ok = json_writer_null(writer);
+                    break;
+            }
+
+            if (container)
+                continue;
+        }
+
+        if (reader->depth > 0 && reader->stack[reader->depth - 1].map)
+            expect_key[reader->depth - 1] = true;
+    }
+
+    ok = ok && !cbor_reader_has_error(reader);
+    free(reader);
+    return ok;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Writer Output                                                             */
+/* ------------------------------------------------------------------------- */
+
+static bool writer_drain(cbor_writer_t *w)
+{
+    if (!w->buffer)
+    {
+        w->error = true;
+        return false;
+    }
+
+    if (w->pos > 0 && !buffer_append(w->buffer, w->out, w->pos))
+    {
+        w->error = true;
+        return false;
+    }
+
+    w->pos = 0;
+    return true;
+}
+
+static bool writer_put(cbor_writer_t *w, const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    w->length += len;
+
+    if (w->error)
+        return false;
+
+    if (w->capacity - w->pos >= len)
+    {
+        memcpy(w->out + w->pos, bytes, len);
+        w->pos += len;
+        return true;
+    }
+
+    /* Large pieces skip the stage */
+    if (w->buffer && len > w->capacity)
+    {
+        if (!writer_drain(w))
+            return false;
+
+        if (!buffer_append(w->buffer, bytes, len))
+        {
+            w->error = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    while (len > 0)
+    {
+        if (w->pos == w->capacity && !writer_drain(w))
+            return false;
+
+        size_t n = w->capacity - w->pos < len ? w->capacity - w->pos : len;
+        memcpy(w->out + w->pos, bytes, n);
+        w->pos += n;
+        bytes += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+/* Initial byte plus the shortest argument for 'value' */
+static bool writer_head(cbor_writer_t *w, uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    size_t n;
+
+    major = (uint8_t)(major << 5);
+
+    if (value < 24)
+    {
+        head[0] = (uint8_t)(major | value);
+        n = 1;
+    }
+    else if (value <= 0xFF)
+    {
+        head[0] = (uint8_t)(major | 24);
+        head[1] = (uint8_t)value;
+        n = 2;
+    }
+    else if (value <= 0xFFFF)
+    {
+        head[0] = (uint8_t)(major | 25);
+        head[1] = (uint8_t)(value >> 8);
+        head[2] = (uint8_t)value;
+        n = 3;
+    }
+    else if (value <= 0xFFFFFFFFu)
+    {
+        head[0] = (uint8_t)(major | 26);
+        for (int i = 0; i < 4; i++)
+            head[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+        n = 5;
+    }
+    else
+    {
+        head[0] = (uint8_t)(major | 27);
+        for (int i = 0; i < 8; i++)
+            head[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+        n = 9;
+    }
+
+    return writer_put(w, head, n);
+}
+
+/* Accounts for a complete item (or the start of a container) in its parent */
+static bool writer_item_done(cbor_writer_t *w)
+{
+    w->after_tag = false;
+
+    if (w->depth == 0)
+        return !w->error;
+
+    cbor_writer_frame_t *frame = &w->stack[w->depth - 1];
+
+    if (frame->remaining == CBOR_INDEFINITE)
+        frame->odd = frame->map && !frame->odd;
+    else
+        frame->remaining--;
+
+    return !w->error;
+}
+
+/* Definite containers close themselves once full */
+static void writer_close_full(cbor_writer_t *w)
+{
+    while (w->depth > 0 && w->stack[w->depth - 1].remaining == 0)
+        w->depth--;
+}
+
+static bool writer_scalar_done(cbor_writer_t *w)
+{
+    bool ok = writer_item_done(w);
+    writer_close_full(w);
+    return ok;
+}
+
+static bool writer_begin(cbor_writer_t *w, uint8_t major, uint64_t count)
+{
+    if (w->error)
+        return false;
+
+    if (w->depth == CBOR_MAX_DEPTH || (count != CBOR_INDEFINITE && major == CBOR_MAJOR_MAP && count > UINT64_MAX / 2 - 1))
+    {
+        w->error = true;
+        return false;
+    }
+
+    if (count == CBOR_INDEFINITE)
+    {
+        uint8_t initial = (uint8_t)((major << 5) | 31);
+
+        if (!writer_put(w, &initial, 1))
+            return false;
+    }
+    else if (!writer_head(w, major, count))
+    {
+        return false;
+    }
+
+    writer_item_done(w);
+
+    cbor_writer_frame_t *frame = &w->stack[w->depth++];
+    frame->map = major == CBOR_MAJOR_MAP;
+    frame->odd = false;
+    frame->remaining = count == CBOR_INDEFINITE ? CBOR_INDEFINITE : (frame->map ? count * 2 : count);
+
+    writer_close_full(w);
+    return !w->error;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Writer API                                                                */
+/* ------------------------------------------------------------------------- */
+
+static cbor_writer_t *writer_new(void)
+{
+    cbor_writer_t *w = (cbor_writer_t *)malloc(sizeof(cbor_writer_t));
+    if (!w)
+        return NULL;
+
+    w->buffer = NULL;
+    w->out = NULL;
+    w->capacity = 0;
+
+    cbor_writer_reset(w);
+    return w;
+}
+
+cbor_writer_t *cbor_writer_allocate(buffer_t *buffer)
+{
+    if (!buffer)
+        return NULL;
+
+    cbor_writer_t *w = writer_new();
+    if (!w)
+        return NULL;
+
+    w->buffer = buffer;
+    w->out = w->stage;
+    w->capacity = sizeof(w->stage);
+    return w;
+}
+
+cbor_writer_t *cbor_writer_allocate_fixed(uint8_t *out, size_t capacity)
+{
+    if (!out || capacity == 0)
+        return NULL;
+
+    cbor_writer_t *w = writer_new();
+    if (!w)
+        return NULL;
+
+    w->out = out;
+    w->capacity = capacity;
+    return w;
+}
+
+void cbor_writer_free(cbor_writer_t *writer)
+{
+    if (!writer)
+        return;
+
+    cbor_writer_flush(writer);
+    free(writer);
+}
+
+void cbor_writer_reset(cbor_writer_t *writer)
+{
+    if (!writer)
+        return;
+
+    writer->pos = 0;
+    writer->length = 0;
+    writer->error = false;
+    writer->after_tag = false;
+    writer->depth = 0;
+}
+
+bool cbor_writer_begin_array(cbor_writer_t *writer, uint64_t count)
+{
+    if (!writer)
+        return false;
+
+    return writer_begin(writer, CBOR_MAJOR_ARRAY, count);
+}
+
+bool cbor_writer_begin_map(cbor_writer_t *writer, uint64_t count)
+{
+    if (!writer)
+        return false;
+
+    return writer_begin(writer, CBOR_MAJOR_MAP, count);
+}
+
+bool cbor_writer_end(cbor_writer_t *writer)
+{
+    static const uint8_t brk = CBOR_BREAK;
+
+    if (!writer || writer->error)
+        return false;
+
+    if (writer->depth == 0 || writer->after_tag || writer->stack[writer->depth - 1].remaining != CBOR_INDEFINITE ||
+        writer->stack[writer->depth - 1].odd)
+    {
+        writer->error = true;
+        return false;
+    }
+
+    writer->depth--;
+    writer_close_full(writer);
+    return writer_put(writer, &brk, 1);
+}
+
+bool cbor_writer_uint64(cbor_writer_t *writer, uint64_t value)
+{
+    if (!writer || !writer_head(writer, CBOR_MAJOR_UNSIGNED, value))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_negative(cbor_writer_t *writer, uint64_t value)
+{
+    if (!writer || !writer_head(writer, CBOR_MAJOR_NEGATIVE, value))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_int64(cbor_writer_t *writer, int64_t value)
+{
+    if (value < 0)
+        return cbor_writer_negative(writer, (uint64_t)(-1 - value));
+
+    return cbor_writer_uint64(writer, (uint64_t)value);
+}
+
+bool cbor_writer_double(cbor_writer_t *writer, double value)
+{
+    uint8_t out[9];
+    size_t n;
+    uint16_t half;
+    float single = (float)value;
+
+    if (!writer)
+        return false;
+
+    /* Half precision is only worth trying for values that fit a float */
+    if (((double)single == value || isnan(value)) && cbor_double_to_half(value, &half))
+    {
+        out[0] = 0xF9;
+        out[1] = (uint8_t)(half >> 8);
+        out[2] = (uint8_t)half;
+        n = 3;
+    }
+    else if ((double)single == value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        out[0] = 0xFA;
+        for (int i = 0; i < 4; i++)
+            out[1 + i] = (uint8_t)(bits >> (24 - 8 * i));
+        n = 5;
+    }
+    else
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out[0] = 0xFB;
+        for (int i = 0; i < 8; i++)
+            out[1 + i] = (uint8_t)(bits >> (56 - 8 * i));
+        n = 9;
+    }
+
+    if (!writer_put(writer, out, n))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_boolean(cbor_writer_t *writer, bool value)
+{
+    uint8_t initial = value ? 0xF5 : 0xF4;
+
+    if (!writer || !writer_put(writer, &initial, 1))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_null(cbor_writer_t *writer)
+{
+    static const uint8_t initial = 0xF6;
+
+    if (!writer || !writer_put(writer, &initial, 1))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_text_length(cbor_writer_t *writer, const char *text, size_t len)
+{
+    if (!writer || !text)
+        return false;
+
+    if (!writer_head(writer, CBOR_MAJOR_TEXT, len) || !writer_put(writer, text, len))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_text(cbor_writer_t *writer, const char *text)
+{
+    if (!text)
+        return false;
+
+    return cbor_writer_text_length(writer, text, strlen(text));
+}
+
+bool cbor_writer_bytes(cbor_writer_t *writer, const void *data, size_t len)
+{
+    if (!writer || (!data && len > 0))
+        return false;
+
+    if (!writer_head(writer, CBOR_MAJOR_BYTES, len) || (len > 0 && !writer_put(writer, data, len)))
+        return false;
+
+    return writer_scalar_done(writer);
+}
+
+bool cbor_writer_tag(cbor_writer_t *writer, uint64_t tag)
+{
+    if (!writer || writer->error)
+        return false;
+
+    if (!writer_head(writer, CBOR_MAJOR_TAG, tag))
+        return false;
+
+    writer->after_tag = true;
+    return true;
+}
+
+/* Integers keep every digit, including those past int64 */
+static bool writer_json_number(cbor_writer_t *writer, json_node_t *node)
+{
+    int64_t integer;
+    double real;
+
+    if (json_node_is_integer(node) && json_node_get_int64(node, &integer))
+        return cbor_writer_int64(writer, integer);
+
+    const char *text = json_node_get_text(node);
+    bool negative = *text == '-';
+    const char *digits = text + negative;
+    uint64_t value = 0;
+    bool exact = *digits != '\0';
+
+    for (const char *p = digits; *p && exact; p++)
+    {
+        uint64_t digit = (uint64_t)(*p - '0');
+
+        if (*p < '0' || *p > '9' || value > (UINT64_MAX - digit) / 10)
+            exact = false;
+        else
+            value = value * 10 + digit;
+    }
+
+    /* -0 and -18446744073709551616 are fine, the rest of the range too */
+    if (exact && negative && value > 0)
+        return cbor_writer_negative(writer, value - 1);
+
+    if (exact && !negative)
+        return cbor_writer_uint64(writer, value);
+
+    if (negative && strcmp(digits, "18446744073709551616") == 0)
+        return cbor_writer_negative(writer, UINT64_MAX);
+
+    if (!json_node_get_double(node, &real))
+        return false;
+
+    return cbor_writer_double(writer, real);
+}
+
+bool cbor_writer_json_node(cbor_writer_t *writer, json_node_t *node)
+{
+    if (!writer || !node)
+        return false;
+
+    const char *text = json_node_get_text(node);
+    json_node_t *child = json_node_first_child_element(node, NULL);
+
+    switch (json_node_type(node))
+    {
+        case JSON_NODE_DOCUMENT:
+            return cbor_writer_json_node(writer, child);
+
+        case JSON_NODE_OBJECT:
+            if (!cbor_writer_begin_map(writer, json_node_get_child_count(node)))
+                return false;
+
+            for (; child; child = json_node_next_sibling_element(child, NULL))
+            {
+                if (!cbor_writer_text(writer, json_node_name(child)) || !cbor_writer_json_node(writer, child))
+                    return false;
+            }
+
+            return !writer->error;
+
+        case JSON_NODE_ARRAY:
+            if (!cbor_writer_begin_array(writer, json_node_get_child_count(node)))
+                return false;
+
+            for (; child; child = json_node_next_sibling_element(child, NULL))
+            {
+                if (!cbor_writer_json_node(writer, child))
+                    return false;
+            }
+
+            return !writer->error;
+
+        case JSON_NODE_STRING:
+            return cbor_writer_text(writer, text);
+
+        case JSON_NODE_NUMBER:
+            return writer_json_number(writer, node);
+
+        case JSON_NODE_BOOLEAN:
+            return cbor_writer_boolean(writer, text[0] == 't');
+
+        case JSON_NODE_NULL:
+            return cbor_writer_null(writer);
+
+        default:
+            return false;
+    }
+}
+
+bool cbor_writer_flush(cbor_writer_t *writer)
+{
+    if (!writer || writer->error)
+        return false;
+
+    if (!writer->buffer)
+        return true;
+
+    return writer_drain(writer);
+}
+
+size_t cbor_writer_get_length(const cbor_writer_t *writer)
+{
+    return writer ? writer->length : 0;
+}
+
+bool cbor_writer_has_error(const cbor_writer_t *writer)
+{
+    return !writer || writer->error;
+}
+
+bool cbor_from_json(const char *json, size_t length, buffer_t *out)
+{
+    if (!json || !out)
+        return false;
+
+    json_document_t *doc = json_parse_string_length(json, length);
+    if (!doc)
+        return false;
+
+    cbor_writer_t *writer = cbor_writer_allocate(out);
+    bool ok = writer && cbor_writer_json_node(writer, json_document_root(doc)) && cbor_writer_flush(writer);
+
+    cbor_writer_free(writer);
+    json_free_document(doc);
+    return ok;
+}
@@ -37,32 +37,187 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <limits.h>
 #include <float.h>
 #include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#define CONFIGURATION_MIN_SLOTS 16
+
+#define CONFIG_TYPE_INTEGER  0x01
+#define CONFIG_TYPE_REAL     0x02
+#define CONFIG_TYPE_BOOLEAN  0x04
+#define CONFIG_TYPE_SIZE     0x08
+#define CONFIG_TYPE_DURATION 0x10
+
+/* Offset of an absent value, and item_first of a value without commas */
+#define CONFIG_NO_VALUE    UINT32_MAX
+#define CONFIG_SCALAR_ITEM UINT32_MAX
+
+#define CONFIG_IMAGE_MAGIC   "TRZCONF"
+#define CONFIG_IMAGE_VERSION 1
+#define CONFIG_IMAGE_ORDER   0x01020304u
 
-typedef struct key_value_t
-{
-    char* key;
-    char* value;
-    struct key_value_t* next;
-}key_value_t;
+/*
+  Snapshot records hold no pointers: strings are offsets into the snapshot
+  text and records refer to each other by index + 1 (0 means none). This
+  lets a compiled image be mapped and used as it is.
+*/
 
-typedef struct section_t
+/* A value converted to every type it can be read as */
+typedef struct config_item_t
+{
+    long integer;
+    double real;
+    uint64_t size;
+    int64_t duration;
+    uint32_t text;
+    bool boolean;
+    uint8_t types;
+}config_item_t;
+
+typedef struct config_entry_t
+{
+    uint32_t key;
+    uint32_t value;
+    uint32_t hash;
+    uint32_t section;
+    uint32_t next;
+    uint32_t item_first;
+    uint32_t item_count;
+    uint32_t reserved;
+    config_item_t scalar;
+}config_entry_t;
+
+typedef struct config_section_t
+{
+    uint32_t name;
+    uint32_t hash;
+    uint32_t first;
+    uint32_t last;
+}config_section_t;
+
+/* Immutable once published. 'text' is a copy of the file content
+   tokenized in place, followed by a second copy in which array values are
+   split when any value has commas. 'source' keeps the content as read so
+   a reload can tell whether anything changed. */
+typedef struct config_snapshot_t
+{
+    char* source;
+    size_t source_size;
+    uint32_t source_hash;
+    char* text;
+    size_t text_size;
+
+    config_section_t* sections;
+    uint32_t section_count;
+    uint32_t* section_slots;
+    uint32_t section_mask;
+
+    config_entry_t* entries;
+    uint32_t entry_count;
+    uint32_t* entry_slots;
+    uint32_t entry_mask;
+
+    config_item_t* items;
+    uint32_t item_count;
+
+    /* Set when everything above points into a mapped image */
+    void* mapping;
+    size_t mapping_size;
+
+    /* What handles bound to an absent key resolve to */
+    config_entry_t missing;
+
+    struct config_snapshot_t* retired;
+}config_snapshot_t;
+
+/* Compiled image layout: this header, then the arrays at 8 byte aligned
+   offsets. Images are only meant for the machine that wrote them. */
+typedef struct config_image_header_t
 {
-    char* section_name;
-    long key_value_count;
-    key_value_t* key_value_list;
-    struct section_t* next;
-}section_t;
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t layout;
+    uint32_t source_hash;
+    uint64_t image_size;
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t text_size;
+    uint32_t section_count;
+    uint32_t section_mask;
+    uint32_t entry_count;
+    uint32_t entry_mask;
+    uint32_t item_count;
+    uint32_t reserved;
+    uint64_t source_offset;
+    uint64_t text_offset;
+    uint64_t sections_offset;
+    uint64_t section_slots_offset;
+    uint64_t entries_offset;
+    uint64_t entry_slots_offset;
+    uint64_t items_offset;
+    uint32_t header_hash;
+    uint32_t padding;
+}config_image_header_t;
 
 typedef struct configuration_t
 {
-    long section_count;
-    section_t* section_list;
+    _Atomic(config_snapshot_t*) current;
+    _Atomic uint64_t generation;
+    char* filename;
+    char* cache_filename;
+    pthread_mutex_t reload_lock;
+    config_snapshot_t* retired;
+
+    bool watching;
+    pthread_t watcher;
+    int watch_fd;
+    int stop_pipe[2];
+    configuration_reload_callback callback;
+    void* callback_context;
 }configuration_t;
 
-void configuration_internal_add_section(configuration_t* conf_ptr, const char* section_name);
-void configuration_internal_add_key_value(configuration_t* conf_ptr, const char* section_name, const char* key, const char* value);
-const section_t* configuration_internal_get_section(const configuration_t* conf_ptr, const char *section_name);
-const char* configuration_internal_get_value(const configuration_t *conf_ptr, const section_t* section, const char *key);
+typedef struct configuration_value_t
+{
+    configuration_t* config;
+    char* section;
+    char* key;
+    /* Entry of whichever snapshot was current at the last read */
+    _Atomic(const config_entry_t*) cached;
+}configuration_value_t;
+
+static uint32_t configuration_internal_hash(const char* str, size_t len);
+static uint32_t configuration_internal_key_hash(uint32_t section, const char* key, size_t len);
+static bool configuration_internal_read_file(const char* filename, char** text, size_t* size, struct stat* st);
+static config_snapshot_t* configuration_internal_build(char* source, size_t size);
+static configuration_t* configuration_internal_allocate(const char* filename, const char* cache_filename, config_snapshot_t* snap);
+static bool configuration_internal_write_image(const config_snapshot_t* snap, const char* cache_filename, const struct stat* source_stat);
+static config_snapshot_t* configuration_internal_map_image(const char* cache_filename, const struct stat* source_stat);
+static void configuration_internal_free_snapshot(config_snapshot_t* snap);
+static bool configuration_internal_grow_sections(config_snapshot_t* snap);
+static bool configuration_internal_index_entries(config_snapshot_t* snap);
+static uint32_t configuration_internal_add_section(config_snapshot_t* snap, uint32_t name, size_t len, size_t* capacity);
+static bool configuration_internal_add_key_value(config_snapshot_t* snap, uint32_t section, uint32_t key, uint32_t value, size_t* capacity);
+static const config_section_t* configuration_internal_get_section(const config_snapshot_t* snap, const char* section_name);
+static const config_snapshot_t* configuration_internal_snapshot(const configuration_t* config);
+static const config_entry_t* configuration_internal_get_entry(const config_snapshot_t* snap, const char* section_name, const char* key);
+static const char* configuration_internal_get_value(const configuration_t* config, const char* section_name, const char* key);
+static bool configuration_internal_type_entries(config_snapshot_t* snap);
+static const config_entry_t* configuration_internal_resolve(const configuration_value_t* value, const config_snapshot_t** snap_out);
+static const config_item_t* configuration_internal_get_item(const config_snapshot_t* snap, const config_entry_t* entry, size_t index);
 
 configuration_t* configuration_allocate_default(void)
 {
@@ -117,87 +272,124 @@ configuration_t* configuration_allocate(const char* filename)
         return NULL;
     }
 
-    configuration_t* ptr = NULL;
-    FILE* fp = fopen(filename, "r");
+    char* text = NULL;
+    size_t size = 0;
+    struct stat st;
+
+    if (!configuration_internal_read_file(filename, &text, &size, &st))
+    {
+        return NULL;
+    }
+
+    config_snapshot_t* snap = configuration_internal_build(text, size);
+
+    if (snap == NULL)
+    {
+        return NULL;
+    }
+
+    return configuration_internal_allocate(filename, NULL, snap);
+}
+
+configuration_t* configuration_allocate_cached(const char* filename, const char* cache_filename)
+{
+    if (filename == NULL || cache_filename == NULL)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+
+    if (stat(filename, &st) != 0)
+    {
+        return NULL;
+    }
+
+    config_snapshot_t* snap = configuration_internal_map_image(cache_filename, &st);
 
-    if(fp)
+    if (snap == NULL)
     {
-        ptr = (configuration_t*)calloc(1, sizeof (configuration_t));
+        // Missing or stale image: parse the file and compile a fresh one
+        char* text = NULL;
+        size_t size = 0;
 
-        if (!ptr)
+        if (!configuration_internal_read_file(filename, &text, &size, &st))
         {
-            fclose(fp);
             return NULL;
         }
 
-        ptr->section_list = NULL;
-        ptr->section_count = 0;
+        snap = configuration_internal_build(text, size);
 
-        char current_section[65] = {0};
-
-        while(!feof(fp))
+        if (snap == NULL)
         {
-            char buffer[1025] = {0};
+            return NULL;
+        }
 
-            if(fgets(buffer, 1024, fp))
-            {
-                string_t* buffer_str = string_allocate(buffer);
-                string_t* temp_buffer =  string_allocate(buffer);
+        configuration_internal_write_image(snap, cache_filename, &st);
+    }
 
-                if (buffer_str == NULL || temp_buffer == NULL)
-                {
-                    string_free(&buffer_str);
-                    string_free(&temp_buffer);
-                    continue;
-                }
+    return configuration_internal_allocate(filename, cache_filename, snap);
+}
 
-                string_all_trim(temp_buffer);
-                memset(buffer, 0, sizeof(buffer));
-                strcpy(buffer, string_c_str(temp_buffer));
-                string_free(&temp_buffer);
+bool configuration_compile(const char* filename, const char* cache_filename)
+{
+    if (filename == NULL || cache_filename == NULL)
+    {
+        return false;
+    }
 
-                if(buffer[0] == 0 || buffer[0] == ';' || buffer[0] == '#')
-                {
-                    string_free(&buffer_str);
-                    continue;
-                }
+    char* text = NULL;
+    size_t size = 0;
+    struct stat st;
 
-                if(buffer[0] == '[')
-                {
-                    string_remove_char_first(buffer_str, '[');
-                    string_remove_char_first(buffer_str, ']');
-                    configuration_internal_add_section(ptr, string_c_str(buffer_str));
-                    memset(current_section, 0, 65);
-                    strcpy(current_section, string_c_str(buffer_str));
-                    string_free(&buffer_str);
-                    continue;
-                }
+    if (!configuration_internal_read_file(filename, &text, &size, &st))
+    {
+        return false;
+    }
 
-                string_t* key = NULL;
-                string_t* value = NULL;
+    config_snapshot_t* snap = configuration_internal_build(text, size);
 
-                string_split_key_value_by_char(buffer_str, '=', &key, &value);
+    if (snap == NULL)
+    {
+        return false;
+    }
 
-                if (key == NULL || value == NULL)
-                {
-                    string_free(&key);
-                    string_free(&value);
-                    string_free(&buffer_str);
-                    continue;
-                }
+    bool written = configuration_internal_write_image(snap, cache_filename, &st);
+    configuration_internal_free_snapshot(snap);
 
-                string_all_trim(key);
-                string_all_trim(value);
+    return written;
+}
 
-                configuration_internal_add_key_value(ptr, current_section, string_c_str(key), string_c_str(value));
-                string_free(&key);
-                string_free(&value);
-                string_free(&buffer_str);
-            }
-        }
-        fclose(fp);
+static configuration_t* configuration_internal_allocate(const char* filename, const char* cache_filename, config_snapshot_t* snap)
+{
+    configuration_t* ptr = (configuration_t*)calloc(1, sizeof (configuration_t));
+
+    if (!ptr)
+    {
+        configuration_internal_free_snapshot(snap);
+        return NULL;
     }
 
+    ptr->filename = strdup(filename);
+    ptr->cache_filename = (cache_filename != NULL) ? strdup(cache_filename) : NULL;
+
+    if (!ptr->filename || (cache_filename != NULL && !ptr->cache_filename))
+    {
+        configuration_internal_free_snapshot(snap);
+        free(ptr->filename);
+        free(ptr->cache_filename);
+        free(ptr);
+        return NULL;
+    }
+
+    pthread_mutex_init(&ptr->reload_lock, NULL);
+    ptr->retired = NULL;
+    ptr->watching = false;
+    ptr->watch_fd = -1;
+    ptr->stop_pipe[0] = ptr->stop_pipe[1] = -1;
+    atomic_init(&ptr->current, snap);
+    atomic_init(&ptr->generation, 1);
+
     return ptr;
 }
 
@@ -208,33 +400,270 @@ void  configuration_release(configuration_t* config)
         return;
     }
 
-    section_t* temp_section = NULL;
-    section_t* head_section = config->section_list;
+    configuration_unwatch(config);
+
+    configuration_internal_free_snapshot(atomic_load(&config->current));
+
+    while(config->retired != NULL)
+    {
+        config_snapshot_t* next = config->retired->retired;
+        configuration_internal_free_snapshot(config->retired);
+        config->retired = next;
+    }
+
+    pthread_mutex_destroy(&config->reload_lock);
+    free(config->filename);
+    free(config->cache_filename);
+    free(config);
+}
+
+bool  configuration_reload(configuration_t* config)
+{
+    if(config == NULL)
+    {
+        return false;
+    }
+
+    char* text = NULL;
+    size_t size = 0;
+    struct stat st;
+
+    if (!configuration_internal_read_file(config->filename, &text, &size, &st))
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&config->reload_lock);
+
+    config_snapshot_t* old_snap = atomic_load_explicit(&config->current, memory_order_relaxed);
+
+    // Editors often rewrite a file unchanged; keep the snapshot in that case
+    if (old_snap->source_size == size && old_snap->source_hash == configuration_internal_hash(text, size) && memcmp(old_snap->source, text, size) == 0)
+    {
+        pthread_mutex_unlock(&config->reload_lock);
+        free(text);
+        return true;
+    }
+
+    config_snapshot_t* new_snap = configuration_internal_build(text, size);
+
+    if (new_snap == NULL)
+    {
+        pthread_mutex_unlock(&config->reload_lock);
+        return false;
+    }
+
+    atomic_store_explicit(&config->current, new_snap, memory_order_release);
+    atomic_fetch_add_explicit(&config->generation, 1, memory_order_release);
+
+    // Readers may still hold strings from the old snapshot
+    old_snap->retired = config->retired;
+    config->retired = old_snap;
+
+    if (config->cache_filename != NULL)
+    {
+        configuration_internal_write_image(new_snap, config->cache_filename, &st);
+    }
+
+    pthread_mutex_unlock(&config->reload_lock);
+
+    return true;
+}
+
+uint64_t configuration_get_generation(const configuration_t* config)
+{
+    if(config == NULL)
+    {
+        return 0;
+    }
+
+    return atomic_load_explicit(&config->generation, memory_order_acquire);
+}
+
+#if defined(__linux__)
+
+static void* configuration_internal_watch_loop(void* arg)
+{
+    configuration_t* config = (configuration_t*)arg;
+
+    const char* basename = strrchr(config->filename, '/');
+    basename = (basename != NULL) ? basename + 1 : config->filename;
 
-    while(head_section != NULL)
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    struct pollfd fds[2];
+    fds[0].fd = config->watch_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = config->stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    while(true)
     {
-        temp_section = head_section;
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            break;
+        }
 
-        key_value_t* temp_kv = NULL;
-        key_value_t* head_kv = temp_section->key_value_list;
+        if (fds[1].revents != 0)
+        {
+            break;
+        }
+
+        if ((fds[0].revents & POLLIN) == 0)
+        {
+            continue;
+        }
+
+        ssize_t len = read(config->watch_fd, events, sizeof(events));
+
+        if (len <= 0)
+        {
+            if (len < 0 && (errno == EINTR || errno == EAGAIN))
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        bool changed = false;
 
-        while(head_kv != NULL)
+        for(char* pos = events; pos < events + len; )
         {
-            temp_kv = head_kv;
-            head_kv = head_kv->next;
-            free(temp_kv->key);
-            free(temp_kv->value);
-            free(temp_kv);
+            const struct inotify_event* ev = (const struct inotify_event*)pos;
+
+            if (ev->len > 0 && strcmp(ev->name, basename) == 0)
+            {
+                changed = true;
+            }
+
+            pos += sizeof(struct inotify_event) + ev->len;
+        }
+
+        if (!changed)
+        {
+            continue;
         }
 
-        head_section = head_section->next;
-        free(temp_section->section_name);
-        free(temp_section);
+        uint64_t before = configuration_get_generation(config);
+
+        if (configuration_reload(config) && config->callback != NULL && configuration_get_generation(config) != before)
+        {
+            config->callback(config, config->callback_context);
+        }
     }
 
-    free(config);
+    return NULL;
+}
+
+bool  configuration_watch(configuration_t* config, configuration_reload_callback callback, void* context)
+{
+    if(config == NULL || config->watching)
+    {
+        return false;
+    }
+
+    // Watch the directory: editors and deployment tools usually replace the
+    // file by renaming a new one over it, which a watch on the file misses
+    char* dirname = strdup(config->filename);
+
+    if (dirname == NULL)
+    {
+        return false;
+    }
+
+    char* slash = strrchr(dirname, '/');
+
+    if (slash == NULL)
+    {
+        strcpy(dirname, ".");
+    }
+    else if (slash == dirname)
+    {
+        slash[1] = 0;
+    }
+    else
+    {
+        *slash = 0;
+    }
+
+    config->watch_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+    if (config->watch_fd < 0)
+    {
+        free(dirname);
+        return false;
+    }
+
+    int wd = inotify_add_watch(config->watch_fd, dirname, IN_CLOSE_WRITE | IN_MOVED_TO);
+    free(dirname);
+
+    if (wd < 0 || pipe(config->stop_pipe) != 0)
+    {
+        close(config->watch_fd);
+        config->watch_fd = -1;
+        return false;
+    }
+
+    config->callback = callback;
+    config->callback_context = context;
+
+    if (pthread_create(&config->watcher, NULL, configuration_internal_watch_loop, config) != 0)
+    {
+        close(config->watch_fd);
+        close(config->stop_pipe[0]);
+        close(config->stop_pipe[1]);
+        config->watch_fd = config->stop_pipe[0] = config->stop_pipe[1] = -1;
+        return false;
+    }
+
+    config->watching = true;
+
+    return true;
+}
+
+void  configuration_unwatch(configuration_t* config)
+{
+    if(config == NULL || !config->watching)
+    {
+        return;
+    }
+
+    char stop = 1;
+
+    while (write(config->stop_pipe[1], &stop, 1) < 0 && errno == EINTR) {}
+
+    pthread_join(config->watcher, NULL);
+
+    close(config->watch_fd);
+    close(config->stop_pipe[0]);
+    close(config->stop_pipe[1]);
+    config->watch_fd = config->stop_pipe[0] = config->stop_pipe[1] = -1;
+    config->watching = false;
+}
+
+#else
+
+bool  configuration_watch(configuration_t* config, configuration_reload_callback callback, void* context)
+{
+    (void)config;
+    (void)callback;
+    (void)context;
+    return false;
+}
+
+void  configuration_unwatch(configuration_t* config)
+{
+    (void)config;
 }
 
+#endif
+
 string_list_t*  configuration_get_all_sections(const configuration_t* config)
 {
     if(config == NULL)
@@ -242,27 +671,25 @@ string_list_t*  configuration_get_all_sections(const configuration_t* config)
         return NULL;
     }
 
-    string_list_t* buffer = string_list_allocate_default();
+    const config_snapshot_t* snap = configuration_internal_snapshot(config);
 
-    long len = config->section_count + 1;
+    string_list_t* buffer = string_list_allocate_default();
 
     if(buffer == NULL)
     {
         return NULL;
     }
 
-    section_t* curr_section = NULL;
-
-    for(curr_section = config->section_list; curr_section != NULL; curr_section = curr_section->next)
+    for(uint32_t index = 0; index < snap->section_count; index++)
     {
-        long temp_str_len = (long)strlen(curr_section->section_name);
+        const char* name = snap->text + snap->sections[index].name;
 
-        if(temp_str_len < 1)
+        if(name[0] == 0)
         {
             continue;
         }
 
-        string_append_to_list(buffer, curr_section->section_name);
+        string_append_to_list(buffer, name);
     }
 
     return buffer;
@@ -275,15 +702,15 @@ string_list_t*  configuration_get_all_keys(const configuration_t *config, const
         return NULL;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
+    const config_snapshot_t* snap = configuration_internal_snapshot(config);
+
+    const config_section_t* curr_section = configuration_internal_get_section(snap, section);
 
     if (curr_section == NULL)
     {
         return NULL;
     }
 
-    key_value_t* curr_kv = NULL;
-
     string_list_t* buffer = string_list_allocate_default();
 
     if(buffer == NULL)
@@ -291,16 +718,16 @@ string_list_t*  configuration_get_all_keys(const configuration_t *config, const
         return NULL;
     }
 
-    for(curr_kv = curr_section->key_value_list; curr_kv != NULL; curr_kv = curr_kv->next)
+    for(uint32_t index = curr_section->first; index != 0; index = snap->entries[index - 1].next)
     {
-        long temp_str_len = (long)strlen(curr_kv->value);
+        const config_entry_t* curr_kv = &snap->entries[index - 1];
 
-        if(temp_str_len < 1)
+        if(snap->text[curr_kv->value] == 0)
         {
             continue;
         }
 
-        string_append_to_list(buffer, curr_kv->key);
+        string_append_to_list(buffer, snap->text + curr_kv->key);
     }
 
     return buffer;
@@ -313,14 +740,9 @@ bool  configuration_has_section(const configuration_t* config, const char* secti
         return false;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
-
-    if(curr_section == NULL)
-    {
-        return false;
-    }
+    const config_snapshot_t* snap = configuration_internal_snapshot(config);
 
-    return true;
+    return configuration_internal_get_section(snap, section) != NULL;
 }
 
 bool  configuration_has_key(const configuration_t* config, const char* section, char* key)
@@ -330,24 +752,9 @@ bool  configuration_has_key(const configuration_t* config, const char* section,
         return false;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
-
-    if(curr_section == NULL)
-    {
-        return false;
-    }
-
-    const char* value = configuration_internal_get_value(config, curr_section, key);
-
-    if(value == NULL)
-    {
-        return false;
-    }
-
-    return true;
+    return configuration_internal_get_value(config, section, key) != NULL;
 }
 
-
 long  configuration_get_value_as_integer(const configuration_t *config, const char* section, const char* key)
 {
     if(config == NULL || section == NULL || key == NULL)
@@ -355,14 +762,7 @@ long  configuration_get_value_as_integer(const configuration_t *config, const ch
         return LONG_MAX;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
-
-    if(curr_section == NULL)
-    {
-        return LONG_MAX;
-    }
-
-    const char* value = configuration_internal_get_value(config, curr_section, key);
+    const char* value = configuration_internal_get_value(config, section, key);
 
     if(value == NULL)
     {
@@ -379,14 +779,7 @@ bool  configuration_get_value_as_boolean(const configuration_t* config, const ch
         return false;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
-
-    if(curr_section == NULL)
-    {
-        return false;
-    }
-
-    const char* value = configuration_internal_get_value(config, curr_section, key);
+    const char* value = configuration_internal_get_value(config, section, key);
 
     if(value == NULL)
     {
@@ -408,14 +801,7 @@ double configuration_get_value_as_real(const configuration_t *config, const char
         return DBL_MAX;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
-
-    if(curr_section == NULL)
-    {
-        return DBL_MAX;
-    }
-
-    const char* value = configuration_internal_get_value(config, curr_section, key);
+    const char* value = configuration_internal_get_value(config, section, key);
 
     if(value == NULL)
     {
@@ -432,184 +818,1355 @@ const char* configuration_get_value_as_string(const configuration_t* config, con
         return NULL;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
+    return configuration_internal_get_value(config, section, key);
+}
 
-    if(curr_section == NULL)
+char configuration_get_value_as_char(const configuration_t* config, const char* section, const char* key)
+{
+    if(config == NULL || section == NULL || key == NULL)
     {
-        return NULL;
+        return 0;
     }
 
-    const char* value = configuration_internal_get_value(config, curr_section, key);
+    const char* value = configuration_internal_get_value(config, section, key);
 
     if(value == NULL)
+    {
+        return 0;
+    }
+
+    return value[0];
+}
+
+configuration_value_t* configuration_bind(configuration_t* config, const char* section, const char* key)
+{
+    if(config == NULL || section == NULL || key == NULL)
+    {
+        return NULL;
+    }
+
+    configuration_value_t* value = (configuration_value_t*)calloc(1, sizeof(configuration_value_t));
+
+    if (value == NULL)
     {
         return NULL;
     }
 
+    value->config = config;
+    value->section = strdup(section);
+    value->key = strdup(key);
+
+    if (value->section == NULL || value->key == NULL)
+    {
+        configuration_unbind(value);
+        return NULL;
+    }
+
+    atomic_init(&value->cached, NULL);
+    configuration_internal_resolve(value, NULL);
+
     return value;
 }
 
-char configuration_get_value_as_char(const configuration_t* config, const char* section, const char* key)
+void configuration_unbind(configuration_value_t* value)
 {
-    if(config == NULL || section == NULL || key == NULL)
+    if(value == NULL)
     {
-        return 0;
+        return;
     }
 
-    const section_t* curr_section = configuration_internal_get_section(config, section);
+    free(value->section);
+    free(value->key);
+    free(value);
+}
 
-    if(curr_section == NULL)
+bool configuration_value_exists(const configuration_value_t* value)
+{
+    if(value == NULL)
     {
-        return 0;
+        return false;
+    }
+
+    return configuration_internal_resolve(value, NULL)->value != CONFIG_NO_VALUE;
+}
+
+const char* configuration_value_string(const configuration_value_t* value, const char* default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
+    }
+
+    const config_snapshot_t* snap = NULL;
+    const config_entry_t* entry = configuration_internal_resolve(value, &snap);
+
+    return (entry->value != CONFIG_NO_VALUE) ? snap->text + entry->value : default_value;
+}
+
+long configuration_value_integer(const configuration_value_t* value, long default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
+    }
+
+    const config_item_t* item = &configuration_internal_resolve(value, NULL)->scalar;
+
+    return (item->types & CONFIG_TYPE_INTEGER) ? item->integer : default_value;
+}
+
+double configuration_value_real(const configuration_value_t* value, double default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
+    }
+
+    const config_item_t* item = &configuration_internal_resolve(value, NULL)->scalar;
+
+    return (item->types & CONFIG_TYPE_REAL) ? item->real : default_value;
+}
+
+bool configuration_value_boolean(const configuration_value_t* value, bool default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
+    }
+
+    const config_item_t* item = &configuration_internal_resolve(value, NULL)->scalar;
+
+    return (item->types & CONFIG_TYPE_BOOLEAN) ? item->boolean : default_value;
+}
+
+uint64_t configuration_value_size(const configuration_value_t* value, uint64_t default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
+    }
+
+    const config_item_t* item = &configuration_internal_resolve(value, NULL)->scalar;
+
+    return (item->types & CONFIG_TYPE_SIZE) ? item->size : default_value;
+}
+
+int64_t configuration_value_duration(const configuration_value_t* value, int64_t default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
     }
 
-    const char* value = configuration_internal_get_value(config, curr_section, key);
+    const config_item_t* item = &configuration_internal_resolve(value, NULL)->scalar;
+
+    return (item->types & CONFIG_TYPE_DURATION) ? item->duration : default_value;
+}
 
-    if(value == 0)
+size_t configuration_value_array_count(const configuration_value_t* value)
+{
+    if(value == NULL)
     {
         return 0;
     }
 
-    return value[0];
+    return configuration_internal_resolve(value, NULL)->item_count;
 }
 
-void configuration_internal_add_section(configuration_t* conf_ptr, const char* section_name)
+const char* configuration_value_array_string(const configuration_value_t* value, size_t index, const char* default_value)
 {
-    if(conf_ptr == NULL)
+    if(value == NULL)
     {
-        return;
+        return default_value;
     }
 
-    section_t* new_section = (section_t*)calloc(1, sizeof(section_t));
+    const config_snapshot_t* snap = NULL;
+    const config_entry_t* entry = configuration_internal_resolve(value, &snap);
 
-    if (!new_section)
+    if (index >= entry->item_count)
     {
-        return;
+        return default_value;
     }
 
-    new_section->next = NULL;
-    new_section->key_value_list = NULL;
-    new_section->key_value_count = 0;
-    new_section->section_name = (char*)calloc(1, strlen(section_name)+1);
+    return snap->text + configuration_internal_get_item(snap, entry, index)->text;
+}
 
-    if (!new_section->section_name)
+long configuration_value_array_integer(const configuration_value_t* value, size_t index, long default_value)
+{
+    if(value == NULL)
     {
-        free(new_section);
-        return;
+        return default_value;
     }
 
-    strcpy(new_section->section_name, section_name);
+    const config_snapshot_t* snap = NULL;
+    const config_entry_t* entry = configuration_internal_resolve(value, &snap);
 
-    if(conf_ptr->section_list == NULL)
+    if (index >= entry->item_count)
     {
-        conf_ptr->section_list = new_section;
+        return default_value;
     }
-    else
+
+    const config_item_t* item = configuration_internal_get_item(snap, entry, index);
+
+    return (item->types & CONFIG_TYPE_INTEGER) ? item->integer : default_value;
+}
+
+double configuration_value_array_real(const configuration_value_t* value, size_t index, double default_value)
+{
+    if(value == NULL)
+    {
+        return default_value;
+    }
+
+    const config_snapshot_t* snap = NULL;
+    const config_entry_t* entry = configuration_internal_resolve(value, &snap);
+
+    if (index >= entry->item_count)
     {
-        section_t* temp = NULL;
-        for(temp = conf_ptr->section_list; temp->next != NULL; temp = temp->next) {}
-        temp->next = new_section;
+        return default_value;
     }
 
-    conf_ptr->section_count++;
+    const config_item_t* item = configuration_internal_get_item(snap, entry, index);
+
+    return (item->types & CONFIG_TYPE_REAL) ? item->real : default_value;
 }
 
-void configuration_internal_add_key_value(configuration_t* conf_ptr, const char* section_name, const char* key, const char* value)
+static uint32_t configuration_internal_hash(const char* str, size_t len)
 {
-    if(conf_ptr == NULL)
+    // Jenkins one-at-a-time
+    uint32_t hash = 0;
+
+    for(size_t index = 0; index < len; index++)
     {
-        return;
+        hash += (unsigned char)str[index];
+        hash += (hash << 10);
+        hash ^= (hash >> 6);
+    }
+
+    hash += (hash << 3);
+    hash ^= (hash >> 11);
+    hash += (hash << 15);
+
+    return hash;
+}
+
+static uint32_t configuration_internal_key_hash(uint32_t section, const char* key, size_t len)
+{
+    // Same key in different sections must land in different slots
+    return configuration_internal_hash(key, len) ^ (section * 0x9E3779B1u);
+}
+
+/* 'st' receives the attributes the content was read under */
+static bool configuration_internal_read_file(const char* filename, char** text, size_t* size, struct stat* st)
+{
+    FILE* fp = fopen(filename, "rb");
+
+    if(fp == NULL)
+    {
+        return false;
+    }
+
+    if (fstat(fileno(fp), st) != 0 || st->st_size < 0)
+    {
+        fclose(fp);
+        return false;
     }
 
-    section_t* curr_section = NULL;
+    size_t capacity = (size_t)st->st_size + 1;
+    size_t used = 0;
+    char* data = (char*)malloc(capacity);
+
+    if (data == NULL)
+    {
+        fclose(fp);
+        return false;
+    }
 
-    for(curr_section = conf_ptr->section_list; curr_section != NULL; curr_section = curr_section->next)
+    // The size may change while we read; follow the actual content
+    while(true)
     {
-        if(strcmp(curr_section->section_name, section_name) == 0)
+        if (used + 1 >= capacity)
         {
-            key_value_t* new_kv = (key_value_t*)calloc(1, sizeof (key_value_t));
+            char* temp = (char*)realloc(data, capacity * 2);
 
-            if(!new_kv)
+            if (temp == NULL)
             {
-                return;
+                free(data);
+                fclose(fp);
+                return false;
             }
 
-            new_kv->next = NULL;
-            new_kv->key = (char*)calloc(1, strlen(key)+1);
+            data = temp;
+            capacity *= 2;
+        }
+
+        size_t count = fread(data + used, 1, capacity - used - 1, fp);
 
-            if (!new_kv->key)
-            {
-                free(new_kv);
-                return;
-            }
+        if (count == 0)
+        {
+            break;
+        }
 
-            strcpy(new_kv->key, key);
+        used += count;
+    }
 
-            new_kv->value = (char*)calloc(1, strlen(value)+1);
+    bool failed = ferror(fp) != 0;
+    fclose(fp);
 
-            if (!new_kv->value)
-            {
-                free(new_kv);
-                free(new_kv->key);
-                return;
-            }
+    if (failed)
+    {
+        free(data);
+        return false;
+    }
+
+    data[used] = 0;
+    *text = data;
+    *size = used;
+
+    return true;
+}
+
+static bool configuration_internal_is_space(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f';
+}
+
+/* Trims [*start, *end) in place */
+static void configuration_internal_trim(char** start, char** end)
+{
+    while(*start < *end && configuration_internal_is_space(**start))
+    {
+        (*start)++;
+    }
+
+    while(*end > *start && configuration_internal_is_space((*end)[-1]))
+    {
+        (*end)--;
+    }
+}
+
+/* Takes ownership of 'source' (NUL terminated at 'size') */
+static config_snapshot_t* configuration_internal_build(char* source, size_t size)
+{
+    config_snapshot_t* snap = (config_snapshot_t*)calloc(1, sizeof(config_snapshot_t));
+
+    if (snap == NULL)
+    {
+        free(source);
+        return NULL;
+    }
+
+    snap->source = source;
+    snap->source_size = size;
+    snap->source_hash = configuration_internal_hash(source, size);
+
+    // Offsets are 32 bit
+    if (size >= CONFIG_NO_VALUE / 2)
+    {
+        configuration_internal_free_snapshot(snap);
+        return NULL;
+    }
+
+    snap->text_size = (memchr(source, ',', size) != NULL) ? 2 * (size + 1) : size + 1;
+    snap->text = (char*)malloc(snap->text_size);
+
+    if (snap->text == NULL)
+    {
+        configuration_internal_free_snapshot(snap);
+        return NULL;
+    }
+
+    memcpy(snap->text, source, size + 1);
+
+    char* text = snap->text;
+
+    size_t section_capacity = 0;
+    size_t entry_capacity = 0;
+    uint32_t current_section = 0;
+
+    char* line = text;
+    char* text_end = text + size;
+
+    while(line < text_end)
+    {
+        char* line_end = memchr(line, '\n', (size_t)(text_end - line));
+
+        if (line_end == NULL)
+        {
+            line_end = text_end;
+        }
+
+        char* next_line = (line_end < text_end) ? line_end + 1 : text_end;
+        char* start = line;
+        char* end = line_end;
+
+        configuration_internal_trim(&start, &end);
+
+        if(start == end || *start == ';' || *start == '#')
+        {
+            line = next_line;
+            continue;
+        }
 
-            strcpy(new_kv->value, value);
+        if(*start == '[')
+        {
+            char* name = start + 1;
+            char* name_end = memchr(name, ']', (size_t)(end - name));
 
-            if(curr_section->key_value_list == NULL)
+            if (name_end == NULL)
             {
-                curr_section->key_value_list = new_kv;
+                name_end = end;
             }
-            else
+
+            configuration_internal_trim(&name, &name_end);
+            current_section = configuration_internal_add_section(snap, (uint32_t)(name - text), (size_t)(name_end - name), &section_capacity);
+
+            if (current_section == 0)
             {
-                key_value_t* temp = NULL;
-                for(temp = curr_section->key_value_list; temp->next != NULL; temp = temp->next) {}
-                temp->next = new_kv;
+                configuration_internal_free_snapshot(snap);
+                return NULL;
             }
 
-            curr_section->key_value_count++;
+            line = next_line;
+            continue;
+        }
 
-            break;
+        char* equal = memchr(start, '=', (size_t)(end - start));
+
+        // Keys before the first section header are ignored
+        if (equal == NULL || current_section == 0)
+        {
+            line = next_line;
+            continue;
+        }
+
+        char* key = start;
+        char* key_end = equal;
+        char* value = equal + 1;
+        char* value_end = end;
+
+        configuration_internal_trim(&key, &key_end);
+        configuration_internal_trim(&value, &value_end);
+        *key_end = 0;
+        *value_end = 0;
+
+        if (!configuration_internal_add_key_value(snap, current_section, (uint32_t)(key - text), (uint32_t)(value - text), &entry_capacity))
+        {
+            configuration_internal_free_snapshot(snap);
+            return NULL;
         }
+
+        line = next_line;
+    }
+
+    if (!configuration_internal_index_entries(snap) || !configuration_internal_type_entries(snap))
+    {
+        configuration_internal_free_snapshot(snap);
+        return NULL;
+    }
+
+    snap->missing.value = CONFIG_NO_VALUE;
+    snap->missing.item_first = CONFIG_SCALAR_ITEM;
+
+    return snap;
+}
+
+static void configuration_internal_free_snapshot(config_snapshot_t* snap)
+{
+    if (snap == NULL)
+    {
+        return;
+    }
+
+    if (snap->mapping != NULL)
+    {
+        munmap(snap->mapping, snap->mapping_size);
+        free(snap);
+        return;
     }
+
+    free(snap->items);
+    free(snap->entry_slots);
+    free(snap->entries);
+    free(snap->section_slots);
+    free(snap->sections);
+    free(snap->text);
+    free(snap->source);
+    free(snap);
 }
 
-const section_t *configuration_internal_get_section(const configuration_t *conf_ptr, const char* section_name)
+static bool configuration_internal_grow_sections(config_snapshot_t* snap)
 {
-    if(conf_ptr == NULL)
+    uint32_t slot_count = (snap->section_mask + 1) * 2;
+
+    if (snap->section_slots == NULL)
     {
-        return NULL;
+        slot_count = CONFIGURATION_MIN_SLOTS;
+    }
+
+    uint32_t* slots = (uint32_t*)calloc(slot_count, sizeof(uint32_t));
+
+    if (slots == NULL)
+    {
+        return false;
     }
 
-    section_t* curr_section = NULL;
+    uint32_t mask = slot_count - 1;
 
-    for(curr_section = conf_ptr->section_list; curr_section != NULL; curr_section = curr_section->next)
+    for(uint32_t index = 0; index < snap->section_count; index++)
     {
-        if(strcmp(curr_section->section_name, section_name) == 0)
+        uint32_t slot = snap->sections[index].hash & mask;
+
+        while(slots[slot] != 0)
         {
-            return curr_section;
+            slot = (slot + 1) & mask;
         }
+
+        slots[slot] = index + 1;
     }
 
-    return NULL;
+    free(snap->section_slots);
+    snap->section_slots = slots;
+    snap->section_mask = mask;
+
+    return true;
 }
 
-const char *configuration_internal_get_value(const configuration_t* conf_ptr, const section_t *section, const char* key)
+/* Returns the section index + 1, merging repeated headers; 0 on failure */
+static uint32_t configuration_internal_add_section(config_snapshot_t* snap, uint32_t name, size_t len, size_t* capacity)
 {
-    if(conf_ptr == NULL || section == NULL || key == NULL)
+    char* name_text = snap->text + name;
+    uint32_t hash = configuration_internal_hash(name_text, len);
+
+    if (snap->section_slots != NULL)
     {
-        return NULL;
+        for(uint32_t slot = hash & snap->section_mask; snap->section_slots[slot] != 0; slot = (slot + 1) & snap->section_mask)
+        {
+            const config_section_t* curr_section = &snap->sections[snap->section_slots[slot] - 1];
+
+            const char* curr_name = snap->text + curr_section->name;
+
+            if (curr_section->hash == hash && strncmp(curr_name, name_text, len) == 0 && curr_name[len] == 0)
+            {
+                return snap->section_slots[slot];
+            }
+        }
     }
 
-    key_value_t* curr_kv = NULL;
+    if (snap->section_count >= *capacity)
+    {
+        size_t new_capacity = (*capacity == 0) ? 8 : *capacity * 2;
+        config_section_t* temp = (config_section_t*)realloc(snap->sections, new_capacity * sizeof(config_section_t));
+
+        if (temp == NULL)
+        {
+            return 0;
+        }
+
+        snap->sections = temp;
+        *capacity = new_capacity;
+    }
+
+    // The closing bracket (or line end) is overwritten, the name stays in place
+    name_text[len] = 0;
+
+    config_section_t* new_section = &snap->sections[snap->section_count++];
+    new_section->name = name;
+    new_section->hash = hash;
+    new_section->first = 0;
+    new_section->last = 0;
 
-    for(curr_kv = section->key_value_list; curr_kv != NULL; curr_kv = curr_kv->next)
+    if (snap->section_slots == NULL || snap->section_count * 2 > snap->section_mask + 1)
     {
-        if(strcmp(curr_kv->key, key) == 0)
+        if (!configuration_internal_grow_sections(snap))
         {
-            return curr_kv->value;
+            return 0;
         }
     }
+    else
+    {
+        uint32_t slot = hash & snap->section_mask;
 
-    return NULL;
+        while(snap->section_slots[slot] != 0)
+        {
+            slot = (slot + 1) & snap->section_mask;
+        }
+
+        snap->section_slots[slot] = snap->section_count;
+    }
+
+    return snap->section_count;
+}
+
+static bool configuration_internal_add_key_value(config_snapshot_t* snap, uint32_t section, uint32_t key, uint32_t value, size_t* capacity)
+{
+    if (snap->entry_count >= *capacity)
+    {
+        size_t new_capacity = (*capacity == 0) ? 16 : *capacity * 2;
+        config_entry_t* temp = (config_entry_t*)realloc(snap->entries, new_capacity * sizeof(config_entry_t));
+
+        if (temp == NULL)
+        {
+            return false;
+        }
+
+        snap->entries = temp;
+        *capacity = new_capacity;
+    }
+
+    config_entry_t* new_kv = &snap->entries[snap->entry_count++];
+    new_kv->key = key;
+    new_kv->value = value;
+    new_kv->hash = configuration_internal_key_hash(section, snap->text + key, strlen(snap->text + key));
+    new_kv->section = section;
+    new_kv->next = 0;
+    new_kv->item_first = CONFIG_SCALAR_ITEM;
+    new_kv->item_count = 0;
+    new_kv->reserved = 0;
+
+    config_section_t* curr_section = &snap->sections[section - 1];
+
+    if (curr_section->last == 0)
+    {
+        curr_section->first = snap->entry_count;
+    }
+    else
+    {
+        snap->entries[curr_section->last - 1].next = snap->entry_count;
+    }
+
+    curr_section->last = snap->entry_count;
+
+    return true;
+}
+
+static bool configuration_internal_index_entries(config_snapshot_t* snap)
+{
+    uint32_t slot_count = CONFIGURATION_MIN_SLOTS;
+
+    while(slot_count < snap->entry_count * 2)
+    {
+        slot_count *= 2;
+    }
+
+    snap->entry_slots = (uint32_t*)calloc(slot_count, sizeof(uint32_t));
+
+    if (snap->entry_slots == NULL)
+    {
+        return false;
+    }
+
+    snap->entry_mask = slot_count - 1;
+
+    for(uint32_t index = 0; index < snap->entry_count; index++)
+    {
+        const config_entry_t* new_kv = &snap->entries[index];
+        uint32_t slot = new_kv->hash & snap->entry_mask;
+        bool duplicate = false;
+
+        while(snap->entry_slots[slot] != 0)
+        {
+            const config_entry_t* curr_kv = &snap->entries[snap->entry_slots[slot] - 1];
+
+            // The first occurrence of a key wins
+            if (curr_kv->hash == new_kv->hash && curr_kv->section == new_kv->section && strcmp(snap->text + curr_kv->key, snap->text + new_kv->key) == 0)
+            {
+                duplicate = true;
+                break;
+            }
+
+            slot = (slot + 1) & snap->entry_mask;
+        }
+
+        if (!duplicate)
+        {
+            snap->entry_slots[slot] = index + 1;
+        }
+    }
+
+    return true;
+}
+
+static const config_snapshot_t* configuration_internal_snapshot(const configuration_t* config)
+{
+    // Pairs with the release store in configuration_reload
+    return atomic_load_explicit(&config->current, memory_order_acquire);
+}
+
+static const config_section_t* configuration_internal_get_section(const config_snapshot_t* snap, const char* section_name)
+{
+    if (snap->section_slots == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t hash = configuration_internal_hash(section_name, strlen(section_name));
+
+    for(uint32_t slot = hash & snap->section_mask; snap->section_slots[slot] != 0; slot = (slot + 1) & snap->section_mask)
+    {
+        const config_section_t* curr_section = &snap->sections[snap->section_slots[slot] - 1];
+
+        if (curr_section->hash == hash && strcmp(snap->text + curr_section->name, section_name) == 0)
+        {
+            return curr_section;
+        }
+    }
+
+    return NULL;
+}
+
+static const char* configuration_internal_get_value(const configuration_t* config, const char* section_name, const char* key)
+{
+    const config_snapshot_t* snap = configuration_internal_snapshot(config);
+    const config_entry_t* entry = configuration_internal_get_entry(snap, section_name, key);
+
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    return snap->text + entry->value;
+}
+
+static const config_entry_t* configuration_internal_get_entry(const config_snapshot_t* snap, const char* section_name, const char* key)
+{
+    const config_section_t* curr_section = configuration_internal_get_section(snap, section_name);
+
+    if (curr_section == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t section = (uint32_t)(curr_section - snap->sections) + 1;
+    uint32_t hash = configuration_internal_key_hash(section, key, strlen(key));
+
+    for(uint32_t slot = hash & snap->entry_mask; snap->entry_slots[slot] != 0; slot = (slot + 1) & snap->entry_mask)
+    {
+        const config_entry_t* curr_kv = &snap->entries[snap->entry_slots[slot] - 1];
+
+        if (curr_kv->hash == hash && curr_kv->section == section && strcmp(snap->text + curr_kv->key, key) == 0)
+        {
+            return curr_kv;
+        }
+    }
+
+    return NULL;
+}
+
+static const config_entry_t* configuration_internal_resolve(const configuration_value_t* value, const config_snapshot_t** snap_out)
+{
+    const config_snapshot_t* snap = configuration_internal_snapshot(value->config);
+    const config_entry_t* entry = atomic_load_explicit(&value->cached, memory_order_acquire);
+
+    if (snap_out != NULL)
+    {
+        *snap_out = snap;
+    }
+
+    // Snapshots are never freed while the configuration lives, so an entry
+    // address identifies the snapshot it belongs to
+    if (entry != NULL && (entry == &snap->missing || (entry >= snap->entries && entry < snap->entries + snap->entry_count)))
+    {
+        return entry;
+    }
+
+    // First read after a reload. Entries of replaced snapshots stay alive, so
+    // a racing reader holding the old pointer is safe; both store the same.
+    entry = configuration_internal_get_entry(snap, value->section, value->key);
+
+    if (entry == NULL)
+    {
+        entry = &snap->missing;
+    }
+
+    atomic_store_explicit(&((configuration_value_t*)value)->cached, entry, memory_order_release);
+
+    return entry;
+}
+
+static const config_item_t* configuration_internal_get_item(const config_snapshot_t* snap, const config_entry_t* entry, size_t index)
+{
+    if (entry->item_first == CONFIG_SCALAR_ITEM)
+    {
+        return &entry->scalar;
+    }
+
+    return &snap->items[entry->item_first + index];
+}
+
+static bool configuration_internal_parse_integer(const char* str, long* out)
+{
+    const char* digits = (str[0] == '-' || str[0] == '+') ? str + 1 : str;
+    int base = (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) ? 16 : 10;
+    char* end = NULL;
+
+    errno = 0;
+    long result = strtol(str, &end, base);
+
+    if (end == str || *end != 0 || errno == ERANGE)
+    {
+        return false;
+    }
+
+    *out = result;
+
+    return true;
+}
+
+static bool configuration_internal_parse_real(const char* str, double* out)
+{
+    char* end = NULL;
+
+    errno = 0;
+    double result = strtod(str, &end);
+
+    if (end == str || *end != 0 || errno == ERANGE)
+    {
+        return false;
+    }
+
+    *out = result;
+
+    return true;
+}
+
+static bool configuration_internal_parse_boolean(const char* str, bool* out)
+{
+    static const char* const true_words[] = {"true", "yes", "on", "1"};
+    static const char* const false_words[] = {"false", "no", "off", "0"};
+
+    for(size_t index = 0; index < sizeof(true_words) / sizeof(true_words[0]); index++)
+    {
+        if (strcasecmp(str, true_words[index]) == 0)
+        {
+            *out = true;
+            return true;
+        }
+
+        if (strcasecmp(str, false_words[index]) == 0)
+        {
+            *out = false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* "4MB", "512 KiB", "1.5G"; multiples of 1024, a plain number is bytes */
+static bool configuration_internal_parse_size(const char* str, uint64_t* out)
+{
+    static const struct { const char* unit; double scale; } units[] =
+    {
+        {"", 1.0}, {"b", 1.0},
+        {"k", 1024.0}, {"kb", 1024.0}, {"kib", 1024.0},
+        {"m", 1048576.0}, {"mb", 1048576.0}, {"mib", 1048576.0},
+        {"g", 1073741824.0}, {"gb", 1073741824.0}, {"gib", 1073741824.0},
+        {"t", 1099511627776.0}, {"tb", 1099511627776.0}, {"tib", 1099511627776.0}
+    };
+
+    if (str[0] < '0' || str[0] > '9')
+    {
+        return false;
+    }
+
+    char* end = NULL;
+    double number = strtod(str, &end);
+
+    while(*end == ' ' || *end == '\t')
+    {
+        end++;
+    }
+
+    for(size_t index = 0; index < sizeof(units) / sizeof(units[0]); index++)
+    {
+        if (strcasecmp(end, units[index].unit) == 0)
+        {
+            double result = number * units[index].scale;
+
+            if (!isfinite(result) || result >= 18446744073709551616.0)
+            {
+                return false;
+            }
+
+            *out = (uint64_t)result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* "10ms", "1h30m", "1.5s", "250us"; in nanoseconds, a plain number is seconds */
+static bool configuration_internal_parse_duration(const char* str, int64_t* out)
+{
+    static const struct { const char* unit; double scale; } units[] =
+    {
+        {"ns", 1.0}, {"us", 1e3}, {"ms", 1e6}, {"s", 1e9},
+        {"m", 60e9}, {"min", 60e9}, {"h", 3600e9}, {"d", 86400e9}
+    };
+
+    double total = 0;
+    const char* pos = str;
+
+    while(*pos != 0)
+    {
+        if (*pos < '0' || *pos > '9')
+        {
+            if (*pos != '.')
+            {
+                return false;
+            }
+        }
+
+        char* end = NULL;
+        double number = strtod(pos, &end);
+
+        if (end == pos)
+        {
+            return false;
+        }
+
+        const char* unit = end;
+        size_t unit_len = 0;
+
+        while((unit[unit_len] >= 'a' && unit[unit_len] <= 'z') || (unit[unit_len] >= 'A' && unit[unit_len] <= 'Z'))
+        {
+            unit_len++;
+        }
+
+        if (unit_len == 0)
+        {
+            // Only a lone number may omit its unit
+            if (pos != str || *end != 0)
+            {
+                return false;
+            }
+
+            total = number * 1e9;
+            break;
+        }
+
+        bool known = false;
+
+        for(size_t index = 0; index < sizeof(units) / sizeof(units[0]); index++)
+        {
+            if (strlen(units[index].unit) == unit_len && strncasecmp(unit, units[index].unit, unit_len) == 0)
+            {
+                total += number * units[index].scale;
+                known = true;
+                break;
+            }
+        }
+
+        if (!known)
+        {
+            return false;
+        }
+
+        pos = unit + unit_len;
+    }
+
+    if (!isfinite(total) || total >= 9223372036854775808.0)
+    {
+        return false;
+    }
+
+    *out = (int64_t)total;
+
+    return true;
+}
+
+static void configuration_internal_type_item(config_item_t* item, const char* text, uint32_t offset)
+{
+    memset(item, 0, sizeof(config_item_t));
+    item->text = offset;
+
+    if (text[0] == 0)
+    {
+        return;
+    }
+
+    if (configuration_internal_parse_integer(text, &item->integer))
+    {
+        item->types |= CONFIG_TYPE_INTEGER;
+    }
+
+    if (configuration_internal_parse_real(text, &item->real))
+    {
+        item->types |= CONFIG_TYPE_REAL;
+    }
+
+    if (configuration_internal_parse_boolean(text, &item->boolean))
+    {
+        item->types |= CONFIG_TYPE_BOOLEAN;
+    }
+
+    if (configuration_internal_parse_size(text, &item->size))
+    {
+        item->types |= CONFIG_TYPE_SIZE;
+    }
+
+    if (configuration_internal_parse_duration(text, &item->duration))
+    {
+        item->types |= CONFIG_TYPE_DURATION;
+    }
+}
+
+/* Converts every value once, while the snapshot is still private */
+static bool configuration_internal_type_entries(config_snapshot_t* snap)
+{
+    size_t item_capacity = 0;
+    size_t split_base = snap->source_size + 1;
+
+    if (snap->text_size > split_base)
+    {
+        memcpy(snap->text + split_base, snap->text, split_base);
+    }
+
+    for(uint32_t index = 0; index < snap->entry_count; index++)
+    {
+        config_entry_t* entry = &snap->entries[index];
+        const char* value = snap->text + entry->value;
+
+        configuration_internal_type_item(&entry->scalar, value, entry->value);
+        entry->item_first = CONFIG_SCALAR_ITEM;
+        entry->item_count = (value[0] != 0) ? 1 : 0;
+
+        if (strchr(value, ',') == NULL)
+        {
+            continue;
+        }
+
+        // Split in the second copy so the whole value remains readable as is
+        char* start = snap->text + split_base + entry->value;
+        entry->item_first = snap->item_count;
+        entry->item_count = 0;
+
+        while(true)
+        {
+            char* comma = strchr(start, ',');
+            char* end = (comma != NULL) ? comma : start + strlen(start);
+            char* next = (comma != NULL) ? comma + 1 : NULL;
+
+            configuration_internal_trim(&start, &end);
+            *end = 0;
+
+            if (snap->item_count >= item_capacity)
+            {
+                size_t new_capacity = (item_capacity == 0) ? 16 : item_capacity * 2;
+                config_item_t* temp = (config_item_t*)realloc(snap->items, new_capacity * sizeof(config_item_t));
+
+                if (temp == NULL)
+                {
+                    return false;
+                }
+
+                snap->items = temp;
+                item_capacity = new_capacity;
+            }
+
+            configuration_internal_type_item(&snap->items[snap->item_count++], start, (uint32_t)(start - snap->text));
+            entry->item_count++;
+
+            if (next == NULL)
+            {
+                break;
+            }
+
+            start = next;
+        }
+    }
+
+    return true;
+}
+
+static bool configuration_internal_write_block(FILE* fp, uint64_t* offset, const void* data, size_t len)
+{
+    static const char zeros[8] = {0};
+    size_t padding = (size_t)((8 - (*offset % 8)) % 8);
+
+    if (padding > 0 && fwrite(zeros, 1, padding, fp) != padding)
+    {
+        return false;
+    }
+
+    *offset += padding;
+
+    if (len > 0 && fwrite(data, 1, len, fp) != len)
+    {
+        return false;
+    }
+
+    *offset += len;
+
+    return true;
+}
+
+static uint32_t configuration_internal_image_layout(void)
+{
+    return (uint32_t)(sizeof(config_entry_t) | (sizeof(config_item_t) << 8) | (sizeof(config_section_t) << 16) | (sizeof(long) << 24));
+}
+
+static void configuration_internal_get_mtime(const struct stat* st, int64_t* sec, int64_t* nsec)
+{
+#if defined(__APPLE__)
+    *sec = (int64_t)st->st_mtimespec.tv_sec;
+    *nsec = (int64_t)st->st_mtimespec.tv_nsec;
+#else
+    *sec = (int64_t)st->st_mtim.tv_sec;
+    *nsec = (int64_t)st->st_mtim.tv_nsec;
+#endif
+}
+
+/* Written next to the target and renamed over it, so a reader never maps a
+   partial image */
+static bool configuration_internal_write_image(const config_snapshot_t* snap, const char* cache_filename, const struct stat* source_stat)
+{
+    config_image_header_t header;
+    memset(&header, 0, sizeof(header));
+
+    memcpy(header.magic, CONFIG_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = CONFIG_IMAGE_VERSION;
+    header.byte_order = CONFIG_IMAGE_ORDER;
+    header.layout = configuration_internal_image_layout();
+    header.source_hash = snap->source_hash;
+    header.source_size = snap->source_size;
+    configuration_internal_get_mtime(source_stat, &header.source_mtime_sec, &header.source_mtime_nsec);
+    header.text_size = snap->text_size;
+    header.section_count = snap->section_count;
+    header.section_mask = (snap->section_slots != NULL) ? snap->section_mask : 0;
+    header.entry_count = snap->entry_count;
+    header.entry_mask = snap->entry_mask;
+    header.item_count = snap->item_count;
+
+    size_t section_slot_count = (snap->section_slots != NULL) ? (size_t)snap->section_mask + 1 : 0;
+
+    // Offsets follow the order the blocks are written in
+    uint64_t offset = sizeof(header);
+    uint64_t* offsets[] = {&header.source_offset, &header.text_offset, &header.sections_offset, &header.section_slots_offset, &header.entries_offset, &header.entry_slots_offset, &header.items_offset};
+    const void* blocks[] = {snap->source, snap->text, snap->sections, snap->section_slots, snap->entries, snap->entry_slots, snap->items};
+    size_t lengths[] = {snap->source_size + 1, snap->text_size, snap->section_count * sizeof(config_section_t), section_slot_count * sizeof(uint32_t),
+                        snap->entry_count * sizeof(config_entry_t), ((size_t)snap->entry_mask + 1) * sizeof(uint32_t), snap->item_count * sizeof(config_item_t)};
+
+    for(size_t index = 0; index < sizeof(blocks) / sizeof(blocks[0]); index++)
+    {
+        offset = (offset + 7) & ~(uint64_t)7;
+        *offsets[index] = offset;
+        offset += lengths[index];
+    }
+
+    header.image_size = offset;
+    header.header_hash = configuration_internal_hash((const char*)&header, offsetof(config_image_header_t, header_hash));
+
+    size_t name_len = strlen(cache_filename);
+    char* temp_name = (char*)malloc(name_len + 32);
+
+    if (temp_name == NULL)
+    {
+        return false;
+    }
+
+    snprintf(temp_name, name_len + 32, "%s.%d.tmp", cache_filename, (int)getpid());
+
+    FILE* fp = fopen(temp_name, "wb");
+
+    if (fp == NULL)
+    {
+        free(temp_name);
+        return false;
+    }
+
+    offset = 0;
+    bool written = configuration_internal_write_block(fp, &offset, &header, sizeof(header));
+
+    for(size_t index = 0; written && index < sizeof(blocks) / sizeof(blocks[0]); index++)
+    {
+        written = configuration_internal_write_block(fp, &offset, blocks[index], lengths[index]);
+    }
+
+    if (fclose(fp) != 0 || !written || offset != header.image_size || rename(temp_name, cache_filename) != 0)
+    {
+        unlink(temp_name);
+        free(temp_name);
+        return false;
+    }
+
+    free(temp_name);
+
+    return true;
+}
+
+static bool configuration_internal_image_block(const config_image_header_t* header, uint64_t offset, uint64_t count, size_t item_size)
+{
+    if (offset % 8 != 0 || offset < sizeof(config_image_header_t) || offset > header->image_size)
+    {
+        return false;
+    }
+
+    return count <= (header->image_size - offset) / item_size;
+}
+
+/* True if some slot of an open addressed table is empty, so probes end, and
+   every used slot refers to one of 'count' records */
+static bool configuration_internal_image_slots(const uint32_t* slots, uint32_t mask, uint32_t count)
+{
+    bool has_empty = false;
+
+    for(uint64_t slot = 0; slot <= mask; slot++)
+    {
+        if (slots[slot] > count)
+        {
+            return false;
+        }
+
+        has_empty = has_empty || slots[slot] == 0;
+    }
+
+    return has_empty;
+}
+
+/* Every offset and index in the mapped body must stay inside its block.
+   Entry chains must move forward so that walking a section ends. */
+static bool configuration_internal_image_records(const config_snapshot_t* snap)
+{
+    if (snap->text_size == 0 || snap->text[snap->text_size - 1] != 0)
+    {
+        return false;
+    }
+
+    for(uint32_t index = 0; index < snap->section_count; index++)
+    {
+        const config_section_t* section = &snap->sections[index];
+
+        if (section->name >= snap->text_size || section->first > snap->entry_count || section->last > snap->entry_count)
+        {
+            return false;
+        }
+    }
+
+    for(uint32_t index = 0; index < snap->entry_count; index++)
+    {
+        const config_entry_t* entry = &snap->entries[index];
+
+        if (entry->key >= snap->text_size || entry->value >= snap->text_size || entry->scalar.text >= snap->text_size
+            || entry->section == 0 || entry->section > snap->section_count
+            || (entry->next != 0 && (entry->next <= index + 1 || entry->next > snap->entry_count)))
+        {
+            return false;
+        }
+
+        if (entry->item_first == CONFIG_SCALAR_ITEM ? entry->item_count > 1
+            : (entry->item_first > snap->item_count || entry->item_count > snap->item_count - entry->item_first))
+        {
+            return false;
+        }
+    }
+
+    for(uint32_t index = 0; index < snap->item_count; index++)
+    {
+        if (snap->items[index].text >= snap->text_size)
+        {
+            return false;
+        }
+    }
+
+    return (snap->section_slots == NULL || configuration_internal_image_slots(snap->section_slots, snap->section_mask, snap->section_count))
+           && configuration_internal_image_slots(snap->entry_slots, snap->entry_mask, snap->entry_count);
+}
+
+/* The header decides whether the image is current; the body is then checked
+   record by record, which is still far cheaper than parsing */
+static config_snapshot_t* configuration_internal_map_image(const char* cache_filename, const struct stat* source_stat)
+{
+    int fd = open(cache_filename, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(config_image_header_t))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    const config_image_header_t* header = (const config_image_header_t*)mapping;
+    int64_t mtime_sec = 0;
+    int64_t mtime_nsec = 0;
+    configuration_internal_get_mtime(source_stat, &mtime_sec, &mtime_nsec);
+
+    bool valid = memcmp(header->magic, CONFIG_IMAGE_MAGIC, sizeof(header->magic)) == 0
+            && header->version == CONFIG_IMAGE_VERSION
+            && header->byte_order == CONFIG_IMAGE_ORDER
+            && header->layout == configuration_internal_image_layout()
+            && header->header_hash == configuration_internal_hash((const char*)header, offsetof(config_image_header_t, header_hash))
+            && header->image_size == (uint64_t)st.st_size
+            && header->source_size == (uint64_t)source_stat->st_size
+            && header->source_mtime_sec == mtime_sec
+            && header->source_mtime_nsec == mtime_nsec;
+
+    // Stale images fail above; the rest guards against a damaged file
+    valid = valid
+            && header->text_size >= header->source_size + 1
+            && header->entry_mask >= CONFIGURATION_MIN_SLOTS - 1 && (header->entry_mask & (header->entry_mask + 1)) == 0
+            && (header->section_mask & (header->section_mask + 1)) == 0
+            && (header->section_count == 0 || header->section_mask != 0)
+            && configuration_internal_image_block(header, header->source_offset, header->source_size + 1, 1)
+            && configuration_internal_image_block(header, header->text_offset, header->text_size, 1)
+            && configuration_internal_image_block(header, header->sections_offset, header->section_count, sizeof(config_section_t))
+            && configuration_internal_image_block(header, header->section_slots_offset, (header->section_mask != 0) ? (uint64_t)header->section_mask + 1 : 0, sizeof(uint32_t))
+            && configuration_internal_image_block(header, header->entries_offset, header->entry_count, sizeof(config_entry_t))
+            && configuration_internal_image_block(header, header->entry_slots_offset, (uint64_t)header->entry_mask + 1, sizeof(uint32_t))
+            && configuration_internal_image_block(header, header->items_offset, header->item_count, sizeof(config_item_t));
+
+    config_snapshot_t* snap = valid ? (config_snapshot_t*)calloc(1, sizeof(config_snapshot_t)) : NULL;
+
+    if (snap == NULL)
+    {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    char* base = (char*)mapping;
+
+    snap->mapping = mapping;
+    snap->mapping_size = (size_t)st.st_size;
+    snap->source = base + header->source_offset;
+    snap->source_size = (size_t)header->source_size;
+    snap->source_hash = header->source_hash;
+    snap->text = base + header->text_offset;
+    snap->text_size = (size_t)header->text_size;
+    snap->sections = (config_section_t*)(base + header->sections_offset);
+    snap->section_count = header->section_count;
+    snap->section_slots = (header->section_mask != 0) ? (uint32_t*)(base + header->section_slots_offset) : NULL;
+    snap->section_mask = header->section_mask;
+    snap->entries = (config_entry_t*)(base + header->entries_offset);
+    snap->entry_count = header->entry_count;
+    snap->entry_slots = (uint32_t*)(base + header->entry_slots_offset);
+    snap->entry_mask = header->entry_mask;
+    snap->items = (config_item_t*)(base + header->items_offset);
+    snap->item_count = header->item_count;
+    snap->missing.value = CONFIG_NO_VALUE;
+    snap->missing.item_first = CONFIG_SCALAR_ITEM;
+
+    // A damaged body makes the caller parse the file instead
+    if (!configuration_internal_image_records(snap))
+    {
+        configuration_internal_free_snapshot(snap);
+        return NULL;
+    }
+
+    return snap;
 }
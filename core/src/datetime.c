@@ -31,6 +31,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <time.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <strings.h>
+#include <limits.h>
 
 typedef struct date_time_t
 {
@@ -38,6 +40,26 @@ typedef struct date_time_t
 
 }date_time_t;
 
+static const char date_time_day_names[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char date_time_month_names[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+static const char date_time_month_full_names[12][10] = {"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"};
+
+static _Thread_local long long cached_offset_slot = LLONG_MIN;
+static _Thread_local long cached_offset = 0;
+
+static char* date_time_internal_put2(char* out, int value)
+{
+	out[0] = (char)('0' + value / 10);
+	out[1] = (char)('0' + value % 10);
+	return out + 2;
+}
+
+static char* date_time_internal_put4(char* out, int value)
+{
+	out = date_time_internal_put2(out, value / 100);
+	return date_time_internal_put2(out, value % 100);
+}
+
 char* date_time_get_default_string(char* ptr)
 {
     if(!ptr)
@@ -97,17 +119,22 @@ date_time_t* date_time_allocate_default()
 	return retval;
 }
 
-// Helper function to extract integer from string at position
-static int extract_int_from_string(const char* str, size_t pos, int len)
+// Reads the digits of str[pos .. pos + len - 1]; 0 when out of range
+static int extract_int_from_string(const char* str, size_t str_len, size_t pos, int len)
 {
-	if(str == NULL || pos + len > strlen(str)) 
+	if(pos + len > str_len)
 	{
 		return 0;
 	}
-	
-	char temp[5] = {0};
-	strncpy(temp, str + pos, len);
-	return atoi(temp);
+
+	int value = 0;
+
+	for(int index = 0; index < len && str[pos + index] >= '0' && str[pos + index] <= '9'; index++)
+	{
+		value = value * 10 + (str[pos + index] - '0');
+	}
+
+	return value;
 }
 
 date_time_t* date_time_allocate_from_string(const char* strts, const char* strformat)
@@ -124,10 +151,13 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	}
 
 	// Initialize with current time as base
-	time_t t;
-	time(&t);
-	struct tm* tmp = localtime(&t);
-	retval->timeinfo = *tmp;
+	time_t t = time(NULL);
+
+	if(localtime_r(&t, &retval->timeinfo) == NULL)
+	{
+		free(retval);
+		return NULL;
+	}
 
 	// Simple string parsing based on your C++ logic
 	size_t str_len = strlen(strts);
@@ -143,7 +173,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	if(pos != NULL)
 	{
 		size_t idx = pos - strformat;
-		retval->timeinfo.tm_year = extract_int_from_string(strts, idx, 4) - 1900;
+		retval->timeinfo.tm_year = extract_int_from_string(strts, str_len, idx, 4) - 1900;
 	}
 	else
 	{
@@ -151,7 +181,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 		if(pos != NULL)
 		{
 			size_t idx = pos - strformat;
-			retval->timeinfo.tm_year = extract_int_from_string(strts, idx, 2) + 100;
+			retval->timeinfo.tm_year = extract_int_from_string(strts, str_len, idx, 2) + 100;
 		}
 	}
 
@@ -160,7 +190,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	if(pos != NULL)
 	{
 		size_t idx = pos - strformat;
-		retval->timeinfo.tm_mon = extract_int_from_string(strts, idx, 2) - 1;
+		retval->timeinfo.tm_mon = extract_int_from_string(strts, str_len, idx, 2) - 1;
 	}
 
 	// Find and parse day
@@ -168,7 +198,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	if(pos != NULL)
 	{
 		size_t idx = pos - strformat;
-		retval->timeinfo.tm_mday = extract_int_from_string(strts, idx, 2);
+		retval->timeinfo.tm_mday = extract_int_from_string(strts, str_len, idx, 2);
 	}
 
 	// Find and parse hour
@@ -176,7 +206,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	if(pos != NULL)
 	{
 		size_t idx = pos - strformat;
-		retval->timeinfo.tm_hour = extract_int_from_string(strts, idx, 2);
+		retval->timeinfo.tm_hour = extract_int_from_string(strts, str_len, idx, 2);
 	}
 
 	// Find and parse minute  
@@ -184,7 +214,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	if(pos != NULL)
 	{
 		size_t idx = pos - strformat;
-		retval->timeinfo.tm_min = extract_int_from_string(strts, idx, 2);
+		retval->timeinfo.tm_min = extract_int_from_string(strts, str_len, idx, 2);
 	}
 
 	// Find and parse second
@@ -192,7 +222,7 @@ date_time_t* date_time_allocate_from_string(const char* strts, const char* strfo
 	if(pos != NULL)
 	{
 		size_t idx = pos - strformat;
-		retval->timeinfo.tm_sec = extract_int_from_string(strts, idx, 2);
+		retval->timeinfo.tm_sec = extract_int_from_string(strts, str_len, idx, 2);
 	}
 
 	return retval;
@@ -270,34 +300,6 @@ char* date_time_get_string(date_time_t* ptr)
 	return retval;
 }
 
-// Helper function to replace substring in string (for formatting)
-static void str_replace_format(char* dest, const char* src, const char* find, const char* replace, size_t dest_size)
-{
-	char* pos = strstr(src, find);
-	if(pos == NULL)
-	{
-		strncpy(dest, src, dest_size - 1);
-		dest[dest_size - 1] = '\0';
-		return;
-	}
-	
-	size_t prefix_len = pos - src;
-	size_t find_len = strlen(find);
-	size_t replace_len = strlen(replace);
-	size_t suffix_len = strlen(pos + find_len);
-	
-	if(prefix_len + replace_len + suffix_len >= dest_size)
-	{
-		strncpy(dest, src, dest_size - 1);
-		dest[dest_size - 1] = '\0';
-		return;
-	}
-	
-	strncpy(dest, src, prefix_len);
-	strcpy(dest + prefix_len, replace);
-	strcpy(dest + prefix_len + replace_len, pos + find_len);
-}
-
 // NOTE: Caller must call free() on returned string
 char* date_time_get_formatted_string(date_time_t* ptr, const char* strformat)
 {
@@ -312,105 +314,118 @@ char* date_time_get_formatted_string(date_time_t* ptr, const char* strformat)
 		return NULL;
 	}
 
-	char temp_format[256] = {0};
-	strncpy(temp_format, strformat, 255);
-	
-	bool am_pm_needed = false;
-	
-	// Convert custom format to strftime format
-	char work_buf[256] = {0};
-	
-	// Handle seconds
-	if(strstr(temp_format, "ss"))
-	{
-		str_replace_format(work_buf, temp_format, "ss", "%S", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-	}
-	
-	// Handle minutes
-	if(strstr(temp_format, "mm"))
-	{
-		str_replace_format(work_buf, temp_format, "mm", "%M", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-	}
-	
-	// Handle hours
-	if(strstr(temp_format, "hh"))
-	{
-		str_replace_format(work_buf, temp_format, "hh", "%H", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-	}
-	else if(strstr(temp_format, "h"))
-	{
-		str_replace_format(work_buf, temp_format, "h", "%I", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-		am_pm_needed = true;
-	}
-	
-	// Handle day
-	if(strstr(temp_format, "dd"))
-	{
-		str_replace_format(work_buf, temp_format, "dd", "%d", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-	}
-	
-	// Handle month name vs number
-	if(strstr(temp_format, "MMMM"))
-	{
-		str_replace_format(work_buf, temp_format, "MMMM", "%B", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-	}
-	else if(strstr(temp_format, "MM"))
-	{
-		str_replace_format(work_buf, temp_format, "MM", "%m", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
-	}
-	
-	// Handle year
-	if(strstr(temp_format, "yyyy"))
+	if(date_time_format(ptr, strformat, retval, 256) == 0)
 	{
-		str_replace_format(work_buf, temp_format, "yyyy", "%Y", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
+		free(retval);
+		return NULL;
 	}
-	else if(strstr(temp_format, "yy"))
+
+	return retval;
+}
+
+size_t date_time_format(date_time_t* ptr, const char* strformat, char* out, size_t out_size)
+{
+	if(ptr == NULL || strformat == NULL || out == NULL || out_size == 0)
 	{
-		str_replace_format(work_buf, temp_format, "yy", "%y", sizeof(work_buf));
-		strcpy(temp_format, work_buf);
+		return 0;
 	}
-	
-	// Add AM/PM if needed
-	if(am_pm_needed)
+
+	const struct tm* tm = &ptr->timeinfo;
+	int year = tm->tm_year < 100 ? tm->tm_year + 100 + 1900 : tm->tm_year + 1900;
+	int month = tm->tm_mon >= 0 && tm->tm_mon < 12 ? tm->tm_mon : 0;
+	bool am_pm_needed = false;
+	size_t len = 0;
+
+	for(const char* fmt = strformat; *fmt != 0; )
 	{
-		size_t temp_len = strlen(temp_format);
-		const char* ampm = " %p";
-		size_t ampm_len = strlen(ampm);
+		char field[16];
+		size_t field_len = 0;
 
-		if(temp_len + ampm_len >= sizeof(temp_format))
+		if(strncmp(fmt, "yyyy", 4) == 0)
 		{
-			free(retval);
-			return NULL;
+			field_len = (size_t)snprintf(field, sizeof(field), "%04d", year);
+			fmt += 4;
+		}
+		else if(strncmp(fmt, "yy", 2) == 0)
+		{
+			date_time_internal_put2(field, year % 100);
+			field_len = 2;
+			fmt += 2;
+		}
+		else if(strncmp(fmt, "MMMM", 4) == 0)
+		{
+			field_len = strlen(date_time_month_full_names[month]);
+			memcpy(field, date_time_month_full_names[month], field_len);
+			fmt += 4;
+		}
+		else if(strncmp(fmt, "MM", 2) == 0)
+		{
+			date_time_internal_put2(field, month + 1);
+			field_len = 2;
+			fmt += 2;
+		}
+		else if(strncmp(fmt, "dd", 2) == 0)
+		{
+			date_time_internal_put2(field, tm->tm_mday);
+			field_len = 2;
+			fmt += 2;
+		}
+		else if(strncmp(fmt, "hh", 2) == 0)
+		{
+			date_time_internal_put2(field, tm->tm_hour);
+			field_len = 2;
+			fmt += 2;
+		}
+		else if(*fmt == 'h')
+		{
+			// 12 hour clock, AM/PM goes at the end
+			date_time_internal_put2(field, tm->tm_hour % 12 == 0 ? 12 : tm->tm_hour % 12);
+			field_len = 2;
+			am_pm_needed = true;
+			fmt++;
+		}
+		else if(strncmp(fmt, "mm", 2) == 0)
+		{
+			date_time_internal_put2(field, tm->tm_min);
+			field_len = 2;
+			fmt += 2;
+		}
+		else if(strncmp(fmt, "ss", 2) == 0)
+		{
+			date_time_internal_put2(field, tm->tm_sec);
+			field_len = 2;
+			fmt += 2;
+		}
+		else
+		{
+			field[0] = *fmt++;
+			field_len = 1;
 		}
 
-		memcpy(temp_format + temp_len, ampm, ampm_len + 1);
-	}
-	
-	// Make a copy of timeinfo to avoid modification
-	struct tm temp_tm = ptr->timeinfo;
-	
-	// Ensure year is correct for strftime
-	if(temp_tm.tm_year < 100)
-	{
-		temp_tm.tm_year += 100;
+		if(len + field_len >= out_size)
+		{
+			out[0] = 0;
+			return 0;
+		}
+
+		memcpy(out + len, field, field_len);
+		len += field_len;
 	}
-	
-	// Format the string
-	if(strftime(retval, 256, temp_format, &temp_tm) == 0)
+
+	if(am_pm_needed)
 	{
-		free(retval);
-		return NULL;
+		if(len + 3 >= out_size)
+		{
+			out[0] = 0;
+			return 0;
+		}
+
+		memcpy(out + len, tm->tm_hour < 12 ? " AM" : " PM", 3);
+		len += 3;
 	}
 
-	return retval;
+	out[len] = 0;
+	return len;
 }
 
 time_t date_time_get_unix_epoch(date_time_t* ptr)
@@ -814,3 +829,681 @@ date_time_t* date_time_from_epoch_ll(unsigned long long epoch)
 	// Use existing time_t function
 	return date_time_allocate_from_unix_epoch(t);
 }
+
+/*
+  Protocol timestamps. Calendar arithmetic uses the days-from-civil
+  algorithm over the proleptic Gregorian calendar, so no libc time
+  conversion, locale or lock is involved. Only the local zone offset
+  comes from localtime_r, and it is cached per thread for the current
+  quarter hour (zone transitions fall on quarter hours).
+*/
+
+static long long date_time_internal_days_from_civil(long long year, int month, int day)
+{
+	year -= month <= 2;
+	long long era = (year >= 0 ? year : year - 399) / 400;
+	long long yoe = year - era * 400;
+	long long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+static void date_time_internal_civil_from_days(long long days, long long* year, int* month, int* day)
+{
+	days += 719468;
+	long long era = (days >= 0 ? days : days - 146096) / 146097;
+	long long doe = days - era * 146097;
+	long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long long mp = (5 * doy + 2) / 153;
+
+	*day = (int)(doy - (153 * mp + 2) / 5 + 1);
+	*month = (int)(mp < 10 ? mp + 3 : mp - 9);
+	*year = yoe + era * 400 + (*month <= 2);
+}
+
+static int date_time_internal_days_in_month(long long year, int month)
+{
+	static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+	if(month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+	{
+		return 29;
+	}
+
+	return days[month - 1];
+}
+
+// Broken down wall clock time of 't' shifted by 'offset' seconds
+typedef struct date_time_fields_t
+{
+	long long year;
+	int month;
+	int day;
+	int hour;
+	int minute;
+	int second;
+	int weekday;
+}date_time_fields_t;
+
+static void date_time_internal_split(time_t t, long offset, date_time_fields_t* fields)
+{
+	long long seconds = (long long)t + offset;
+	long long days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+	long long rest = seconds - days * 86400;
+
+	date_time_internal_civil_from_days(days, &fields->year, &fields->month, &fields->day);
+	fields->hour = (int)(rest / 3600);
+	fields->minute = (int)(rest / 60 % 60);
+	fields->second = (int)(rest % 60);
+	fields->weekday = (int)((days % 7 + 11) % 7);
+}
+
+// Reads exactly 'count' digits
+static bool date_time_internal_digits(const char** cursor, const char* end, int count, int* value)
+{
+	const char* ptr = *cursor;
+	int result = 0;
+
+	if(end - ptr < count)
+	{
+		return false;
+	}
+
+	for(int index = 0; index < count; index++)
+	{
+		if(ptr[index] < '0' || ptr[index] > '9')
+		{
+			return false;
+		}
+
+		result = result * 10 + (ptr[index] - '0');
+	}
+
+	*cursor = ptr + count;
+	*value = result;
+	return true;
+}
+
+static bool date_time_internal_is_digit(const char* cursor, const char* end)
+{
+	return cursor < end && *cursor >= '0' && *cursor <= '9';
+}
+
+static bool date_time_internal_valid(long long year, int month, int day, int hour, int minute, int second)
+{
+	if(month < 1 || month > 12 || day < 1 || day > date_time_internal_days_in_month(year, month))
+	{
+		return false;
+	}
+
+	// Second 60 is a leap second
+	return hour < 24 && minute < 60 && second <= 60;
+}
+
+static time_t date_time_internal_join(long long year, int month, int day, int hour, int minute, int second)
+{
+	long long days = date_time_internal_days_from_civil(year, month, day);
+
+	return (time_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+// Treats a wall clock time without zone as local time
+static time_t date_time_internal_from_local(time_t wall, long* offset)
+{
+	long first = date_time_get_local_offset(wall);
+	long second = date_time_get_local_offset(wall - first);
+
+	*offset = second;
+	return wall - second;
+}
+
+long date_time_get_local_offset(time_t t)
+{
+	long long slot = (long long)t / 900;
+
+	if(slot == cached_offset_slot)
+	{
+		return cached_offset;
+	}
+
+	struct tm local_tm;
+
+	if(localtime_r(&t, &local_tm) == NULL)
+	{
+		return 0;
+	}
+
+	cached_offset = local_tm.tm_gmtoff;
+	cached_offset_slot = slot;
+
+	return cached_offset;
+}
+
+size_t date_time_format_rfc3339(time_t t, long offset, char* out, size_t out_size)
+{
+	date_time_fields_t fields;
+	date_time_internal_split(t, offset, &fields);
+
+	size_t len = offset == 0 ? 20 : 25;
+
+	if(out == NULL || out_size <= len || fields.year < 0 || fields.year > 9999 || offset % 60 != 0 || labs(offset) >= 86400)
+	{
+		return 0;
+	}
+
+	char* ptr = date_time_internal_put4(out, (int)fields.year);
+	*ptr++ = '-';
+	ptr = date_time_internal_put2(ptr, fields.month);
+	*ptr++ = '-';
+	ptr = date_time_internal_put2(ptr, fields.day);
+	*ptr++ = 'T';
+	ptr = date_time_internal_put2(ptr, fields.hour);
+	*ptr++ = ':';
+	ptr = date_time_internal_put2(ptr, fields.minute);
+	*ptr++ = ':';
+	ptr = date_time_internal_put2(ptr, fields.second);
+
+	if(offset == 0)
+	{
+		*ptr++ = 'Z';
+	}
+	else
+	{
+		long minutes = labs(offset) / 60;
+		*ptr++ = offset < 0 ? '-' : '+';
+		ptr = date_time_internal_put2(ptr, (int)(minutes / 60));
+		*ptr++ = ':';
+		ptr = date_time_internal_put2(ptr, (int)(minutes % 60));
+	}
+
+	*ptr = 0;
+	return len;
+}
+
+size_t date_time_format_rfc2822(time_t t, long offset, char* out, size_t out_size)
+{
+	date_time_fields_t fields;
+	date_time_internal_split(t, offset, &fields);
+
+	if(out == NULL || out_size <= 31 || fields.year < 0 || fields.year > 9999 || offset % 60 != 0 || labs(offset) >= 86400)
+	{
+		return 0;
+	}
+
+	long minutes = labs(offset) / 60;
+
+	memcpy(out, date_time_day_names[fields.weekday], 3);
+	out[3] = ',';
+	out[4] = ' ';
+	char* ptr = date_time_internal_put2(out + 5, fields.day);
+	*ptr++ = ' ';
+	memcpy(ptr, date_time_month_names[fields.month - 1], 3);
+	ptr += 3;
+	*ptr++ = ' ';
+	ptr = date_time_internal_put4(ptr, (int)fields.year);
+	*ptr++ = ' ';
+	ptr = date_time_internal_put2(ptr, fields.hour);
+	*ptr++ = ':';
+	ptr = date_time_internal_put2(ptr, fields.minute);
+	*ptr++ = ':';
+	ptr = date_time_internal_put2(ptr, fields.second);
+	*ptr++ = ' ';
+	*ptr++ = offset < 0 ? '-' : '+';
+	ptr = date_time_internal_put4(ptr, (int)(minutes / 60 * 100 + minutes % 60));
+	*ptr = 0;
+
+	return 31;
+}
+
+size_t date_time_format_imap_date(time_t t, long offset, char* out, size_t out_size)
+{
+	date_time_fields_t fields;
+	date_time_internal_split(t, offset, &fields);
+
+	if(out == NULL || out_size <= 11 || fields.year < 0 || fields.year > 9999)
+	{
+		return 0;
+	}
+
+	char* ptr = date_time_internal_put2(out, fields.day);
+	*ptr++ = '-';
+	memcpy(ptr, date_time_month_names[fields.month - 1], 3);
+	ptr += 3;
+	*ptr++ = '-';
+	ptr = date_time_internal_put4(ptr, (int)fields.year);
+	*ptr = 0;
+
+	return 11;
+}
+
+static bool date_time_internal_parse_iso8601(const char* str, size_t len, bool strict, time_t* t, long* offset)
+{
+	if(str == NULL || t == NULL)
+	{
+		return false;
+	}
+
+	const char* ptr = str;
+	const char* end = str + len;
+	int year = 0;
+	int month = 0;
+	int day = 0;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	long zone = 0;
+	bool has_zone = false;
+
+	if(!date_time_internal_digits(&ptr, end, 4, &year))
+	{
+		return false;
+	}
+
+	// Extended (2026-10-18) or basic (20261018) form; the time follows suit
+	bool extended = ptr < end && *ptr == '-';
+
+	if(strict && !extended)
+	{
+		return false;
+	}
+
+	if(extended)
+	{
+		ptr++;
+	}
+
+	if(!date_time_internal_digits(&ptr, end, 2, &month))
+	{
+		return false;
+	}
+
+	if(extended && (ptr == end || *ptr++ != '-'))
+	{
+		return false;
+	}
+
+	if(!date_time_internal_digits(&ptr, end, 2, &day))
+	{
+		return false;
+	}
+
+	if(ptr < end && (*ptr == 'T' || *ptr == 't' || *ptr == ' '))
+	{
+		ptr++;
+
+		if(!date_time_internal_digits(&ptr, end, 2, &hour))
+		{
+			return false;
+		}
+
+		if(extended && (ptr == end || *ptr++ != ':'))
+		{
+			return false;
+		}
+
+		if(!date_time_internal_digits(&ptr, end, 2, &minute))
+		{
+			return false;
+		}
+
+		if(ptr < end && (extended ? *ptr == ':' : date_time_internal_is_digit(ptr, end)))
+		{
+			if(extended)
+			{
+				ptr++;
+			}
+
+			if(!date_time_internal_digits(&ptr, end, 2, &second))
+			{
+				return false;
+			}
+
+			// Fractions of a second are accepted and dropped
+			if(ptr < end && (*ptr == '.' || (*ptr == ',' && !strict)))
+			{
+				ptr++;
+
+				if(!date_time_internal_is_digit(ptr, end))
+				{
+					return false;
+				}
+
+				while(date_time_internal_is_digit(ptr, end))
+				{
+					ptr++;
+				}
+			}
+		}
+		else if(strict)
+		{
+			return false;
+		}
+
+		if(ptr < end && (*ptr == 'Z' || *ptr == 'z'))
+		{
+			ptr++;
+			has_zone = true;
+		}
+		else if(ptr < end && (*ptr == '+' || *ptr == '-'))
+		{
+			int sign = *ptr++ == '-' ? -1 : 1;
+			int zone_hour = 0;
+			int zone_minute = 0;
+
+			if(!date_time_internal_digits(&ptr, end, 2, &zone_hour))
+			{
+				return false;
+			}
+
+			if(ptr < end && *ptr == ':')
+			{
+				ptr++;
+
+				if(!date_time_internal_digits(&ptr, end, 2, &zone_minute))
+				{
+					return false;
+				}
+			}
+			else if(strict)
+			{
+				return false;
+			}
+			else if(date_time_internal_is_digit(ptr, end) && !date_time_internal_digits(&ptr, end, 2, &zone_minute))
+			{
+				return false;
+			}
+
+			if(zone_hour > 23 || zone_minute > 59)
+			{
+				return false;
+			}
+
+			zone = sign * (zone_hour * 3600L + zone_minute * 60L);
+			has_zone = true;
+		}
+	}
+	else if(strict)
+	{
+		return false;
+	}
+
+	// ISO 8601 allows 24:00:00 for the end of the day; RFC 3339 does not
+	bool end_of_day = !strict && hour == 24 && minute == 0 && second == 0;
+
+	if(ptr != end || (strict && !has_zone) || !date_time_internal_valid(year, month, day, end_of_day ? 0 : hour, minute, second))
+	{
+		return false;
+	}
+
+	time_t wall = date_time_internal_join(year, month, day, hour, minute, second);
+
+	if(!has_zone)
+	{
+		wall = date_time_internal_from_local(wall, &zone);
+	}
+	else
+	{
+		wall -= zone;
+	}
+
+	*t = wall;
+
+	if(offset != NULL)
+	{
+		*offset = zone;
+	}
+
+	return true;
+}
+
+bool date_time_parse_iso8601(const char* str, size_t len, time_t* t, long* offset)
+{
+	return date_time_internal_parse_iso8601(str, len, false, t, offset);
+}
+
+bool date_time_parse_rfc3339(const char* str, size_t len, time_t* t, long* offset)
+{
+	return date_time_internal_parse_iso8601(str, len, true, t, offset);
+}
+
+// Folding white space and (possibly nested) comments
+static void date_time_internal_skip_cfws(const char** cursor, const char* end)
+{
+	const char* ptr = *cursor;
+	int depth = 0;
+
+	while(ptr < end)
+	{
+		if(*ptr == '(')
+		{
+			depth++;
+		}
+		else if(*ptr == ')' && depth > 0)
+		{
+			depth--;
+		}
+		else if(*ptr == '\\' && depth > 0 && ptr + 1 < end)
+		{
+			ptr++;
+		}
+		else if(depth == 0 && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')
+		{
+			break;
+		}
+
+		ptr++;
+	}
+
+	*cursor = ptr;
+}
+
+// Matches a three letter name, ignoring case
+static int date_time_internal_name(const char** cursor, const char* end, const char (*names)[4], int count)
+{
+	if(end - *cursor < 3)
+	{
+		return -1;
+	}
+
+	for(int index = 0; index < count; index++)
+	{
+		const char* name = names[index];
+		const char* ptr = *cursor;
+
+		if((ptr[0] | 0x20) == (name[0] | 0x20) && (ptr[1] | 0x20) == name[1] && (ptr[2] | 0x20) == name[2])
+		{
+			*cursor = ptr + 3;
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+// Obsolete alphabetic zones of RFC 5322 section 4.3
+static bool date_time_internal_zone_name(const char** cursor, const char* end, long* zone)
+{
+	static const struct
+	{
+		const char* name;
+		long hours;
+	} zones[] = {{"UT", 0}, {"GMT", 0}, {"EST", -5}, {"EDT", -4}, {"CST", -6}, {"CDT", -5}, {"MST", -7}, {"MDT", -6}, {"PST", -8}, {"PDT", -7}};
+	const char* ptr = *cursor;
+	size_t len = 0;
+
+	while(ptr + len < end && ((ptr[len] | 0x20) >= 'a' && (ptr[len] | 0x20) <= 'z'))
+	{
+		len++;
+	}
+
+	for(size_t index = 0; index < sizeof(zones) / sizeof(zones[0]); index++)
+	{
+		if(strlen(zones[index].name) == len && strncasecmp(ptr, zones[index].name, len) == 0)
+		{
+			*zone = zones[index].hours * 3600;
+			*cursor = ptr + len;
+			return true;
+		}
+	}
+
+	// Military zones carry no reliable meaning and count as -0000
+	if(len == 1 && (*ptr | 0x20) != 'j')
+	{
+		*zone = 0;
+		*cursor = ptr + 1;
+		return true;
+	}
+
+	return false;
+}
+
+bool date_time_parse_rfc2822(const char* str, size_t len, time_t* t, long* offset)
+{
+	if(str == NULL || t == NULL)
+	{
+		return false;
+	}
+
+	const char* ptr = str;
+	const char* end = str + len;
+	long long year = 0;
+	int day = 0;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	long zone = 0;
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	if(ptr < end && !date_time_internal_is_digit(ptr, end))
+	{
+		if(date_time_internal_name(&ptr, end, date_time_day_names, 7) < 0)
+		{
+			return false;
+		}
+
+		date_time_internal_skip_cfws(&ptr, end);
+
+		if(ptr == end || *ptr++ != ',')
+		{
+			return false;
+		}
+
+		date_time_internal_skip_cfws(&ptr, end);
+	}
+
+	if(!date_time_internal_digits(&ptr, end, 1, &day))
+	{
+		return false;
+	}
+
+	if(date_time_internal_is_digit(ptr, end))
+	{
+		day = day * 10 + (*ptr++ - '0');
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	int month = date_time_internal_name(&ptr, end, date_time_month_names, 12) + 1;
+
+	if(month == 0)
+	{
+		return false;
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	const char* year_start = ptr;
+
+	while(date_time_internal_is_digit(ptr, end) && ptr - year_start < 9)
+	{
+		year = year * 10 + (*ptr++ - '0');
+	}
+
+	// Two and three digit years are obsolete forms (RFC 5322 section 4.3)
+	switch(ptr - year_start)
+	{
+	case 0:
+	case 1:
+		return false;
+	case 2:
+		year += year < 50 ? 2000 : 1900;
+		break;
+	case 3:
+		year += 1900;
+		break;
+	default:
+		break;
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	if(!date_time_internal_digits(&ptr, end, 2, &hour))
+	{
+		return false;
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	if(ptr == end || *ptr++ != ':')
+	{
+		return false;
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	if(!date_time_internal_digits(&ptr, end, 2, &minute))
+	{
+		return false;
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	if(ptr < end && *ptr == ':')
+	{
+		ptr++;
+		date_time_internal_skip_cfws(&ptr, end);
+
+		if(!date_time_internal_digits(&ptr, end, 2, &second))
+		{
+			return false;
+		}
+
+		date_time_internal_skip_cfws(&ptr, end);
+	}
+
+	if(ptr < end && (*ptr == '+' || *ptr == '-'))
+	{
+		int sign = *ptr++ == '-' ? -1 : 1;
+		int zone_value = 0;
+
+		if(!date_time_internal_digits(&ptr, end, 4, &zone_value) || zone_value % 100 > 59)
+		{
+			return false;
+		}
+
+		zone = sign * ((zone_value / 100) * 3600L + (zone_value % 100) * 60L);
+	}
+	else if(!date_time_internal_zone_name(&ptr, end, &zone))
+	{
+		return false;
+	}
+
+	date_time_internal_skip_cfws(&ptr, end);
+
+	if(ptr != end || !date_time_internal_valid(year, month, day, hour, minute, second))
+	{
+		return false;
+	}
+
+	*t = date_time_internal_join(year, month, day, hour, minute, second) - zone;
+
+	if(offset != NULL)
+	{
+		*offset = zone;
+	}
+
+	return true;
+}
@@ -35,8 +35,20 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+typedef struct file_map_t
+{
+	char* data;
+	size_t size;
+	bool mapped;
+}file_map_t;
+
+static bool file_internal_read_all(int fd, file_map_t* ptr);
 
 bool file_is_exists(const char* filename)
 {
@@ -181,3 +193,162 @@ char* file_get_extension(const char* filename)
 
     return extension;
 }
+
+file_map_t* file_map_open(const char* filename)
+{
+	if(filename == NULL || filename[0] == 0)
+	{
+		return NULL;
+	}
+
+	int fd = open(filename, O_RDONLY);
+
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	file_map_t* ptr = (file_map_t*)calloc(1, sizeof(file_map_t));
+
+	if(ptr == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	struct stat st;
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	// The zero filled remainder of the last page terminates the data, which
+	// only exists when the size is not a multiple of the page size
+	if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && page_size > 0 && (st.st_size % page_size) != 0)
+	{
+		void* addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(addr != MAP_FAILED)
+		{
+			madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+			ptr->data = (char*)addr;
+			ptr->size = (size_t)st.st_size;
+			ptr->mapped = true;
+			close(fd);
+			return ptr;
+		}
+	}
+
+	if(!file_internal_read_all(fd, ptr))
+	{
+		close(fd);
+		free(ptr);
+		return NULL;
+	}
+
+	close(fd);
+	return ptr;
+}
+
+void file_map_close(file_map_t* ptr)
+{
+	if(ptr == NULL)
+	{
+		return;
+	}
+
+	if(ptr->mapped)
+	{
+		munmap(ptr->data, ptr->size);
+	}
+	else
+	{
+		free(ptr->data);
+	}
+
+	free(ptr);
+}
+
+const char* file_map_get_data(const file_map_t* ptr)
+{
+	if(ptr == NULL)
+	{
+		return NULL;
+	}
+
+	return ptr->data;
+}
+
+size_t file_map_get_size(const file_map_t* ptr)
+{
+	if(ptr == NULL)
+	{
+		return 0;
+	}
+
+	return ptr->size;
+}
+
+bool file_map_is_mapped(const file_map_t* ptr)
+{
+	if(ptr == NULL)
+	{
+		return false;
+	}
+
+	return ptr->mapped;
+}
+
+static bool file_internal_read_all(int fd, file_map_t* ptr)
+{
+	size_t capacity = 64 * 1024;
+	size_t size = 0;
+	char* data = (char*)malloc(capacity);
+
+	if(data == NULL)
+	{
+		return false;
+	}
+
+	while(true)
+	{
+		// Keep room for the terminating NUL
+		if(capacity - size < 2)
+		{
+			char* grown = (char*)realloc(data, capacity * 2);
+
+			if(grown == NULL)
+			{
+				free(data);
+				return false;
+			}
+
+			data = grown;
+			capacity *= 2;
+		}
+
+		ssize_t count = read(fd, data + size, capacity - size - 1);
+
+		if(count < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			free(data);
+			return false;
+		}
+
+		if(count == 0)
+		{
+			break;
+		}
+
+		size += (size_t)count;
+	}
+
+	data[size] = 0;
+	ptr->data = data;
+	ptr->size = size;
+	ptr->mapped = false;
+
+	return true;
+}
@@ -0,0 +1,999 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "gzip.h"
+#include <memory.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define GZIP_WINDOW_SIZE  32768
+#define GZIP_HASH_BITS    15
+#define GZIP_HASH_SIZE    (1 << GZIP_HASH_BITS)
+#define GZIP_MIN_MATCH    3
+#define GZIP_MAX_MATCH    258
+#define GZIP_MAX_CHAIN    64
+#define GZIP_NICE_MATCH   128
+#define GZIP_MAX_BITS     15
+#define GZIP_HEADER_SIZE  10
+#define GZIP_TRAILER_SIZE 8
+
+static const unsigned short length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                  8193, 12289, 16385, 24577 };
+static const unsigned char distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const unsigned char code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+typedef struct gzip_bit_writer_t
+{
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+    uint64_t bits;
+    unsigned int count;
+    bool failed;
+}gzip_bit_writer_t;
+
+typedef struct gzip_huffman_t
+{
+    unsigned short count[GZIP_MAX_BITS + 1];
+    unsigned short symbol[288];
+}gzip_huffman_t;
+
+typedef struct gzip_inflater_t
+{
+    const unsigned char* in;
+    size_t in_size;
+    size_t in_pos;
+    uint32_t bits;
+    unsigned int count;
+    unsigned char* out;
+    size_t out_size;
+    size_t out_capacity;
+    bool failed;
+}gzip_inflater_t;
+
+static void gzip_internal_build_crc_table(void);
+static bool gzip_internal_reserve(gzip_bit_writer_t* writer, size_t more);
+static void gzip_internal_put_bits(gzip_bit_writer_t* writer, uint32_t value, unsigned int count);
+static void gzip_internal_put_code(gzip_bit_writer_t* writer, uint32_t code, unsigned int length);
+static void gzip_internal_put_symbol(gzip_bit_writer_t* writer, unsigned int symbol);
+static void gzip_internal_put_match(gzip_bit_writer_t* writer, unsigned int length, unsigned int distance);
+static void gzip_internal_flush_bits(gzip_bit_writer_t* writer);
+static bool gzip_internal_deflate(gzip_bit_writer_t* writer, const unsigned char* data, size_t length);
+static void gzip_internal_store(gzip_bit_writer_t* writer, const unsigned char* data, size_t length);
+static bool gzip_internal_inflate(gzip_inflater_t* state);
+
+unsigned long gzip_crc32(unsigned long crc, const unsigned char* data, unsigned long length)
+{
+    pthread_once(&crc_table_once, gzip_internal_build_crc_table);
+
+    uint32_t value = (uint32_t)crc ^ 0xFFFFFFFFu;
+
+    for (unsigned long index = 0; index < length; index++)
+    {
+        value = crc_table[(value ^ data[index]) & 0xFF] ^ (value >> 8);
+    }
+
+    return value ^ 0xFFFFFFFFu;
+}
+
+unsigned char* gzip_compress(const unsigned char* data, unsigned long inputlength, unsigned long* outputlength)
+{
+    if ((data == NULL && inputlength > 0) || outputlength == NULL || (uint64_t)inputlength > UINT32_MAX)
+    {
+        return NULL;
+    }
+
+    gzip_bit_writer_t writer;
+    memset(&writer, 0, sizeof(writer));
+
+    // Fixed Huffman codes expand incompressible input by at most 1/8
+    if (!gzip_internal_reserve(&writer, GZIP_HEADER_SIZE + (size_t)inputlength + (size_t)inputlength / 8 + 64))
+    {
+        return NULL;
+    }
+
+    static const unsigned char header[GZIP_HEADER_SIZE] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+    memcpy(writer.data, header, sizeof(header));
+    writer.size = sizeof(header);
+
+    if (!gzip_internal_deflate(&writer, data, (size_t)inputlength))
+    {
+        free(writer.data);
+        return NULL;
+    }
+
+    // Incompressible input goes out as stored blocks instead
+    size_t stored_size = (size_t)inputlength + 5 * ((size_t)inputlength / 65535 + 1);
+
+    if (writer.size - GZIP_HEADER_SIZE > stored_size)
+    {
+        writer.size = GZIP_HEADER_SIZE;
+        gzip_internal_store(&writer, data, (size_t)inputlength);
+    }
+
+    if (!gzip_internal_reserve(&writer, GZIP_TRAILER_SIZE))
+    {
+        free(writer.data);
+        return NULL;
+    }
+
+    uint32_t crc = (uint32_t)gzip_crc32(0, data, inputlength);
+    uint32_t size = (uint32_t)inputlength;
+
+    for (int index = 0; index < 4; index++)
+    {
+        writer.data[writer.size++] = (unsigned char)(crc >> (8 * index));
+    }
+
+    for (int index = 0; index < 4; index++)
+    {
+        writer.data[writer.size++] = (unsigned char)(size >> (8 * index));
+    }
+
+    *outputlength = (unsigned long)writer.size;
+
+    return writer.data;
+}
+
+unsigned char* gzip_decompress(const unsigned char* data, unsigned long inputlength, unsigned long* outputlength)
+{
+    if (data == NULL || outputlength == NULL)
+    {
+        return NULL;
+    }
+
+    gzip_inflater_t state;
+    memset(&state, 0, sizeof(state));
+    state.in = data;
+    state.in_size = (size_t)inputlength;
+
+    // Concatenated members decode to the concatenation of their contents
+    do
+    {
+        size_t pos = state.in_pos;
+
+        if (state.in_size - pos < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE || data[pos] != 0x1f || data[pos + 1] != 0x8b || data[pos + 2] != 8)
+        {
+            free(state.out);
+            return NULL;
+        }
+
+        unsigned char flags = data[pos + 3];
+        pos += GZIP_HEADER_SIZE;
+
+        // FEXTRA
+        if (flags & 0x04)
+        {
+            if (state.in_size - pos < 2)
+            {
+                free(state.out);
+                return NULL;
+            }
+
+            pos += 2 + (size_t)(data[pos] | (data[pos + 1] << 8));
+        }
+
+        // FNAME and FCOMMENT are NUL terminated
+        for (unsigned char flag = 0x08; flag <= 0x10; flag <<= 1)
+        {
+            if (flags & flag)
+            {
+                while (pos < state.in_size && data[pos] != 0)
+                {
+                    pos++;
+                }
+                pos++;
+            }
+        }
+
+        // FHCRC
+        if (flags & 0x02)
+        {
+            pos += 2;
+        }
+
+        if (pos > state.in_size)
+        {
+            free(state.out);
+            return NULL;
+        }
+
+        size_t member_start = state.out_size;
+        state.in_pos = pos;
+        state.bits = 0;
+        state.count = 0;
+
+        if (!gzip_internal_inflate(&state) || state.in_size - state.in_pos < GZIP_TRAILER_SIZE)
+        {
+            free(state.out);
+            return NULL;
+        }
+
+        const unsigned char* trailer = data + state.in_pos;
+        uint32_t crc = (uint32_t)trailer[0] | ((uint32_t)trailer[1] << 8) | ((uint32_t)trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+        uint32_t size = (uint32_t)trailer[4] | ((uint32_t)trailer[5] << 8) | ((uint32_t)trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+        size_t member_size = state.out_size - member_start;
+
+        if (crc != (uint32_t)gzip_crc32(0, state.out + member_start, (unsigned long)member_size) || size != (uint32_t)member_size)
+        {
+            free(state.out);
+            return NULL;
+        }
+
+        state.in_pos += GZIP_TRAILER_SIZE;
+    }while (state.in_pos < state.in_size);
+
+    // Empty content still yields a valid pointer
+    if (state.out == NULL)
+    {
+        state.out = (unsigned char*)malloc(1);
+    }
+
+    *outputlength = (unsigned long)state.out_size;
+
+    return state.out;
+}
+
+bool gzip_compress_file(const char* source, const char* destination)
+{
+    if (source == NULL || destination == NULL)
+    {
+        return false;
+    }
+
+    FILE* fp = fopen(source, "rb");
+
+    if (fp == NULL)
+    {
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    unsigned char* data = (unsigned char*)malloc(size > 0 ? (size_t)size : 1);
+
+    if (size < 0 || data == NULL || (size > 0 && fread(data, 1, (size_t)size, fp) != (size_t)size))
+    {
+        free(data);
+        fclose(fp);
+        return false;
+    }
+
+    fclose(fp);
+
+    unsigned long compressed_size = 0;
+    unsigned char* compressed = gzip_compress(data, (unsigned long)size, &compressed_size);
+    free(data);
+
+    if (compressed == NULL)
+    {
+        return false;
+    }
+
+    size_t temp_len = strlen(destination) + 32;
+    char* temp = (char*)malloc(temp_len);
+
+    if (temp == NULL)
+    {
+        free(compressed);
+        return false;
+    }
+
+    snprintf(temp, temp_len, "%s.%d.tmp", destination, (int)getpid());
+
+    fp = fopen(temp, "wb");
+    bool written = (fp != NULL && fwrite(compressed, 1, compressed_size, fp) == compressed_size);
+
+    if (fp != NULL && fclose(fp) != 0)
+    {
+        written = false;
+    }
+
+    if (written)
+    {
+        written = (rename(temp, destination) == 0);
+    }
+
+    if (!written)
+    {
+        remove(temp);
+    }
+
+    free(temp);
+    free(compressed);
+
+    return written;
+}
+
+static void gzip_internal_build_crc_table(void)
+{
+    for (uint32_t index = 0; index < 256; index++)
+    {
+        uint32_t value = index;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+        }
+
+        crc_table[index] = value;
+    }
+}
+
+static bool gzip_internal_reserve(gzip_bit_writer_t* writer, size_t more)
+{
+    if (writer->failed)
+    {
+        return false;
+    }
+
+    if (writer->size + more <= writer->capacity)
+    {
+        return true;
+    }
+
+    size_t capacity = (writer->capacity == 0) ? 256 : writer->capacity;
+
+    while (capacity < writer->size + more)
+    {
+        capacity *= 2;
+    }
+
+    unsigned char* data = (unsigned char*)realloc(writer->data, capacity);
+
+    if (data == NULL)
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    writer->data = data;
+    writer->capacity = capacity;
+
+    return true;
+}
+
+/* Deflate packs bits starting at the least significant bit of each byte */
+static void gzip_internal_put_bits(gzip_bit_writer_t* writer, uint32_t value, unsigned int count)
+{
+    writer->bits |= (uint64_t)value << writer->count;
+    writer->count += count;
+
+    if (writer->count >= 32)
+    {
+        if (!gzip_internal_reserve(writer, 4))
+        {
+            return;
+        }
+
+        for (int index = 0; index < 4; index++)
+        {
+            writer->data[writer->size++] = (unsigned char)writer->bits;
+            writer->bits >>= 8;
+        }
+
+        writer->count -= 32;
+    }
+}
+
+/* Huffman codes go out most significant bit first */
+static void gzip_internal_put_code(gzip_bit_writer_t* writer, uint32_t code, unsigned int length)
+{
+    uint32_t reversed = 0;
+
+    for (unsigned int bit = 0; bit < length; bit++)
+    {
+        reversed = (reversed << 1) | ((code >> bit) & 1);
+    }
+
+    gzip_internal_put_bits(writer, reversed, length);
+}
+
+/* Literal/length symbol in the fixed Huffman code */
+static void gzip_internal_put_symbol(gzip_bit_writer_t* writer, unsigned int symbol)
+{
+    if (symbol < 144)
+    {
+        gzip_internal_put_code(writer, 0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        gzip_internal_put_code(writer, 0x190 + (symbol - 144), 9);
+    }
+    else if (symbol < 280)
+    {
+        gzip_internal_put_code(writer, symbol - 256, 7);
+    }
+    else
+    {
+        gzip_internal_put_code(writer, 0xC0 + (symbol - 280), 8);
+    }
+}
+
+static void gzip_internal_put_match(gzip_bit_writer_t* writer, unsigned int length, unsigned int distance)
+{
+    unsigned int code = 28;
+
+    while (length_base[code] > length)
+    {
+        code--;
+    }
+
+    gzip_internal_put_symbol(writer, 257 + code);
+    gzip_internal_put_bits(writer, length - length_base[code], length_extra[code]);
+
+    code = 29;
+
+    while (distance_base[code] > distance)
+    {
+        code--;
+    }
+
+    gzip_internal_put_code(writer, code, 5);
+    gzip_internal_put_bits(writer, distance - distance_base[code], distance_extra[code]);
+}
+
+static void gzip_internal_flush_bits(gzip_bit_writer_t* writer)
+{
+    while (writer->count > 0 && gzip_internal_reserve(writer, 1))
+    {
+        writer->data[writer->size++] = (unsigned char)writer->bits;
+        writer->bits >>= 8;
+        writer->count = (writer->count > 8) ? writer->count - 8 : 0;
+    }
+}
+
+static uint32_t gzip_internal_hash(const unsigned char* ptr)
+{
+    uint32_t value = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16);
+    return (value * 2654435761u) >> (32 - GZIP_HASH_BITS);
+}
+
+/* One final block with the fixed code; matches come from hash chains */
+static bool gzip_internal_deflate(gzip_bit_writer_t* writer, const unsigned char* data, size_t length)
+{
+    // Positions are stored plus one so that zero means empty
+    uint32_t* head = (uint32_t*)calloc(GZIP_HASH_SIZE, sizeof(uint32_t));
+    uint32_t* prev = (uint32_t*)calloc(GZIP_WINDOW_SIZE, sizeof(uint32_t));
+
+    if (head == NULL || prev == NULL)
+    {
+        free(head);
+        free(prev);
+        return false;
+    }
+
+    // BFINAL = 1, BTYPE = 01 (fixed Huffman)
+    gzip_internal_put_bits(writer, 1, 1);
+    gzip_internal_put_bits(writer, 1, 2);
+
+    size_t pos = 0;
+
+    while (pos < length && !writer->failed)
+    {
+        size_t best_length = 0;
+        size_t best_distance = 0;
+
+        if (pos + GZIP_MIN_MATCH <= length)
+        {
+            size_t limit = length - pos;
+            uint32_t hash = gzip_internal_hash(data + pos);
+            uint32_t candidate = head[hash];
+            int chain = GZIP_MAX_CHAIN;
+
+            if (limit > GZIP_MAX_MATCH)
+            {
+                limit = GZIP_MAX_MATCH;
+            }
+
+            while (candidate != 0 && chain-- > 0)
+            {
+                size_t match = candidate - 1;
+
+                if (pos - match > GZIP_WINDOW_SIZE)
+                {
+                    break;
+                }
+
+                if (data[match + best_length] == data[pos + best_length])
+                {
+                    size_t len = 0;
+
+                    while (len < limit && data[match + len] == data[pos + len])
+                    {
+                        len++;
+                    }
+
+                    if (len > best_length)
+                    {
+                        best_length = len;
+                        best_distance = pos - match;
+
+                        if (len >= GZIP_NICE_MATCH || len == limit)
+                        {
+                            break;
+                        }
+                    }
+                }
+
+                candidate = prev[match % GZIP_WINDOW_SIZE];
+            }
+        }
+
+        size_t advance = (best_length >= GZIP_MIN_MATCH) ? best_length : 1;
+
+        if (best_length >= GZIP_MIN_MATCH)
+        {
+            gzip_internal_put_match(writer, (unsigned int)best_length, (unsigned int)best_distance);
+        }
+        else
+        {
+            gzip_internal_put_symbol(writer, data[pos]);
+        }
+
+        for (size_t index = 0; index < advance; index++, pos++)
+        {
+            if (pos + GZIP_MIN_MATCH <= length)
+            {
+                uint32_t hash = gzip_internal_hash(data + pos);
+                prev[pos % GZIP_WINDOW_SIZE] = head[hash];
+                head[hash] = (uint32_t)(pos + 1);
+            }
+        }
+    }
+
+    gzip_internal_put_symbol(writer, 256);
+    gzip_internal_flush_bits(writer);
+
+    free(head);
+    free(prev);
+
+    return !writer->failed;
+}
+
+/* Stored blocks of up to 65535 bytes; the buffer already has room for them */
+static void gzip_internal_store(gzip_bit_writer_t* writer, const unsigned char* data, size_t length)
+{
+    size_t pos = 0;
+
+    do
+    {
+        size_t block = (length - pos > 65535) ? 65535 : length - pos;
+        unsigned char* out = writer->data + writer->size;
+
+        // BFINAL on the last block, BTYPE = 00, then LEN and NLEN
+        out[0] = (pos + block == length) ? 1 : 0;
+        out[1] = (unsigned char)block;
+        out[2] = (unsigned char)(block >> 8);
+        out[3] = (unsigned char)~block;
+        out[4] = (unsigned char)(~block >> 8);
+        memcpy(out + 5, data + pos, block);
+
+        writer->size += 5 + block;
+        pos += block;
+    }while (pos < length);
+}
+
+static uint32_t gzip_internal_get_bits(gzip_inflater_t* state, unsigned int count)
+{
+    while (state->count < count)
+    {
+        if (state->in_pos >= state->in_size)
+        {
+            state->failed = true;
+            return 0;
+        }
+
+        state->bits |= (uint32_t)state->in[state->in_pos++] << state->count;
+        state->count += 8;
+    }
+
+    uint32_t value = state->bits & ((count == 32) ? 0xFFFFFFFFu : ((1u << count) - 1));
+    state->bits = (count == 32) ? 0 : state->bits >> count;
+    state->count -= count;
+
+    return value;
+}
+
+static bool gzip_internal_put_byte(gzip_inflater_t* state, unsigned char value)
+{
+    if (state->out_size == state->out_capacity)
+    {
+        size_t capacity = (state->out_capacity == 0) ? 4096 : state->out_capacity * 2;
+        unsigned char* out = (unsigned char*)realloc(state->out, capacity);
+
+        if (out == NULL)
+        {
+            state->failed = true;
+            return false;
+        }
+
+        state->out = out;
+        state->out_capacity = capacity;
+    }
+
+    state->out[state->out_size++] = value;
+
+    return true;
+}
+
+/* Canonical code from code lengths; false if the lengths over-subscribe */
+static bool gzip_internal_build_huffman(gzip_huffman_t* huffman, const unsigned char* lengths, unsigned int count)
+{
+    unsigned short offsets[GZIP_MAX_BITS + 1];
+    int left = 1;
+
+    memset(huffman->count, 0, sizeof(huffman->count));
+
+    for (unsigned int symbol = 0; symbol < count; symbol++)
+    {
+        huffman->count[lengths[symbol]]++;
+    }
+
+    for (unsigned int len = 1; len <= GZIP_MAX_BITS; len++)
+    {
+        left = (left << 1) - huffman->count[len];
+
+        if (left < 0)
+        {
+            return false;
+        }
+    }
+
+    offsets[1] = 0;
+
+    for (unsigned int len = 1; len < GZIP_MAX_BITS; len++)
+    {
+        offsets[len + 1] = offsets[len] + huffman->count[len];
+    }
+
+    for (unsigned int symbol = 0; symbol < count; symbol++)
+    {
+        if (lengths[symbol] != 0)
+        {
+            huffman->symbol[offsets[lengths[symbol]]++] = (unsigned short)symbol;
+        }
+    }
+
+    return true;
+}
+
+static int gzip_internal_decode(gzip_inflater_t* state, const gzip_huffman_t* huffman)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (unsigned int len = 1; len <= GZIP_MAX_BITS; len++)
+    {
+        code |= (int)gzip_internal_get_bits(state, 1);
+
+        if (state->failed)
+        {
+            return -1;
+        }
+
+        int count = huffman->count[len];
+
+        if (code - count < first)
+        {
+            return huffman->symbol[index + (code - first)];
+        }
+
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    state->failed = true;
+
+    return -1;
+}
+
+static bool gzip_internal_inflate_codes(gzip_inflater_t* state, const gzip_huffman_t* lengths, const gzip_huffman_t* distances)
+{
+    while (true)
+    {
+        int symbol = gzip_internal_decode(state, lengths);
+
+        if (symbol < 0)
+        {
+            return false;
+        }
+
+        if (symbol < 256)
+        {
+            if (!gzip_internal_put_byte(state, (unsigned char)symbol))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (symbol == 256)
+        {
+            return true;
+        }
+
+        symbol -= 257;
+
+        if (symbol >= 29)
+        {
+            return false;
+        }
+
+        size_t length = length_base[symbol] + gzip_internal_get_bits(state, length_extra[symbol]);
+        int distance_symbol = gzip_internal_decode(state, distances);
+
+        if (distance_symbol < 0 || distance_symbol >= 30)
+        {
+            return false;
+        }
+
+        size_t distance = distance_base[distance_symbol] + gzip_internal_get_bits(state, distance_extra[distance_symbol]);
+
+        if (state->failed || distance > state->out_size)
+        {
+            return false;
+        }
+
+        for (size_t index = 0; index < length; index++)
+        {
+            if (!gzip_internal_put_byte(state, state->out[state->out_size - distance]))
+            {
+                return false;
+            }
+        }
+    }
+}
+
+static bool gzip_internal_inflate_stored(gzip_inflater_t* state)
+{
+    state->bits = 0;
+    state->count = 0;
+
+    if (state->in_size - state->in_pos < 4)
+    {
+        return false;
+    }
+
+    const unsigned char* ptr = state->in + state->in_pos;
+    size_t length = (size_t)(ptr[0] | (ptr[1] << 8));
+    size_t complement = (size_t)(ptr[2] | (ptr[3] << 8));
+
+    state->in_pos += 4;
+
+    if (length != (~complement & 0xFFFF) || state->in_size - state->in_pos < length)
+    {
+        return false;
+    }
+
+    for (size_t index = 0; index < length; index++)
+    {
+        if (!gzip_internal_put_byte(state, state->in[state->in_pos++]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool gzip_internal_inflate_fixed(gzip_inflater_t* state)
+{
+    gzip_huffman_t lengths;
+    gzip_huffman_t distances;
+    unsigned char code_lengths[288];
+    unsigned int symbol = 0;
+
+    for (; symbol < 144; symbol++)
+    {
+        code_lengths[symbol] = 8;
+    }
+
+    for (; symbol < 256; symbol++)
+    {
+        code_lengths[symbol] = 9;
+    }
+
+    for (; symbol < 280; symbol++)
+    {
+        code_lengths[symbol] = 7;
+    }
+
+    for (; symbol < 288; symbol++)
+    {
+        code_lengths[symbol] = 8;
+    }
+
+    gzip_internal_build_huffman(&lengths, code_lengths, 288);
+
+    memset(code_lengths, 5, 30);
+    gzip_internal_build_huffman(&distances, code_lengths, 30);
+
+    return gzip_internal_inflate_codes(state, &lengths, &distances);
+}
+
+static bool gzip_internal_inflate_dynamic(gzip_inflater_t* state)
+{
+    gzip_huffman_t lengths;
+    gzip_huffman_t distances;
+    unsigned char code_lengths[320];
+    unsigned int length_count = gzip_internal_get_bits(state, 5) + 257;
+    unsigned int distance_count = gzip_internal_get_bits(state, 5) + 1;
+    unsigned int header_count = gzip_internal_get_bits(state, 4) + 4;
+
+    if (state->failed || length_count > 286 || distance_count > 30)
+    {
+        return false;
+    }
+
+    memset(code_lengths, 0, sizeof(code_lengths));
+
+    for (unsigned int index = 0; index < header_count; index++)
+    {
+        code_lengths[code_length_order[index]] = (unsigned char)gzip_internal_get_bits(state, 3);
+    }
+
+    if (state->failed || !gzip_internal_build_huffman(&lengths, code_lengths, 19))
+    {
+        return false;
+    }
+
+    unsigned int index = 0;
+
+    while (index < length_count + distance_count)
+    {
+        int symbol = gzip_internal_decode(state, &lengths);
+
+        if (symbol < 0)
+        {
+            return false;
+        }
+
+        if (symbol < 16)
+        {
+            code_lengths[index++] = (unsigned char)symbol;
+            continue;
+        }
+
+        unsigned char value = 0;
+        unsigned int repeat = 0;
+
+        if (symbol == 16)
+        {
+            if (index == 0)
+            {
+                return false;
+            }
+
+            value = code_lengths[index - 1];
+            repeat = 3 + gzip_internal_get_bits(state, 2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + gzip_internal_get_bits(state, 3);
+        }
+        else
+        {
+            repeat = 11 + gzip_internal_get_bits(state, 7);
+        }
+
+        if (state->failed || index + repeat > length_count + distance_count)
+        {
+            return false;
+        }
+
+        while (repeat-- > 0)
+        {
+            code_lengths[index++] = value;
+        }
+    }
+
+    // The end of block code must exist
+    if (code_lengths[256] == 0)
+    {
+        return false;
+    }
+
+    if (!gzip_internal_build_huffman(&lengths, code_lengths, length_count) ||
+        !gzip_internal_build_huffman(&distances, code_lengths + length_count, distance_count))
+    {
+        return false;
+    }
+
+    return gzip_internal_inflate_codes(state, &lengths, &distances);
+}
+
+static bool gzip_internal_inflate(gzip_inflater_t* state)
+{
+    bool last = false;
+
+    while (!last)
+    {
+        last = (gzip_internal_get_bits(state, 1) == 1);
+        uint32_t type = gzip_internal_get_bits(state, 2);
+        bool decoded = false;
+
+        if (state->failed)
+        {
+            return false;
+        }
+
+        switch (type)
+        {
+            case 0:
+            {
+                decoded = gzip_internal_inflate_stored(state);
+                break;
+            }
+            case 1:
+            {
+                decoded = gzip_internal_inflate_fixed(state);
+                break;
+            }
+            case 2:
+            {
+                decoded = gzip_internal_inflate_dynamic(state);
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+
+        if (!decoded || state->failed)
+        {
+            return false;
+        }
+    }
+
+    // The trailer starts at the next byte boundary
+    state->bits = 0;
+    state->count = 0;
+
+    return true;
+}
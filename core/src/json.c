@@ -27,83 +27,102 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "json.h"
+#include "arena.h"
+#include "file.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <stdint.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define JSON_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/* Initial arena block; blocks grow geometrically from here */
+#define JSON_ARENA_BLOCK_SIZE (16 * 1024)
+
+/* Objects with at least this many members get a hashed member index when
+   the parser closes them */
+#define JSON_MEMBER_INDEX_THRESHOLD 16
+
+/* Arrays with at least this many elements get a positional index when
+   the parser closes them */
+#define JSON_ELEMENT_INDEX_THRESHOLD 16
+
+#define JSON_NUMBER_INTEGER 0
+#define JSON_NUMBER_REAL    1
 
 /* ------------------------------------------------------------------------- */
 /* Structures                                                                */
 /* ------------------------------------------------------------------------- */
 
+typedef struct json_member_slot_t
+{
+    uint32_t hash;
+    json_node_t *node;       /* NULL for an empty slot */
+} json_member_slot_t;
+
+/* Open addressing table over an object's members, in the document arena */
+typedef struct json_member_index_t
+{
+    uint32_t mask;
+    json_member_slot_t slots[];
+} json_member_index_t;
+
 struct json_node_t
 {
-    json_node_type_t type;
+    uint8_t type;            /* json_node_type_t */
+    uint8_t number_kind;     /* JSON_NUMBER_INTEGER or JSON_NUMBER_REAL */
+    uint32_t child_count;
     char *name;              /* Key for object members, NULL otherwise */
     char *text;              /* For scalars: string, number, boolean, null */
     json_node_t *parent;
     json_node_t *first_child;
+    json_node_t *last_child; /* Keeps appends O(1) while parsing */
     json_node_t *next_sibling;
+    union
+    {
+        int64_t integer;                 /* Numbers */
+        double real;
+        json_member_index_t *members;    /* Wide objects, built while parsing */
+        json_node_t **elements;          /* Long arrays, built while parsing */
+        json_document_t *document;       /* The document node */
+    } value;
 };
 
+/* Every node and string of a document lives in its arena, or in the
+   input buffer for in-situ documents */
 struct json_document_t
 {
     json_node_t *root;
+    arena_t *arena;
+    char *owned_input;       /* In-situ buffer freed with the document */
 };
 
-/* ------------------------------------------------------------------------- */
-/* Memory Helpers                                                            */
-/* ------------------------------------------------------------------------- */
-
-static void *xmalloc(size_t size)
-{
-    void *p = malloc(size);
-    return p;
-}
-
-static void xfree_ptr(void *p)
-{
-    if (p)
-        free(p);
-}
-
-static char *xstrdup(const char *s)
-{
-    if (!s)
-        return NULL;
-
-    size_t n = strlen(s) + 1;
-    char *p = xmalloc(n);
-    if (!p)
-        return NULL;
-
-    memcpy(p, s, n);
-    return p;
-}
-
 /* ------------------------------------------------------------------------- */
 /* Node Helpers                                                              */
 /* ------------------------------------------------------------------------- */
 
-static void skip_ws(const char **p)
+static json_node_t *node_new(arena_t *arena, json_node_type_t type)
 {
-    while (**p && (unsigned char)**p <= ' ')
-        (*p)++;
-}
-
-static json_node_t *node_new(json_node_type_t type)
-{
-    json_node_t *n = (json_node_t *)xmalloc(sizeof(json_node_t));
+    json_node_t *n = (json_node_t *)arena_alloc(arena, sizeof(json_node_t));
     if (!n)
         return NULL;
 
-    n->type = type;
+    n->type = (uint8_t)type;
+    n->number_kind = JSON_NUMBER_INTEGER;
+    n->child_count = 0;
+    n->value.integer = 0;
     n->name = NULL;
     n->text = NULL;
     n->parent = NULL;
     n->first_child = NULL;
+    n->last_child = NULL;
     n->next_sibling = NULL;
 
     return n;
@@ -117,46 +136,21 @@ static void node_append_child(json_node_t *parent, json_node_t *child)
     child->parent = parent;
 
     if (!parent->first_child)
-    {
         parent->first_child = child;
-    }
     else
-    {
-        json_node_t *cur = parent->first_child;
-        while (cur->next_sibling)
-            cur = cur->next_sibling;
-        cur->next_sibling = child;
-    }
-}
-
-static void node_free_recursive(json_node_t *n)
-{
-    if (!n)
-        return;
-
-    json_node_t *c = n->first_child;
-    while (c)
-    {
-        json_node_t *next = c->next_sibling;
-        node_free_recursive(c);
-        c = next;
-    }
+        parent->last_child->next_sibling = child;
 
-    xfree_ptr(n->name);
-    xfree_ptr(n->text);
-    xfree_ptr(n);
+    parent->last_child = child;
+    parent->child_count++;
 }
 
 /* ------------------------------------------------------------------------- */
 /* String Utilities                                                          */
 /* ------------------------------------------------------------------------- */
 
-static char *unescape_json_string(const char *start, size_t len)
+/* Output never overtakes input, so 'out' may equal 'start' (in-situ) */
+static char *unescape_json_string(char *out, const char *start, size_t len)
 {
-    char *out = (char *)xmalloc(len + 1);
-    if (!out)
-        return NULL;
-
     size_t oi = 0;
 
     for (size_t i = 0; i < len; ++i)
@@ -236,307 +230,670 @@ static char *unescape_json_string(const char *start, size_t len)
 }
 
 /* ------------------------------------------------------------------------- */
-/* Parsing Primitives                                                        */
+/* Structural Index                                                          */
 /* ------------------------------------------------------------------------- */
 
-static char *parse_string_literal(const char **p)
+/* The first pass classifies 64 bytes at a time into bitmaps (quotes,
+   backslashes, operators, whitespace), resolves which quotes are escaped
+   and which bytes are inside strings, and records the offset of every
+   structural character, every string's opening and closing quote and the
+   first byte of every number or literal. The parser then jumps from one
+   index entry to the next instead of walking the input byte by byte. */
+
+#define JSON_CLASS_QUOTE     0x01
+#define JSON_CLASS_BACKSLASH 0x02
+#define JSON_CLASS_OP        0x04
+#define JSON_CLASS_WS        0x08
+
+typedef struct json_index_state_t
 {
-    const char *s = *p;
+    uint64_t prev_odd_backslash;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
+} json_index_state_t;
+
+static _Atomic json_kernel_t active_kernel = JSON_KERNEL_SCALAR;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
 
-    if (*s != '"')
+static unsigned char json_class(unsigned char c)
+{
+    switch (c)
+    {
+        case '"':  return JSON_CLASS_QUOTE;
+        case '\\': return JSON_CLASS_BACKSLASH;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            return JSON_CLASS_OP;
+        case ' ': case '\t': case '\n': case '\r':
+            return JSON_CLASS_WS;
+        default:
+            return 0;
+    }
+}
+
+/* Bytes preceded by an odd length run of backslashes */
+static inline uint64_t json_escaped_bits(uint64_t backslash, uint64_t *prev_odd)
+{
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    const uint64_t odd_bits = ~even_bits;
+
+    uint64_t start_edges = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = even_bits ^ *prev_odd;
+    uint64_t even_starts = start_edges & even_start_mask;
+    uint64_t odd_starts = start_edges & ~even_start_mask;
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries = backslash + odd_starts;
+    uint64_t ends_odd = odd_carries < backslash ? 1 : 0;
+
+    odd_carries |= *prev_odd;
+    *prev_odd = ends_odd;
+
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+
+    return (even_carry_ends & odd_bits) | (odd_carry_ends & even_bits);
+}
+
+static inline uint64_t json_prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static inline uint32_t *json_index_block(json_index_state_t *st, uint64_t quote, uint64_t backslash,
+                                         uint64_t op, uint64_t ws, uint32_t base, uint32_t *out)
+{
+    quote &= ~json_escaped_bits(backslash, &st->prev_odd_backslash);
+
+    /* Opening quote and contents are set, the closing quote is not */
+    uint64_t in_string = json_prefix_xor(quote) ^ st->prev_in_string;
+    st->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+    uint64_t scalar = ~(op | ws);
+    uint64_t nonquote_scalar = scalar & ~quote;
+    uint64_t follows_scalar = (nonquote_scalar << 1) | st->prev_scalar;
+    st->prev_scalar = nonquote_scalar >> 63;
+
+    uint64_t string_tail = in_string ^ quote;
+    uint64_t structural = ((op | (scalar & ~follows_scalar)) & ~string_tail) | (quote & ~in_string);
+
+    while (structural)
+    {
+        *out++ = base + (uint32_t)__builtin_ctzll(structural);
+        structural &= structural - 1;
+    }
+
+    return out;
+}
+
+static uint32_t *json_index_blocks_scalar(const unsigned char *data, size_t blocks, uint32_t base,
+                                          json_index_state_t *st, uint32_t *out)
+{
+    for (size_t b = 0; b < blocks; b++, data += 64, base += 64)
+    {
+        uint64_t quote = 0, backslash = 0, op = 0, ws = 0;
+
+        for (int k = 0; k < 64; k++)
+        {
+            unsigned char c = json_class(data[k]);
+            uint64_t bit = 1ULL << k;
+
+            if (c & JSON_CLASS_QUOTE) quote |= bit;
+            if (c & JSON_CLASS_BACKSLASH) backslash |= bit;
+            if (c & JSON_CLASS_OP) op |= bit;
+            if (c & JSON_CLASS_WS) ws |= bit;
+        }
+
+        out = json_index_block(st, quote, backslash, op, ws, base, out);
+    }
+
+    return out;
+}
+
+#if defined(JSON_X86_SIMD)
+
+__attribute__((target("avx2")))
+static inline uint64_t json_mask_avx2(__m256i lo, __m256i hi, __m256i v)
+{
+    uint32_t l = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v));
+    uint32_t h = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v));
+    return ((uint64_t)h << 32) | l;
+}
+
+__attribute__((target("avx2")))
+static uint32_t *json_index_blocks_avx2(const unsigned char *data, size_t blocks, uint32_t base,
+                                        json_index_state_t *st, uint32_t *out)
+{
+    const __m256i quote_v = _mm256_set1_epi8('"');
+    const __m256i backslash_v = _mm256_set1_epi8('\\');
+    const __m256i lower_v = _mm256_set1_epi8(0x20);
+    const __m256i brace_open_v = _mm256_set1_epi8('{');
+    const __m256i brace_close_v = _mm256_set1_epi8('}');
+    const __m256i colon_v = _mm256_set1_epi8(':');
+    const __m256i comma_v = _mm256_set1_epi8(',');
+    const __m256i space_v = _mm256_set1_epi8(' ');
+    const __m256i tab_v = _mm256_set1_epi8('\t');
+    const __m256i lf_v = _mm256_set1_epi8('\n');
+    const __m256i cr_v = _mm256_set1_epi8('\r');
+
+    for (size_t b = 0; b < blocks; b++, data += 64, base += 64)
+    {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)data);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(data + 32));
+
+        /* '[' and ']' differ from '{' and '}' only in bit 0x20 */
+        __m256i lo_folded = _mm256_or_si256(lo, lower_v);
+        __m256i hi_folded = _mm256_or_si256(hi, lower_v);
+
+        uint64_t quote = json_mask_avx2(lo, hi, quote_v);
+        uint64_t backslash = json_mask_avx2(lo, hi, backslash_v);
+        uint64_t op = json_mask_avx2(lo_folded, hi_folded, brace_open_v) |
+                      json_mask_avx2(lo_folded, hi_folded, brace_close_v) |
+                      json_mask_avx2(lo, hi, colon_v) |
+                      json_mask_avx2(lo, hi, comma_v);
+        uint64_t ws = json_mask_avx2(lo, hi, space_v) |
+                      json_mask_avx2(lo, hi, tab_v) |
+                      json_mask_avx2(lo, hi, lf_v) |
+                      json_mask_avx2(lo, hi, cr_v);
+
+        out = json_index_block(st, quote, backslash, op, ws, base, out);
+    }
+
+    return out;
+}
+
+#endif
+
+static bool json_kernel_supported(json_kernel_t kernel)
+{
+    switch (kernel)
+    {
+        case JSON_KERNEL_SCALAR:
+            return true;
+#if defined(JSON_X86_SIMD)
+        case JSON_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+/* Runs once, whichever parsing thread gets here first */
+static void json_detect_kernel(void)
+{
+#if defined(JSON_X86_SIMD)
+    __builtin_cpu_init();
+#endif
+
+    atomic_store_explicit(&active_kernel, json_kernel_supported(JSON_KERNEL_AVX2) ? JSON_KERNEL_AVX2 : JSON_KERNEL_SCALAR,
+                          memory_order_release);
+}
+
+static json_kernel_t json_resolve_kernel(void)
+{
+    pthread_once(&kernel_once, json_detect_kernel);
+
+    return atomic_load_explicit(&active_kernel, memory_order_acquire);
+}
+
+static uint32_t *json_index_blocks(const unsigned char *data, size_t blocks, uint32_t base,
+                                   json_index_state_t *st, uint32_t *out)
+{
+#if defined(JSON_X86_SIMD)
+    if (json_resolve_kernel() == JSON_KERNEL_AVX2)
+        return json_index_blocks_avx2(data, blocks, base, st, out);
+#endif
+
+    return json_index_blocks_scalar(data, blocks, base, st, out);
+}
+
+/* Returns the index terminated by a sentinel entry equal to length, or
+   NULL for an unterminated string. Offsets are 32 bit, so input is
+   limited to 4GB. */
+static uint32_t *json_build_index(const char *input, size_t length, size_t *count)
+{
+    if (length >= UINT32_MAX)
+        return NULL;
+
+    /* At most one entry per input byte, plus the sentinel */
+    uint32_t *index = (uint32_t *)malloc((length + 1) * sizeof(uint32_t));
+    if (!index)
         return NULL;
 
-    s++;
-    const char *start = s;
+    json_index_state_t st = { 0, 0, 0 };
+    size_t full = length / 64;
+    uint32_t *out = json_index_blocks((const unsigned char *)input, full, 0, &st, index);
 
-    while (*s && *s != '"')
+    /* The tail is padded with whitespace, which never produces an entry */
+    if (length % 64)
     {
-        if (*s == '\\' && *(s + 1))
-            s++;
-        s++;
+        unsigned char tail[64];
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, input + full * 64, length % 64);
+        out = json_index_blocks(tail, 1, (uint32_t)(full * 64), &st, out);
     }
 
-    if (*s != '"')
+    if (st.prev_in_string)
+    {
+        free(index);
         return NULL;
+    }
+
+    *out = (uint32_t)length;
+    *count = (size_t)(out - index);
+    return index;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Parsing Primitives                                                        */
+/* ------------------------------------------------------------------------- */
+
+typedef struct json_parser_t
+{
+    const char *input;
+    char *insitu;            /* Same as input when parsing in place */
+    const uint32_t *index;
+    size_t count;            /* Entries, not counting the sentinel */
+    size_t pos;              /* Next entry to consume */
+    arena_t *arena;
+} json_parser_t;
+
+/* Character at the next index entry, NUL once the index is exhausted */
+static char json_peek(const json_parser_t *ps)
+{
+    if (ps->pos >= ps->count)
+        return '\0';
+
+    return ps->input[ps->index[ps->pos]];
+}
+
+static char json_advance(json_parser_t *ps)
+{
+    char c = json_peek(ps);
+
+    if (ps->pos < ps->count)
+        ps->pos++;
+
+    return c;
+}
+
+/* 'at' is the opening quote; the index guarantees the closing quote is next */
+static char *parse_string_literal(json_parser_t *ps, size_t at)
+{
+    size_t end = ps->index[ps->pos];
+
+    if (ps->pos >= ps->count || ps->input[end] != '"')
+        return NULL;
+
+    ps->pos++;
+
+    const char *start = ps->input + at + 1;
+    size_t len = end - at - 1;
+    bool escaped = memchr(start, '\\', len) != NULL;
+
+    /* In place: the closing quote becomes the terminator */
+    if (ps->insitu)
+    {
+        char *text = ps->insitu + at + 1;
+
+        if (escaped)
+            return unescape_json_string(text, text, len);
+
+        text[len] = '\0';
+        return text;
+    }
+
+    if (escaped)
+    {
+        char *out = (char *)arena_alloc(ps->arena, len + 1);
+        if (!out)
+            return NULL;
 
-    size_t len = (size_t)(s - start);
-    char *res = unescape_json_string(start, len);
+        return unescape_json_string(out, start, len);
+    }
 
-    *p = s + 1;
-    return res;
+    return arena_strndup(ps->arena, start, len);
 }
 
-static char *parse_number_literal(const char **p)
+/* Validates a number and records its value on the node. Integers that
+   fit int64 are accumulated while validating; anything else goes through
+   strtod, which needs the NUL terminated copy in 'text'. */
+static bool parse_number_value(json_node_t *n, const char *s, size_t len, const char *text)
 {
-    const char *s = *p;
-    const char *start = s;
+    const char *end = s + len;
+    bool negative = false;
+    uint64_t magnitude = 0;
+    int digits = 0;
 
-    if (*s == '-') s++;
-    if (*s == '0') s++;
+    if (s < end && *s == '-')
+    {
+        negative = true;
+        s++;
+    }
+
+    if (s == end) return false;
+
+    if (*s == '0')
+    {
+        s++;
+        digits = 1;
+    }
     else if (isdigit((unsigned char)*s))
-        while (isdigit((unsigned char)*s)) s++;
+    {
+        while (s < end && isdigit((unsigned char)*s))
+        {
+            if (digits < 19)
+                magnitude = magnitude * 10 + (uint64_t)(*s - '0');
+            digits++;
+            s++;
+        }
+    }
     else
-        return NULL;
+    {
+        return false;
+    }
 
-    if (*s == '.')
+    bool integral = true;
+
+    if (s < end && *s == '.')
     {
         s++;
-        if (!isdigit((unsigned char)*s)) return NULL;
-        while (isdigit((unsigned char)*s)) s++;
+        integral = false;
+        if (s == end || !isdigit((unsigned char)*s)) return false;
+        while (s < end && isdigit((unsigned char)*s)) s++;
     }
 
-    if (*s == 'e' || *s == 'E')
+    if (s < end && (*s == 'e' || *s == 'E'))
     {
         s++;
-        if (*s == '+' || *s == '-') s++;
-        if (!isdigit((unsigned char)*s)) return NULL;
-        while (isdigit((unsigned char)*s)) s++;
+        integral = false;
+        if (s < end && (*s == '+' || *s == '-')) s++;
+        if (s == end || !isdigit((unsigned char)*s)) return false;
+        while (s < end && isdigit((unsigned char)*s)) s++;
     }
 
-    size_t len = (size_t)(s - start);
-    char *out = (char *)xmalloc(len + 1);
-    if (!out)
-        return NULL;
+    if (s != end)
+        return false;
 
-    memcpy(out, start, len);
-    out[len] = '\0';
+    /* 19 digits may still fit; INT64_MIN has no positive counterpart */
+    if (integral && digits <= 19 && magnitude <= (uint64_t)INT64_MAX + (negative ? 1 : 0))
+    {
+        n->number_kind = JSON_NUMBER_INTEGER;
+        n->value.integer = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+        return true;
+    }
 
-    *p = s;
-    return out;
+    n->number_kind = JSON_NUMBER_REAL;
+    n->value.real = strtod(text, NULL);
+    return true;
 }
 
-static char *parse_literal_text(const char **p, const char *lit)
+/* Exact integer value of validated number text such as "1e3" or "-20.0".
+   Fails for fractions and for values outside int64. */
+static bool number_text_to_int64(const char *s, int64_t *value)
 {
-    size_t L = strlen(lit);
-    if (strncmp(*p, lit, L) == 0)
+    bool negative = (*s == '-');
+    char digits[20];
+    int count = 0;
+    int scale = 0;           /* Power of ten applied to 'digits' */
+    bool nonzero = false;
+
+    if (negative)
+        s++;
+
+    /* Significant digits without leading zeros; any beyond 19 must be
+       cancelled by the exponent as trailing zeros, or the value is too large */
+    for (bool fraction = false; *s && *s != 'e' && *s != 'E'; s++)
     {
-        *p += L;
-        return xstrdup(lit);
+        if (*s == '.')
+        {
+            fraction = true;
+            continue;
+        }
+
+        if (fraction)
+            scale--;
+
+        if (*s == '0' && !nonzero)
+            continue;
+
+        nonzero = true;
+
+        if (count < (int)sizeof(digits))
+            digits[count++] = *s;
+        else if (*s != '0')
+            return false;
+        else
+            scale++;
     }
-    return NULL;
+
+    if (*s == 'e' || *s == 'E')
+    {
+        s++;
+        bool exp_negative = (*s == '-');
+        long exponent = 0;
+
+        if (*s == '+' || *s == '-')
+            s++;
+
+        for (; *s; s++)
+        {
+            if (exponent < 100000)
+                exponent = exponent * 10 + (*s - '0');
+        }
+
+        scale += (int)(exp_negative ? -exponent : exponent);
+    }
+
+    if (!nonzero)
+    {
+        *value = 0;
+        return true;
+    }
+
+    /* Fold trailing zeros into the scale */
+    while (count > 0 && digits[count - 1] == '0')
+    {
+        count--;
+        scale++;
+    }
+
+    if (scale < 0 || count + scale > 19)
+        return false;
+
+    uint64_t magnitude = 0;
+
+    for (int i = 0; i < count; i++)
+        magnitude = magnitude * 10 + (uint64_t)(digits[i] - '0');
+
+    for (int i = 0; i < scale; i++)
+        magnitude *= 10;
+
+    if (magnitude > (uint64_t)INT64_MAX + (negative ? 1 : 0))
+        return false;
+
+    *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return true;
 }
 
 /* ------------------------------------------------------------------------- */
 /* Recursive Descent Parser                                                  */
 /* ------------------------------------------------------------------------- */
 
-static json_node_t *parse_value(const char **p);
-
-static json_node_t *parse_array(const char **p)
-{
-    const char *s = *p;
-
-    if (*s != '[')
-        return NULL;
+/* Nodes are arena allocated, so error paths simply return NULL and the
+   caller releases the whole arena. */
 
-    s++;
-    skip_ws(&s);
+static json_node_t *parse_value(json_parser_t *ps);
+static json_member_index_t *json_build_member_index(arena_t *arena, json_node_t *obj);
+static json_node_t **json_build_element_index(arena_t *arena, json_node_t *arr);
 
-    json_node_t *arr = node_new(JSON_NODE_ARRAY);
+static json_node_t *parse_array(json_parser_t *ps)
+{
+    json_node_t *arr = node_new(ps->arena, JSON_NODE_ARRAY);
     if (!arr)
         return NULL;
 
-    if (*s == ']')
+    if (json_peek(ps) == ']')
     {
-        *p = s + 1;
+        json_advance(ps);
         return arr;
     }
 
     while (1)
     {
-        skip_ws(&s);
-        json_node_t *elem = parse_value(&s);
+        json_node_t *elem = parse_value(ps);
         if (!elem)
-        {
-            node_free_recursive(arr);
             return NULL;
-        }
 
         node_append_child(arr, elem);
-        skip_ws(&s);
 
-        if (*s == ',')
-        {
-            s++;
+        char c = json_advance(ps);
+
+        if (c == ',')
             continue;
-        }
-        else if (*s == ']')
-        {
-            *p = s + 1;
-            return arr;
-        }
-        else
-        {
-            node_free_recursive(arr);
+        else if (c != ']')
             return NULL;
+
+        if (arr->child_count >= JSON_ELEMENT_INDEX_THRESHOLD)
+        {
+            arr->value.elements = json_build_element_index(ps->arena, arr);
+            if (!arr->value.elements)
+                return NULL;
         }
+
+        return arr;
     }
 }
 
-static json_node_t *parse_object(const char **p)
+static json_node_t *parse_object(json_parser_t *ps)
 {
-    const char *s = *p;
-
-    if (*s != '{')
-        return NULL;
-
-    s++;
-    skip_ws(&s);
-
-    json_node_t *obj = node_new(JSON_NODE_OBJECT);
+    json_node_t *obj = node_new(ps->arena, JSON_NODE_OBJECT);
     if (!obj)
         return NULL;
 
-    if (*s == '}')
+    if (json_peek(ps) == '}')
     {
-        *p = s + 1;
+        json_advance(ps);
         return obj;
     }
 
     while (1)
     {
-        skip_ws(&s);
+        size_t at = ps->index[ps->pos];
 
-        if (*s != '"')
-        {
-            node_free_recursive(obj);
+        if (json_advance(ps) != '"')
             return NULL;
-        }
 
-        char *key = parse_string_literal(&s);
-        skip_ws(&s);
-
-        if (*s != ':')
-        {
-            xfree_ptr(key);
-            node_free_recursive(obj);
+        char *key = parse_string_literal(ps, at);
+        if (!key)
             return NULL;
-        }
 
-        s++;
-        skip_ws(&s);
+        if (json_advance(ps) != ':')
+            return NULL;
 
-        json_node_t *val = parse_value(&s);
+        json_node_t *val = parse_value(ps);
         if (!val)
-        {
-            xfree_ptr(key);
-            node_free_recursive(obj);
             return NULL;
-        }
 
         val->name = key;
         node_append_child(obj, val);
-        skip_ws(&s);
 
-        if (*s == ',')
-        {
-            s++;
+        char c = json_advance(ps);
+
+        if (c == ',')
             continue;
-        }
-        else if (*s == '}')
-        {
-            *p = s + 1;
-            return obj;
-        }
-        else
-        {
-            node_free_recursive(obj);
+        else if (c != '}')
             return NULL;
+
+        if (obj->child_count >= JSON_MEMBER_INDEX_THRESHOLD)
+        {
+            obj->value.members = json_build_member_index(ps->arena, obj);
+            if (!obj->value.members)
+                return NULL;
         }
+
+        return obj;
     }
 }
 
-static json_node_t *parse_value(const char **p)
+static json_node_t *parse_value(json_parser_t *ps)
 {
-    skip_ws(p);
-    const char *s = *p;
-
-    if (!*s)
+    if (ps->pos >= ps->count)
         return NULL;
 
-    if (*s == '{') return parse_object(p);
-    if (*s == '[') return parse_array(p);
+    size_t at = ps->index[ps->pos++];
+    const char *s = ps->input + at;
+
+    if (*s == '{') return parse_object(ps);
+    if (*s == '[') return parse_array(ps);
 
     if (*s == '"')
     {
-        char *str = parse_string_literal(p);
+        char *str = parse_string_literal(ps, at);
         if (!str) return NULL;
 
-        json_node_t *n = node_new(JSON_NODE_STRING);
+        json_node_t *n = node_new(ps->arena, JSON_NODE_STRING);
         if (!n)
-        {
-            xfree_ptr(str);
             return NULL;
-        }
 
         n->text = str;
         return n;
     }
 
+    /* Numbers and literals run up to the next index entry */
+    size_t len = ps->index[ps->pos] - at;
+    while (len > 0 && (unsigned char)s[len - 1] <= ' ')
+        len--;
+
     if (*s == '-' || isdigit((unsigned char)*s))
     {
-        char *num = parse_number_literal(p);
+        char *num = arena_strndup(ps->arena, s, len);
         if (!num) return NULL;
 
-        json_node_t *n = node_new(JSON_NODE_NUMBER);
+        json_node_t *n = node_new(ps->arena, JSON_NODE_NUMBER);
         if (!n)
-        {
-            xfree_ptr(num);
             return NULL;
-        }
+
+        if (!parse_number_value(n, s, len, num))
+            return NULL;
 
         n->text = num;
         return n;
     }
 
-    if (strncmp(s, "true", 4) == 0)
+    /* Literal texts are shared constants rather than per-node copies */
+    if (len == 4 && strncmp(s, "true", 4) == 0)
     {
-        *p = s + 4;
-        json_node_t *n = node_new(JSON_NODE_BOOLEAN);
+        json_node_t *n = node_new(ps->arena, JSON_NODE_BOOLEAN);
         if (!n)
             return NULL;
 
-        n->text = xstrdup("true");
-        if (!n->text)
-        {
-            node_free_recursive(n);
-            return NULL;
-        }
-
+        n->text = (char *)"true";
         return n;
     }
 
-    if (strncmp(s, "false", 5) == 0)
+    if (len == 5 && strncmp(s, "false", 5) == 0)
     {
-        *p = s + 5;
-        json_node_t *n = node_new(JSON_NODE_BOOLEAN);
+        json_node_t *n = node_new(ps->arena, JSON_NODE_BOOLEAN);
         if (!n)
             return NULL;
 
-        n->text = xstrdup("false");
-        if (!n->text)
-        {
-            node_free_recursive(n);
-            return NULL;
-        }
-
+        n->text = (char *)"false";
         return n;
     }
 
-    if (strncmp(s, "null", 4) == 0)
+    if (len == 4 && strncmp(s, "null", 4) == 0)
     {
-        *p = s + 4;
-        json_node_t *n = node_new(JSON_NODE_NULL);
+        json_node_t *n = node_new(ps->arena, JSON_NODE_NULL);
         if (!n)
             return NULL;
 
-        n->text = xstrdup("null");
-        if (!n->text)
-        {
-            node_free_recursive(n);
-            return NULL;
-        }
-
+        n->text = (char *)"null";
         return n;
     }
 
@@ -547,42 +904,79 @@ static json_node_t *parse_value(const char **p)
 /* Public API                                                                */
 /* ------------------------------------------------------------------------- */
 
-json_document_t *json_parse_string(const char *input)
+static json_document_t *json_parse_buffer(const char *input, size_t length, char *insitu)
 {
-    if (!input)
-        return NULL;
-
-    const char *p = input;
-    skip_ws(&p);
-
-    json_node_t *rootval = parse_value(&p);
-    if (!rootval)
+    json_parser_t ps;
+    ps.input = input;
+    ps.insitu = insitu;
+    ps.pos = 0;
+    ps.index = json_build_index(input, length, &ps.count);
+    if (!ps.index)
         return NULL;
 
-    skip_ws(&p);
-    if (*p != '\0')
+    /* Small documents (single records, messages) start with a small first
+       block; nodes take several times the size of their text */
+    size_t block = length < JSON_ARENA_BLOCK_SIZE / 8 ? length * 8 : JSON_ARENA_BLOCK_SIZE;
+    ps.arena = arena_allocate(block);
+    if (!ps.arena)
     {
-        node_free_recursive(rootval);
+        free((void *)ps.index);
         return NULL;
     }
 
-    json_document_t *doc = (json_document_t *)xmalloc(sizeof(json_document_t));
-    if (!doc)
-    {
-        node_free_recursive(rootval);
-        return NULL;
-    }
+    json_document_t *doc = (json_document_t *)arena_alloc(ps.arena, sizeof(json_document_t));
+    json_node_t *docroot = node_new(ps.arena, JSON_NODE_DOCUMENT);
+    json_node_t *rootval = NULL;
 
-    json_node_t *docroot = node_new(JSON_NODE_DOCUMENT);
-    if (!docroot)
+    if (doc && docroot)
+        rootval = parse_value(&ps);
+
+    /* Anything left after the top level value is an error */
+    bool complete = rootval && ps.pos == ps.count;
+    free((void *)ps.index);
+
+    if (!complete)
     {
-        node_free_recursive(rootval);
-        xfree_ptr(doc);
+        arena_release(ps.arena);
         return NULL;
     }
 
     node_append_child(docroot, rootval);
+    docroot->value.document = doc;
     doc->root = docroot;
+    doc->arena = ps.arena;
+    doc->owned_input = NULL;
+
+    return doc;
+}
+
+json_document_t *json_parse_string(const char *input)
+{
+    if (!input)
+        return NULL;
+
+    return json_parse_buffer(input, strlen(input), NULL);
+}
+
+json_document_t *json_parse_string_length(const char *input, size_t length)
+{
+    if (!input)
+        return NULL;
+
+    return json_parse_buffer(input, length, NULL);
+}
+
+json_document_t *json_parse_insitu(char *input, size_t length, bool take_ownership)
+{
+    if (!input)
+        return NULL;
+
+    json_document_t *doc = json_parse_buffer(input, length, input);
+
+    if (doc && take_ownership)
+        doc->owned_input = input;
+    else if (take_ownership)
+        free(input);
 
     return doc;
 }
@@ -592,63 +986,152 @@ json_document_t *json_load_file(const char *path)
     if (!path)
         return NULL;
 
-    FILE *f = fopen(path, "rb");
-    if (!f)
+    /* Strings are copied out of the view, so a mapping can be dropped as
+       soon as parsing ends and never needs to be written to */
+    file_map_t *map = file_map_open(path);
+    if (!map)
         return NULL;
 
-    if (fseek(f, 0, SEEK_END) != 0)
-    {
-        fclose(f);
+    json_document_t *doc = json_parse_buffer(file_map_get_data(map), file_map_get_size(map), NULL);
+    file_map_close(map);
+    return doc;
+}
+
+void json_free_document(json_document_t *doc)
+{
+    if (!doc)
+        return;
+
+    free(doc->owned_input);
+
+    /* The document itself is part of the arena */
+    arena_release(doc->arena);
+}
+
+json_node_t *json_document_root(json_document_t *doc)
+{
+    if (!doc)
         return NULL;
-    }
 
-    long sz = ftell(f);
-    if (sz < 0)
+    return doc->root;
+}
+
+json_kernel_t json_get_kernel(void)
+{
+    return json_resolve_kernel();
+}
+
+bool json_set_kernel(json_kernel_t kernel)
+{
+    json_resolve_kernel();
+
+    if (!json_kernel_supported(kernel))
+        return false;
+
+    atomic_store_explicit(&active_kernel, kernel, memory_order_release);
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Member Index                                                              */
+/* ------------------------------------------------------------------------- */
+
+/* Jenkins one-at-a-time, as used by the dictionary */
+static uint32_t json_hash_name(const char *name)
+{
+    uint32_t hash = 0;
+
+    for (; *name; name++)
     {
-        fclose(f);
-        return NULL;
+        hash += (unsigned char)*name;
+        hash += hash << 10;
+        hash ^= hash >> 6;
     }
 
-    if ((unsigned long)sz > (unsigned long)SIZE_MAX - 1)
-    {
-        fclose(f);
+    hash += hash << 3;
+    hash ^= hash >> 11;
+    hash += hash << 15;
+
+    return hash;
+}
+
+/* Built when the parser closes a wide object, so lookups only ever read
+   the document. The first of duplicate keys wins, matching a linear scan. */
+static json_member_index_t *json_build_member_index(arena_t *arena, json_node_t *obj)
+{
+    size_t size = 1;
+    while (size < (size_t)obj->child_count * 2)
+        size <<= 1;
+
+    json_member_index_t *index = (json_member_index_t *)arena_calloc(arena,
+        sizeof(json_member_index_t) + size * sizeof(json_member_slot_t));
+    if (!index)
         return NULL;
-    }
 
-    rewind(f);
+    index->mask = (uint32_t)(size - 1);
 
-    char *buf = (char *)xmalloc((size_t)sz + 1);
-    if (!buf)
+    for (json_node_t *c = obj->first_child; c; c = c->next_sibling)
     {
-        fclose(f);
-        return NULL;
+        uint32_t hash = json_hash_name(c->name);
+        uint32_t slot = hash & index->mask;
+
+        while (index->slots[slot].node)
+        {
+            if (index->slots[slot].hash == hash && strcmp(index->slots[slot].node->name, c->name) == 0)
+                break;
+            slot = (slot + 1) & index->mask;
+        }
+
+        if (!index->slots[slot].node)
+        {
+            index->slots[slot].hash = hash;
+            index->slots[slot].node = c;
+        }
     }
 
-    size_t read_sz = fread(buf, 1, (size_t)sz, f);
-    if (read_sz != (size_t)sz)
+    return index;
+}
+
+static json_node_t *json_find_member(json_node_t *obj, const char *name)
+{
+    const json_member_index_t *index = obj->value.members;
+
+    if (index)
     {
-        xfree_ptr(buf);
-        fclose(f);
+        uint32_t hash = json_hash_name(name);
+        uint32_t slot = hash & index->mask;
+
+        while (index->slots[slot].node)
+        {
+            if (index->slots[slot].hash == hash && strcmp(index->slots[slot].node->name, name) == 0)
+                return index->slots[slot].node;
+            slot = (slot + 1) & index->mask;
+        }
+
         return NULL;
     }
 
-    buf[sz] = '\0';
-    fclose(f);
+    for (json_node_t *c = obj->first_child; c; c = c->next_sibling)
+    {
+        if (strcmp(c->name, name) == 0)
+            return c;
+    }
 
-    json_document_t *doc = json_parse_string(buf);
-    xfree_ptr(buf);
-    return doc;
+    return NULL;
 }
 
-void json_free_document(json_document_t *doc)
+/* Built when the parser closes a long array, like the member index */
+static json_node_t **json_build_element_index(arena_t *arena, json_node_t *arr)
 {
-    if (!doc)
-        return;
+    json_node_t **elements = (json_node_t **)arena_alloc(arena, arr->child_count * sizeof(json_node_t *));
+    if (!elements)
+        return NULL;
 
-    if (doc->root)
-        node_free_recursive(doc->root);
+    size_t i = 0;
+    for (json_node_t *c = arr->first_child; c; c = c->next_sibling)
+        elements[i++] = c;
 
-    xfree_ptr(doc);
+    return elements;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -665,6 +1148,9 @@ json_node_t *json_node_first_child_element(json_node_t *node, const char *name)
     if (!name)
         return c;
 
+    if (node->type == JSON_NODE_OBJECT)
+        return json_find_member(node, name);
+
     while (c)
     {
         if (c->name && strcmp(c->name, name) == 0)
@@ -702,7 +1188,7 @@ json_node_t *json_node_parent(json_node_t *node)
 
 json_node_type_t json_node_type(json_node_t *node)
 {
-    return node ? node->type : JSON_NODE_NULL;
+    return node ? (json_node_type_t)node->type : JSON_NODE_NULL;
 }
 
 const char *json_node_name(json_node_t *node)
@@ -720,15 +1206,8 @@ const char *json_node_get_attr(json_node_t *node, const char *name)
         if (!name)
             return NULL;
 
-        json_node_t *c = node->first_child;
-        while (c)
-        {
-            if (c->name && strcmp(c->name, name) == 0)
-                return c->text;
-            c = c->next_sibling;
-        }
-
-        return NULL;
+        json_node_t *c = json_find_member(node, name);
+        return c ? c->text : NULL;
     }
 
     if (name == NULL)
@@ -755,6 +1234,65 @@ const char *json_node_get_text(json_node_t *node)
     }
 }
 
+size_t json_node_get_child_count(json_node_t *node)
+{
+    return node ? node->child_count : 0;
+}
+
+json_node_t *json_node_get_child_at(json_node_t *node, size_t index)
+{
+    if (!node || index >= node->child_count)
+        return NULL;
+
+    if (node->type == JSON_NODE_ARRAY)
+    {
+        json_node_t **elements = node->value.elements;
+
+        if (elements)
+            return elements[index];
+    }
+
+    json_node_t *c = node->first_child;
+    while (index-- > 0)
+        c = c->next_sibling;
+
+    return c;
+}
+
+bool json_node_is_integer(json_node_t *node)
+{
+    return node && node->type == JSON_NODE_NUMBER && node->number_kind == JSON_NUMBER_INTEGER;
+}
+
+bool json_node_get_int64(json_node_t *node, int64_t *value)
+{
+    if (!node || !value || node->type != JSON_NODE_NUMBER)
+        return false;
+
+    if (node->number_kind == JSON_NUMBER_INTEGER)
+    {
+        *value = node->value.integer;
+        return true;
+    }
+
+    /* Reals qualify only when integral and inside the int64 range. The
+       double may have rounded, so decide from the number text. */
+    return node->text && number_text_to_int64(node->text, value);
+}
+
+bool json_node_get_double(json_node_t *node, double *value)
+{
+    if (!node || !value || node->type != JSON_NODE_NUMBER)
+        return false;
+
+    if (node->number_kind == JSON_NUMBER_INTEGER)
+        *value = (double)node->value.integer;
+    else
+        *value = node->value.real;
+
+    return true;
+}
+
 /* ------------------------------------------------------------------------- */
 /* Debug Print                                                               */
 /* ------------------------------------------------------------------------- */
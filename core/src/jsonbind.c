@@ -0,0 +1,629 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "jsonbind.h"
+#include "jsonsax.h"
+#include "datetime.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define JSON_BIND_MAX_DEPTH 32
+#define JSON_BIND_NUMBER_SIZE 128
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef struct json_bind_frame_t
+{
+    const json_bind_schema_t *schema;   /* Object frames */
+    const json_bind_field_t *field;     /* Object: field of the pending key; array: the array */
+    char *base;                         /* Struct, or first element of the array */
+    size_t next;                        /* Object: field expected next; array: elements stored */
+    size_t *count;                      /* Array frames */
+    bool array;
+} json_bind_frame_t;
+
+typedef struct json_bind_context_t
+{
+    const json_bind_schema_t *root;
+    char *out;
+    bool started;
+    size_t skip;                        /* Depth inside a member without a field */
+    size_t depth;
+    json_bind_frame_t frames[JSON_BIND_MAX_DEPTH];
+} json_bind_context_t;
+
+/* Where the next value goes */
+typedef struct json_bind_slot_t
+{
+    json_bind_type_t type;
+    char *dest;
+    size_t size;
+    const json_bind_field_t *field;
+    const json_bind_schema_t *schema;
+    char *owner;                        /* Struct holding an array's count */
+} json_bind_slot_t;
+
+typedef enum
+{
+    JSON_BIND_SLOT_STORE,
+    JSON_BIND_SLOT_IGNORE,
+    JSON_BIND_SLOT_ERROR
+} json_bind_slot_result_t;
+
+/* ------------------------------------------------------------------------- */
+/* Decoding                                                                  */
+/* ------------------------------------------------------------------------- */
+
+static json_bind_slot_result_t json_bind_next_slot(json_bind_context_t *ctx, json_bind_slot_t *slot)
+{
+    if (ctx->depth == 0)
+    {
+        /* Only one top level object */
+        if (ctx->started)
+            return JSON_BIND_SLOT_ERROR;
+
+        ctx->started = true;
+        slot->type = JSON_BIND_TYPE_OBJECT;
+        slot->dest = ctx->out;
+        slot->size = ctx->root->size;
+        slot->field = NULL;
+        slot->schema = ctx->root;
+        slot->owner = NULL;
+        return JSON_BIND_SLOT_STORE;
+    }
+
+    json_bind_frame_t *frame = &ctx->frames[ctx->depth - 1];
+    const json_bind_field_t *field = frame->field;
+
+    if (!frame->array)
+    {
+        if (!field)
+            return JSON_BIND_SLOT_IGNORE;
+
+        frame->field = NULL;
+        slot->type = field->type;
+        slot->dest = frame->base + field->offset;
+        slot->size = field->size;
+        slot->field = field;
+        slot->schema = field->schema;
+        slot->owner = frame->base;
+        return JSON_BIND_SLOT_STORE;
+    }
+
+    if (frame->next >= field->size / field->element_size)
+        return JSON_BIND_SLOT_ERROR;
+
+    slot->type = field->element;
+    slot->dest = frame->base + frame->next * field->element_size;
+    slot->size = field->element_size;
+    slot->field = NULL;
+    slot->schema = field->schema;
+    slot->owner = NULL;
+
+    frame->next++;
+    *frame->count = frame->next;
+    return JSON_BIND_SLOT_STORE;
+}
+
+static bool json_bind_push(json_bind_context_t *ctx, bool array, json_bind_type_t expected)
+{
+    json_bind_slot_t slot;
+
+    if (ctx->skip)
+    {
+        ctx->skip++;
+        return true;
+    }
+
+    switch (json_bind_next_slot(ctx, &slot))
+    {
+        case JSON_BIND_SLOT_IGNORE:
+            ctx->skip = 1;
+            return true;
+        case JSON_BIND_SLOT_ERROR:
+            return false;
+        default:
+            break;
+    }
+
+    if (slot.type != expected || ctx->depth == JSON_BIND_MAX_DEPTH)
+        return false;
+
+    json_bind_frame_t *frame = &ctx->frames[ctx->depth++];
+    frame->schema = slot.schema;
+    frame->field = array ? slot.field : NULL;
+    frame->base = slot.dest;
+    frame->next = 0;
+    frame->count = NULL;
+    frame->array = array;
+
+    if (array)
+    {
+        frame->count = (size_t *)(slot.owner + slot.field->count_offset);
+        *frame->count = 0;
+    }
+
+    return true;
+}
+
+static bool json_bind_pop(json_bind_context_t *ctx)
+{
+    if (ctx->skip)
+        ctx->skip--;
+    else
+        ctx->depth--;
+
+    return true;
+}
+
+static bool json_bind_start_object(void *context)
+{
+    return json_bind_push((json_bind_context_t *)context, false, JSON_BIND_TYPE_OBJECT);
+}
+
+static bool json_bind_start_array(void *context)
+{
+    return json_bind_push((json_bind_context_t *)context, true, JSON_BIND_TYPE_ARRAY);
+}
+
+static bool json_bind_end(void *context)
+{
+    return json_bind_pop((json_bind_context_t *)context);
+}
+
+static bool json_bind_key(void *context, const char *key, size_t len)
+{
+    json_bind_context_t *ctx = (json_bind_context_t *)context;
+
+    if (ctx->skip)
+        return true;
+
+    json_bind_frame_t *frame = &ctx->frames[ctx->depth - 1];
+    const json_bind_schema_t *schema = frame->schema;
+    frame->field = NULL;
+
+    /* Members usually arrive in declaration order, so start the search
+       where the last match left off */
+    for (size_t i = 0; i < schema->field_count; i++)
+    {
+        size_t idx = frame->next + i;
+        if (idx >= schema->field_count)
+            idx -= schema->field_count;
+
+        const char *name = schema->fields[idx].name;
+        if (strncmp(name, key, len) == 0 && name[len] == '\0')
+        {
+            frame->field = &schema->fields[idx];
+            frame->next = idx + 1 < schema->field_count ? idx + 1 : 0;
+            break;
+        }
+    }
+
+    return true;
+}
+
+/* Resolves the slot for a scalar; *store is false when it is ignored */
+static bool json_bind_scalar_slot(json_bind_context_t *ctx, json_bind_slot_t *slot, bool *store)
+{
+    *store = false;
+
+    if (ctx->skip)
+        return true;
+
+    switch (json_bind_next_slot(ctx, slot))
+    {
+        case JSON_BIND_SLOT_IGNORE:
+            return true;
+        case JSON_BIND_SLOT_ERROR:
+            return false;
+        default:
+            *store = true;
+            return true;
+    }
+}
+
+static bool json_bind_string(void *context, const char *str, size_t len)
+{
+    json_bind_slot_t slot;
+    bool store = false;
+
+    if (!json_bind_scalar_slot((json_bind_context_t *)context, &slot, &store))
+        return false;
+
+    if (!store)
+        return true;
+
+    if (slot.type == JSON_BIND_TYPE_TIMESTAMP)
+        return date_time_parse_iso8601(str, len, (time_t *)slot.dest, NULL);
+
+    if (slot.type != JSON_BIND_TYPE_STRING || len >= slot.size)
+        return false;
+
+    memcpy(slot.dest, str, len);
+    slot.dest[len] = '\0';
+    return true;
+}
+
+/* Exact powers of ten for the fast double path */
+static const double json_bind_powers[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+typedef struct json_bind_number_t
+{
+    bool negative;
+    bool integer;           /* No fraction or exponent */
+    bool exact;             /* 'mantissa' holds every significant digit */
+    uint64_t mantissa;
+    int exponent;           /* Value is mantissa * 10^exponent */
+} json_bind_number_t;
+
+static bool json_bind_push_digit(json_bind_number_t *n, char c)
+{
+    uint64_t digit = (uint64_t)(c - '0');
+
+    if (n->mantissa > UINT64_MAX / 10 || (n->mantissa == UINT64_MAX / 10 && digit > UINT64_MAX % 10))
+    {
+        n->exact = false;
+        return false;
+    }
+
+    n->mantissa = n->mantissa * 10 + digit;
+    return true;
+}
+
+/* Splits SAX number text (already validated as JSON) into its parts */
+static void json_bind_scan_number(const char *num, size_t len, json_bind_number_t *n)
+{
+    size_t i = 0;
+    int dropped = 0;
+
+    n->negative = false;
+    n->integer = true;
+    n->exact = true;
+    n->mantissa = 0;
+    n->exponent = 0;
+
+    if (i < len && num[i] == '-')
+    {
+        n->negative = true;
+        i++;
+    }
+
+    for (; i < len && num[i] >= '0' && num[i] <= '9'; i++)
+    {
+        if (!json_bind_push_digit(n, num[i]))
+            dropped++;
+    }
+
+    if (i < len && num[i] == '.')
+    {
+        n->integer = false;
+        for (i++; i < len && num[i] >= '0' && num[i] <= '9'; i++)
+        {
+            if (json_bind_push_digit(n, num[i]))
+                n->exponent--;
+        }
+    }
+
+    if (i < len && (num[i] == 'e' || num[i] == 'E'))
+    {
+        int sign = 1;
+        int exp = 0;
+
+        n->integer = false;
+        i++;
+        if (i < len && (num[i] == '+' || num[i] == '-'))
+        {
+            sign = num[i] == '-' ? -1 : 1;
+            i++;
+        }
+        for (; i < len && num[i] >= '0' && num[i] <= '9'; i++)
+        {
+            if (exp < 100000)
+                exp = exp * 10 + (num[i] - '0');
+        }
+        n->exponent += sign * exp;
+    }
+
+    n->exponent += dropped;
+}
+
+/* SAX text is not terminated; strtod and friends need a copy */
+static bool json_bind_copy_number(const char *num, size_t len, char *text)
+{
+    if (len >= JSON_BIND_NUMBER_SIZE)
+        return false;
+
+    memcpy(text, num, len);
+    text[len] = '\0';
+    return true;
+}
+
+/* With both operands exact, one correctly rounded multiply or divide gives
+   the correctly rounded result; anything else goes through the C library */
+static bool json_bind_to_double(const char *num, size_t len, const json_bind_number_t *n, double *value)
+{
+    if (n->exact && n->mantissa < (1ULL << 53) && n->exponent >= -22 && n->exponent <= 22)
+    {
+        double m = (double)n->mantissa;
+        m = n->exponent < 0 ? m / json_bind_powers[-n->exponent] : m * json_bind_powers[n->exponent];
+        *value = n->negative ? -m : m;
+        return true;
+    }
+
+    char text[JSON_BIND_NUMBER_SIZE];
+    char *end = NULL;
+
+    if (!json_bind_copy_number(num, len, text))
+        return false;
+
+    *value = strtod(text, &end);
+    return *end == '\0';
+}
+
+static bool json_bind_to_float(const char *num, size_t len, const json_bind_number_t *n, float *value)
+{
+    if (n->exact && n->mantissa < (1ULL << 24) && n->exponent >= -10 && n->exponent <= 10)
+    {
+        float m = (float)n->mantissa;
+        float p = (float)json_bind_powers[n->exponent < 0 ? -n->exponent : n->exponent];
+        m = n->exponent < 0 ? m / p : m * p;
+        *value = n->negative ? -m : m;
+        return true;
+    }
+
+    char text[JSON_BIND_NUMBER_SIZE];
+    char *end = NULL;
+
+    if (!json_bind_copy_number(num, len, text))
+        return false;
+
+    *value = strtof(text, &end);
+    return *end == '\0';
+}
+
+static bool json_bind_number(void *context, const char *num, size_t len)
+{
+    json_bind_slot_t slot;
+    bool store = false;
+
+    if (!json_bind_scalar_slot((json_bind_context_t *)context, &slot, &store))
+        return false;
+
+    if (!store)
+        return true;
+
+    json_bind_number_t n;
+    json_bind_scan_number(num, len, &n);
+
+    switch (slot.type)
+    {
+        case JSON_BIND_TYPE_INT32:
+        case JSON_BIND_TYPE_INT64:
+        {
+            uint64_t limit = slot.type == JSON_BIND_TYPE_INT64 ? (uint64_t)INT64_MAX : (uint64_t)INT32_MAX;
+
+            if (!n.integer || !n.exact || n.mantissa > limit + (n.negative ? 1 : 0))
+                return false;
+
+            int64_t value = n.negative ? (int64_t)(0 - n.mantissa) : (int64_t)n.mantissa;
+
+            if (slot.type == JSON_BIND_TYPE_INT64)
+                *(int64_t *)slot.dest = value;
+            else
+                *(int32_t *)slot.dest = (int32_t)value;
+            return true;
+        }
+
+        case JSON_BIND_TYPE_UINT32:
+        case JSON_BIND_TYPE_UINT64:
+        {
+            uint64_t limit = slot.type == JSON_BIND_TYPE_UINT64 ? UINT64_MAX : (uint64_t)UINT32_MAX;
+
+            if (!n.integer || !n.exact || (n.negative && n.mantissa != 0) || n.mantissa > limit)
+                return false;
+
+            if (slot.type == JSON_BIND_TYPE_UINT64)
+                *(uint64_t *)slot.dest = n.mantissa;
+            else
+                *(uint32_t *)slot.dest = (uint32_t)n.mantissa;
+            return true;
+        }
+
+        case JSON_BIND_TYPE_FLOAT:
+            return json_bind_to_float(num, len, &n, (float *)slot.dest);
+
+        case JSON_BIND_TYPE_DOUBLE:
+            return json_bind_to_double(num, len, &n, (double *)slot.dest);
+
+        default:
+            return false;
+    }
+}
+
+static bool json_bind_boolean(void *context, bool value)
+{
+    json_bind_slot_t slot;
+    bool store = false;
+
+    if (!json_bind_scalar_slot((json_bind_context_t *)context, &slot, &store))
+        return false;
+
+    if (!store)
+        return true;
+
+    if (slot.type != JSON_BIND_TYPE_BOOL)
+        return false;
+
+    *(bool *)slot.dest = value;
+    return true;
+}
+
+static bool json_bind_null(void *context)
+{
+    json_bind_slot_t slot;
+    bool store = false;
+
+    /* The slot is consumed (an array element still counts) but not written */
+    return json_bind_scalar_slot((json_bind_context_t *)context, &slot, &store);
+}
+
+static const json_sax_handler_t json_bind_handler =
+{
+    json_bind_start_object,
+    json_bind_end,
+    json_bind_start_array,
+    json_bind_end,
+    json_bind_key,
+    json_bind_string,
+    json_bind_number,
+    json_bind_boolean,
+    json_bind_null,
+    NULL
+};
+
+bool json_bind_decode(const json_bind_schema_t *schema, const char *input, size_t length, void *out)
+{
+    if (!schema || !input || !out)
+        return false;
+
+    json_bind_context_t ctx;
+    ctx.root = schema;
+    ctx.out = (char *)out;
+    ctx.started = false;
+    ctx.skip = 0;
+    ctx.depth = 0;
+
+    return json_sax_parse(input, length, &json_bind_handler, &ctx) == JSON_SAX_OK;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Encoding                                                                  */
+/* ------------------------------------------------------------------------- */
+
+static bool json_bind_write_float(json_writer_t *writer, float value)
+{
+    if (!isfinite(value))
+        return json_writer_null(writer);
+
+    /* Shortest of the usual precisions that reads back as the same float */
+    char text[32];
+    int len = snprintf(text, sizeof(text), "%.6g", (double)value);
+
+    if (strtof(text, NULL) != value)
+        len = snprintf(text, sizeof(text), "%.9g", (double)value);
+
+    return json_writer_number_text(writer, text, (size_t)len);
+}
+
+static bool json_bind_write_value(json_writer_t *writer, json_bind_type_t type, const char *src, size_t size, const json_bind_schema_t *schema)
+{
+    switch (type)
+    {
+        case JSON_BIND_TYPE_BOOL:
+            return json_writer_boolean(writer, *(const bool *)src);
+        case JSON_BIND_TYPE_INT32:
+            return json_writer_int64(writer, *(const int32_t *)src);
+        case JSON_BIND_TYPE_INT64:
+            return json_writer_int64(writer, *(const int64_t *)src);
+        case JSON_BIND_TYPE_UINT32:
+            return json_writer_uint64(writer, *(const uint32_t *)src);
+        case JSON_BIND_TYPE_UINT64:
+            return json_writer_uint64(writer, *(const uint64_t *)src);
+        case JSON_BIND_TYPE_FLOAT:
+            return json_bind_write_float(writer, *(const float *)src);
+        case JSON_BIND_TYPE_DOUBLE:
+            return json_writer_double(writer, *(const double *)src);
+        case JSON_BIND_TYPE_STRING:
+        {
+            const char *nul = (const char *)memchr(src, '\0', size);
+            return json_writer_string_length(writer, src, nul ? (size_t)(nul - src) : size);
+        }
+        case JSON_BIND_TYPE_TIMESTAMP:
+            return json_writer_timestamp(writer, *(const time_t *)src, 0);
+        case JSON_BIND_TYPE_OBJECT:
+            return json_bind_encode(schema, src, writer);
+        default:
+            return false;
+    }
+}
+
+bool json_bind_encode(const json_bind_schema_t *schema, const void *in, json_writer_t *writer)
+{
+    if (!schema || !in || !writer)
+        return false;
+
+    const char *base = (const char *)in;
+
+    if (!json_writer_begin_object(writer))
+        return false;
+
+    for (size_t i = 0; i < schema->field_count; i++)
+    {
+        const json_bind_field_t *field = &schema->fields[i];
+
+        if (!json_writer_key(writer, field->name))
+            return false;
+
+        if (field->type != JSON_BIND_TYPE_ARRAY)
+        {
+            if (!json_bind_write_value(writer, field->type, base + field->offset, field->size, field->schema))
+                return false;
+
+            continue;
+        }
+
+        size_t capacity = field->size / field->element_size;
+        size_t count = *(const size_t *)(base + field->count_offset);
+        if (count > capacity)
+            count = capacity;
+
+        if (!json_writer_begin_array(writer))
+            return false;
+
+        for (size_t e = 0; e < count; e++)
+        {
+            const char *element = base + field->offset + e * field->element_size;
+
+            if (!json_bind_write_value(writer, field->element, element, field->element_size, field->schema))
+                return false;
+        }
+
+        if (!json_writer_end_array(writer))
+            return false;
+    }
+
+    return json_writer_end_object(writer);
+}
@@ -0,0 +1,416 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "jsonlines.h"
+#include "file.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* Chunks are cut at the first newline after the target size. Many chunks
+   per thread balance uneven records; the window bounds how far parsing may
+   run ahead of delivery, and with it the memory held by parsed documents. */
+#define JSON_LINES_MIN_CHUNK (64 * 1024)
+#define JSON_LINES_MAX_CHUNK (1024 * 1024)
+#define JSON_LINES_CHUNKS_PER_THREAD 4
+#define JSON_LINES_WINDOW_PER_THREAD 4
+#define JSON_LINES_MAX_THREADS 64
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef struct json_lines_chunk_t
+{
+    const char *start;
+    size_t length;
+    json_document_t **docs;  /* One entry per record, NULL if malformed */
+    size_t count;
+    bool done;
+    bool failed;
+} json_lines_chunk_t;
+
+typedef struct json_lines_job_t
+{
+    json_lines_chunk_t *chunks;
+    size_t chunk_count;
+    size_t next;             /* First chunk not yet claimed by a thread */
+    size_t delivered;        /* Chunks already handed to the callback */
+    size_t window;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;    /* A chunk finished parsing */
+    pthread_cond_t room;     /* Delivery advanced or the run stopped */
+} json_lines_job_t;
+
+typedef struct json_lines_collect_t
+{
+    json_document_t **docs;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} json_lines_collect_t;
+
+/* ------------------------------------------------------------------------- */
+/* Records                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* Finds the next record in [*pos, end); false when only blank lines remain */
+static bool json_lines_next_record(const char *start, size_t length, size_t *pos, const char **line, size_t *line_len)
+{
+    while (*pos < length)
+    {
+        const char *begin = start + *pos;
+        const char *nl = (const char *)memchr(begin, '\n', length - *pos);
+        size_t len = nl ? (size_t)(nl - begin) : length - *pos;
+
+        *pos += len + (nl ? 1 : 0);
+
+        if (len > 0 && begin[len - 1] == '\r')
+            len--;
+
+        for (size_t i = 0; i < len; i++)
+        {
+            char c = begin[i];
+            if (c != ' ' && c != '\t' && c != '\r')
+            {
+                *line = begin;
+                *line_len = len;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void json_lines_parse_chunk(json_lines_chunk_t *chunk)
+{
+    size_t pos = 0;
+    size_t capacity = 0;
+    const char *line = NULL;
+    size_t len = 0;
+
+    while (json_lines_next_record(chunk->start, chunk->length, &pos, &line, &len))
+    {
+        if (chunk->count == capacity)
+        {
+            size_t grown = capacity ? capacity * 2 : 256;
+            json_document_t **docs = (json_document_t **)realloc(chunk->docs, grown * sizeof(json_document_t *));
+            if (!docs)
+            {
+                chunk->failed = true;
+                return;
+            }
+            chunk->docs = docs;
+            capacity = grown;
+        }
+
+        chunk->docs[chunk->count++] = json_parse_string_length(line, len);
+    }
+}
+
+static void json_lines_release_chunk(json_lines_chunk_t *chunk, size_t from)
+{
+    for (size_t i = from; i < chunk->count; i++)
+        json_free_document(chunk->docs[i]);
+
+    free(chunk->docs);
+    chunk->docs = NULL;
+    chunk->count = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Scheduling                                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Claims the next chunk if it is inside the window; caller holds the lock */
+static bool json_lines_claim(json_lines_job_t *job, size_t *index)
+{
+    if (job->stop || job->next >= job->chunk_count || job->next >= job->delivered + job->window)
+        return false;
+
+    *index = job->next++;
+    return true;
+}
+
+static void json_lines_run_chunk(json_lines_job_t *job, size_t index)
+{
+    pthread_mutex_unlock(&job->lock);
+    json_lines_parse_chunk(&job->chunks[index]);
+    pthread_mutex_lock(&job->lock);
+
+    job->chunks[index].done = true;
+    pthread_cond_broadcast(&job->ready);
+}
+
+static void *json_lines_worker(void *arg)
+{
+    json_lines_job_t *job = (json_lines_job_t *)arg;
+    size_t index = 0;
+
+    pthread_mutex_lock(&job->lock);
+
+    while (!job->stop && job->next < job->chunk_count)
+    {
+        if (json_lines_claim(job, &index))
+            json_lines_run_chunk(job, index);
+        else
+            pthread_cond_wait(&job->room, &job->lock);
+    }
+
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+static size_t json_lines_plan(const char *input, size_t length, size_t threads, json_lines_chunk_t **out)
+{
+    size_t target = length / (threads * JSON_LINES_CHUNKS_PER_THREAD);
+
+    if (target < JSON_LINES_MIN_CHUNK)
+        target = JSON_LINES_MIN_CHUNK;
+    if (target > JSON_LINES_MAX_CHUNK)
+        target = JSON_LINES_MAX_CHUNK;
+
+    size_t capacity = length / target + 1;
+    json_lines_chunk_t *chunks = (json_lines_chunk_t *)calloc(capacity, sizeof(json_lines_chunk_t));
+    if (!chunks)
+        return 0;
+
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (pos < length && count < capacity)
+    {
+        size_t end = length;
+
+        if (length - pos > target && count + 1 < capacity)
+        {
+            const char *nl = (const char *)memchr(input + pos + target, '\n', length - pos - target);
+            if (nl)
+                end = (size_t)(nl - input) + 1;
+        }
+
+        chunks[count].start = input + pos;
+        chunks[count].length = end - pos;
+        count++;
+        pos = end;
+    }
+
+    *out = chunks;
+    return count;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+static bool json_lines_parse_serial(const char *input, size_t length, json_lines_callback_t callback, void *context)
+{
+    size_t pos = 0;
+    size_t record = 0;
+    const char *line = NULL;
+    size_t len = 0;
+
+    while (json_lines_next_record(input, length, &pos, &line, &len))
+    {
+        if (!callback(context, record++, json_parse_string_length(line, len)))
+            return false;
+    }
+
+    return true;
+}
+
+bool json_lines_parse(const char *input, size_t length, size_t threads, json_lines_callback_t callback, void *context)
+{
+    if (!input || !callback)
+        return false;
+
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    if (threads > JSON_LINES_MAX_THREADS)
+        threads = JSON_LINES_MAX_THREADS;
+
+    if (threads == 1 || length <= JSON_LINES_MIN_CHUNK)
+        return json_lines_parse_serial(input, length, callback, context);
+
+    json_lines_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.chunk_count = json_lines_plan(input, length, threads, &job.chunks);
+    if (job.chunk_count == 0)
+        return false;
+
+    if (threads > job.chunk_count)
+        threads = job.chunk_count;
+
+    job.window = threads * JSON_LINES_WINDOW_PER_THREAD;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.ready, NULL);
+    pthread_cond_init(&job.room, NULL);
+
+    /* The calling thread parses as well, so a failed pthread_create only
+       costs parallelism */
+    pthread_t workers[JSON_LINES_MAX_THREADS];
+    size_t started = 0;
+
+    for (size_t i = 1; i < threads; i++)
+    {
+        if (pthread_create(&workers[started], NULL, json_lines_worker, &job) == 0)
+            started++;
+    }
+
+    bool result = true;
+    size_t record = 0;
+    size_t index = 0;
+
+    pthread_mutex_lock(&job.lock);
+
+    for (size_t c = 0; c < job.chunk_count && result; c++)
+    {
+        json_lines_chunk_t *chunk = &job.chunks[c];
+
+        while (!chunk->done)
+        {
+            if (json_lines_claim(&job, &index))
+                json_lines_run_chunk(&job, index);
+            else
+                pthread_cond_wait(&job.ready, &job.lock);
+        }
+
+        pthread_mutex_unlock(&job.lock);
+
+        size_t i = 0;
+
+        if (chunk->failed)
+            result = false;
+
+        for (; i < chunk->count && result; i++)
+        {
+            json_document_t *doc = chunk->docs[i];
+            chunk->docs[i] = NULL;
+            result = callback(context, record++, doc);
+        }
+
+        json_lines_release_chunk(chunk, i);
+
+        pthread_mutex_lock(&job.lock);
+        job.delivered = c + 1;
+        if (!result)
+            job.stop = true;
+        pthread_cond_broadcast(&job.room);
+    }
+
+    job.stop = true;
+    pthread_cond_broadcast(&job.room);
+    pthread_mutex_unlock(&job.lock);
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    /* Chunks parsed ahead of a stop are never delivered */
+    for (size_t c = job.delivered; c < job.chunk_count; c++)
+        json_lines_release_chunk(&job.chunks[c], 0);
+
+    pthread_cond_destroy(&job.room);
+    pthread_cond_destroy(&job.ready);
+    pthread_mutex_destroy(&job.lock);
+    free(job.chunks);
+
+    return result;
+}
+
+bool json_lines_load_file(const char *path, size_t threads, json_lines_callback_t callback, void *context)
+{
+    file_map_t *map = file_map_open(path);
+    if (!map)
+        return false;
+
+    bool result = json_lines_parse(file_map_get_data(map), file_map_get_size(map), threads, callback, context);
+    file_map_close(map);
+    return result;
+}
+
+static bool json_lines_collect(void *context, size_t record, json_document_t *doc)
+{
+    json_lines_collect_t *collect = (json_lines_collect_t *)context;
+    (void)record;
+
+    if (collect->count == collect->capacity)
+    {
+        size_t grown = collect->capacity ? collect->capacity * 2 : 1024;
+        json_document_t **docs = (json_document_t **)realloc(collect->docs, grown * sizeof(json_document_t *));
+        if (!docs)
+        {
+            json_free_document(doc);
+            collect->failed = true;
+            return false;
+        }
+        collect->docs = docs;
+        collect->capacity = grown;
+    }
+
+    collect->docs[collect->count++] = doc;
+    return true;
+}
+
+json_document_t **json_lines_parse_all(const char *input, size_t length, size_t threads, size_t *count)
+{
+    json_lines_collect_t collect;
+    memset(&collect, 0, sizeof(collect));
+
+    if (count)
+        *count = 0;
+
+    if (!json_lines_parse(input, length, threads, json_lines_collect, &collect) || collect.count == 0)
+    {
+        json_lines_free_all(collect.docs, collect.count);
+        return NULL;
+    }
+
+    if (count)
+        *count = collect.count;
+
+    return collect.docs;
+}
+
+void json_lines_free_all(json_document_t **docs, size_t count)
+{
+    if (!docs)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+        json_free_document(docs[i]);
+
+    free(docs);
+}
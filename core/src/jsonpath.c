@@ -0,0 +1,241 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "jsonpath.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef struct json_path_segment_t
+{
+    const char *key;         /* Unescaped member name */
+    size_t index;            /* Array position, SIZE_MAX if not a valid one */
+    bool wildcard;
+} json_path_segment_t;
+
+/* Segments and key text share the allocation of the path */
+struct json_path_t
+{
+    size_t count;
+    json_path_segment_t *segments;
+};
+
+typedef struct json_path_matches_t
+{
+    json_node_t **results;
+    size_t max;
+    size_t count;
+    bool first_only;
+} json_path_matches_t;
+
+/* ------------------------------------------------------------------------- */
+/* Compilation                                                               */
+/* ------------------------------------------------------------------------- */
+
+/* RFC 6901 array index: "0" or digits without a leading zero */
+static size_t json_path_parse_index(const char *key)
+{
+    size_t value = 0;
+
+    if (!*key || (key[0] == '0' && key[1]))
+        return SIZE_MAX;
+
+    for (; *key; key++)
+    {
+        if (*key < '0' || *key > '9')
+            return SIZE_MAX;
+
+        size_t digit = (size_t)(*key - '0');
+
+        if (value > (SIZE_MAX - 1 - digit) / 10)
+            return SIZE_MAX;
+
+        value = value * 10 + digit;
+    }
+
+    return value;
+}
+
+json_path_t *json_path_compile(const char *pointer, bool wildcards)
+{
+    if (!pointer || (*pointer && *pointer != '/'))
+        return NULL;
+
+    size_t count = 0;
+    size_t len = strlen(pointer);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (pointer[i] == '/')
+            count++;
+    }
+
+    /* Unescaped keys are never longer than the text they come from */
+    json_path_t *path = (json_path_t *)malloc(sizeof(json_path_t) + count * sizeof(json_path_segment_t) + len + 1);
+    if (!path)
+        return NULL;
+
+    path->count = count;
+    path->segments = (json_path_segment_t *)(path + 1);
+
+    char *keys = (char *)(path->segments + count);
+    const char *s = pointer;
+
+    for (size_t seg = 0; seg < count; seg++)
+    {
+        const char *raw = ++s;
+        char *key = keys;
+
+        while (*s && *s != '/')
+        {
+            if (*s == '~')
+            {
+                if (s[1] == '0')
+                    *keys++ = '~';
+                else if (s[1] == '1')
+                    *keys++ = '/';
+                else
+                {
+                    free(path);
+                    return NULL;
+                }
+
+                s += 2;
+                continue;
+            }
+
+            *keys++ = *s++;
+        }
+
+        *keys++ = '\0';
+
+        path->segments[seg].key = key;
+        path->segments[seg].index = json_path_parse_index(key);
+        path->segments[seg].wildcard = wildcards && s - raw == 1 && raw[0] == '*';
+    }
+
+    return path;
+}
+
+void json_path_free(json_path_t *path)
+{
+    free(path);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Evaluation                                                                */
+/* ------------------------------------------------------------------------- */
+
+static json_node_t *json_path_step(json_node_t *node, const json_path_segment_t *seg)
+{
+    switch (json_node_type(node))
+    {
+        case JSON_NODE_OBJECT:
+            return json_node_first_child_element(node, seg->key);
+
+        case JSON_NODE_ARRAY:
+            if (seg->index == SIZE_MAX)
+                return NULL;
+            return json_node_get_child_at(node, seg->index);
+
+        default:
+            return NULL;
+    }
+}
+
+/* Returns false once the caller only wanted the first match and has it */
+static bool json_path_collect(const json_path_t *path, size_t seg, json_node_t *node, json_path_matches_t *m)
+{
+    for (; seg < path->count && node; seg++)
+    {
+        const json_path_segment_t *s = &path->segments[seg];
+
+        if (!s->wildcard)
+        {
+            node = json_path_step(node, s);
+            continue;
+        }
+
+        json_node_type_t type = json_node_type(node);
+
+        if (type != JSON_NODE_OBJECT && type != JSON_NODE_ARRAY)
+            return true;
+
+        for (json_node_t *c = json_node_first_child_element(node, NULL); c; c = json_node_next_sibling_element(c, NULL))
+        {
+            if (!json_path_collect(path, seg + 1, c, m))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (!node)
+        return true;
+
+    if (m->count < m->max)
+        m->results[m->count] = node;
+
+    m->count++;
+    return !m->first_only;
+}
+
+static json_node_t *json_path_start(json_node_t *node)
+{
+    if (json_node_type(node) == JSON_NODE_DOCUMENT)
+        return json_node_first_child_element(node, NULL);
+
+    return node;
+}
+
+json_node_t *json_path_find(const json_path_t *path, json_node_t *node)
+{
+    if (!path || !node)
+        return NULL;
+
+    json_node_t *result = NULL;
+    json_path_matches_t m = { &result, 1, 0, true };
+
+    json_path_collect(path, 0, json_path_start(node), &m);
+    return result;
+}
+
+size_t json_path_find_all(const json_path_t *path, json_node_t *node, json_node_t **results, size_t max)
+{
+    if (!path || !node)
+        return 0;
+
+    json_path_matches_t m = { results, results ? max : 0, 0, false };
+
+    json_path_collect(path, 0, json_path_start(node), &m);
+    return m.count;
+}
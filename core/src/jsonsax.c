@@ -0,0 +1,737 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "jsonsax.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define JSON_SAX_MAX_DEPTH 1024
+#define JSON_SAX_TOKEN_SIZE 256
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef enum
+{
+    SAX_STATE_VALUE,                /* Expecting a value */
+    SAX_STATE_VALUE_OR_ARRAY_END,   /* Just after '[' */
+    SAX_STATE_KEY_OR_OBJECT_END,    /* Just after '{' */
+    SAX_STATE_KEY,                  /* After ',' inside an object */
+    SAX_STATE_COLON,
+    SAX_STATE_AFTER_VALUE,          /* Expecting ',' or a closing bracket */
+    SAX_STATE_STRING,
+    SAX_STATE_NUMBER,
+    SAX_STATE_LITERAL,
+    SAX_STATE_DONE                  /* Top level value complete */
+} sax_state_t;
+
+typedef enum
+{
+    SAX_ESCAPE_NONE,
+    SAX_ESCAPE_START,               /* Seen '\' */
+    SAX_ESCAPE_UNICODE              /* Inside \uXXXX */
+} sax_escape_t;
+
+struct json_sax_parser_t
+{
+    json_sax_handler_t handler;
+    void *context;
+    bool multiple_values;
+
+    json_sax_status_t status;
+    sax_state_t state;
+    size_t offset;
+
+    /* Open containers, '{' or '[' */
+    size_t depth;
+    char stack[JSON_SAX_MAX_DEPTH];
+
+    /* Strings and numbers that span chunks or need unescaping */
+    char *token;
+    size_t token_len;
+    size_t token_capacity;
+
+    bool string_is_key;
+    sax_escape_t escape;
+    int hex_digits;
+    unsigned int code_point;
+    unsigned int high_surrogate;
+
+    const char *literal;
+    size_t literal_pos;
+};
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static const char *sax_fail(json_sax_parser_t *p, const char *s)
+{
+    p->status = JSON_SAX_ERROR;
+    return s;
+}
+
+static bool sax_check(json_sax_parser_t *p, bool keep_going)
+{
+    if (!keep_going)
+        p->status = JSON_SAX_ABORTED;
+
+    return keep_going;
+}
+
+static bool sax_token_append(json_sax_parser_t *p, const char *data, size_t len)
+{
+    if (p->token_len + len > p->token_capacity)
+    {
+        size_t cap = p->token_capacity ? p->token_capacity : JSON_SAX_TOKEN_SIZE;
+
+        while (cap < p->token_len + len)
+            cap *= 2;
+
+        char *tok = (char *)realloc(p->token, cap);
+        if (!tok)
+        {
+            p->status = JSON_SAX_ERROR;
+            return false;
+        }
+
+        p->token = tok;
+        p->token_capacity = cap;
+    }
+
+    memcpy(p->token + p->token_len, data, len);
+    p->token_len += len;
+    return true;
+}
+
+static bool sax_token_append_utf8(json_sax_parser_t *p, unsigned int code)
+{
+    char out[4];
+    size_t n = 0;
+
+    if (code <= 0x7F)
+    {
+        out[n++] = (char)code;
+    }
+    else if (code <= 0x7FF)
+    {
+        out[n++] = (char)(0xC0 | ((code >> 6) & 0x1F));
+        out[n++] = (char)(0x80 | (code & 0x3F));
+    }
+    else if (code <= 0xFFFF)
+    {
+        out[n++] = (char)(0xE0 | ((code >> 12) & 0x0F));
+        out[n++] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[n++] = (char)(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        out[n++] = (char)(0xF0 | ((code >> 18) & 0x07));
+        out[n++] = (char)(0x80 | ((code >> 12) & 0x3F));
+        out[n++] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[n++] = (char)(0x80 | (code & 0x3F));
+    }
+
+    return sax_token_append(p, out, n);
+}
+
+/* A high surrogate not followed by a low one is kept as is, like json.c does */
+static bool sax_flush_surrogate(json_sax_parser_t *p)
+{
+    if (!p->high_surrogate)
+        return true;
+
+    unsigned int code = p->high_surrogate;
+    p->high_surrogate = 0;
+    return sax_token_append_utf8(p, code);
+}
+
+static bool sax_is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool sax_is_number_char(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/* Strict RFC 8259 number grammar */
+static bool sax_is_valid_number(const char *s, size_t len)
+{
+    const char *end = s + len;
+
+    if (s < end && *s == '-') s++;
+    if (s == end) return false;
+
+    if (*s == '0')
+    {
+        s++;
+    }
+    else if (*s >= '1' && *s <= '9')
+    {
+        while (s < end && *s >= '0' && *s <= '9') s++;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (s < end && *s == '.')
+    {
+        s++;
+        if (s == end || *s < '0' || *s > '9') return false;
+        while (s < end && *s >= '0' && *s <= '9') s++;
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E'))
+    {
+        s++;
+        if (s < end && (*s == '+' || *s == '-')) s++;
+        if (s == end || *s < '0' || *s > '9') return false;
+        while (s < end && *s >= '0' && *s <= '9') s++;
+    }
+
+    return s == end;
+}
+
+/* ------------------------------------------------------------------------- */
+/* State Machine                                                             */
+/* ------------------------------------------------------------------------- */
+
+static void sax_value_done(json_sax_parser_t *p)
+{
+    if (p->depth > 0)
+    {
+        p->state = SAX_STATE_AFTER_VALUE;
+        return;
+    }
+
+    p->state = SAX_STATE_DONE;
+
+    if (p->handler.on_document_end)
+        sax_check(p, p->handler.on_document_end(p->context));
+}
+
+static const char *sax_open(json_sax_parser_t *p, const char *s, char kind)
+{
+    if (p->depth == JSON_SAX_MAX_DEPTH)
+        return sax_fail(p, s);
+
+    p->stack[p->depth++] = kind;
+
+    if (kind == '{')
+    {
+        p->state = SAX_STATE_KEY_OR_OBJECT_END;
+        if (p->handler.on_start_object)
+            sax_check(p, p->handler.on_start_object(p->context));
+    }
+    else
+    {
+        p->state = SAX_STATE_VALUE_OR_ARRAY_END;
+        if (p->handler.on_start_array)
+            sax_check(p, p->handler.on_start_array(p->context));
+    }
+
+    return s + 1;
+}
+
+static const char *sax_close(json_sax_parser_t *p, const char *s, char kind)
+{
+    if (p->depth == 0 || p->stack[p->depth - 1] != kind)
+        return sax_fail(p, s);
+
+    p->depth--;
+
+    if (kind == '{')
+    {
+        if (p->handler.on_end_object && !sax_check(p, p->handler.on_end_object(p->context)))
+            return s + 1;
+    }
+    else
+    {
+        if (p->handler.on_end_array && !sax_check(p, p->handler.on_end_array(p->context)))
+            return s + 1;
+    }
+
+    sax_value_done(p);
+    return s + 1;
+}
+
+static const char *sax_begin_value(json_sax_parser_t *p, const char *s)
+{
+    switch (*s)
+    {
+        case '{':
+            return sax_open(p, s, '{');
+
+        case '[':
+            return sax_open(p, s, '[');
+
+        case '"':
+            p->state = SAX_STATE_STRING;
+            p->string_is_key = false;
+            p->token_len = 0;
+            return s + 1;
+
+        case 't':
+            p->literal = "true";
+            break;
+
+        case 'f':
+            p->literal = "false";
+            break;
+
+        case 'n':
+            p->literal = "null";
+            break;
+
+        default:
+            if (*s == '-' || (*s >= '0' && *s <= '9'))
+            {
+                p->state = SAX_STATE_NUMBER;
+                p->token_len = 0;
+                return s;
+            }
+            return sax_fail(p, s);
+    }
+
+    p->state = SAX_STATE_LITERAL;
+    p->literal_pos = 0;
+    return s;
+}
+
+static void sax_emit_string(json_sax_parser_t *p, const char *str, size_t len)
+{
+    if (p->string_is_key)
+    {
+        p->state = SAX_STATE_COLON;
+        if (p->handler.on_key)
+            sax_check(p, p->handler.on_key(p->context, str, len));
+        return;
+    }
+
+    if (p->handler.on_string && !sax_check(p, p->handler.on_string(p->context, str, len)))
+        return;
+
+    sax_value_done(p);
+}
+
+static const char *sax_scan_escape(json_sax_parser_t *p, const char *s)
+{
+    char c = *s;
+
+    if (p->escape == SAX_ESCAPE_UNICODE)
+    {
+        unsigned int digit;
+
+        if (c >= '0' && c <= '9') digit = (unsigned int)(c - '0');
+        else if (c >= 'a' && c <= 'f') digit = 10 + (unsigned int)(c - 'a');
+        else if (c >= 'A' && c <= 'F') digit = 10 + (unsigned int)(c - 'A');
+        else return sax_fail(p, s);
+
+        p->code_point = (p->code_point << 4) | digit;
+
+        if (++p->hex_digits < 4)
+            return s + 1;
+
+        p->escape = SAX_ESCAPE_NONE;
+        unsigned int code = p->code_point;
+
+        if (code >= 0xDC00 && code <= 0xDFFF && p->high_surrogate)
+        {
+            code = 0x10000 + ((p->high_surrogate - 0xD800) << 10) + (code - 0xDC00);
+            p->high_surrogate = 0;
+        }
+        else
+        {
+            if (!sax_flush_surrogate(p))
+                return s;
+
+            if (code >= 0xD800 && code <= 0xDBFF)
+            {
+                p->high_surrogate = code;
+                return s + 1;
+            }
+        }
+
+        sax_token_append_utf8(p, code);
+        return s + 1;
+    }
+
+    char out;
+
+    switch (c)
+    {
+        case '"':  out = '"';  break;
+        case '\\': out = '\\'; break;
+        case '/':  out = '/';  break;
+        case 'b':  out = '\b'; break;
+        case 'f':  out = '\f'; break;
+        case 'n':  out = '\n'; break;
+        case 'r':  out = '\r'; break;
+        case 't':  out = '\t'; break;
+
+        case 'u':
+            p->escape = SAX_ESCAPE_UNICODE;
+            p->hex_digits = 0;
+            p->code_point = 0;
+            return s + 1;
+
+        default:
+            return sax_fail(p, s);
+    }
+
+    p->escape = SAX_ESCAPE_NONE;
+
+    if (sax_flush_surrogate(p))
+        sax_token_append(p, &out, 1);
+
+    return s + 1;
+}
+
+static const char *sax_scan_string(json_sax_parser_t *p, const char *s, const char *end)
+{
+    while (s < end && p->status == JSON_SAX_OK)
+    {
+        if (p->escape != SAX_ESCAPE_NONE)
+        {
+            s = sax_scan_escape(p, s);
+            continue;
+        }
+
+        const char *run = s;
+
+        while (s < end && *s != '"' && *s != '\\' && (unsigned char)*s >= 0x20)
+            s++;
+
+        /* Whole string inside this chunk without escapes: no copy */
+        if (s < end && *s == '"' && p->token_len == 0 && !p->high_surrogate)
+        {
+            sax_emit_string(p, run, (size_t)(s - run));
+            return s + 1;
+        }
+
+        if (s > run && (!sax_flush_surrogate(p) || !sax_token_append(p, run, (size_t)(s - run))))
+            return s;
+
+        if (s == end)
+            return s;
+
+        if (*s == '"')
+        {
+            if (sax_flush_surrogate(p))
+                sax_emit_string(p, p->token, p->token_len);
+
+            p->token_len = 0;
+            return s + 1;
+        }
+
+        if (*s == '\\')
+        {
+            p->escape = SAX_ESCAPE_START;
+            s++;
+            continue;
+        }
+
+        /* Raw control character */
+        return sax_fail(p, s);
+    }
+
+    return s;
+}
+
+static const char *sax_number_done(json_sax_parser_t *p, const char *s, const char *num, size_t len)
+{
+    if (!sax_is_valid_number(num, len))
+        return sax_fail(p, s);
+
+    if (p->handler.on_number && !sax_check(p, p->handler.on_number(p->context, num, len)))
+        return s;
+
+    p->token_len = 0;
+    sax_value_done(p);
+    return s;
+}
+
+static const char *sax_scan_number(json_sax_parser_t *p, const char *s, const char *end)
+{
+    const char *run = s;
+
+    while (s < end && sax_is_number_char(*s))
+        s++;
+
+    /* The terminating character is left for the structural pass */
+    if (s < end && p->token_len == 0)
+        return sax_number_done(p, s, run, (size_t)(s - run));
+
+    if (!sax_token_append(p, run, (size_t)(s - run)))
+        return s;
+
+    if (s == end)
+        return s;
+
+    return sax_number_done(p, s, p->token, p->token_len);
+}
+
+static const char *sax_scan_literal(json_sax_parser_t *p, const char *s, const char *end)
+{
+    while (s < end && p->literal[p->literal_pos])
+    {
+        if (*s != p->literal[p->literal_pos])
+            return sax_fail(p, s);
+
+        s++;
+        p->literal_pos++;
+    }
+
+    if (p->literal[p->literal_pos])
+        return s;
+
+    if (p->literal[0] == 'n')
+    {
+        if (p->handler.on_null && !sax_check(p, p->handler.on_null(p->context)))
+            return s;
+    }
+    else
+    {
+        if (p->handler.on_boolean && !sax_check(p, p->handler.on_boolean(p->context, p->literal[0] == 't')))
+            return s;
+    }
+
+    sax_value_done(p);
+    return s;
+}
+
+static const char *sax_scan_structural(json_sax_parser_t *p, const char *s, const char *end)
+{
+    if (sax_is_ws(*s))
+    {
+        while (s < end && sax_is_ws(*s))
+            s++;
+        return s;
+    }
+
+    switch (p->state)
+    {
+        case SAX_STATE_VALUE_OR_ARRAY_END:
+            if (*s == ']')
+                return sax_close(p, s, '[');
+            return sax_begin_value(p, s);
+
+        case SAX_STATE_VALUE:
+            return sax_begin_value(p, s);
+
+        case SAX_STATE_KEY_OR_OBJECT_END:
+            if (*s == '}')
+                return sax_close(p, s, '{');
+            /* fall through */
+
+        case SAX_STATE_KEY:
+            if (*s != '"')
+                return sax_fail(p, s);
+            p->state = SAX_STATE_STRING;
+            p->string_is_key = true;
+            p->token_len = 0;
+            return s + 1;
+
+        case SAX_STATE_COLON:
+            if (*s != ':')
+                return sax_fail(p, s);
+            p->state = SAX_STATE_VALUE;
+            return s + 1;
+
+        case SAX_STATE_AFTER_VALUE:
+            if (*s == ',')
+            {
+                p->state = p->stack[p->depth - 1] == '{' ? SAX_STATE_KEY : SAX_STATE_VALUE;
+                return s + 1;
+            }
+            if (*s == '}')
+                return sax_close(p, s, '{');
+            if (*s == ']')
+                return sax_close(p, s, '[');
+            return sax_fail(p, s);
+
+        case SAX_STATE_DONE:
+            if (!p->multiple_values)
+                return sax_fail(p, s);
+            return sax_begin_value(p, s);
+
+        default:
+            return sax_fail(p, s);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+json_sax_parser_t *json_sax_parser_allocate(const json_sax_handler_t *handler, void *context, bool multiple_values)
+{
+    json_sax_parser_t *p = (json_sax_parser_t *)malloc(sizeof(json_sax_parser_t));
+    if (!p)
+        return NULL;
+
+    memset(&p->handler, 0, sizeof(p->handler));
+
+    if (handler)
+        p->handler = *handler;
+
+    p->context = context;
+    p->multiple_values = multiple_values;
+    p->token = NULL;
+    p->token_capacity = 0;
+
+    json_sax_parser_reset(p);
+    return p;
+}
+
+void json_sax_parser_free(json_sax_parser_t *parser)
+{
+    if (!parser)
+        return;
+
+    free(parser->token);
+    free(parser);
+}
+
+void json_sax_parser_reset(json_sax_parser_t *parser)
+{
+    if (!parser)
+        return;
+
+    parser->status = JSON_SAX_OK;
+    parser->state = SAX_STATE_VALUE;
+    parser->offset = 0;
+    parser->depth = 0;
+    parser->token_len = 0;
+    parser->string_is_key = false;
+    parser->escape = SAX_ESCAPE_NONE;
+    parser->hex_digits = 0;
+    parser->code_point = 0;
+    parser->high_surrogate = 0;
+    parser->literal = NULL;
+    parser->literal_pos = 0;
+}
+
+json_sax_status_t json_sax_parser_feed(json_sax_parser_t *parser, const char *data, size_t len)
+{
+    if (!parser)
+        return JSON_SAX_ERROR;
+
+    if (parser->status != JSON_SAX_OK || !data)
+        return parser->status;
+
+    const char *s = data;
+    const char *end = data + len;
+
+    while (s < end && parser->status == JSON_SAX_OK)
+    {
+        switch (parser->state)
+        {
+            case SAX_STATE_STRING:
+                s = sax_scan_string(parser, s, end);
+                break;
+
+            case SAX_STATE_NUMBER:
+                s = sax_scan_number(parser, s, end);
+                break;
+
+            case SAX_STATE_LITERAL:
+                s = sax_scan_literal(parser, s, end);
+                break;
+
+            default:
+                s = sax_scan_structural(parser, s, end);
+                break;
+        }
+    }
+
+    parser->offset += (size_t)(s - data);
+    return parser->status;
+}
+
+json_sax_status_t json_sax_parser_finish(json_sax_parser_t *parser)
+{
+    if (!parser)
+        return JSON_SAX_ERROR;
+
+    if (parser->status != JSON_SAX_OK)
+        return parser->status;
+
+    /* A top level number has no terminator of its own */
+    if (parser->state == SAX_STATE_NUMBER && parser->depth == 0)
+        sax_number_done(parser, NULL, parser->token, parser->token_len);
+
+    if (parser->status != JSON_SAX_OK)
+        return parser->status;
+
+    if (parser->state == SAX_STATE_DONE)
+        return JSON_SAX_OK;
+
+    /* Zero values is a valid stream, but not a valid document */
+    if (parser->multiple_values && parser->state == SAX_STATE_VALUE && parser->depth == 0)
+        return JSON_SAX_OK;
+
+    parser->status = JSON_SAX_ERROR;
+    return parser->status;
+}
+
+size_t json_sax_parser_get_offset(const json_sax_parser_t *parser)
+{
+    if (!parser)
+        return 0;
+
+    return parser->offset;
+}
+
+size_t json_sax_parser_get_depth(const json_sax_parser_t *parser)
+{
+    if (!parser)
+        return 0;
+
+    return parser->depth;
+}
+
+json_sax_status_t json_sax_parse(const char *input, size_t len, const json_sax_handler_t *handler, void *context)
+{
+    json_sax_parser_t *parser = json_sax_parser_allocate(handler, context, false);
+    if (!parser)
+        return JSON_SAX_ERROR;
+
+    json_sax_status_t status = json_sax_parser_feed(parser, input, len);
+
+    if (status == JSON_SAX_OK)
+        status = json_sax_parser_finish(parser);
+
+    json_sax_parser_free(parser);
+    return status;
+}
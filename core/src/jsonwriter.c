@@ -0,0 +1,755 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "jsonwriter.h"
+#include "datetime.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define JSON_WRITER_MAX_DEPTH 1024
+#define JSON_WRITER_STAGE_SIZE 4096
+#define JSON_WRITER_INDENT 2
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef struct json_writer_frame_t
+{
+    char kind;               /* '{' or '[' */
+    bool has_items;
+} json_writer_frame_t;
+
+struct json_writer_t
+{
+    buffer_t *buffer;        /* NULL for a fixed writer */
+    char *out;               /* Stage for buffer writers, caller memory otherwise */
+    size_t pos;
+    size_t capacity;
+    size_t length;
+
+    bool pretty;
+    bool error;
+    bool after_key;
+    bool has_documents;
+
+    size_t depth;
+    json_writer_frame_t stack[JSON_WRITER_MAX_DEPTH];
+    char stage[JSON_WRITER_STAGE_SIZE];
+};
+
+/* Non-zero entries need escaping; the value is the escape letter */
+static const char escape_table[256] =
+{
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\', 0,  0,   0
+};
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const double powers_of_ten[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+/* ------------------------------------------------------------------------- */
+/* Output                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static bool writer_drain(json_writer_t *w)
+{
+    if (!w->buffer)
+    {
+        w->error = true;
+        return false;
+    }
+
+    if (w->pos > 0 && !buffer_append(w->buffer, w->out, w->pos))
+    {
+        w->error = true;
+        return false;
+    }
+
+    w->pos = 0;
+    return true;
+}
+
+static bool writer_put(json_writer_t *w, const char *data, size_t len)
+{
+    w->length += len;
+
+    if (w->error)
+        return false;
+
+    if (w->capacity - w->pos >= len)
+    {
+        memcpy(w->out + w->pos, data, len);
+        w->pos += len;
+        return true;
+    }
+
+    /* Large pieces skip the stage */
+    if (w->buffer && len > w->capacity)
+    {
+        if (!writer_drain(w))
+            return false;
+
+        if (!buffer_append(w->buffer, data, len))
+        {
+            w->error = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    while (len > 0)
+    {
+        if (w->pos == w->capacity && !writer_drain(w))
+            return false;
+
+        size_t n = w->capacity - w->pos < len ? w->capacity - w->pos : len;
+        memcpy(w->out + w->pos, data, n);
+        w->pos += n;
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+static bool writer_putc(json_writer_t *w, char c)
+{
+    if (w->pos < w->capacity && !w->error)
+    {
+        w->out[w->pos++] = c;
+        w->length++;
+        return true;
+    }
+
+    return writer_put(w, &c, 1);
+}
+
+static bool writer_newline(json_writer_t *w, size_t depth)
+{
+    static const char spaces[] = "                                ";
+    size_t n = depth * JSON_WRITER_INDENT;
+
+    if (!writer_putc(w, '\n'))
+        return false;
+
+    while (n > 0)
+    {
+        size_t k = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+
+        if (!writer_put(w, spaces, k))
+            return false;
+
+        n -= k;
+    }
+
+    return true;
+}
+
+/* Separator and indentation in front of a key or value */
+static bool writer_prefix(json_writer_t *w, bool is_key)
+{
+    if (w->error)
+        return false;
+
+    if (w->depth == 0)
+    {
+        if (is_key)
+        {
+            w->error = true;
+            return false;
+        }
+
+        /* Further top level values become JSON lines */
+        if (w->has_documents)
+            return writer_putc(w, '\n');
+
+        return true;
+    }
+
+    json_writer_frame_t *frame = &w->stack[w->depth - 1];
+
+    if (frame->kind == '{')
+    {
+        if (is_key == w->after_key)
+        {
+            w->error = true;
+            return false;
+        }
+
+        if (w->after_key)
+        {
+            w->after_key = false;
+            return true;
+        }
+    }
+    else if (is_key)
+    {
+        w->error = true;
+        return false;
+    }
+
+    if (frame->has_items && !writer_putc(w, ','))
+        return false;
+
+    frame->has_items = true;
+
+    if (w->pretty)
+        return writer_newline(w, w->depth);
+
+    return true;
+}
+
+static bool writer_value_done(json_writer_t *w)
+{
+    if (w->depth == 0)
+        w->has_documents = true;
+
+    return !w->error;
+}
+
+static bool writer_escaped(json_writer_t *w, const char *s, size_t len);
+
+/* ------------------------------------------------------------------------- */
+/* Formatting                                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Writes digits backwards ending at 'end', returns the first digit */
+static char *format_uint64(char *end, uint64_t v)
+{
+    while (v >= 100)
+    {
+        size_t idx = (size_t)(v % 100) * 2;
+        v /= 100;
+        *--end = digit_pairs[idx + 1];
+        *--end = digit_pairs[idx];
+    }
+
+    if (v < 10)
+    {
+        *--end = (char)('0' + v);
+    }
+    else
+    {
+        *--end = digit_pairs[v * 2 + 1];
+        *--end = digit_pairs[v * 2];
+    }
+
+    return end;
+}
+
+static char *format_int64(char *end, int64_t v)
+{
+    uint64_t u = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+    char *start = format_uint64(end, u);
+
+    if (v < 0)
+        *--start = '-';
+
+    return start;
+}
+
+/* ------------------------------------------------------------------------- */
+/* String Escaping                                                           */
+/* ------------------------------------------------------------------------- */
+
+/* Length of the leading run that needs no escaping */
+static size_t writer_safe_run(const char *s, size_t len)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+        int mask = _mm_movemask_epi8(hit);
+
+        if (mask)
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+    }
+#endif
+
+    while (i < len && !escape_table[(unsigned char)s[i]])
+        i++;
+
+    return i;
+}
+
+static bool writer_escaped(json_writer_t *w, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    if (!writer_putc(w, '"'))
+        return false;
+
+    while (len > 0)
+    {
+        size_t run = writer_safe_run(s, len);
+
+        if (run > 0 && !writer_put(w, s, run))
+            return false;
+
+        if (run == len)
+            break;
+
+        unsigned char c = (unsigned char)s[run];
+        char esc[6] = { '\\', escape_table[c], '0', '0', hex[c >> 4], hex[c & 15] };
+
+        if (!writer_put(w, esc, esc[1] == 'u' ? 6 : 2))
+            return false;
+
+        s += run + 1;
+        len -= run + 1;
+    }
+
+    return writer_putc(w, '"');
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+static json_writer_t *writer_new(bool pretty)
+{
+    json_writer_t *w = (json_writer_t *)malloc(sizeof(json_writer_t));
+    if (!w)
+        return NULL;
+
+    w->buffer = NULL;
+    w->out = NULL;
+    w->capacity = 0;
+    w->pretty = pretty;
+
+    json_writer_reset(w);
+    return w;
+}
+
+json_writer_t *json_writer_allocate(buffer_t *buffer, bool pretty)
+{
+    if (!buffer)
+        return NULL;
+
+    json_writer_t *w = writer_new(pretty);
+    if (!w)
+        return NULL;
+
+    w->buffer = buffer;
+    w->out = w->stage;
+    w->capacity = sizeof(w->stage);
+    return w;
+}
+
+json_writer_t *json_writer_allocate_fixed(char *out, size_t capacity, bool pretty)
+{
+    if (!out || capacity == 0)
+        return NULL;
+
+    json_writer_t *w = writer_new(pretty);
+    if (!w)
+        return NULL;
+
+    /* One byte is kept back for the terminating NUL */
+    w->out = out;
+    w->capacity = capacity - 1;
+    out[0] = '\0';
+    return w;
+}
+
+void json_writer_free(json_writer_t *writer)
+{
+    if (!writer)
+        return;
+
+    json_writer_flush(writer);
+    free(writer);
+}
+
+void json_writer_reset(json_writer_t *writer)
+{
+    if (!writer)
+        return;
+
+    writer->pos = 0;
+    writer->length = 0;
+    writer->error = false;
+    writer->after_key = false;
+    writer->has_documents = false;
+    writer->depth = 0;
+}
+
+bool json_writer_begin_object(json_writer_t *writer)
+{
+    if (!writer || !writer_prefix(writer, false))
+        return false;
+
+    if (writer->depth == JSON_WRITER_MAX_DEPTH)
+    {
+        writer->error = true;
+        return false;
+    }
+
+    writer->stack[writer->depth].kind = '{';
+    writer->stack[writer->depth].has_items = false;
+    writer->depth++;
+
+    return writer_putc(writer, '{');
+}
+
+bool json_writer_begin_array(json_writer_t *writer)
+{
+    if (!writer || !writer_prefix(writer, false))
+        return false;
+
+    if (writer->depth == JSON_WRITER_MAX_DEPTH)
+    {
+        writer->error = true;
+        return false;
+    }
+
+    writer->stack[writer->depth].kind = '[';
+    writer->stack[writer->depth].has_items = false;
+    writer->depth++;
+
+    return writer_putc(writer, '[');
+}
+
+static bool writer_end(json_writer_t *w, char kind, char close)
+{
+    if (!w || w->error)
+        return false;
+
+    if (w->depth == 0 || w->stack[w->depth - 1].kind != kind || w->after_key)
+    {
+        w->error = true;
+        return false;
+    }
+
+    bool has_items = w->stack[w->depth - 1].has_items;
+    w->depth--;
+
+    if (w->pretty && has_items && !writer_newline(w, w->depth))
+        return false;
+
+    if (!writer_putc(w, close))
+        return false;
+
+    return writer_value_done(w);
+}
+
+bool json_writer_end_object(json_writer_t *writer)
+{
+    return writer_end(writer, '{', '}');
+}
+
+bool json_writer_end_array(json_writer_t *writer)
+{
+    return writer_end(writer, '[', ']');
+}
+
+bool json_writer_key(json_writer_t *writer, const char *key)
+{
+    if (!key)
+        return false;
+
+    return json_writer_key_length(writer, key, strlen(key));
+}
+
+bool json_writer_key_length(json_writer_t *writer, const char *key, size_t len)
+{
+    if (!writer || !key || !writer_prefix(writer, true))
+        return false;
+
+    if (!writer_escaped(writer, key, len))
+        return false;
+
+    writer->after_key = true;
+
+    if (writer->pretty)
+        return writer_put(writer, ": ", 2);
+
+    return writer_putc(writer, ':');
+}
+
+bool json_writer_string(json_writer_t *writer, const char *str)
+{
+    if (!str)
+        return json_writer_null(writer);
+
+    return json_writer_string_length(writer, str, strlen(str));
+}
+
+bool json_writer_string_length(json_writer_t *writer, const char *str, size_t len)
+{
+    if (!writer || !str || !writer_prefix(writer, false))
+        return false;
+
+    if (!writer_escaped(writer, str, len))
+        return false;
+
+    return writer_value_done(writer);
+}
+
+bool json_writer_int64(json_writer_t *writer, int64_t value)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *start = format_int64(end, value);
+
+    return json_writer_number_text(writer, start, (size_t)(end - start));
+}
+
+bool json_writer_uint64(json_writer_t *writer, uint64_t value)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *start = format_uint64(end, value);
+
+    return json_writer_number_text(writer, start, (size_t)(end - start));
+}
+
+bool json_writer_double(json_writer_t *writer, double value)
+{
+    if (!isfinite(value))
+        return json_writer_null(writer);
+
+    /* Integral values below 2^53 take the integer path */
+    if (fabs(value) < 9007199254740992.0 && value == (double)(int64_t)value)
+        return json_writer_int64(writer, (int64_t)value);
+
+    /* Short decimals (sensor readings, prices) are found without printf:
+       the fewest decimals whose scaled value divides back to 'value' give
+       the shortest text that reads back exactly */
+    if (fabs(value) < 1.0e6)
+    {
+        for (int decimals = 1; decimals <= 9; decimals++)
+        {
+            double scaled = llround(value * powers_of_ten[decimals]);
+            if (scaled / powers_of_ten[decimals] == value)
+                return json_writer_fixed(writer, value, decimals);
+        }
+    }
+
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%.15g", value);
+
+    if (strtod(tmp, NULL) != value)
+        n = snprintf(tmp, sizeof(tmp), "%.17g", value);
+
+    return json_writer_number_text(writer, tmp, (size_t)n);
+}
+
+bool json_writer_fixed(json_writer_t *writer, double value, int decimals)
+{
+    if (!isfinite(value))
+        return json_writer_null(writer);
+
+    if (decimals < 0) decimals = 0;
+    if (decimals > 9) decimals = 9;
+
+    double scaled = value * powers_of_ten[decimals];
+    char tmp[48];
+
+    /* Outside the int64 range fall back to printf */
+    if (fabs(scaled) >= 9.0e18)
+    {
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, value);
+        return json_writer_number_text(writer, tmp, (size_t)n);
+    }
+
+    int64_t q = (int64_t)llround(scaled);
+    uint64_t u = q < 0 ? (uint64_t)0 - (uint64_t)q : (uint64_t)q;
+    uint64_t p10 = (uint64_t)powers_of_ten[decimals];
+    char *end = tmp + sizeof(tmp);
+    char *start = end;
+
+    if (decimals > 0)
+    {
+        uint64_t frac = u % p10;
+
+        for (int k = 0; k < decimals; k++)
+        {
+            *--start = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+
+        *--start = '.';
+    }
+
+    start = format_uint64(start, u / p10);
+
+    if (q < 0)
+        *--start = '-';
+
+    return json_writer_number_text(writer, start, (size_t)(end - start));
+}
+
+bool json_writer_timestamp(json_writer_t *writer, time_t value, long offset)
+{
+    char tmp[32];
+    size_t len = date_time_format_rfc3339(value, offset, tmp, sizeof(tmp));
+
+    if (len == 0)
+        return false;
+
+    return json_writer_string_length(writer, tmp, len);
+}
+
+bool json_writer_boolean(json_writer_t *writer, bool value)
+{
+    return value ? json_writer_number_text(writer, "true", 4) : json_writer_number_text(writer, "false", 5);
+}
+
+bool json_writer_null(json_writer_t *writer)
+{
+    return json_writer_number_text(writer, "null", 4);
+}
+
+bool json_writer_number_text(json_writer_t *writer, const char *num, size_t len)
+{
+    if (!writer || !num || !writer_prefix(writer, false))
+        return false;
+
+    if (!writer_put(writer, num, len))
+        return false;
+
+    return writer_value_done(writer);
+}
+
+bool json_writer_node(json_writer_t *writer, json_node_t *node)
+{
+    if (!writer || !node)
+        return false;
+
+    const char *text = json_node_get_text(node);
+    json_node_t *child = json_node_first_child_element(node, NULL);
+
+    switch (json_node_type(node))
+    {
+        case JSON_NODE_DOCUMENT:
+            return json_writer_node(writer, child);
+
+        case JSON_NODE_OBJECT:
+            if (!json_writer_begin_object(writer))
+                return false;
+
+            for (; child; child = json_node_next_sibling_element(child, NULL))
+            {
+                if (!json_writer_key(writer, json_node_name(child)) || !json_writer_node(writer, child))
+                    return false;
+            }
+
+            return json_writer_end_object(writer);
+
+        case JSON_NODE_ARRAY:
+            if (!json_writer_begin_array(writer))
+                return false;
+
+            for (; child; child = json_node_next_sibling_element(child, NULL))
+            {
+                if (!json_writer_node(writer, child))
+                    return false;
+            }
+
+            return json_writer_end_array(writer);
+
+        case JSON_NODE_STRING:
+            return json_writer_string(writer, text);
+
+        case JSON_NODE_NUMBER:
+        case JSON_NODE_BOOLEAN:
+        case JSON_NODE_NULL:
+            return json_writer_number_text(writer, text, strlen(text));
+
+        default:
+            return false;
+    }
+}
+
+bool json_writer_flush(json_writer_t *writer)
+{
+    if (!writer)
+        return false;
+
+    if (!writer->buffer)
+    {
+        writer->out[writer->pos] = '\0';
+        return !writer->error;
+    }
+
+    if (writer->error)
+        return false;
+
+    return writer_drain(writer);
+}
+
+size_t json_writer_get_length(const json_writer_t *writer)
+{
+    if (!writer)
+        return 0;
+
+    return writer->length;
+}
+
+bool json_writer_has_error(const json_writer_t *writer)
+{
+    if (!writer)
+        return true;
+
+    return writer->error;
+}
@@ -31,6 +31,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "file.h"
 #include "stringex.h"
 #include "environment.h"
+#include "gzip.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,25 +40,207 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
 
 #define END_OF_LINE "\n"
 #define MAX_LOGGERS 512
 #define MAX_PATHLEN 1024
 
+#define LOGGER_LINE_SIZE      2048
+#define LOGGER_MIN_RING       (64 * 1024)
+#define LOGGER_DEFAULT_RING   (1024 * 1024)
+#define LOGGER_BATCH_SIZE     (64 * 1024)
+#define LOGGER_RECORD_HEADER  8
+#define LOGGER_RECORD_PADDING 0x80000000u
+#define LOGGER_WRITER_WAIT_MS 10
+
+#define LOGGER_BINARY_MAGIC      "TRZBLOG"
+#define LOGGER_BINARY_VERSION    1
+#define LOGGER_BINARY_BYTE_ORDER 0x01020304u
+#define LOGGER_BINARY_MAX_ARGS   32
+#define LOGGER_BINARY_MAX_FORMATS (1024 * 1024)
+#define LOGGER_BINARY_DEFINITION 0u
+#define LOGGER_BINARY_TEXT       0xFFFFFFFFu
+
 static char log_level_names[5][16] = {"Information", "Error", "Warning", "Critical", "Panic"};
+static const size_t log_level_name_lengths[5] = {11, 5, 7, 8, 5};
+
+/* Formatted time of the last second a thread logged in */
+static _Thread_local time_t cached_second = (time_t)-1;
+static _Thread_local char cached_timestamp[20];
 
 void normalize_function_name(char* func_name);
 
-#pragma pack(1)
+/*
+  Asynchronous mode keeps a multi producer, single consumer byte ring.
+  A producer reserves space by advancing 'head' with a CAS, copies its
+  formatted line behind an 8 byte header, then publishes the header with a
+  release store. The writer thread consumes committed records in order,
+  batches them into large write() calls, zeroes what it consumed and
+  advances 'tail'. Records never wrap; the unusable end of the ring is
+  covered by a padding record.
+*/
+typedef struct logger_ring_t
+{
+    _Atomic uint64_t head;
+    char head_pad[64 - sizeof(uint64_t)];
+    _Atomic uint64_t tail;
+    char tail_pad[64 - sizeof(uint64_t)];
+    _Atomic uint64_t dropped;
+    uint64_t dropped_reported;
+    _Atomic bool writer_sleeping;
+    _Atomic bool stop;
+    _Atomic int waiters;
+    LoggerOverflow policy;
+    size_t capacity;
+    unsigned char* data;
+    unsigned char* batch;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t drained;
+}logger_ring_t;
+
+/*
+  Binary log files start with a logger_binary_header_t followed by records,
+  each a uint32 total size and a uint32 id, all in host byte order:
+
+  id 0 (definition)  uint32 format id, uint32 level, int32 line,
+                     uint16 file length, uint16 function length,
+                     uint32 format length, uint32 argument count,
+                     one type byte per argument, then the three strings
+  id 0xFFFFFFFF      int64 timestamp, uint32 level, int32 line,
+  (text)             uint16 file length, uint16 function length,
+                     uint32 message length, then the three strings
+  any other id       int64 timestamp, then the arguments of that format:
+  (event)            8 bytes per integer, pointer or floating point value,
+                     uint32 length plus bytes per string
+
+  Timestamps are CLOCK_MONOTONIC nanoseconds; the header pairs a monotonic
+  reading with the wall clock so the decoder can convert them. Every file
+  repeats the definitions known when it was opened, so a rotated file
+  decodes on its own.
+*/
+typedef struct logger_binary_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    int64_t realtime_ns;
+    int64_t monotonic_ns;
+}logger_binary_header_t;
+
+typedef enum logger_binary_arg_t
+{
+    LOGGER_ARG_INT = 1,
+    LOGGER_ARG_LONG,
+    LOGGER_ARG_LLONG,
+    LOGGER_ARG_SIZE,
+    LOGGER_ARG_INTMAX,
+    LOGGER_ARG_PTRDIFF,
+    LOGGER_ARG_DOUBLE,
+    LOGGER_ARG_LDOUBLE,
+    LOGGER_ARG_STRING,
+    LOGGER_ARG_POINTER
+}logger_binary_arg_t;
+
+typedef struct logger_binary_format_t
+{
+    uint32_t id;
+    uint32_t argc;
+    unsigned char argtypes[LOGGER_BINARY_MAX_ARGS];
+    unsigned char* definition;
+    size_t definition_size;
+}logger_binary_format_t;
+
 typedef struct logger_t
 {
-    size_t LogFileSizeMB;
+    size_t MaxFileSize;
     char FileName[MAX_PATHLEN+1];
-    FILE* FileHandle;
+    int FileDescriptor;
+    size_t FileSize;
+    size_t generations;
+    time_t rotation_interval;
+    time_t next_rotation;
+    bool compress;
+    unsigned long long rotation_count;
+    int pending_rotations;
     bool console_out;
     LogLevel log_level;
+    /* Limits may change while other threads log */
+    _Atomic bool limited;
+    _Atomic uint32_t sample_one_in[LOG_PANIC + 1];
+    _Atomic int64_t rate_interval_ns[LOG_PANIC + 1];
+    _Atomic int64_t rate_tolerance_ns[LOG_PANIC + 1];
+    _Atomic uint64_t suppressed;
+    pthread_mutex_t file_lock;
+    logger_ring_t* ring;
+    bool binary;
+    _Atomic uint32_t binary_defined;
+    pthread_mutex_t definitions_lock;
 }logger_t;
 
+/*
+  Rotated files are renamed to a unique name on the writing thread; a
+  shared background thread then shifts the generations and compresses.
+  Jobs run in order, so generations stay in sequence.
+*/
+typedef struct logger_rotation_job_t
+{
+    struct logger_rotation_job_t* next;
+    logger_t* logger;
+    size_t generations;
+    bool compress;
+    char rotated[MAX_PATHLEN + 64];
+    char base[MAX_PATHLEN + 1];
+}logger_rotation_job_t;
+
+static pthread_mutex_t rotation_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rotation_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rotation_done = PTHREAD_COND_INITIALIZER;
+static logger_rotation_job_t* rotation_first = NULL;
+static logger_rotation_job_t* rotation_last = NULL;
+static bool rotation_worker_started = false;
+
+/* Formats of every binary call site seen so far; ids start at 1 */
+static pthread_mutex_t binary_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static logger_binary_format_t** binary_formats = NULL;
+static uint32_t binary_format_count = 0;
+static uint32_t binary_format_capacity = 0;
+/* Marks call sites whose format cannot be recorded */
+static logger_binary_format_t binary_format_invalid;
+
+/* Loggers in asynchronous mode, for logger_flush_on_crash */
+static _Atomic(logger_t*) async_loggers[MAX_LOGGERS];
+
+static void logger_internal_describe(logger_call_site_t* site);
+static bool logger_internal_admit(logger_t* loggerptr, LogLevel llevel, logger_limit_t* limit, uint64_t* reported);
+static void logger_internal_report_suppressed(logger_t* loggerptr, LogLevel llevel, const logger_call_site_t* site, uint64_t count);
+static int64_t logger_internal_monotonic_ns(void);
+static int64_t logger_internal_coarse_ns(void);
+static bool logger_internal_write(logger_t* loggerptr, const char* logentry, LogLevel llevel, const logger_call_site_t* site);
+static size_t logger_internal_encode(logger_t* loggerptr, char* buffer, size_t capacity, const char* logentry, LogLevel llevel, const logger_call_site_t* site);
+static size_t logger_internal_format(char* buffer, size_t capacity, const char* logentry, LogLevel llevel, const logger_call_site_t* site);
+static bool logger_internal_open(logger_t* loggerptr);
+static size_t logger_internal_encode_text(unsigned char* buffer, size_t capacity, const char* logentry, LogLevel llevel, const logger_call_site_t* site);
+static bool logger_internal_emit(logger_t* loggerptr, const char* data, size_t len);
+static size_t logger_internal_parse_conversion(const char* fmt, unsigned char* types, size_t* count);
+static logger_binary_format_t* logger_internal_register(logger_site_t* site);
+static bool logger_internal_define(logger_t* loggerptr, uint32_t id);
+static void logger_internal_mark_defined(logger_t* loggerptr, uint32_t count);
+static size_t logger_internal_encode_event(unsigned char* buffer, size_t capacity, const logger_binary_format_t* format, va_list args);
+static bool logger_internal_write_out(logger_t* loggerptr, const char* data, size_t len);
+static bool logger_internal_ring_push(logger_t* loggerptr, const char* data, size_t len);
+static void* logger_internal_writer(void* arg);
+static void logger_internal_stop_async(logger_t* loggerptr);
+static void logger_internal_rotate(logger_t* loggerptr);
+
 logger_t*	logger_allocate_default()
 {
     return logger_allocate(10, NULL);
@@ -77,14 +260,16 @@ logger_t*  logger_allocate_file(size_t flszmb, const char* filename)
         return NULL;
     }
 
-    logger_ptr->FileHandle = NULL;
+    logger_ptr->FileDescriptor = -1;
+    pthread_mutex_init(&logger_ptr->file_lock, NULL);
+    pthread_mutex_init(&logger_ptr->definitions_lock, NULL);
 
-    if(flszmb < 1 || flszmb > 10)
+    if(flszmb < 1)
     {
         flszmb = 10;
     }
 
-    logger_ptr->LogFileSizeMB = flszmb;
+    logger_ptr->MaxFileSize = flszmb * 1024 * 1024;
     strncpy(logger_ptr->FileName, filename, MAX_PATHLEN);
     logger_ptr->FileName[MAX_PATHLEN] = 0;
 
@@ -104,14 +289,14 @@ logger_t*	logger_allocate(size_t flszmb, const char* dirpath)
         return NULL;
     }
 
-    logger_ptr->FileHandle = NULL;
+    logger_ptr->FileDescriptor = -1;
 
-    if(flszmb < 1 || flszmb > 10)
+    if(flszmb < 1)
     {
         flszmb = 10;
     }
 
-    logger_ptr->LogFileSizeMB = flszmb;
+    logger_ptr->MaxFileSize = flszmb * 1024 * 1024;
 
     if(dirpath != NULL && dirpath[0] != 0)
     {
@@ -160,12 +345,28 @@ logger_t*	logger_allocate(size_t flszmb, const char* dirpath)
 
     strncat(logger_ptr->FileName, ".log", MAX_PATHLEN - strlen(logger_ptr->FileName));
 
+    pthread_mutex_init(&logger_ptr->file_lock, NULL);
+    pthread_mutex_init(&logger_ptr->definitions_lock, NULL);
     logger_ptr->log_level = LOG_INFO;
     logger_ptr->console_out = false;
 
     return logger_ptr;
 }
 
+logger_t*  logger_allocate_binary(size_t flszmb, const char* filename)
+{
+    logger_t* logger_ptr = logger_allocate_file(flszmb, filename);
+
+    if(!logger_ptr)
+    {
+        return NULL;
+    }
+
+    logger_ptr->binary = true;
+
+    return logger_ptr;
+}
+
 const char* logger_filename(logger_t* loggerptr)
 {
     if(!loggerptr)
@@ -183,12 +384,26 @@ void logger_release(logger_t* loggerptr)
         return;
     }
 
-    if(loggerptr->FileHandle)
+    // Drains the ring before the file is closed
+    logger_internal_stop_async(loggerptr);
+
+    if(loggerptr->FileDescriptor >= 0)
+    {
+        close(loggerptr->FileDescriptor);
+    }
+
+    // Rotation jobs refer to this logger until they finish
+    pthread_mutex_lock(&rotation_lock);
+
+    while(loggerptr->pending_rotations > 0)
     {
-        fflush(loggerptr->FileHandle);
-        fclose(loggerptr->FileHandle);
+        pthread_cond_wait(&rotation_done, &rotation_lock);
     }
 
+    pthread_mutex_unlock(&rotation_lock);
+
+    pthread_mutex_destroy(&loggerptr->definitions_lock);
+    pthread_mutex_destroy(&loggerptr->file_lock);
     free(loggerptr);
 }
 
@@ -209,192 +424,2251 @@ bool logger_write(logger_t* loggerptr, const char* logentry, LogLevel llevel, co
         return false;
     }
 
-    if(loggerptr->FileHandle == NULL)
+    logger_call_site_t site = {file, func, line, 0, NULL, 0, NULL, 0, {0, 0, 0}};
+    logger_internal_describe(&site);
+
+    return logger_internal_write(loggerptr, logentry, llevel, &site);
+}
+
+bool logger_write_site(logger_t* loggerptr, const char* logentry, LogLevel llevel, logger_call_site_t* site)
+{
+    if(!loggerptr || logentry == NULL || site == NULL || site->func == NULL || site->file == NULL)
+    {
+        return false;
+    }
+
+    if(llevel < LOG_INFO || llevel > LOG_PANIC)
+    {
+        return false;
+    }
+
+    if(llevel < loggerptr->log_level)
+    {
+        return false;
+    }
+
+    uint64_t reported = 0;
+
+    if (atomic_load_explicit(&loggerptr->limited, memory_order_relaxed) && !logger_internal_admit(loggerptr, llevel, &site->limit, &reported))
+    {
+        return false;
+    }
+
+    _Atomic int* ready = (_Atomic int*)&site->ready;
+    logger_call_site_t local;
+
+    if (atomic_load_explicit(ready, memory_order_acquire) != 2)
     {
-        loggerptr->FileHandle = fopen(loggerptr->FileName, "w");
+        // The first caller fills in the site; anyone racing it works on a copy
+        int expected = 0;
 
-        if(loggerptr->FileHandle == NULL)
+        if (atomic_compare_exchange_strong(ready, &expected, 1))
         {
-            return false;
+            logger_internal_describe(site);
+            atomic_store_explicit(ready, 2, memory_order_release);
+        }
+        else
+        {
+            local = (logger_call_site_t){site->file, site->func, site->line, 0, NULL, 0, NULL, 0, {0, 0, 0}};
+            logger_internal_describe(&local);
+            site = &local;
         }
     }
 
-    // Check the file size
-    size_t sz = (size_t)ftell(loggerptr->FileHandle);
+    if (reported > 0)
+    {
+        logger_internal_report_suppressed(loggerptr, llevel, site, reported);
+    }
+
+    return logger_internal_write(loggerptr, logentry, llevel, site);
+}
+
+bool logger_write_binary(logger_t* loggerptr, logger_site_t* site, ...)
+{
+    if(!loggerptr || site == NULL || !loggerptr->binary)
+    {
+        return false;
+    }
+
+    if(site->level < LOG_INFO || site->level > LOG_PANIC || site->level < loggerptr->log_level)
+    {
+        return false;
+    }
+
+    uint64_t reported = 0;
 
-    // If it exceeds the set size
-    if(sz >= loggerptr->LogFileSizeMB*1024*1024)
+    if (atomic_load_explicit(&loggerptr->limited, memory_order_relaxed) && !logger_internal_admit(loggerptr, site->level, &site->limit, &reported))
     {
-        // Stop logging
-        fflush(loggerptr->FileHandle);
-        fclose(loggerptr->FileHandle);
+        return false;
+    }
 
-        // Rename the file
-        char old_log_filename[1025] = {0};
-        strcat(old_log_filename, loggerptr->FileName);
-        strcat(old_log_filename, ".old");
+    logger_binary_format_t* format = atomic_load_explicit((_Atomic(logger_binary_format_t*)*)&site->registered, memory_order_acquire);
 
-        rename(loggerptr->FileName, old_log_filename);
+    if (format == NULL)
+    {
+        format = logger_internal_register(site);
+    }
+
+    if (format == &binary_format_invalid)
+    {
+        return false;
+    }
+
+    if (!logger_internal_define(loggerptr, format->id))
+    {
+        return false;
+    }
+
+    if (reported > 0)
+    {
+        logger_call_site_t described = {site->file, site->func, site->line, 0, NULL, 0, NULL, 0, {0, 0, 0}};
+        logger_internal_describe(&described);
+        logger_internal_report_suppressed(loggerptr, site->level, &described, reported);
+    }
+
+    unsigned char record_buffer[LOGGER_LINE_SIZE];
+    unsigned char* record = record_buffer;
+    va_list args;
+
+    va_start(args, site);
+    size_t len = logger_internal_encode_event(record_buffer, sizeof(record_buffer), format, args);
+    va_end(args);
 
-        // Reopen the log file with original name
-        loggerptr->FileHandle = fopen(loggerptr->FileName, "w");
+    if (len > sizeof(record_buffer))
+    {
+        record = (unsigned char*)malloc(len);
 
-        if(loggerptr->FileHandle == NULL)
+        if (record == NULL)
         {
             return false;
         }
+
+        va_start(args, site);
+        logger_internal_encode_event(record, len, format, args);
+        va_end(args);
+    }
+
+    bool written = logger_internal_emit(loggerptr, (const char*)record, len);
+
+    if (record != record_buffer)
+    {
+        free(record);
+    }
+
+    return written;
+}
+
+void logger_enable_console_out(logger_t* loggerptr, bool consoleout)
+{
+    if(!loggerptr)
+    {
+        return;
+    }
+
+    loggerptr->console_out = consoleout;
+}
+
+void logger_set_log_level(logger_t* loggerptr, LogLevel llevel)
+{
+    if(!loggerptr)
+    {
+        return;
     }
 
-    time_t t ;
-    struct tm *tmp ;
-    time(&t);
-    tmp = localtime(&t);
+    loggerptr->log_level = llevel;
+}
 
-    if(tmp == NULL)
+bool logger_set_rotation(logger_t* loggerptr, size_t generations, size_t max_size, time_t interval, bool compress)
+{
+    if(!loggerptr || interval < 0)
     {
         return false;
     }
 
-    // Timestamp
-    fprintf(loggerptr->FileHandle, "%02d-%02d-%04d %02d:%02d:%02d\t",
-             tmp->tm_mday, (tmp->tm_mon+1), (tmp->tm_year+1900),
-             tmp->tm_hour, tmp->tm_min, tmp->tm_sec);
+    pthread_mutex_lock(&loggerptr->file_lock);
 
-    // Level
-    fprintf(loggerptr->FileHandle, "%s\t", log_level_names[llevel]);
+    loggerptr->generations = generations;
+    loggerptr->compress = compress;
+    loggerptr->rotation_interval = interval;
+    loggerptr->next_rotation = 0;
 
-    // File
-    const char* slash = strrchr(file, '/');
-    const char* bslash = strrchr(file, '\\');
-    const char* base_file_name = file;
+    if (max_size > 0)
+    {
+        loggerptr->MaxFileSize = max_size;
+    }
+
+    pthread_mutex_unlock(&loggerptr->file_lock);
+
+    return true;
+}
 
-    if (slash != NULL || bslash != NULL)
+static void logger_internal_update_limited(logger_t* loggerptr)
+{
+    bool limited = false;
+
+    for (int level = LOG_INFO; level <= LOG_PANIC; level++)
     {
-        const char* last_sep = slash;
-        if (last_sep == NULL || (bslash != NULL && bslash > last_sep))
+        if (atomic_load_explicit(&loggerptr->sample_one_in[level], memory_order_relaxed) > 1
+            || atomic_load_explicit(&loggerptr->rate_interval_ns[level], memory_order_relaxed) > 0)
         {
-            last_sep = bslash;
+            limited = true;
         }
+    }
 
-        if (last_sep != NULL && *(last_sep + 1) != 0)
-        {
-            base_file_name = last_sep + 1;
-        }
+    atomic_store_explicit(&loggerptr->limited, limited, memory_order_relaxed);
+}
+
+bool logger_set_sampling(logger_t* loggerptr, LogLevel llevel, uint32_t one_in)
+{
+    if(!loggerptr || llevel < LOG_INFO || llevel > LOG_PANIC)
+    {
+        return false;
     }
 
-    const char* file_name_to_write = base_file_name;
-    fprintf(loggerptr->FileHandle, "%s\t", file_name_to_write);
+    // Setters are serialised so the flag always matches the last limits
+    pthread_mutex_lock(&loggerptr->file_lock);
+    atomic_store_explicit(&loggerptr->sample_one_in[llevel], one_in, memory_order_relaxed);
+    logger_internal_update_limited(loggerptr);
+    pthread_mutex_unlock(&loggerptr->file_lock);
 
-    // Line
-    fprintf(loggerptr->FileHandle, "%d\t", line);
+    return true;
+}
 
-    // Function
-    char* func_name = (char*)calloc(1, strlen(func)+1);
-    if(func_name == NULL)
+bool logger_set_rate_limit(logger_t* loggerptr, LogLevel llevel, double per_second, uint32_t burst)
+{
+    if(!loggerptr || llevel < LOG_INFO || llevel > LOG_PANIC || !(per_second >= 0))
     {
         return false;
     }
 
-    strcpy(func_name, func);
-    normalize_function_name(func_name);
-    fprintf(loggerptr->FileHandle, "%s\t", func_name);
+    int64_t interval = 0;
+    int64_t tolerance = 0;
 
-    // Message
-    fprintf(loggerptr->FileHandle, "%s", logentry);
+    if (per_second > 0)
+    {
+        // Tiny rates would overflow the conversion; saturate instead
+        double interval_ns = 1e9 / per_second;
+        interval = (interval_ns >= (double)INT64_MAX) ? INT64_MAX : (int64_t)interval_ns;
 
-    // End of line
-    fprintf(loggerptr->FileHandle, END_OF_LINE);
+        if (interval < 1)
+        {
+            interval = 1;
+        }
 
-    // Flush th contents
-    fflush(loggerptr->FileHandle);
+        if (burst < 1)
+        {
+            burst = 1;
+        }
 
-    if(loggerptr->console_out)
-    {
-        printf("%s %d %s %s\n", file_name_to_write, line, func, logentry);
-        fflush(stdout);
+        tolerance = ((int64_t)(burst - 1) > INT64_MAX / interval) ? INT64_MAX : interval * (int64_t)(burst - 1);
     }
 
-    free(func_name);
+    // A concurrent admit may pair the new interval with the old tolerance
+    // once; either limit is a valid one
+    pthread_mutex_lock(&loggerptr->file_lock);
+    atomic_store_explicit(&loggerptr->rate_tolerance_ns[llevel], tolerance, memory_order_relaxed);
+    atomic_store_explicit(&loggerptr->rate_interval_ns[llevel], interval, memory_order_relaxed);
+    logger_internal_update_limited(loggerptr);
+    pthread_mutex_unlock(&loggerptr->file_lock);
 
     return true;
 }
 
-void logger_enable_console_out(logger_t* loggerptr, bool consoleout)
+uint64_t logger_get_suppressed(logger_t* loggerptr)
 {
     if(!loggerptr)
     {
-        return;
+        return 0;
     }
 
-    loggerptr->console_out = consoleout;
+    return atomic_load_explicit(&loggerptr->suppressed, memory_order_relaxed);
 }
 
-void logger_set_log_level(logger_t* loggerptr, LogLevel llevel)
+bool logger_start_async(logger_t* loggerptr, size_t buffer_size, LoggerOverflow policy)
 {
-    if(!loggerptr)
+    if(!loggerptr || loggerptr->ring != NULL)
     {
-        return;
+        return false;
     }
 
-    loggerptr->log_level = llevel;
+    // logger_flush_on_crash needs a descriptor it can write to without locking
+    pthread_mutex_lock(&loggerptr->file_lock);
+    bool opened = logger_internal_open(loggerptr);
+    pthread_mutex_unlock(&loggerptr->file_lock);
+
+    if (!opened)
+    {
+        return false;
+    }
+
+    size_t capacity = LOGGER_MIN_RING;
+
+    if (buffer_size == 0)
+    {
+        buffer_size = LOGGER_DEFAULT_RING;
+    }
+
+    while(capacity < buffer_size && capacity < ((size_t)1 << 30))
+    {
+        capacity *= 2;
+    }
+
+    logger_ring_t* ring = (logger_ring_t*)calloc(1, sizeof(logger_ring_t));
+
+    if (ring == NULL)
+    {
+        return false;
+    }
+
+    // Consumed space must read as zero, so the ring starts zeroed
+    ring->data = (unsigned char*)calloc(1, capacity);
+    ring->batch = (unsigned char*)malloc(LOGGER_BATCH_SIZE);
+
+    if (ring->data == NULL || ring->batch == NULL)
+    {
+        free(ring->data);
+        free(ring->batch);
+        free(ring);
+        return false;
+    }
+
+    ring->capacity = capacity;
+    ring->policy = policy;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->writer_sleeping, false);
+    atomic_init(&ring->stop, false);
+    atomic_init(&ring->waiters, 0);
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->wake, NULL);
+    pthread_cond_init(&ring->drained, NULL);
+
+    loggerptr->ring = ring;
+
+    if (pthread_create(&ring->writer, NULL, logger_internal_writer, loggerptr) != 0)
+    {
+        loggerptr->ring = NULL;
+        pthread_cond_destroy(&ring->drained);
+        pthread_cond_destroy(&ring->wake);
+        pthread_mutex_destroy(&ring->lock);
+        free(ring->data);
+        free(ring->batch);
+        free(ring);
+        return false;
+    }
+
+    for(size_t index = 0; index < MAX_LOGGERS; index++)
+    {
+        logger_t* expected = NULL;
+
+        if (atomic_compare_exchange_strong(&async_loggers[index], &expected, loggerptr))
+        {
+            break;
+        }
+    }
+
+    return true;
 }
 
-void normalize_function_name(char* func_name)
+bool logger_flush(logger_t* loggerptr)
 {
-    if(func_name == NULL)
+    if(!loggerptr)
     {
-        return;
+        return false;
     }
 
-    string_t* func_name_str = string_allocate(func_name);
-    if(func_name_str == NULL)
+    logger_ring_t* ring = loggerptr->ring;
+
+    if (ring == NULL)
     {
-        return;
+        return true;
     }
 
-    int len = (int)strlen(func_name);
+    uint64_t target = atomic_load(&ring->head);
 
-    if(len < 2)
+    atomic_fetch_add(&ring->waiters, 1);
+    pthread_mutex_lock(&ring->lock);
+
+    while(atomic_load(&ring->tail) < target)
     {
-        string_free(&func_name_str);
-        return;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOGGER_WRITER_WAIT_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+
+        pthread_cond_signal(&ring->wake);
+        pthread_cond_timedwait(&ring->drained, &ring->lock, &deadline);
     }
 
-    long ctr = len - 1;
+    pthread_mutex_unlock(&ring->lock);
+    atomic_fetch_sub(&ring->waiters, 1);
 
-    long pos = 0;
+    return true;
+}
+
+uint64_t logger_get_dropped(logger_t* loggerptr)
+{
+    if(!loggerptr || loggerptr->ring == NULL)
+    {
+        return 0;
+    }
 
-    pos = string_index_of_char(func_name_str, '(');
+    return atomic_load_explicit(&loggerptr->ring->dropped, memory_order_relaxed);
+}
 
-    if(pos > -1)
+void logger_flush_on_crash(void)
+{
+    // Only async-signal-safe calls from here on: no locks, no allocation.
+    // The writer thread may be part way through a batch, so lines near the
+    // tail can appear twice, but none that were committed are lost.
+    for(size_t index = 0; index < MAX_LOGGERS; index++)
     {
-        while(true)
+        logger_t* loggerptr = atomic_load(&async_loggers[index]);
+
+        if (loggerptr == NULL || loggerptr->ring == NULL || loggerptr->FileDescriptor < 0)
+        {
+            continue;
+        }
+
+        logger_ring_t* ring = loggerptr->ring;
+        uint64_t pos = atomic_load(&ring->tail);
+        uint64_t head = atomic_load(&ring->head);
+
+        while(pos < head)
         {
-            func_name[ctr] = 0;
-            ctr--;
-            if(func_name[ctr] == '(')
+            const unsigned char* record = ring->data + (pos & (ring->capacity - 1));
+            uint32_t header = atomic_load_explicit((_Atomic uint32_t*)record, memory_order_acquire);
+
+            if (header == 0)
             {
-                func_name[ctr] = 0;
                 break;
             }
+
+            uint32_t len = header & ~LOGGER_RECORD_PADDING;
+
+            if ((header & LOGGER_RECORD_PADDING) == 0)
+            {
+                ssize_t unused = write(loggerptr->FileDescriptor, record + LOGGER_RECORD_HEADER, len);
+                (void)unused;
+            }
+
+            pos += LOGGER_RECORD_HEADER + ((len + 7) & ~(uint32_t)7);
         }
     }
+}
+
+static void logger_internal_crash_signal(int signum)
+{
+    logger_flush_on_crash();
+
+    // SA_RESETHAND restored the default action; let it run
+    raise(signum);
+}
+
+void logger_install_crash_handler(void)
+{
+    static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+
+    for(size_t index = 0; index < sizeof(fatal_signals) / sizeof(fatal_signals[0]); index++)
+    {
+        struct sigaction act;
+        memset(&act, 0, sizeof(act));
+        act.sa_handler = logger_internal_crash_signal;
+        act.sa_flags = SA_RESETHAND | SA_NODEFER;
+        sigemptyset(&act.sa_mask);
+        sigaction(fatal_signals[index], &act, NULL);
+    }
+}
+
+/*
+  Function name without return type or parameters, as a view into 'func':
+  "static int foo(int a)" gives "foo". C's __PRETTY_FUNCTION__ is already
+  just the name.
+*/
+static size_t logger_internal_function_name(const char* func, const char** name)
+{
+    size_t len = strlen(func);
+    const char* paren = (const char*)memchr(func, '(', len);
 
-    pos = string_index_of_char(func_name_str, ' ');
+    if (paren != NULL && paren != func)
+    {
+        len = (size_t)(paren - func);
+    }
 
-    if(pos > -1)
+    while(len > 0 && func[len - 1] == ' ')
     {
-        ctr = pos;
-        while(ctr > -1)
-        {
-            func_name[ctr] = 32;
-            ctr--;
-        }
+        len--;
+    }
+
+    size_t start = len;
+
+    while(start > 0 && func[start - 1] != ' ' && func[start - 1] != '*' && func[start - 1] != '&')
+    {
+        start--;
+    }
+
+    while(start < len && func[start] == ' ')
+    {
+        start++;
+    }
+
+    *name = func + start;
+
+    return len - start;
+}
+
+void normalize_function_name(char* func_name)
+{
+    if(func_name == NULL)
+    {
+        return;
+    }
+
+    const char* name = NULL;
+    size_t len = logger_internal_function_name(func_name, &name);
+
+    memmove(func_name, name, len);
+    func_name[len] = 0;
+}
+
+/* Works out the base file name and plain function name of a call site */
+static void logger_internal_describe(logger_call_site_t* site)
+{
+    const char* slash = strrchr(site->file, '/');
+    const char* bslash = strrchr(site->file, '\\');
+    const char* last_sep = (bslash != NULL && (slash == NULL || bslash > slash)) ? bslash : slash;
+
+    site->file_name = (last_sep != NULL && last_sep[1] != 0) ? last_sep + 1 : site->file;
+    site->file_name_len = strlen(site->file_name);
+    site->func_name_len = logger_internal_function_name(site->func, &site->func_name);
+}
+
+/* "dd-mm-yyyy HH:MM:SS" of the current second, refreshed once a second */
+static const char* logger_internal_timestamp(void)
+{
+    time_t t = time(NULL);
+
+    if (t != cached_second)
+    {
+        struct tm tmp;
+
+        if(localtime_r(&t, &tmp) == NULL)
+        {
+            return NULL;
+        }
+
+        snprintf(cached_timestamp, sizeof(cached_timestamp), "%02u-%02u-%04u %02u:%02u:%02u",
+                 (unsigned)tmp.tm_mday % 100, (unsigned)(tmp.tm_mon+1) % 100, (unsigned)(tmp.tm_year+1900) % 10000,
+                 (unsigned)tmp.tm_hour % 100, (unsigned)tmp.tm_min % 100, (unsigned)tmp.tm_sec % 100);
+        cached_second = t;
+    }
+
+    return cached_timestamp;
+}
+
+/* Writes 'value' in decimal; returns the number of characters */
+static size_t logger_internal_decimal(int value, char* out)
+{
+    char digits[12];
+    size_t count = 0;
+    size_t len = 0;
+    unsigned int magnitude = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+
+    do
+    {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    }while(magnitude > 0);
+
+    if (value < 0)
+    {
+        out[len++] = '-';
+    }
+
+    while(count > 0)
+    {
+        out[len++] = digits[--count];
+    }
+
+    return len;
+}
+
+/*
+  Decides whether a call site may log, without locks. Sampling counts the
+  site's calls. The token bucket is kept as the single time at which the
+  bucket would be full again (the generic cell rate algorithm): each entry
+  pushes it one interval further, and an entry is refused when that time
+  lies more than burst - 1 intervals ahead. 'reported' receives how many
+  entries the bucket refused since the site last logged.
+*/
+static bool logger_internal_admit(logger_t* loggerptr, LogLevel llevel, logger_limit_t* limit, uint64_t* reported)
+{
+    uint32_t one_in = atomic_load_explicit(&loggerptr->sample_one_in[llevel], memory_order_relaxed);
+
+    if (one_in > 1)
+    {
+        uint64_t call = atomic_fetch_add_explicit((_Atomic uint64_t*)&limit->calls, 1, memory_order_relaxed);
+
+        if (call % one_in != 0)
+        {
+            atomic_fetch_add_explicit(&loggerptr->suppressed, 1, memory_order_relaxed);
+            return false;
+        }
+    }
+
+    int64_t interval = atomic_load_explicit(&loggerptr->rate_interval_ns[llevel], memory_order_relaxed);
+    _Atomic uint64_t* suppressed = (_Atomic uint64_t*)&limit->suppressed;
+
+    if (interval > 0)
+    {
+        _Atomic int64_t* next = (_Atomic int64_t*)&limit->next_ns;
+        int64_t tolerance = atomic_load_explicit(&loggerptr->rate_tolerance_ns[llevel], memory_order_relaxed);
+        int64_t now = logger_internal_coarse_ns();
+        int64_t expected = atomic_load_explicit(next, memory_order_relaxed);
+
+        for (;;)
+        {
+            int64_t start = expected > now ? expected : now;
+
+            if (start - now > tolerance)
+            {
+                atomic_fetch_add_explicit(suppressed, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&loggerptr->suppressed, 1, memory_order_relaxed);
+                return false;
+            }
+
+            // Saturates for intervals set from tiny rates
+            int64_t full = (start > INT64_MAX - interval) ? INT64_MAX : start + interval;
+
+            if (atomic_compare_exchange_weak_explicit(next, &expected, full, memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+    }
+
+    if (atomic_load_explicit(suppressed, memory_order_relaxed) > 0)
+    {
+        *reported = atomic_exchange_explicit(suppressed, 0, memory_order_relaxed);
+    }
+
+    return true;
+}
+
+static void logger_internal_report_suppressed(logger_t* loggerptr, LogLevel llevel, const logger_call_site_t* site, uint64_t count)
+{
+    char message[64];
+    snprintf(message, sizeof(message), "%llu log entries suppressed", (unsigned long long)count);
+
+    logger_internal_write(loggerptr, message, llevel, site);
+}
+
+static bool logger_internal_write(logger_t* loggerptr, const char* logentry, LogLevel llevel, const logger_call_site_t* site)
+{
+    // The whole line is formatted first so it reaches the file in one piece
+    char line_buffer[LOGGER_LINE_SIZE];
+    char* text = line_buffer;
+    size_t len = logger_internal_encode(loggerptr, line_buffer, sizeof(line_buffer), logentry, llevel, site);
+
+    if (len == 0)
+    {
+        return false;
+    }
+
+    if (len >= sizeof(line_buffer))
+    {
+        text = (char*)malloc(len + 1);
+
+        if (text == NULL)
+        {
+            return false;
+        }
+
+        logger_internal_encode(loggerptr, text, len + 1, logentry, llevel, site);
+    }
+
+    bool written = logger_internal_emit(loggerptr, text, len);
+
+    if(loggerptr->console_out)
+    {
+        printf("%s %d %s %s\n", site->file_name, site->line, site->func, logentry);
+        fflush(stdout);
+    }
+
+    if (text != line_buffer)
+    {
+        free(text);
+    }
+
+    return written;
+}
+
+/* A text line or a binary text record, depending on the logger */
+static size_t logger_internal_encode(logger_t* loggerptr, char* buffer, size_t capacity, const char* logentry, LogLevel llevel, const logger_call_site_t* site)
+{
+    if (loggerptr->binary)
+    {
+        return logger_internal_encode_text((unsigned char*)buffer, capacity, logentry, llevel, site);
+    }
+
+    return logger_internal_format(buffer, capacity, logentry, llevel, site);
+}
+
+/* Returns the line length, 0 on failure; writes only when it fits with a NUL */
+static size_t logger_internal_format(char* buffer, size_t capacity, const char* logentry, LogLevel llevel, const logger_call_site_t* site)
+{
+    const char* timestamp = logger_internal_timestamp();
+
+    if (timestamp == NULL)
+    {
+        return 0;
+    }
+
+    char line_text[12];
+    size_t line_len = logger_internal_decimal(site->line, line_text);
+    size_t level_len = log_level_name_lengths[llevel];
+    size_t entry_len = strlen(logentry);
+    size_t len = 19 + 1 + level_len + 1 + site->file_name_len + 1 + line_len + 1 + site->func_name_len + 1 + entry_len + 1;
+
+    if (len >= capacity)
+    {
+        return len;
+    }
+
+    char* out = buffer;
+
+    memcpy(out, timestamp, 19);
+    out += 19;
+    *out++ = '\t';
+    memcpy(out, log_level_names[llevel], level_len);
+    out += level_len;
+    *out++ = '\t';
+    memcpy(out, site->file_name, site->file_name_len);
+    out += site->file_name_len;
+    *out++ = '\t';
+    memcpy(out, line_text, line_len);
+    out += line_len;
+    *out++ = '\t';
+    memcpy(out, site->func_name, site->func_name_len);
+    out += site->func_name_len;
+    *out++ = '\t';
+    memcpy(out, logentry, entry_len);
+    out += entry_len;
+    *out++ = '\n';
+    *out = 0;
+
+    return len;
+}
+
+/* Opens the log file on first use; called with file_lock held */
+static bool logger_internal_open(logger_t* loggerptr)
+{
+    if(loggerptr->FileDescriptor >= 0)
+    {
+        return true;
+    }
+
+    loggerptr->FileDescriptor = open(loggerptr->FileName, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    loggerptr->FileSize = 0;
+
+    if(loggerptr->FileDescriptor < 0)
+    {
+        return false;
+    }
+
+    if(loggerptr->rotation_interval > 0)
+    {
+        // Align to the interval in local time, so daily files turn at midnight
+        time_t now = time(NULL);
+        struct tm tmp;
+        long offset = 0;
+
+        if(localtime_r(&now, &tmp) != NULL)
+        {
+            offset = tmp.tm_gmtoff;
+        }
+
+        time_t local = now + offset;
+        loggerptr->next_rotation = (local / loggerptr->rotation_interval + 1) * loggerptr->rotation_interval - offset;
+    }
+
+    if(!loggerptr->binary)
+    {
+        return true;
+    }
+
+    // Header, then every definition known so far
+    logger_binary_header_t header;
+    struct timespec now;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOGGER_BINARY_MAGIC, sizeof(LOGGER_BINARY_MAGIC));
+    header.version = LOGGER_BINARY_VERSION;
+    header.byte_order = LOGGER_BINARY_BYTE_ORDER;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.realtime_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    header.monotonic_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    if (write(loggerptr->FileDescriptor, &header, sizeof(header)) == (ssize_t)sizeof(header))
+    {
+        loggerptr->FileSize += sizeof(header);
+    }
+
+    pthread_mutex_lock(&binary_registry_lock);
+
+    for(uint32_t index = 0; index < binary_format_count; index++)
+    {
+        logger_binary_format_t* format = binary_formats[index];
+        ssize_t count = write(loggerptr->FileDescriptor, format->definition, format->definition_size);
+
+        if (count > 0)
+        {
+            loggerptr->FileSize += (size_t)count;
+        }
+    }
+
+    logger_internal_mark_defined(loggerptr, binary_format_count);
+    pthread_mutex_unlock(&binary_registry_lock);
+
+    return true;
+}
+
+/* Appends to the log file, rotating it when it reaches the size limit */
+static bool logger_internal_write_out(logger_t* loggerptr, const char* data, size_t len)
+{
+    pthread_mutex_lock(&loggerptr->file_lock);
+
+    if(loggerptr->FileDescriptor >= 0 && loggerptr->FileSize > 0)
+    {
+        if(loggerptr->FileSize >= loggerptr->MaxFileSize)
+        {
+            logger_internal_rotate(loggerptr);
+        }
+        else if(loggerptr->rotation_interval > 0 && loggerptr->next_rotation > 0 && time(NULL) >= loggerptr->next_rotation)
+        {
+            logger_internal_rotate(loggerptr);
+        }
+    }
+
+    if(!logger_internal_open(loggerptr))
+    {
+        pthread_mutex_unlock(&loggerptr->file_lock);
+        return false;
+    }
+
+    bool written = true;
+
+    while(len > 0)
+    {
+        ssize_t count = write(loggerptr->FileDescriptor, data, len);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            written = false;
+            break;
+        }
+
+        data += count;
+        len -= (size_t)count;
+        loggerptr->FileSize += (size_t)count;
+    }
+
+    pthread_mutex_unlock(&loggerptr->file_lock);
+
+    return written;
+}
+
+/* Shifts name.1 .. name.N up by one and makes 'rotated' the new name.1 */
+static void logger_internal_shift_generations(const logger_rotation_job_t* job)
+{
+    char from[MAX_PATHLEN + 32];
+    char to[MAX_PATHLEN + 32];
+
+    snprintf(from, sizeof(from), "%s.%zu", job->base, job->generations);
+    remove(from);
+    snprintf(from, sizeof(from), "%s.%zu.gz", job->base, job->generations);
+    remove(from);
+
+    for(size_t generation = job->generations - 1; generation > 0; generation--)
+    {
+        snprintf(from, sizeof(from), "%s.%zu", job->base, generation);
+        snprintf(to, sizeof(to), "%s.%zu", job->base, generation + 1);
+        rename(from, to);
+
+        snprintf(from, sizeof(from), "%s.%zu.gz", job->base, generation);
+        snprintf(to, sizeof(to), "%s.%zu.gz", job->base, generation + 1);
+        rename(from, to);
+    }
+
+    if(job->compress)
+    {
+        snprintf(to, sizeof(to), "%s.1.gz", job->base);
+
+        if(gzip_compress_file(job->rotated, to))
+        {
+            remove(job->rotated);
+            return;
+        }
+    }
+
+    snprintf(to, sizeof(to), "%s.1", job->base);
+    rename(job->rotated, to);
+}
+
+static void* logger_internal_rotation_worker(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&rotation_lock);
+
+    while(true)
+    {
+        while(rotation_first == NULL)
+        {
+            pthread_cond_wait(&rotation_wake, &rotation_lock);
+        }
+
+        logger_rotation_job_t* job = rotation_first;
+        rotation_first = job->next;
+
+        if(rotation_first == NULL)
+        {
+            rotation_last = NULL;
+        }
+
+        pthread_mutex_unlock(&rotation_lock);
+
+        logger_internal_shift_generations(job);
+
+        pthread_mutex_lock(&rotation_lock);
+        job->logger->pending_rotations--;
+        pthread_cond_broadcast(&rotation_done);
+        free(job);
+    }
+
+    return NULL;
+}
+
+/* Closes the current file and hands it to the rotation thread; file_lock is held */
+static void logger_internal_rotate(logger_t* loggerptr)
+{
+    close(loggerptr->FileDescriptor);
+    loggerptr->FileDescriptor = -1;
+
+    if(loggerptr->generations == 0)
+    {
+        // A single previous file, as name.old
+        char old_log_filename[MAX_PATHLEN + 8] = {0};
+        snprintf(old_log_filename, sizeof(old_log_filename), "%s.old", loggerptr->FileName);
+        rename(loggerptr->FileName, old_log_filename);
+        return;
+    }
+
+    logger_rotation_job_t* job = (logger_rotation_job_t*)calloc(1, sizeof(logger_rotation_job_t));
+
+    if(job == NULL)
+    {
+        // Keep logging; the current contents are lost to truncation
+        return;
+    }
+
+    job->logger = loggerptr;
+    job->generations = loggerptr->generations;
+    job->compress = loggerptr->compress;
+    memcpy(job->base, loggerptr->FileName, sizeof(job->base));
+    snprintf(job->rotated, sizeof(job->rotated), "%s.%d.%llu.rotating", loggerptr->FileName, (int)getpid(), ++loggerptr->rotation_count);
+
+    // The one step that must happen here: free the name for the new file
+    if(rename(loggerptr->FileName, job->rotated) != 0)
+    {
+        free(job);
+        return;
+    }
+
+    pthread_mutex_lock(&rotation_lock);
+
+    if(!rotation_worker_started)
+    {
+        pthread_t worker;
+
+        if(pthread_create(&worker, NULL, logger_internal_rotation_worker, NULL) == 0)
+        {
+            pthread_detach(worker);
+            rotation_worker_started = true;
+        }
+    }
+
+    if(!rotation_worker_started)
+    {
+        pthread_mutex_unlock(&rotation_lock);
+        logger_internal_shift_generations(job);
+        free(job);
+        return;
+    }
+
+    if(rotation_last != NULL)
+    {
+        rotation_last->next = job;
+    }
+    else
+    {
+        rotation_first = job;
+    }
+
+    rotation_last = job;
+    loggerptr->pending_rotations++;
+    pthread_cond_signal(&rotation_wake);
+    pthread_mutex_unlock(&rotation_lock);
+}
+
+/* Queues a line or record, or writes it directly when not asynchronous */
+static bool logger_internal_emit(logger_t* loggerptr, const char* data, size_t len)
+{
+    if (loggerptr->ring != NULL && len <= loggerptr->ring->capacity / 4)
+    {
+        return logger_internal_ring_push(loggerptr, data, len);
+    }
+
+    // Lines too long for the ring go out directly, after what is queued
+    if (loggerptr->ring != NULL)
+    {
+        logger_flush(loggerptr);
+    }
+
+    return logger_internal_write_out(loggerptr, data, len);
+}
+
+static void logger_internal_wake_writer(logger_ring_t* ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_signal(&ring->wake);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static bool logger_internal_ring_push(logger_t* loggerptr, const char* data, size_t len)
+{
+    logger_ring_t* ring = loggerptr->ring;
+    size_t mask = ring->capacity - 1;
+    uint64_t need = LOGGER_RECORD_HEADER + ((len + 7) & ~(size_t)7);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t padding = 0;
+    bool waiting = false;
+
+    while(true)
+    {
+        uint64_t offset = head & mask;
+        padding = (offset + need > ring->capacity) ? ring->capacity - offset : 0;
+
+        if (head + padding + need - atomic_load_explicit(&ring->tail, memory_order_acquire) > ring->capacity)
+        {
+            if (ring->policy != LOGGER_OVERFLOW_BLOCK)
+            {
+                atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+                return false;
+            }
+
+            // Full: wait for the writer to make room
+            if (!waiting)
+            {
+                atomic_fetch_add(&ring->waiters, 1);
+                waiting = true;
+            }
+
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+
+            pthread_mutex_lock(&ring->lock);
+            pthread_cond_signal(&ring->wake);
+            pthread_cond_timedwait(&ring->drained, &ring->lock, &deadline);
+            pthread_mutex_unlock(&ring->lock);
+
+            head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            continue;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&ring->head, &head, head + padding + need, memory_order_acq_rel, memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    if (waiting)
+    {
+        atomic_fetch_sub(&ring->waiters, 1);
+    }
+
+    if (padding > 0)
+    {
+        atomic_store_explicit((_Atomic uint32_t*)(ring->data + (head & mask)), (uint32_t)(padding - LOGGER_RECORD_HEADER) | LOGGER_RECORD_PADDING, memory_order_release);
+        head += padding;
+    }
+
+    unsigned char* record = ring->data + (head & mask);
+    memcpy(record + LOGGER_RECORD_HEADER, data, len);
+    atomic_store_explicit((_Atomic uint32_t*)record, (uint32_t)len, memory_order_release);
+
+    // A sleeping writer wakes by itself within LOGGER_WRITER_WAIT_MS; it is
+    // only signalled once enough has queued up to be worth a batch
+    if (head + need - atomic_load_explicit(&ring->tail, memory_order_relaxed) < ring->capacity / 8)
+    {
+        return true;
+    }
+
+    // Pairs with the writer announcing sleep and then rechecking head
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&ring->writer_sleeping, memory_order_relaxed))
+    {
+        logger_internal_wake_writer(ring);
+    }
+
+    return true;
+}
+
+/* Writes out committed records from tail onwards; returns false if none */
+static bool logger_internal_ring_drain(logger_t* loggerptr)
+{
+    logger_ring_t* ring = loggerptr->ring;
+    size_t mask = ring->capacity - 1;
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t pos = tail;
+    size_t batched = 0;
+
+    while(pos < head)
+    {
+        unsigned char* record = ring->data + (pos & mask);
+        uint32_t header = atomic_load_explicit((_Atomic uint32_t*)record, memory_order_acquire);
+
+        // Reserved but not yet committed
+        if (header == 0)
+        {
+            break;
+        }
+
+        uint32_t len = header & ~LOGGER_RECORD_PADDING;
+
+        if ((header & LOGGER_RECORD_PADDING) == 0)
+        {
+            if (batched + len > LOGGER_BATCH_SIZE)
+            {
+                // A record larger than the batch goes out straight from the
+                // ring; records never wrap, so it is contiguous
+                if (batched == 0)
+                {
+                    logger_internal_write_out(loggerptr, (const char*)record + LOGGER_RECORD_HEADER, len);
+                    pos += LOGGER_RECORD_HEADER + ((len + 7) & ~(uint32_t)7);
+                }
+
+                break;
+            }
+
+            memcpy(ring->batch + batched, record + LOGGER_RECORD_HEADER, len);
+            batched += len;
+        }
+
+        pos += LOGGER_RECORD_HEADER + ((len + 7) & ~(uint32_t)7);
+    }
+
+    if (pos == tail)
+    {
+        return false;
+    }
+
+    if (batched > 0)
+    {
+        logger_internal_write_out(loggerptr, (const char*)ring->batch, batched);
+    }
+
+    // Consumed space reads as uncommitted on the next lap
+    uint64_t start = tail & mask;
+    uint64_t span = pos - tail;
+
+    if (start + span > ring->capacity)
+    {
+        memset(ring->data + start, 0, ring->capacity - start);
+        memset(ring->data, 0, span - (ring->capacity - start));
+    }
+    else
+    {
+        memset(ring->data + start, 0, span);
+    }
+
+    atomic_store_explicit(&ring->tail, pos, memory_order_release);
+
+    if (atomic_load(&ring->waiters) > 0)
+    {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_broadcast(&ring->drained);
+        pthread_mutex_unlock(&ring->lock);
+    }
+
+    return true;
+}
+
+static void logger_internal_report_dropped(logger_t* loggerptr)
+{
+    logger_ring_t* ring = loggerptr->ring;
+    uint64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+
+    if (ring->policy != LOGGER_OVERFLOW_COUNT || dropped == ring->dropped_reported)
+    {
+        return;
+    }
+
+    char message[64];
+    char line_buffer[256];
+    snprintf(message, sizeof(message), "%llu log entries dropped", (unsigned long long)(dropped - ring->dropped_reported));
+
+    logger_call_site_t site = {"logger.c", "logger", 0, 0, NULL, 0, NULL, 0, {0, 0, 0}};
+    logger_internal_describe(&site);
+
+    size_t len = logger_internal_encode(loggerptr, line_buffer, sizeof(line_buffer), message, LOG_WARNING, &site);
+
+    if (len > 0 && len < sizeof(line_buffer))
+    {
+        logger_internal_write_out(loggerptr, line_buffer, len);
+    }
+
+    ring->dropped_reported = dropped;
+}
+
+static void* logger_internal_writer(void* arg)
+{
+    logger_t* loggerptr = (logger_t*)arg;
+    logger_ring_t* ring = loggerptr->ring;
+
+    while(true)
+    {
+        if (logger_internal_ring_drain(loggerptr))
+        {
+            logger_internal_report_dropped(loggerptr);
+            continue;
+        }
+
+        uint64_t head = atomic_load(&ring->head);
+
+        if (head != atomic_load(&ring->tail))
+        {
+            // A producer is between reserving and committing
+            sched_yield();
+            continue;
+        }
+
+        if (atomic_load(&ring->stop))
+        {
+            break;
+        }
+
+        atomic_store(&ring->writer_sleeping, true);
+
+        if (atomic_load(&ring->head) == head && !atomic_load(&ring->stop))
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += LOGGER_WRITER_WAIT_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+
+            pthread_mutex_lock(&ring->lock);
+            pthread_cond_timedwait(&ring->wake, &ring->lock, &deadline);
+            pthread_mutex_unlock(&ring->lock);
+        }
+
+        atomic_store(&ring->writer_sleeping, false);
+    }
+
+    logger_internal_report_dropped(loggerptr);
+
+    return NULL;
+}
+
+static void logger_internal_stop_async(logger_t* loggerptr)
+{
+    logger_ring_t* ring = loggerptr->ring;
+
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    for(size_t index = 0; index < MAX_LOGGERS; index++)
+    {
+        logger_t* expected = loggerptr;
+
+        if (atomic_compare_exchange_strong(&async_loggers[index], &expected, NULL))
+        {
+            break;
+        }
+    }
+
+    atomic_store(&ring->stop, true);
+    logger_internal_wake_writer(ring);
+    pthread_join(ring->writer, NULL);
+
+    loggerptr->ring = NULL;
+    pthread_cond_destroy(&ring->drained);
+    pthread_cond_destroy(&ring->wake);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring->data);
+    free(ring->batch);
+    free(ring);
+}
+
+static void logger_internal_put(unsigned char* buffer, size_t capacity, size_t* pos, const void* data, size_t len)
+{
+    if (*pos + len <= capacity)
+    {
+        memcpy(buffer + *pos, data, len);
+    }
+
+    *pos += len;
+}
+
+static void logger_internal_put_record_header(unsigned char* buffer, size_t capacity, size_t size, uint32_t id)
+{
+    uint32_t size32 = (uint32_t)size;
+    size_t pos = 0;
+
+    logger_internal_put(buffer, capacity, &pos, &size32, sizeof(size32));
+    logger_internal_put(buffer, capacity, &pos, &id, sizeof(id));
+}
+
+/* Raises the count of definitions known to be in the file; it never drops */
+static void logger_internal_mark_defined(logger_t* loggerptr, uint32_t count)
+{
+    uint32_t defined = atomic_load_explicit(&loggerptr->binary_defined, memory_order_relaxed);
+
+    while(defined < count && !atomic_compare_exchange_weak_explicit(&loggerptr->binary_defined, &defined, count, memory_order_release, memory_order_relaxed))
+    {
+    }
+}
+
+static int64_t logger_internal_monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Millisecond resolution is plenty for rate limits and reads far cheaper */
+static int64_t logger_internal_coarse_ns(void)
+{
+    struct timespec now;
+#if defined(CLOCK_MONOTONIC_COARSE)
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Returns the record size; only fills the buffer when it is large enough */
+static size_t logger_internal_encode_text(unsigned char* buffer, size_t capacity, const char* logentry, LogLevel llevel, const logger_call_site_t* site)
+{
+    int64_t timestamp = logger_internal_monotonic_ns();
+    uint32_t level = (uint32_t)llevel;
+    int32_t line32 = site->line;
+    const char* file = site->file_name;
+    const char* func = site->func_name;
+    uint32_t entry_len = (uint32_t)strlen(logentry);
+    uint16_t file_len16 = (uint16_t)(site->file_name_len > UINT16_MAX ? UINT16_MAX : site->file_name_len);
+    uint16_t func_len16 = (uint16_t)(site->func_name_len > UINT16_MAX ? UINT16_MAX : site->func_name_len);
+    size_t pos = LOGGER_RECORD_HEADER;
+
+    logger_internal_put(buffer, capacity, &pos, &timestamp, sizeof(timestamp));
+    logger_internal_put(buffer, capacity, &pos, &level, sizeof(level));
+    logger_internal_put(buffer, capacity, &pos, &line32, sizeof(line32));
+    logger_internal_put(buffer, capacity, &pos, &file_len16, sizeof(file_len16));
+    logger_internal_put(buffer, capacity, &pos, &func_len16, sizeof(func_len16));
+    logger_internal_put(buffer, capacity, &pos, &entry_len, sizeof(entry_len));
+    logger_internal_put(buffer, capacity, &pos, file, file_len16);
+    logger_internal_put(buffer, capacity, &pos, func, func_len16);
+    logger_internal_put(buffer, capacity, &pos, logentry, entry_len);
+
+    logger_internal_put_record_header(buffer, capacity, pos, LOGGER_BINARY_TEXT);
+
+    return pos;
+}
+
+static size_t logger_internal_encode_event(unsigned char* buffer, size_t capacity, const logger_binary_format_t* format, va_list args)
+{
+    int64_t timestamp = logger_internal_monotonic_ns();
+    size_t pos = LOGGER_RECORD_HEADER;
+
+    logger_internal_put(buffer, capacity, &pos, &timestamp, sizeof(timestamp));
+
+    for(uint32_t index = 0; index < format->argc; index++)
+    {
+        int64_t integer = 0;
+        double real = 0;
+
+        switch(format->argtypes[index])
+        {
+            case LOGGER_ARG_INT:
+            {
+                integer = va_arg(args, int);
+                break;
+            }
+            case LOGGER_ARG_LONG:
+            {
+                integer = va_arg(args, long);
+                break;
+            }
+            case LOGGER_ARG_LLONG:
+            {
+                integer = va_arg(args, long long);
+                break;
+            }
+            case LOGGER_ARG_SIZE:
+            {
+                integer = (int64_t)va_arg(args, size_t);
+                break;
+            }
+            case LOGGER_ARG_INTMAX:
+            {
+                integer = va_arg(args, intmax_t);
+                break;
+            }
+            case LOGGER_ARG_PTRDIFF:
+            {
+                integer = va_arg(args, ptrdiff_t);
+                break;
+            }
+            case LOGGER_ARG_POINTER:
+            {
+                integer = (int64_t)(uintptr_t)va_arg(args, void*);
+                break;
+            }
+            case LOGGER_ARG_DOUBLE:
+            {
+                real = va_arg(args, double);
+                logger_internal_put(buffer, capacity, &pos, &real, sizeof(real));
+                continue;
+            }
+            case LOGGER_ARG_LDOUBLE:
+            {
+                real = (double)va_arg(args, long double);
+                logger_internal_put(buffer, capacity, &pos, &real, sizeof(real));
+                continue;
+            }
+            case LOGGER_ARG_STRING:
+            {
+                const char* str = va_arg(args, const char*);
+
+                if (str == NULL)
+                {
+                    str = "(null)";
+                }
+
+                uint32_t len = (uint32_t)strlen(str);
+                logger_internal_put(buffer, capacity, &pos, &len, sizeof(len));
+                logger_internal_put(buffer, capacity, &pos, str, len);
+                continue;
+            }
+            default:
+            {
+                break;
+            }
+        }
+
+        logger_internal_put(buffer, capacity, &pos, &integer, sizeof(integer));
+    }
+
+    logger_internal_put_record_header(buffer, capacity, pos, format->id);
+
+    return pos;
+}
+
+/*
+  Parses the printf conversion starting at fmt[0] == '%'. Argument types are
+  stored in 'types' (a '*' width or precision comes first, as an int) and
+  their number in 'count'. Returns the length of the conversion, or 0 for
+  conversions that cannot be recorded (%n, wide strings, unknown ones).
+*/
+static size_t logger_internal_parse_conversion(const char* fmt, unsigned char* types, size_t* count)
+{
+    size_t pos = 1;
+    unsigned char length = LOGGER_ARG_INT;
+    bool wide = false;
+
+    *count = 0;
+
+    if (fmt[pos] == '%')
+    {
+        return 2;
+    }
+
+    while(fmt[pos] != 0 && strchr("-+ #0'", fmt[pos]) != NULL)
+    {
+        pos++;
+    }
+
+    if (fmt[pos] == '*')
+    {
+        types[(*count)++] = LOGGER_ARG_INT;
+        pos++;
+    }
+
+    while(fmt[pos] >= '0' && fmt[pos] <= '9')
+    {
+        pos++;
+    }
+
+    if (fmt[pos] == '.')
+    {
+        pos++;
+
+        if (fmt[pos] == '*')
+        {
+            types[(*count)++] = LOGGER_ARG_INT;
+            pos++;
+        }
+
+        while(fmt[pos] >= '0' && fmt[pos] <= '9')
+        {
+            pos++;
+        }
+    }
+
+    switch(fmt[pos])
+    {
+        case 'h':
+        {
+            pos += (fmt[pos + 1] == 'h') ? 2 : 1;
+            break;
+        }
+        case 'l':
+        {
+            if (fmt[pos + 1] == 'l')
+            {
+                length = LOGGER_ARG_LLONG;
+                pos += 2;
+            }
+            else
+            {
+                length = LOGGER_ARG_LONG;
+                wide = true;
+                pos++;
+            }
+            break;
+        }
+        case 'q':
+        case 'L':
+        {
+            length = LOGGER_ARG_LLONG;
+            pos++;
+            break;
+        }
+        case 'j':
+        {
+            length = LOGGER_ARG_INTMAX;
+            pos++;
+            break;
+        }
+        case 'z':
+        case 'Z':
+        {
+            length = LOGGER_ARG_SIZE;
+            pos++;
+            break;
+        }
+        case 't':
+        {
+            length = LOGGER_ARG_PTRDIFF;
+            pos++;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    switch(fmt[pos])
+    {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+        {
+            types[(*count)++] = length;
+            break;
+        }
+        case 'c':
+        {
+            if (wide)
+            {
+                return 0;
+            }
+
+            types[(*count)++] = LOGGER_ARG_INT;
+            break;
+        }
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+        {
+            types[(*count)++] = (length == LOGGER_ARG_LLONG && fmt[pos - 1] == 'L') ? LOGGER_ARG_LDOUBLE : LOGGER_ARG_DOUBLE;
+            break;
+        }
+        case 's':
+        {
+            if (wide)
+            {
+                return 0;
+            }
+
+            types[(*count)++] = LOGGER_ARG_STRING;
+            break;
+        }
+        case 'p':
+        {
+            types[(*count)++] = LOGGER_ARG_POINTER;
+            break;
+        }
+        default:
+        {
+            return 0;
+        }
+    }
+
+    return pos + 1;
+}
+
+static logger_binary_format_t* logger_internal_register(logger_site_t* site)
+{
+    _Atomic(logger_binary_format_t*)* registered = (_Atomic(logger_binary_format_t*)*)&site->registered;
+
+    pthread_mutex_lock(&binary_registry_lock);
+
+    // Another thread may have won the race
+    logger_binary_format_t* format = atomic_load_explicit(registered, memory_order_acquire);
+
+    if (format != NULL)
+    {
+        pthread_mutex_unlock(&binary_registry_lock);
+        return format;
+    }
+
+    format = (logger_binary_format_t*)calloc(1, sizeof(logger_binary_format_t));
+
+    if (format == NULL || site->format == NULL || site->file == NULL || site->func == NULL)
+    {
+        free(format);
+        atomic_store_explicit(registered, &binary_format_invalid, memory_order_release);
+        pthread_mutex_unlock(&binary_registry_lock);
+        return &binary_format_invalid;
+    }
+
+    bool valid = true;
+
+    for(const char* ptr = site->format; *ptr != 0 && valid; ptr++)
+    {
+        if (*ptr != '%')
+        {
+            continue;
+        }
+
+        unsigned char types[3];
+        size_t count = 0;
+        size_t len = logger_internal_parse_conversion(ptr, types, &count);
+
+        if (len == 0 || format->argc + count > LOGGER_BINARY_MAX_ARGS)
+        {
+            valid = false;
+            break;
+        }
+
+        memcpy(format->argtypes + format->argc, types, count);
+        format->argc += (uint32_t)count;
+        ptr += len - 1;
+    }
+
+    // Keeps format ids within what the decoder accepts
+    if (binary_format_count >= LOGGER_BINARY_MAX_FORMATS)
+    {
+        valid = false;
+    }
+
+    if (valid && binary_format_count == binary_format_capacity)
+    {
+        uint32_t capacity = (binary_format_capacity == 0) ? 64 : binary_format_capacity * 2;
+        logger_binary_format_t** formats = (logger_binary_format_t**)realloc(binary_formats, capacity * sizeof(logger_binary_format_t*));
+
+        if (formats == NULL)
+        {
+            valid = false;
+        }
+        else
+        {
+            binary_formats = formats;
+            binary_format_capacity = capacity;
+        }
+    }
+
+    size_t file_len = strlen(site->file);
+    size_t func_len = strlen(site->func);
+    uint16_t file_len16 = (uint16_t)(file_len > UINT16_MAX ? UINT16_MAX : file_len);
+    uint16_t func_len16 = (uint16_t)(func_len > UINT16_MAX ? UINT16_MAX : func_len);
+    uint32_t format_len = (uint32_t)strlen(site->format);
+    size_t size = LOGGER_RECORD_HEADER + 6 * sizeof(uint32_t) + format->argc + file_len16 + func_len16 + format_len;
+
+    if (valid)
+    {
+        format->definition = (unsigned char*)malloc(size);
+        valid = (format->definition != NULL);
+    }
+
+    if (!valid)
+    {
+        free(format);
+        atomic_store_explicit(registered, &binary_format_invalid, memory_order_release);
+        pthread_mutex_unlock(&binary_registry_lock);
+        return &binary_format_invalid;
+    }
+
+    format->id = binary_format_count + 1;
+    format->definition_size = size;
+
+    uint32_t level = (uint32_t)site->level;
+    int32_t line = site->line;
+    size_t pos = LOGGER_RECORD_HEADER;
+
+    logger_internal_put(format->definition, size, &pos, &format->id, sizeof(format->id));
+    logger_internal_put(format->definition, size, &pos, &level, sizeof(level));
+    logger_internal_put(format->definition, size, &pos, &line, sizeof(line));
+    logger_internal_put(format->definition, size, &pos, &file_len16, sizeof(file_len16));
+    logger_internal_put(format->definition, size, &pos, &func_len16, sizeof(func_len16));
+    logger_internal_put(format->definition, size, &pos, &format_len, sizeof(format_len));
+    logger_internal_put(format->definition, size, &pos, &format->argc, sizeof(format->argc));
+    logger_internal_put(format->definition, size, &pos, format->argtypes, format->argc);
+    logger_internal_put(format->definition, size, &pos, site->file, file_len16);
+    logger_internal_put(format->definition, size, &pos, site->func, func_len16);
+    logger_internal_put(format->definition, size, &pos, site->format, format_len);
+    logger_internal_put_record_header(format->definition, size, pos, LOGGER_BINARY_DEFINITION);
+
+    binary_formats[binary_format_count++] = format;
+    atomic_store_explicit(registered, format, memory_order_release);
+
+    pthread_mutex_unlock(&binary_registry_lock);
+
+    return format;
+}
+
+/* Makes sure the definitions of formats 1 .. id precede any event using them */
+static bool logger_internal_define(logger_t* loggerptr, uint32_t id)
+{
+    if (atomic_load_explicit(&loggerptr->binary_defined, memory_order_acquire) >= id)
+    {
+        return true;
+    }
+
+    // Opening the file writes out every definition registered so far
+    pthread_mutex_lock(&loggerptr->file_lock);
+    bool written = logger_internal_open(loggerptr);
+    pthread_mutex_unlock(&loggerptr->file_lock);
+
+    pthread_mutex_lock(&loggerptr->definitions_lock);
+
+    while(written && atomic_load_explicit(&loggerptr->binary_defined, memory_order_relaxed) < id)
+    {
+        uint32_t next = atomic_load_explicit(&loggerptr->binary_defined, memory_order_relaxed);
+
+        pthread_mutex_lock(&binary_registry_lock);
+        logger_binary_format_t* format = binary_formats[next];
+        pthread_mutex_unlock(&binary_registry_lock);
+
+        // A definition must never be dropped, so it bypasses the ring
+        if (loggerptr->ring != NULL)
+        {
+            logger_flush(loggerptr);
+        }
+
+        written = logger_internal_write_out(loggerptr, (const char*)format->definition, format->definition_size);
+
+        if (written)
+        {
+            logger_internal_mark_defined(loggerptr, next + 1);
+        }
+    }
+
+    pthread_mutex_unlock(&loggerptr->definitions_lock);
+
+    return written;
+}
+
+typedef struct logger_decode_format_t
+{
+    uint32_t level;
+    int32_t line;
+    uint32_t argc;
+    unsigned char* argtypes;
+    char* file;
+    char* func;
+    char* format;
+}logger_decode_format_t;
+
+static bool logger_internal_take(const unsigned char** ptr, const unsigned char* end, void* out, size_t len)
+{
+    if ((size_t)(end - *ptr) < len)
+    {
+        return false;
+    }
+
+    memcpy(out, *ptr, len);
+    *ptr += len;
+
+    return true;
+}
+
+static char* logger_internal_take_string(const unsigned char** ptr, const unsigned char* end, size_t len)
+{
+    if ((size_t)(end - *ptr) < len)
+    {
+        return NULL;
+    }
+
+    char* str = (char*)malloc(len + 1);
+
+    if (str != NULL)
+    {
+        memcpy(str, *ptr, len);
+        str[len] = 0;
+        *ptr += len;
+    }
+
+    return str;
+}
+
+static void logger_internal_print_prefix(FILE* out, const logger_binary_header_t* header, int64_t timestamp, uint32_t level, const char* file, int32_t line, const char* func)
+{
+    // Timestamps come from the file; wrap instead of overflowing on bad ones
+    int64_t realtime = (int64_t)((uint64_t)header->realtime_ns + ((uint64_t)timestamp - (uint64_t)header->monotonic_ns));
+    time_t t = (time_t)(realtime / 1000000000LL);
+    struct tm tmp;
+
+    memset(&tmp, 0, sizeof(tmp));
+    localtime_r(&t, &tmp);
+
+    const char* slash = strrchr(file, '/');
+    const char* bslash = strrchr(file, '\\');
+    const char* last_sep = (bslash != NULL && (slash == NULL || bslash > slash)) ? bslash : slash;
+    const char* base_file_name = (last_sep != NULL && last_sep[1] != 0) ? last_sep + 1 : file;
+
+    fprintf(out, "%02d-%02d-%04d %02d:%02d:%02d\t%s\t%s\t%d\t%s\t",
+            tmp.tm_mday, (tmp.tm_mon+1), (tmp.tm_year+1900),
+            tmp.tm_hour, tmp.tm_min, tmp.tm_sec,
+            log_level_names[level <= LOG_PANIC ? level : LOG_INFO], base_file_name, line, func);
+}
+
+/* Checks a definition's stored argument types against its format text */
+static bool logger_internal_check_definition(const logger_decode_format_t* format)
+{
+    uint32_t arg = 0;
+
+    for(const char* ptr = format->format; *ptr != 0; ptr++)
+    {
+        if (*ptr != '%')
+        {
+            continue;
+        }
+
+        unsigned char types[3];
+        size_t count = 0;
+        size_t len = logger_internal_parse_conversion(ptr, types, &count);
+
+        if (len == 0 || arg + count > format->argc || memcmp(format->argtypes + arg, types, count) != 0)
+        {
+            return false;
+        }
+
+        arg += (uint32_t)count;
+        ptr += len - 1;
+    }
+
+    return (arg == format->argc);
+}
+
+#define LOGGER_PRINT_VALUE(value) \
+    ((star_count == 0) ? fprintf(out, spec, value) : \
+     (star_count == 1) ? fprintf(out, spec, stars[0], value) : \
+                         fprintf(out, spec, stars[0], stars[1], value))
+
+/* Renders one event's message from its format and raw arguments */
+static bool logger_internal_print_event(FILE* out, const logger_decode_format_t* format, const unsigned char* ptr, const unsigned char* end)
+{
+    uint32_t arg = 0;
+    const char* fmt = format->format;
+
+    while(*fmt != 0)
+    {
+        const char* percent = strchr(fmt, '%');
+
+        if (percent == NULL)
+        {
+            fputs(fmt, out);
+            break;
+        }
+
+        fwrite(fmt, 1, (size_t)(percent - fmt), out);
+
+        unsigned char types[3];
+        size_t count = 0;
+        size_t len = logger_internal_parse_conversion(percent, types, &count);
+        char spec[64];
+
+        if (len == 0 || len >= sizeof(spec) || arg + count > format->argc)
+        {
+            return false;
+        }
+
+        fmt = percent + len;
+
+        if (count == 0)
+        {
+            fputc('%', out);
+            continue;
+        }
+
+        memcpy(spec, percent, len);
+        spec[len] = 0;
+
+        int stars[2] = {0, 0};
+        size_t star_count = count - 1;
+
+        for(size_t index = 0; index < star_count; index++)
+        {
+            int64_t value = 0;
+
+            if (!logger_internal_take(&ptr, end, &value, sizeof(value)))
+            {
+                return false;
+            }
+
+            stars[index] = (int)value;
+        }
+
+        unsigned char type = types[star_count];
+        arg += (uint32_t)count;
+
+        if (type == LOGGER_ARG_STRING)
+        {
+            uint32_t str_len = 0;
+
+            if (!logger_internal_take(&ptr, end, &str_len, sizeof(str_len)))
+            {
+                return false;
+            }
+
+            char* str = logger_internal_take_string(&ptr, end, str_len);
+
+            if (str == NULL)
+            {
+                return false;
+            }
+
+            LOGGER_PRINT_VALUE(str);
+            free(str);
+            continue;
+        }
+
+        int64_t integer = 0;
+        double real = 0;
+
+        if (type == LOGGER_ARG_DOUBLE || type == LOGGER_ARG_LDOUBLE)
+        {
+            if (!logger_internal_take(&ptr, end, &real, sizeof(real)))
+            {
+                return false;
+            }
+        }
+        else if (!logger_internal_take(&ptr, end, &integer, sizeof(integer)))
+        {
+            return false;
+        }
+
+        switch(type)
+        {
+            case LOGGER_ARG_INT:
+            {
+                LOGGER_PRINT_VALUE((int)integer);
+                break;
+            }
+            case LOGGER_ARG_LONG:
+            {
+                LOGGER_PRINT_VALUE((long)integer);
+                break;
+            }
+            case LOGGER_ARG_LLONG:
+            {
+                LOGGER_PRINT_VALUE((long long)integer);
+                break;
+            }
+            case LOGGER_ARG_SIZE:
+            {
+                LOGGER_PRINT_VALUE((size_t)integer);
+                break;
+            }
+            case LOGGER_ARG_INTMAX:
+            {
+                LOGGER_PRINT_VALUE((intmax_t)integer);
+                break;
+            }
+            case LOGGER_ARG_PTRDIFF:
+            {
+                LOGGER_PRINT_VALUE((ptrdiff_t)integer);
+                break;
+            }
+            case LOGGER_ARG_POINTER:
+            {
+                LOGGER_PRINT_VALUE((void*)(uintptr_t)integer);
+                break;
+            }
+            case LOGGER_ARG_DOUBLE:
+            {
+                LOGGER_PRINT_VALUE(real);
+                break;
+            }
+            case LOGGER_ARG_LDOUBLE:
+            {
+                LOGGER_PRINT_VALUE((long double)real);
+                break;
+            }
+            default:
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool logger_decode_binary(const char* filename, FILE* out)
+{
+    if (filename == NULL || out == NULL)
+    {
+        return false;
+    }
+
+    FILE* fp = fopen(filename, "rb");
+
+    if (fp == NULL)
+    {
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    unsigned char* data = (file_size > 0) ? (unsigned char*)malloc((size_t)file_size) : NULL;
+
+    if (data == NULL || fread(data, 1, (size_t)file_size, fp) != (size_t)file_size)
+    {
+        free(data);
+        fclose(fp);
+        return false;
+    }
+
+    fclose(fp);
+
+    logger_binary_header_t header;
+    const unsigned char* ptr = data;
+    const unsigned char* end = data + file_size;
+
+    if (!logger_internal_take(&ptr, end, &header, sizeof(header))
+        || memcmp(header.magic, LOGGER_BINARY_MAGIC, sizeof(LOGGER_BINARY_MAGIC)) != 0
+        || header.version != LOGGER_BINARY_VERSION
+        || header.byte_order != LOGGER_BINARY_BYTE_ORDER)
+    {
+        free(data);
+        return false;
+    }
+
+    logger_decode_format_t* formats = NULL;
+    uint32_t format_count = 0;
+    bool decoded = true;
+
+    // A record cut short by a crash ends the file
+    while((size_t)(end - ptr) >= LOGGER_RECORD_HEADER)
+    {
+        uint32_t size = 0;
+        uint32_t id = 0;
+
+        memcpy(&size, ptr, sizeof(size));
+        memcpy(&id, ptr + sizeof(size), sizeof(id));
+
+        if (size < LOGGER_RECORD_HEADER || size > (size_t)(end - ptr))
+        {
+            break;
+        }
+
+        const unsigned char* record = ptr + LOGGER_RECORD_HEADER;
+        const unsigned char* record_end = ptr + size;
+        ptr = record_end;
+
+        if (id == LOGGER_BINARY_DEFINITION)
+        {
+            logger_decode_format_t format;
+            uint32_t format_id = 0;
+            uint16_t file_len = 0;
+            uint16_t func_len = 0;
+            uint32_t format_len = 0;
+
+            memset(&format, 0, sizeof(format));
+
+            if (!logger_internal_take(&record, record_end, &format_id, sizeof(format_id))
+                || !logger_internal_take(&record, record_end, &format.level, sizeof(format.level))
+                || !logger_internal_take(&record, record_end, &format.line, sizeof(format.line))
+                || !logger_internal_take(&record, record_end, &file_len, sizeof(file_len))
+                || !logger_internal_take(&record, record_end, &func_len, sizeof(func_len))
+                || !logger_internal_take(&record, record_end, &format_len, sizeof(format_len))
+                || !logger_internal_take(&record, record_end, &format.argc, sizeof(format.argc))
+                || format_id == 0 || format_id > LOGGER_BINARY_MAX_FORMATS
+                || format.argc > LOGGER_BINARY_MAX_ARGS)
+            {
+                decoded = false;
+                continue;
+            }
+
+            // Later files repeat definitions; the first one stands
+            if (format_id <= format_count && formats[format_id - 1].format != NULL)
+            {
+                continue;
+            }
+
+            format.argtypes = (unsigned char*)logger_internal_take_string(&record, record_end, format.argc);
+            format.file = logger_internal_take_string(&record, record_end, file_len);
+            format.func = logger_internal_take_string(&record, record_end, func_len);
+            format.format = logger_internal_take_string(&record, record_end, format_len);
+
+            if (format.argtypes == NULL || format.file == NULL || format.func == NULL || format.format == NULL
+                || !logger_internal_check_definition(&format))
+            {
+                free(format.argtypes);
+                free(format.file);
+                free(format.func);
+                free(format.format);
+                decoded = false;
+                continue;
+            }
+
+            normalize_function_name(format.func);
+
+            if (format_id > format_count)
+            {
+                logger_decode_format_t* grown = (logger_decode_format_t*)realloc(formats, format_id * sizeof(logger_decode_format_t));
+
+                if (grown == NULL)
+                {
+                    free(format.argtypes);
+                    free(format.file);
+                    free(format.func);
+                    free(format.format);
+                    decoded = false;
+                    break;
+                }
+
+                memset(grown + format_count, 0, (format_id - format_count) * sizeof(logger_decode_format_t));
+                formats = grown;
+                format_count = format_id;
+            }
+
+            formats[format_id - 1] = format;
+        }
+        else if (id == LOGGER_BINARY_TEXT)
+        {
+            int64_t timestamp = 0;
+            uint32_t level = 0;
+            int32_t line = 0;
+            uint16_t file_len = 0;
+            uint16_t func_len = 0;
+            uint32_t entry_len = 0;
+
+            if (!logger_internal_take(&record, record_end, &timestamp, sizeof(timestamp))
+                || !logger_internal_take(&record, record_end, &level, sizeof(level))
+                || !logger_internal_take(&record, record_end, &line, sizeof(line))
+                || !logger_internal_take(&record, record_end, &file_len, sizeof(file_len))
+                || !logger_internal_take(&record, record_end, &func_len, sizeof(func_len))
+                || !logger_internal_take(&record, record_end, &entry_len, sizeof(entry_len)))
+            {
+                decoded = false;
+                continue;
+            }
+
+            char* file = logger_internal_take_string(&record, record_end, file_len);
+            char* func = logger_internal_take_string(&record, record_end, func_len);
+            char* entry = logger_internal_take_string(&record, record_end, entry_len);
+
+            if (file != NULL && func != NULL && entry != NULL)
+            {
+                normalize_function_name(func);
+                logger_internal_print_prefix(out, &header, timestamp, level, file, line, func);
+                fprintf(out, "%s" END_OF_LINE, entry);
+            }
+            else
+            {
+                decoded = false;
+            }
+
+            free(file);
+            free(func);
+            free(entry);
+        }
+        else
+        {
+            int64_t timestamp = 0;
+
+            if (id > format_count || formats[id - 1].format == NULL
+                || !logger_internal_take(&record, record_end, &timestamp, sizeof(timestamp)))
+            {
+                decoded = false;
+                continue;
+            }
+
+            const logger_decode_format_t* format = &formats[id - 1];
+
+            logger_internal_print_prefix(out, &header, timestamp, format->level, format->file, format->line, format->func);
+
+            if (!logger_internal_print_event(out, format, record, record_end))
+            {
+                decoded = false;
+            }
+
+            fputs(END_OF_LINE, out);
+        }
+    }
+
+    for(uint32_t index = 0; index < format_count; index++)
+    {
+        free(formats[index].argtypes);
+        free(formats[index].file);
+        free(formats[index].func);
+        free(formats[index].format);
     }
 
-    string_left_trim(func_name_str);
+    free(formats);
+    free(data);
 
-    memset(func_name, 0, len + 1);
-    strcpy(func_name, string_c_str(func_name_str));
-    string_free(&func_name_str);
+    return decoded;
 }
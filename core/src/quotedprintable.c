@@ -0,0 +1,525 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "quotedprintable.h"
+#include <memory.h>
+#include <stdlib.h>
+
+#define QP_MAX_LINE_LENGTH 76
+#define QP_MIN_LINE_LENGTH 8
+#define QP_MAX_WHITESPACE 80
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+typedef struct quoted_printable_encoder_t
+{
+	unsigned long line_length;
+	unsigned long column;
+	bool binary;
+	char pending_space;
+	bool pending_cr;
+}quoted_printable_encoder_t;
+
+typedef struct quoted_printable_decoder_t
+{
+	char escape[2];
+	unsigned long escape_length;
+	bool in_escape;
+	char whitespace[QP_MAX_WHITESPACE];
+	unsigned long whitespace_length;
+	bool pending_cr;
+	bool valid;
+}quoted_printable_decoder_t;
+
+static inline bool quoted_printable_internal_is_literal(unsigned char ch)
+{
+	return (ch >= 33 && ch <= 126 && ch != '=');
+}
+
+static int quoted_printable_internal_hex_value(char ch)
+{
+	if (ch >= '0' && ch <= '9') return ch - '0';
+	if (ch >= 'A' && ch <= 'F') return 10 + (ch - 'A');
+	if (ch >= 'a' && ch <= 'f') return 10 + (ch - 'a');
+	return -1;
+}
+
+// Writes a token, inserting a soft line break first when it would not fit.
+// One column is always kept free for the '=' of a soft break.
+static unsigned long quoted_printable_internal_put(quoted_printable_encoder_t* ptr, const char* token, unsigned long len, char* out)
+{
+	unsigned long o = 0;
+
+	if (ptr->column + len > ptr->line_length - 1)
+	{
+		out[o++] = '=';
+		out[o++] = '\r';
+		out[o++] = '\n';
+		ptr->column = 0;
+	}
+
+	memcpy(out + o, token, len);
+	ptr->column += len;
+
+	return o + len;
+}
+
+static unsigned long quoted_printable_internal_put_escaped(quoted_printable_encoder_t* ptr, unsigned char ch, char* out)
+{
+	char token[3] = { '=', hexdigits[ch >> 4], hexdigits[ch & 0x0F] };
+
+	return quoted_printable_internal_put(ptr, token, 3, out);
+}
+
+// Whitespace is held back until the next octet shows whether it ends a line
+static unsigned long quoted_printable_internal_flush_space(quoted_printable_encoder_t* ptr, bool line_end, char* out)
+{
+	if (ptr->pending_space == 0)
+	{
+		return 0;
+	}
+
+	char space = ptr->pending_space;
+	ptr->pending_space = 0;
+
+	if (line_end)
+	{
+		return quoted_printable_internal_put_escaped(ptr, (unsigned char)space, out);
+	}
+
+	return quoted_printable_internal_put(ptr, &space, 1, out);
+}
+
+static unsigned long quoted_printable_internal_hard_break(quoted_printable_encoder_t* ptr, char* out)
+{
+	unsigned long o = quoted_printable_internal_flush_space(ptr, true, out);
+
+	out[o++] = '\r';
+	out[o++] = '\n';
+	ptr->column = 0;
+
+	return o;
+}
+
+quoted_printable_encoder_t* quoted_printable_encoder_allocate(unsigned long line_length, bool binary)
+{
+	quoted_printable_encoder_t* ptr = (quoted_printable_encoder_t*)calloc(1, sizeof(quoted_printable_encoder_t));
+
+	if (ptr == NULL)
+	{
+		return NULL;
+	}
+
+	if (line_length == 0 || line_length > QP_MAX_LINE_LENGTH)
+	{
+		line_length = QP_MAX_LINE_LENGTH;
+	}
+
+	if (line_length < QP_MIN_LINE_LENGTH)
+	{
+		line_length = QP_MIN_LINE_LENGTH;
+	}
+
+	ptr->line_length = line_length;
+	ptr->column = 0;
+	ptr->binary = binary;
+	ptr->pending_space = 0;
+	ptr->pending_cr = false;
+
+	return ptr;
+}
+
+void quoted_printable_encoder_free(quoted_printable_encoder_t* ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	free(ptr);
+}
+
+unsigned long quoted_printable_encoder_max_output(const quoted_printable_encoder_t* ptr, unsigned long inputlength)
+{
+	if (ptr == NULL)
+	{
+		return 0;
+	}
+
+	// Every octet expands to at most 3 characters plus held back state,
+	// and each line carries at most 3 characters of soft break overhead
+	unsigned long content = (inputlength + 2) * 3;
+
+	return content + (content / (ptr->line_length - 4) + 2) * 3;
+}
+
+unsigned long quoted_printable_encoder_update(quoted_printable_encoder_t* ptr, const unsigned char* data, unsigned long inputlength, char* out)
+{
+	if (ptr == NULL || out == NULL || (data == NULL && inputlength > 0))
+	{
+		return 0;
+	}
+
+	unsigned long i = 0;
+	unsigned long o = 0;
+
+	while (i < inputlength)
+	{
+		// Copy runs of literal octets a line at a time
+		if (ptr->pending_space == 0 && !ptr->pending_cr && quoted_printable_internal_is_literal(data[i]))
+		{
+			unsigned long room = ptr->line_length - 1 - ptr->column;
+
+			if (room == 0)
+			{
+				out[o++] = '=';
+				out[o++] = '\r';
+				out[o++] = '\n';
+				ptr->column = 0;
+				room = ptr->line_length - 1;
+			}
+
+			unsigned long run = 1;
+
+			while (run < room && i + run < inputlength && quoted_printable_internal_is_literal(data[i + run]))
+			{
+				run++;
+			}
+
+			memcpy(out + o, data + i, run);
+			o += run;
+			i += run;
+			ptr->column += run;
+			continue;
+		}
+
+		unsigned char ch = data[i++];
+
+		if (!ptr->binary)
+		{
+			if (ptr->pending_cr)
+			{
+				ptr->pending_cr = false;
+
+				if (ch == '\n')
+				{
+					o += quoted_printable_internal_hard_break(ptr, out + o);
+					continue;
+				}
+
+				o += quoted_printable_internal_flush_space(ptr, false, out + o);
+				o += quoted_printable_internal_put_escaped(ptr, '\r', out + o);
+			}
+
+			if (ch == '\r')
+			{
+				ptr->pending_cr = true;
+				continue;
+			}
+
+			if (ch == '\n')
+			{
+				o += quoted_printable_internal_hard_break(ptr, out + o);
+				continue;
+			}
+		}
+
+		o += quoted_printable_internal_flush_space(ptr, false, out + o);
+
+		if (ch == ' ' || ch == '\t')
+		{
+			ptr->pending_space = (char)ch;
+		}
+		else if (quoted_printable_internal_is_literal(ch))
+		{
+			o += quoted_printable_internal_put(ptr, (const char*)&ch, 1, out + o);
+		}
+		else
+		{
+			o += quoted_printable_internal_put_escaped(ptr, ch, out + o);
+		}
+	}
+
+	return o;
+}
+
+unsigned long quoted_printable_encoder_finish(quoted_printable_encoder_t* ptr, char* out)
+{
+	if (ptr == NULL || out == NULL)
+	{
+		return 0;
+	}
+
+	unsigned long o = 0;
+
+	if (ptr->pending_cr)
+	{
+		o += quoted_printable_internal_flush_space(ptr, false, out + o);
+		o += quoted_printable_internal_put_escaped(ptr, '\r', out + o);
+		ptr->pending_cr = false;
+	}
+
+	// Whitespace at the very end of the data is a line end as well
+	o += quoted_printable_internal_flush_space(ptr, true, out + o);
+	ptr->column = 0;
+
+	return o;
+}
+
+quoted_printable_decoder_t* quoted_printable_decoder_allocate(void)
+{
+	quoted_printable_decoder_t* ptr = (quoted_printable_decoder_t*)calloc(1, sizeof(quoted_printable_decoder_t));
+
+	if (ptr == NULL)
+	{
+		return NULL;
+	}
+
+	ptr->escape_length = 0;
+	ptr->in_escape = false;
+	ptr->whitespace_length = 0;
+	ptr->pending_cr = false;
+	ptr->valid = true;
+
+	return ptr;
+}
+
+void quoted_printable_decoder_free(quoted_printable_decoder_t* ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	free(ptr);
+}
+
+unsigned long quoted_printable_decoder_max_output(const quoted_printable_decoder_t* ptr, unsigned long inputlength)
+{
+	if (ptr == NULL)
+	{
+		return 0;
+	}
+
+	// A bare LF widens to CRLF, and held back whitespace or escapes may be released
+	return inputlength * 2 + QP_MAX_WHITESPACE + 4;
+}
+
+static unsigned long quoted_printable_internal_release_space(quoted_printable_decoder_t* ptr, unsigned char* out)
+{
+	unsigned long len = ptr->whitespace_length;
+
+	memcpy(out, ptr->whitespace, len);
+	ptr->whitespace_length = 0;
+
+	return len;
+}
+
+// Handles the octet following '=': two hex digits or a soft line break
+static unsigned long quoted_printable_internal_escape(quoted_printable_decoder_t* ptr, char ch, unsigned char* out)
+{
+	unsigned long o = 0;
+
+	if (ch == '\n' && (ptr->escape_length == 0 || ptr->escape[0] == '\r'))
+	{
+		ptr->in_escape = false;
+		ptr->escape_length = 0;
+		return 0;
+	}
+
+	if (ch == '\r' && ptr->escape_length == 0)
+	{
+		ptr->escape[ptr->escape_length++] = ch;
+		return 0;
+	}
+
+	ptr->escape[ptr->escape_length++] = ch;
+
+	if (ptr->escape_length < 2)
+	{
+		return 0;
+	}
+
+	int hi = quoted_printable_internal_hex_value(ptr->escape[0]);
+	int lo = quoted_printable_internal_hex_value(ptr->escape[1]);
+
+	if (hi < 0 || lo < 0)
+	{
+		ptr->valid = false;
+		out[o++] = '=';
+		out[o++] = (unsigned char)ptr->escape[0];
+		out[o++] = (unsigned char)ptr->escape[1];
+	}
+	else
+	{
+		out[o++] = (unsigned char)((hi << 4) | lo);
+	}
+
+	ptr->in_escape = false;
+	ptr->escape_length = 0;
+
+	return o;
+}
+
+unsigned long quoted_printable_decoder_update(quoted_printable_decoder_t* ptr, const char* data, unsigned long inputlength, unsigned char* out)
+{
+	if (ptr == NULL || out == NULL || (data == NULL && inputlength > 0))
+	{
+		return 0;
+	}
+
+	unsigned long i = 0;
+	unsigned long o = 0;
+
+	while (i < inputlength)
+	{
+		char ch = data[i++];
+
+		if (ptr->in_escape)
+		{
+			o += quoted_printable_internal_escape(ptr, ch, out + o);
+			continue;
+		}
+
+		if (ptr->pending_cr)
+		{
+			ptr->pending_cr = false;
+
+			if (ch == '\n')
+			{
+				ptr->whitespace_length = 0;
+				out[o++] = '\r';
+				out[o++] = '\n';
+				continue;
+			}
+
+			o += quoted_printable_internal_release_space(ptr, out + o);
+			out[o++] = '\r';
+		}
+
+		switch (ch)
+		{
+			case ' ':
+			case '\t':
+				if (ptr->whitespace_length == QP_MAX_WHITESPACE)
+				{
+					o += quoted_printable_internal_release_space(ptr, out + o);
+				}
+				ptr->whitespace[ptr->whitespace_length++] = ch;
+				break;
+
+			case '\r':
+				ptr->pending_cr = true;
+				break;
+
+			case '\n':
+				ptr->whitespace_length = 0;
+				out[o++] = '\r';
+				out[o++] = '\n';
+				break;
+
+			case '=':
+				o += quoted_printable_internal_release_space(ptr, out + o);
+				ptr->in_escape = true;
+				ptr->escape_length = 0;
+				break;
+
+			default:
+			{
+				o += quoted_printable_internal_release_space(ptr, out + o);
+
+				// Copy the rest of a plain run in one go
+				unsigned long run = 1;
+
+				while (i + run - 1 < inputlength)
+				{
+					char next = data[i + run - 1];
+
+					if (next == '=' || next == '\r' || next == '\n' || next == ' ' || next == '\t')
+					{
+						break;
+					}
+
+					run++;
+				}
+
+				out[o] = (unsigned char)ch;
+				memcpy(out + o + 1, data + i, run - 1);
+				o += run;
+				i += run - 1;
+				break;
+			}
+		}
+	}
+
+	return o;
+}
+
+bool quoted_printable_decoder_finish(quoted_printable_decoder_t* ptr, unsigned char* out, unsigned long* outputlength)
+{
+	if (ptr == NULL || out == NULL || outputlength == NULL)
+	{
+		return false;
+	}
+
+	unsigned long o = 0;
+
+	// Trailing whitespace ends the last line and is dropped
+	ptr->whitespace_length = 0;
+
+	if (ptr->pending_cr)
+	{
+		out[o++] = '\r';
+		ptr->pending_cr = false;
+	}
+
+	if (ptr->in_escape)
+	{
+		// A lone '=' followed only by CR is a truncated soft break
+		if (!(ptr->escape_length == 1 && ptr->escape[0] == '\r'))
+		{
+			ptr->valid = false;
+			out[o++] = '=';
+
+			for (unsigned long k = 0; k < ptr->escape_length; k++)
+			{
+				out[o++] = (unsigned char)ptr->escape[k];
+			}
+		}
+
+		ptr->in_escape = false;
+		ptr->escape_length = 0;
+	}
+
+	*outputlength = o;
+
+	bool valid = ptr->valid;
+	ptr->valid = true;
+
+	return valid;
+}
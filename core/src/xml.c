@@ -27,57 +27,103 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "xml.h"
+#include "arena.h"
+#include "file.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <ctype.h>
 
+#define XML_ARENA_BLOCK_SIZE (16 * 1024)
+/* Elements with at least this many attributes get a hash index */
+#define XML_ATTR_INDEX_THRESHOLD 8
+#define XML_NAME_TABLE_SIZE 64
+
 /* ---------------- Internal Structures ---------------- */
 
-typedef struct xml_attribute_t
+struct xml_attribute_t
 {
-    char *name;
+    char *name;                     /* interned */
     char *value;
     struct xml_attribute_t *next;
-} xml_attribute_t;
+};
+
+/* Open addressing table over the attributes of one element */
+typedef struct xml_attribute_index_t
+{
+    size_t mask;
+    xml_attribute_t *slots[];
+} xml_attribute_index_t;
 
 struct xml_node_t
 {
     xml_node_type_t type;
-    char *name;                  /* element name (NULL for text nodes) */
-    char *text;                  /* text content for text/cdata/comment */
-    xml_attribute_t *attr;          /* linked list of attributes */
+    unsigned int attr_count;
+    size_t order;                   /* creation order, which is document order */
+    char *name;                     /* interned element name (NULL for text nodes) */
+    char *text;                     /* text content for text/cdata/comment */
+    xml_attribute_t *attr;          /* attributes in document order */
+    xml_attribute_index_t *attr_index;
     struct xml_node_t *parent;
     struct xml_node_t *firstChild;
+    struct xml_node_t *lastChild;
     struct xml_node_t *nextSibling;
 };
 
 struct xml_document_t
 {
     xml_node_t *root;               /* Document node as container */
+    arena_t *arena;                 /* Every node, attribute and name */
+    char *owned_input;              /* Buffer the text points into, if ours */
 };
 
-/* ---------------- Helpers ---------------- */
+/* Element and attribute names are stored once per document; the table is
+   only needed while parsing */
+typedef struct xml_name_entry_t
+{
+    uint32_t hash;
+    uint32_t len;
+    char *name;
+} xml_name_entry_t;
 
-static char *xstrndup(const char *s, size_t n)
+typedef struct xml_parser_t
 {
-    char *p = (char*)malloc(n + 1);
-    if (!p) return NULL;
-    memcpy(p, s, n);
-    p[n] = '\0';
-    return p;
-}
+    char *p;
+    char *end;
+    arena_t *arena;
+    xml_name_entry_t *names;
+    size_t names_capacity;
+    size_t names_count;
+    size_t node_count;
+} xml_parser_t;
+
+/* ---------------- Helpers ---------------- */
 
-static char *xstrdup(const char *s)
+/* Jenkins one-at-a-time, as used by the dictionary */
+static uint32_t xml_hash_name(const char *name, size_t len)
 {
-    return s ? xstrndup(s, strlen(s)) : NULL;
+    uint32_t hash = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash += (unsigned char)name[i];
+        hash += hash << 10;
+        hash ^= hash >> 6;
+    }
+
+    hash += hash << 3;
+    hash ^= hash >> 11;
+    hash += hash << 15;
+
+    return hash;
 }
 
-static void skip_ws(const char **p)
+static void skip_ws(xml_parser_t *ps)
 {
-    while (**p && isspace((unsigned char)**p))
+    while (ps->p < ps->end && isspace((unsigned char)*ps->p))
     {
-        (*p)++;
+        ps->p++;
     }
 }
 
@@ -86,61 +132,182 @@ static int is_name_char(char c)
     return (isalnum((unsigned char)c) || c == '_' || c == ':' || c == '-' || c == '.');
 }
 
-static char *parse_name(const char **p)
+static int starts_with(const xml_parser_t *ps, const char *lit, size_t n)
 {
-    const char *s = *p;
-    if (!is_name_char(*s)) return NULL;
-    const char *start = s++;
-    while (*s && is_name_char(*s)) s++;
-    *p = s;
-    return xstrndup(start, s - start);
+    return (size_t)(ps->end - ps->p) >= n && memcmp(ps->p, lit, n) == 0;
 }
 
-static char *unescape_entities(const char *src)
+static char *find_literal(char *s, char *end, const char *lit, size_t n)
 {
-    if (!src) return NULL;
-    size_t n = strlen(src);
-    char *out = (char*)malloc(n + 1);
-    if (!out) return NULL;
+    while (s < end)
+    {
+        char *hit = (char*)memchr(s, lit[0], (size_t)(end - s));
+        if (!hit || (size_t)(end - hit) < n) return NULL;
+        if (memcmp(hit, lit, n) == 0) return hit;
+        s = hit + 1;
+    }
+    return NULL;
+}
 
-    const char *s = src;
-    char *d = out;
-    while (*s)
+static char *intern_name(xml_parser_t *ps, const char *s, size_t len)
+{
+    if (ps->names_count * 2 >= ps->names_capacity)
     {
-        if (*s == '&')
+        size_t cap = ps->names_capacity ? ps->names_capacity * 2 : XML_NAME_TABLE_SIZE;
+        xml_name_entry_t *grown = (xml_name_entry_t*)calloc(cap, sizeof(xml_name_entry_t));
+        if (!grown) return NULL;
+
+        for (size_t i = 0; i < ps->names_capacity; i++)
         {
-            if (strncmp(s, "&amp;", 5) == 0) { *d++ = '&'; s += 5; }
-            else if (strncmp(s, "&lt;", 4) == 0) { *d++ = '<'; s += 4; }
-            else if (strncmp(s, "&gt;", 4) == 0) { *d++ = '>'; s += 4; }
-            else if (strncmp(s, "&quot;", 6) == 0) { *d++ = '"'; s += 6; }
-            else if (strncmp(s, "&apos;", 6) == 0) { *d++ = '\''; s += 6; }
-            else { *d++ = *s++; }
+            xml_name_entry_t *e = &ps->names[i];
+            if (!e->name) continue;
+            size_t slot = e->hash & (cap - 1);
+            while (grown[slot].name) slot = (slot + 1) & (cap - 1);
+            grown[slot] = *e;
         }
-        else
+
+        free(ps->names);
+        ps->names = grown;
+        ps->names_capacity = cap;
+    }
+
+    uint32_t hash = xml_hash_name(s, len);
+    size_t slot = hash & (ps->names_capacity - 1);
+
+    while (ps->names[slot].name)
+    {
+        xml_name_entry_t *e = &ps->names[slot];
+        if (e->hash == hash && e->len == len && memcmp(e->name, s, len) == 0) return e->name;
+        slot = (slot + 1) & (ps->names_capacity - 1);
+    }
+
+    char *name = arena_strndup(ps->arena, s, len);
+    if (!name) return NULL;
+
+    ps->names[slot].hash = hash;
+    ps->names[slot].len = (uint32_t)len;
+    ps->names[slot].name = name;
+    ps->names_count++;
+    return name;
+}
+
+static char *parse_name(xml_parser_t *ps)
+{
+    char *start = ps->p;
+    while (ps->p < ps->end && is_name_char(*ps->p)) ps->p++;
+    if (ps->p == start) return NULL;
+    return intern_name(ps, start, (size_t)(ps->p - start));
+}
+
+static size_t encode_utf8(unsigned long code, char *out)
+{
+    if (code <= 0x7F)
+    {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code <= 0x7FF)
+    {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code <= 0xFFFF)
+    {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+/* Decodes the reference between '&' and ';' into 'out' (never longer than
+   the reference itself); returns 0 if it is not one we know */
+static size_t decode_entity(const char *name, size_t len, char *out)
+{
+    if (len == 2 && memcmp(name, "lt", 2) == 0) { *out = '<'; return 1; }
+    if (len == 2 && memcmp(name, "gt", 2) == 0) { *out = '>'; return 1; }
+    if (len == 3 && memcmp(name, "amp", 3) == 0) { *out = '&'; return 1; }
+    if (len == 4 && memcmp(name, "quot", 4) == 0) { *out = '"'; return 1; }
+    if (len == 4 && memcmp(name, "apos", 4) == 0) { *out = '\''; return 1; }
+
+    if (len < 2 || name[0] != '#') return 0;
+
+    int hex = name[1] == 'x';
+    size_t i = hex ? 2 : 1;
+    unsigned long code = 0;
+    if (i == len) return 0;
+
+    for (; i < len; i++)
+    {
+        char c = name[i];
+        unsigned long digit;
+        if (c >= '0' && c <= '9') digit = (unsigned long)(c - '0');
+        else if (hex && c >= 'a' && c <= 'f') digit = (unsigned long)(c - 'a' + 10);
+        else if (hex && c >= 'A' && c <= 'F') digit = (unsigned long)(c - 'A' + 10);
+        else return 0;
+
+        code = code * (hex ? 16 : 10) + digit;
+        if (code > 0x10FFFF) return 0;
+    }
+
+    if (code == 0 || (code >= 0xD800 && code <= 0xDFFF)) return 0;
+    return encode_utf8(code, out);
+}
+
+/* Decodes entities of s[0..len) in place and terminates the result, which
+   may overwrite s[len]. Text without '&' is only terminated. */
+static char *unescape_in_place(char *s, size_t len)
+{
+    char *amp = (char*)memchr(s, '&', len);
+    if (!amp)
+    {
+        s[len] = '\0';
+        return s;
+    }
+
+    char *end = s + len;
+    char *d = amp;
+    char *r = amp;
+
+    while (r < end)
+    {
+        if (*r == '&')
         {
-            *d++ = *s++;
+            char *semi = (char*)memchr(r + 1, ';', (size_t)(end - r - 1) < 12 ? (size_t)(end - r - 1) : 12);
+            if (semi)
+            {
+                char out[4];
+                size_t n = decode_entity(r + 1, (size_t)(semi - r - 1), out);
+                if (n)
+                {
+                    memcpy(d, out, n);
+                    d += n;
+                    r = semi + 1;
+                    continue;
+                }
+            }
         }
+        *d++ = *r++;
     }
-    *d = '\0';
 
-    char *res = xstrdup(out);
-    free(out);
-    return res;
+    *d = '\0';
+    return s;
 }
 
 /* ---------------- Node Management ---------------- */
 
-static xml_node_t *node_new(xml_node_type_t type)
+static xml_node_t *node_new(xml_parser_t *ps, xml_node_type_t type)
 {
-    xml_node_t *n = (xml_node_t*)malloc(sizeof(xml_node_t));
+    xml_node_t *n = (xml_node_t*)arena_calloc(ps->arena, sizeof(xml_node_t));
     if (!n) return NULL;
     n->type = type;
-    n->name = NULL;
-    n->text = NULL;
-    n->attr = NULL;
-    n->parent = NULL;
-    n->firstChild = NULL;
-    n->nextSibling = NULL;
+    n->order = ps->node_count++;
     return n;
 }
 
@@ -152,338 +319,333 @@ static void node_append_child(xml_node_t *parent, xml_node_t *child)
     }
     else
     {
-        xml_node_t *c = parent->firstChild;
-        while (c->nextSibling) c = c->nextSibling;
-        c->nextSibling = child;
+        parent->lastChild->nextSibling = child;
     }
+    parent->lastChild = child;
     child->parent = parent;
 }
 
-static void free_attrs(xml_attribute_t *a)
+static int node_build_attr_index(arena_t *arena, xml_node_t *node)
 {
-    while (a)
+    size_t cap = 16;
+    while (cap < (size_t)node->attr_count * 2) cap *= 2;
+
+    xml_attribute_index_t *index = (xml_attribute_index_t*)arena_calloc(arena, sizeof(xml_attribute_index_t) + cap * sizeof(xml_attribute_t*));
+    if (!index) return 0;
+    index->mask = cap - 1;
+
+    for (xml_attribute_t *a = node->attr; a; a = a->next)
     {
-        xml_attribute_t *n = a->next;
-        free(a->name);
-        free(a->value);
-        free(a);
-        a = n;
+        size_t slot = xml_hash_name(a->name, strlen(a->name)) & index->mask;
+        int duplicate = 0;
+
+        /* The first of duplicate attributes wins, as in the list scan */
+        while (index->slots[slot])
+        {
+            if (index->slots[slot]->name == a->name)
+            {
+                duplicate = 1;
+                break;
+            }
+            slot = (slot + 1) & index->mask;
+        }
+
+        if (!duplicate) index->slots[slot] = a;
     }
+
+    node->attr_index = index;
+    return 1;
 }
 
-static void free_node(xml_node_t *n)
+/* ---------------- Parsing ---------------- */
+
+static int parse_attributes(xml_parser_t *ps, xml_node_t *node, int *open)
 {
-    if (!n) return;
-    free(n->name);
-    free(n->text);
-    free_attrs(n->attr);
+    xml_attribute_t *last = NULL;
 
-    xml_node_t *c = n->firstChild;
-    while (c)
+    for (;;)
     {
-        xml_node_t *nx = c->nextSibling;
-        free_node(c);
-        c = nx;
+        skip_ws(ps);
+        if (ps->p >= ps->end) return 0;
+
+        if (*ps->p == '>')
+        {
+            ps->p++;
+            *open = 1;
+            break;
+        }
+
+        if (*ps->p == '/')
+        {
+            if (ps->p + 1 >= ps->end || ps->p[1] != '>') return 0;
+            ps->p += 2;
+            *open = 0;
+            break;
+        }
+
+        char *name = parse_name(ps);
+        if (!name) return 0;
+        skip_ws(ps);
+        if (ps->p >= ps->end || *ps->p != '=') return 0;
+        ps->p++;
+        skip_ws(ps);
+        if (ps->p >= ps->end || (*ps->p != '"' && *ps->p != '\'')) return 0;
+
+        char q = *ps->p++;
+        char *value = ps->p;
+        char *close = (char*)memchr(value, q, (size_t)(ps->end - value));
+        if (!close) return 0;
+        ps->p = close + 1;
+
+        xml_attribute_t *a = (xml_attribute_t*)arena_alloc(ps->arena, sizeof(xml_attribute_t));
+        if (!a) return 0;
+        a->name = name;
+        a->value = unescape_in_place(value, (size_t)(close - value));
+        a->next = NULL;
+
+        if (last) last->next = a;
+        else node->attr = a;
+        last = a;
+        node->attr_count++;
     }
-    free(n);
-}
 
-/* ---------------- Parsing ---------------- */
+    if (node->attr_count >= XML_ATTR_INDEX_THRESHOLD) return node_build_attr_index(ps->arena, node);
+    return 1;
+}
 
-static char *parse_quoted_value(const char **p)
+/* Text, comment and CDATA content is terminated in place; a run that
+   ends the input has no byte left to hold the NUL and is copied */
+static char *terminate_text(xml_parser_t *ps, char *start, char *stop)
 {
-    skip_ws(p);
-    if (**p != '"' && **p != '\'') return NULL;
-    char q = *(*p)++;
-    const char *start = *p;
-    while (**p && **p != q) (*p)++;
-    const char *end = *p;
-    if (**p == q) (*p)++;
+    if (stop < ps->end) return unescape_in_place(start, (size_t)(stop - start));
 
-    char *raw = xstrndup(start, end - start);
-    char *un = unescape_entities(raw);
-    free(raw);
-    return un;
+    char *copy = arena_alloc(ps->arena, (size_t)(stop - start) + 1);
+    if (!copy) return NULL;
+    memcpy(copy, start, (size_t)(stop - start));
+    return unescape_in_place(copy, (size_t)(stop - start));
 }
 
-static void node_add_attr(xml_node_t *node, char *name, char *value)
+static int add_text_node(xml_parser_t *ps, xml_node_t *parent, xml_node_type_t type, char *start, char *stop)
 {
-    xml_attribute_t *a = (xml_attribute_t*)malloc(sizeof(xml_attribute_t));
-    if (!a)
+    xml_node_t *n = node_new(ps, type);
+    if (!n) return 0;
+
+    if (type == XML_NODE_TEXT)
     {
-        free(name);
-        free(value);
-        return;
+        n->text = terminate_text(ps, start, stop);
+    }
+    else
+    {
+        /* Comments and CDATA are taken literally */
+        *stop = '\0';
+        n->text = start;
     }
 
-    a->name = name;
-    a->value = value;
-    a->next = node->attr;
-    node->attr = a;
+    if (!n->text) return 0;
+    node_append_child(parent, n);
+    return 1;
 }
 
-static int parse_attributes(const char **p, xml_node_t *node)
+static int skip_declaration(xml_parser_t *ps)
 {
-    for (;;)
+    int depth = 0;
+    char q = 0;
+
+    for (; ps->p < ps->end; ps->p++)
     {
-        skip_ws(p);
-        if (**p == '>' || **p == '/' || !**p) break;
-        char *name = parse_name(p);
-        if (!name) return 0;
-        skip_ws(p);
-        if (**p != '=')
+        char c = *ps->p;
+        if (q)
         {
-            free(name);
-            return 0;
+            if (c == q) q = 0;
         }
-        (*p)++;
-        char *value = parse_quoted_value(p);
-        if (!value)
+        else if (c == '"' || c == '\'') q = c;
+        else if (c == '[') depth++;
+        else if (c == ']' && depth > 0) depth--;
+        else if (c == '>' && depth == 0)
         {
-            free(name);
-            return 0;
+            ps->p++;
+            return 1;
         }
-        node_add_attr(node, name, value);
     }
-    return 1;
+    return 0;
 }
 
-static int parse_node(const char **p, xml_node_t *parent);
-
-static int parse_element(const char **p, xml_node_t *parent)
+/* Called just past a '<' (which may already be overwritten) */
+static int parse_markup(xml_parser_t *ps, xml_node_t **current)
 {
-    (*p)++;
-    char *ename = parse_name(p);
-    if (!ename) return 0;
+    if (ps->p >= ps->end) return 0;
 
-    xml_node_t *elem = node_new(XML_NODE_ELEMENT);
-    if (!elem)
+    if (*ps->p == '/')
     {
-        free(ename);
-        return 0;
+        char *gt = (char*)memchr(ps->p, '>', (size_t)(ps->end - ps->p));
+        ps->p = gt ? gt + 1 : ps->end;
+        if ((*current)->parent) *current = (*current)->parent;
+        return 1;
     }
 
-    elem->name = ename;
-
-    if (!parse_attributes(p, elem))
+    if (starts_with(ps, "!--", 3))
     {
-        free_node(elem);
-        return 0;
+        char *end = find_literal(ps->p + 3, ps->end, "-->", 3);
+        if (!end) return 0;
+        if (!add_text_node(ps, *current, XML_NODE_COMMENT, ps->p + 3, end)) return 0;
+        ps->p = end + 3;
+        return 1;
     }
 
-    skip_ws(p);
-
-    if (**p == '/' && *(*p + 1) == '>')
+    if (starts_with(ps, "![CDATA[", 8))
     {
-        *p += 2;
-        node_append_child(parent, elem);
+        char *end = find_literal(ps->p + 8, ps->end, "]]>", 3);
+        if (!end) return 0;
+        if (!add_text_node(ps, *current, XML_NODE_CDATA, ps->p + 8, end)) return 0;
+        ps->p = end + 3;
         return 1;
     }
 
-    if (**p == '>')
+    if (*ps->p == '?')
     {
-        (*p)++;
-        node_append_child(parent, elem);
-        if (!parse_node(p, elem)) return 0;
+        char *end = find_literal(ps->p + 1, ps->end, "?>", 2);
+        if (!end) return 0;
+        ps->p = end + 2;
         return 1;
     }
 
-    free_node(elem);
-    return 0;
-}
-
-static int parse_node(const char **p, xml_node_t *parent)
-{
-    while (**p)
-    {
-        skip_ws(p);
+    if (*ps->p == '!') return skip_declaration(ps);
 
-        if (**p == '<' && *(*p + 1) == '/')
-        {
-            *p += 2;
-            while (**p && **p != '>') (*p)++;
-            if (**p == '>') (*p)++;
-            return 1;
-        }
-        else if (**p == '<')
-        {
-            if (strncmp(*p, "<!--", 4) == 0)
-            {
-                const char *end = strstr(*p + 4, "-->");
-                if (!end) return 0;
-                char *txt = xstrndup(*p + 4, end - (*p + 4));
-                xml_node_t *n = node_new(XML_NODE_COMMENT);
-                if (!txt || !n)
-                {
-                    free(txt);
-                    free_node(n);
-                    return 0;
-                }
+    char *ename = parse_name(ps);
+    if (!ename) return 0;
 
-                n->text = txt;
-                node_append_child(parent, n);
-                *p = end + 3;
-            }
-            else if (strncmp(*p, "<![CDATA[", 9) == 0)
-            {
-                const char *end = strstr(*p + 9, "]]>");
-                if (!end) return 0;
-                char *txt = xstrndup(*p + 9, end - (*p + 9));
-                xml_node_t *n = node_new(XML_NODE_CDATA);
-                if (!txt || !n)
-                {
-                    free(txt);
-                    free_node(n);
-                    return 0;
-                }
+    xml_node_t *elem = node_new(ps, XML_NODE_ELEMENT);
+    if (!elem) return 0;
+    elem->name = ename;
 
-                n->text = txt;
-                node_append_child(parent, n);
-                *p = end + 3;
-            }
-            else if (strncmp(*p, "<?", 2) == 0)
-            {
-                const char *end = strstr(*p + 2, "?>");
-                if (!end) return 0;
-                *p = end + 2;
-            }
-            else
-            {
-                if (!parse_element(p, parent)) return 0;
-            }
-        }
-        else
-        {
-            const char *start = *p;
-            while (**p && **p != '<') (*p)++;
-            char *raw = xstrndup(start, *p - start);
-            if (!raw)
-            {
-                return 0;
-            }
+    int open = 0;
+    if (!parse_attributes(ps, elem, &open)) return 0;
 
-            int onlyws = 1;
-            for (char *t = raw; *t; t++)
-            {
-                if (!isspace((unsigned char)*t))
-                {
-                    onlyws = 0;
-                    break;
-                }
-            }
+    node_append_child(*current, elem);
+    if (open) *current = elem;
+    return 1;
+}
 
-            if (!onlyws)
-            {
-                xml_node_t *n = node_new(XML_NODE_TEXT);
-                if (!n)
-                {
-                    free(raw);
-                    return 0;
-                }
+static int parse_document(xml_parser_t *ps, xml_node_t *docroot)
+{
+    xml_node_t *current = docroot;
 
-                n->text = unescape_entities(raw);
-                if (!n->text)
-                {
-                    free_node(n);
-                    free(raw);
-                    return 0;
-                }
+    while (ps->p < ps->end)
+    {
+        skip_ws(ps);
+        if (ps->p >= ps->end) break;
 
-                node_append_child(parent, n);
-            }
-            free(raw);
+        if (*ps->p != '<')
+        {
+            char *start = ps->p;
+            char *lt = (char*)memchr(start, '<', (size_t)(ps->end - start));
+            char *stop = lt ? lt : ps->end;
+
+            /* The run starts at non whitespace, so it is never empty */
+            if (!add_text_node(ps, current, XML_NODE_TEXT, start, stop)) return 0;
+            if (!lt) break;
+            ps->p = lt;
         }
+
+        ps->p++;
+        if (!parse_markup(ps, &current)) return 0;
     }
     return 1;
 }
 
-/* ---------------- Public API ---------------- */
-
-xml_document_t *xml_parse_string(const char *input)
+static xml_document_t *xml_parse_buffer(char *input, size_t length)
 {
-    if (!input) return NULL;
-    const char *p = input;
-    xml_document_t *doc = (xml_document_t*)malloc(sizeof(xml_document_t));
-    if (!doc) return NULL;
-
-    doc->root = node_new(XML_NODE_DOCUMENT);
-    if (!doc->root)
+    xml_parser_t ps;
+    ps.p = input;
+    ps.end = input + length;
+    ps.names = NULL;
+    ps.names_capacity = 0;
+    ps.names_count = 0;
+    ps.node_count = 0;
+
+    /* Small documents start with a small first block */
+    ps.arena = arena_allocate(length < XML_ARENA_BLOCK_SIZE / 4 ? length * 4 : XML_ARENA_BLOCK_SIZE);
+    if (!ps.arena) return NULL;
+
+    xml_document_t *doc = (xml_document_t*)arena_alloc(ps.arena, sizeof(xml_document_t));
+    xml_node_t *docroot = node_new(&ps, XML_NODE_DOCUMENT);
+    int ok = doc && docroot && parse_document(&ps, docroot);
+    free(ps.names);
+
+    if (!ok)
     {
-        free(doc);
+        arena_release(ps.arena);
         return NULL;
     }
 
-    if (strncmp(p, "<?xml", 5) == 0)
-    {
-        const char *end = strstr(p, "?>");
-        if (end) p = end + 2;
-    }
-
-    if (!parse_node(&p, doc->root))
-    {
-        xml_free_document(doc);
-        return NULL;
-    }
+    doc->root = docroot;
+    doc->arena = ps.arena;
+    doc->owned_input = NULL;
     return doc;
 }
 
-static char *read_file_all(const char *path)
+/* ---------------- Public API ---------------- */
+
+xml_document_t *xml_parse_string(const char *input)
 {
-    FILE *f = fopen(path, "rb");
-    if (!f) return NULL;
+    if (!input) return NULL;
 
-    if (fseek(f, 0, SEEK_END) != 0)
-    {
-        fclose(f);
-        return NULL;
-    }
+    /* One copy of the input holds every text and attribute value */
+    size_t length = strlen(input);
+    char *copy = (char*)malloc(length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, input, length + 1);
 
-    long sz = ftell(f);
-    if (sz < 0)
-    {
-        fclose(f);
-        return NULL;
-    }
+    return xml_parse_insitu(copy, length, true);
+}
 
-    if (fseek(f, 0, SEEK_SET) != 0)
-    {
-        fclose(f);
-        return NULL;
-    }
+xml_document_t *xml_parse_insitu(char *input, size_t length, bool take_ownership)
+{
+    if (!input) return NULL;
 
-    char *buf = (char*)malloc(sz + 1);
-    if (!buf)
-    {
-        fclose(f);
-        return NULL;
-    }
+    xml_document_t *doc = xml_parse_buffer(input, length);
 
-    if (fread(buf, 1, sz, f) != (size_t)sz)
-    {
-        free(buf);
-        fclose(f);
-        return NULL;
-    }
+    if (doc && take_ownership) doc->owned_input = input;
+    else if (take_ownership) free(input);
 
-    buf[sz] = '\0';
-    fclose(f);
-    return buf;
+    return doc;
 }
 
 xml_document_t *xml_load_file(const char *path)
 {
-    char *s = read_file_all(path);
-    if (!s) return NULL;
-    xml_document_t *d = xml_parse_string(s);
-    free(s);
-    return d;
+    /* The mapping is read only; parse a private copy of it */
+    file_map_t *map = file_map_open(path);
+    if (!map) return NULL;
+
+    size_t length = file_map_get_size(map);
+    char *copy = (char*)malloc(length + 1);
+    if (copy) memcpy(copy, file_map_get_data(map), length + 1);
+    file_map_close(map);
+    if (!copy) return NULL;
+
+    return xml_parse_insitu(copy, length, true);
 }
 
 void xml_free_document(xml_document_t *doc)
 {
     if (!doc) return;
-    free_node(doc->root);
-    free(doc);
+    free(doc->owned_input);
+    arena_release(doc->arena);
+}
+
+xml_node_t *xml_document_root(xml_document_t *doc)
+{
+    return doc ? doc->root : NULL;
+}
+
+xml_node_t *xml_node_first_child(xml_node_t *node)
+{
+    return node ? node->firstChild : NULL;
+}
+
+xml_node_t *xml_node_next_sibling(xml_node_t *node)
+{
+    return node ? node->nextSibling : NULL;
 }
 
 xml_node_t *xml_node_first_child_element(xml_node_t *node, const char *name)
@@ -534,6 +696,21 @@ const char *xml_node_name(xml_node_t *node)
 const char *xml_node_get_attr(xml_node_t *node, const char *name)
 {
     if (!node || !name) return NULL;
+
+    if (node->attr_index)
+    {
+        xml_attribute_index_t *index = node->attr_index;
+        size_t len = strlen(name);
+        size_t slot = xml_hash_name(name, len) & index->mask;
+
+        while (index->slots[slot])
+        {
+            if (strcmp(index->slots[slot]->name, name) == 0) return index->slots[slot]->value;
+            slot = (slot + 1) & index->mask;
+        }
+        return NULL;
+    }
+
     xml_attribute_t *a = node->attr;
     while (a)
     {
@@ -558,6 +735,36 @@ const char *xml_node_get_text(xml_node_t *node)
     return NULL;
 }
 
+const char *xml_node_text(xml_node_t *node)
+{
+    return node ? node->text : NULL;
+}
+
+size_t xml_node_document_order(xml_node_t *node)
+{
+    return node ? node->order : 0;
+}
+
+xml_attribute_t *xml_node_first_attr(xml_node_t *node)
+{
+    return node ? node->attr : NULL;
+}
+
+xml_attribute_t *xml_attr_next(xml_attribute_t *attr)
+{
+    return attr ? attr->next : NULL;
+}
+
+const char *xml_attr_name(xml_attribute_t *attr)
+{
+    return attr ? attr->name : NULL;
+}
+
+const char *xml_attr_value(xml_attribute_t *attr)
+{
+    return attr ? attr->value : NULL;
+}
+
 static void print_indent(int d)
 {
     while (d--) putchar(' ');
@@ -0,0 +1,576 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "xmlpath.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define XML_PATH_MAX_PREDICATES 8
+#define XML_PATH_INLINE_SET 16
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef enum
+{
+    XML_PATH_CHILD,
+    XML_PATH_DESCENDANT,     /* Children of the context or of any node below it */
+    XML_PATH_SELF
+} xml_path_axis_t;
+
+typedef enum
+{
+    XML_PATH_POSITION,
+    XML_PATH_HAS_ATTR,
+    XML_PATH_ATTR_EQUALS,
+    XML_PATH_ATTR_DIFFERS,
+    XML_PATH_TEXT_EQUALS
+} xml_path_test_t;
+
+typedef struct xml_path_predicate_t
+{
+    xml_path_test_t test;
+    size_t position;
+    const char *name;
+    const char *value;
+} xml_path_predicate_t;
+
+typedef struct xml_path_step_t
+{
+    xml_path_axis_t axis;
+    const char *name;        /* NULL matches any element */
+    const xml_path_predicate_t *predicates;
+    size_t predicate_count;
+} xml_path_step_t;
+
+/* Steps, predicates and their text share the allocation of the path */
+struct xml_path_t
+{
+    bool absolute;
+    bool has_descendant;
+    size_t count;
+    xml_path_step_t *steps;
+};
+
+/* Node set of one evaluation step; small sets stay on the stack */
+typedef struct xml_path_set_t
+{
+    xml_node_t **nodes;
+    size_t count;
+    size_t capacity;
+    xml_node_t *inline_nodes[XML_PATH_INLINE_SET];
+} xml_path_set_t;
+
+/* ------------------------------------------------------------------------- */
+/* Compilation                                                               */
+/* ------------------------------------------------------------------------- */
+
+static bool xml_path_is_name_char(char c)
+{
+    unsigned char u = (unsigned char)c;
+
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') ||
+           u == '_' || u == ':' || u == '-' || u == '.' || u >= 0x80;
+}
+
+static const char *xml_path_skip_ws(const char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        s++;
+
+    return s;
+}
+
+/* Copies a name into the string pool; NULL if there is none */
+static const char *xml_path_parse_name(const char **s, char **pool)
+{
+    const char *start = *s;
+    char *name = *pool;
+
+    if ((*start >= '0' && *start <= '9') || *start == '-' || *start == '.')
+        return NULL;
+
+    while (xml_path_is_name_char(**s))
+        (*s)++;
+
+    size_t len = (size_t)(*s - start);
+    if (len == 0)
+        return NULL;
+
+    memcpy(name, start, len);
+    name[len] = '\0';
+    *pool += len + 1;
+    return name;
+}
+
+static const char *xml_path_parse_literal(const char **s, char **pool)
+{
+    char quote = **s;
+
+    if (quote != '\'' && quote != '"')
+        return NULL;
+
+    const char *start = *s + 1;
+    const char *end = strchr(start, quote);
+    if (!end)
+        return NULL;
+
+    size_t len = (size_t)(end - start);
+    char *value = *pool;
+    memcpy(value, start, len);
+    value[len] = '\0';
+    *pool += len + 1;
+    *s = end + 1;
+    return value;
+}
+
+static bool xml_path_parse_predicate(const char **s, xml_path_predicate_t *pred, char **pool)
+{
+    const char *p = xml_path_skip_ws(*s + 1);
+
+    memset(pred, 0, sizeof(*pred));
+
+    if (*p >= '0' && *p <= '9')
+    {
+        size_t value = 0;
+
+        for (; *p >= '0' && *p <= '9'; p++)
+        {
+            size_t digit = (size_t)(*p - '0');
+
+            if (value > (SIZE_MAX - digit) / 10)
+                return false;
+
+            value = value * 10 + digit;
+        }
+
+        if (value == 0)
+            return false;
+
+        pred->test = XML_PATH_POSITION;
+        pred->position = value;
+    }
+    else if (*p == '@')
+    {
+        p++;
+        pred->name = xml_path_parse_name(&p, pool);
+        if (!pred->name)
+            return false;
+
+        p = xml_path_skip_ws(p);
+        pred->test = XML_PATH_HAS_ATTR;
+
+        if (*p == '=' || (p[0] == '!' && p[1] == '='))
+        {
+            pred->test = *p == '=' ? XML_PATH_ATTR_EQUALS : XML_PATH_ATTR_DIFFERS;
+            p = xml_path_skip_ws(p + (*p == '=' ? 1 : 2));
+            pred->value = xml_path_parse_literal(&p, pool);
+            if (!pred->value)
+                return false;
+        }
+    }
+    else if (strncmp(p, "text()", 6) == 0)
+    {
+        p = xml_path_skip_ws(p + 6);
+        if (*p != '=')
+            return false;
+
+        p = xml_path_skip_ws(p + 1);
+        pred->test = XML_PATH_TEXT_EQUALS;
+        pred->value = xml_path_parse_literal(&p, pool);
+        if (!pred->value)
+            return false;
+    }
+    else
+    {
+        return false;
+    }
+
+    p = xml_path_skip_ws(p);
+    if (*p != ']')
+        return false;
+
+    *s = p + 1;
+    return true;
+}
+
+xml_path_t *xml_path_compile(const char *expression)
+{
+    if (!expression || !*expression)
+        return NULL;
+
+    size_t len = strlen(expression);
+    size_t max_steps = 1;
+    size_t max_predicates = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (expression[i] == '/')
+            max_steps++;
+        else if (expression[i] == '[')
+            max_predicates++;
+    }
+
+    /* Every name or literal is shorter than its source plus a terminator */
+    xml_path_t *path = (xml_path_t *)malloc(sizeof(xml_path_t) + max_steps * sizeof(xml_path_step_t) +
+                                            max_predicates * sizeof(xml_path_predicate_t) + len * 2 + 2);
+    if (!path)
+        return NULL;
+
+    path->steps = (xml_path_step_t *)(path + 1);
+    xml_path_predicate_t *predicates = (xml_path_predicate_t *)(path->steps + max_steps);
+    char *pool = (char *)(predicates + max_predicates);
+
+    const char *s = expression;
+    xml_path_axis_t axis = XML_PATH_CHILD;
+
+    path->absolute = *s == '/';
+    path->has_descendant = false;
+    path->count = 0;
+
+    if (path->absolute)
+    {
+        axis = s[1] == '/' ? XML_PATH_DESCENDANT : XML_PATH_CHILD;
+        s += axis == XML_PATH_DESCENDANT ? 2 : 1;
+
+        /* "/" alone selects the document node */
+        if (!*s && axis == XML_PATH_CHILD)
+            return path;
+    }
+
+    for (;;)
+    {
+        xml_path_step_t *step = &path->steps[path->count++];
+
+        step->axis = axis;
+        step->name = NULL;
+        step->predicates = predicates;
+        step->predicate_count = 0;
+
+        if (axis == XML_PATH_DESCENDANT)
+            path->has_descendant = true;
+
+        if (s[0] == '.' && (s[1] == '/' || !s[1]))
+        {
+            if (axis != XML_PATH_CHILD)
+                break;
+
+            step->axis = XML_PATH_SELF;
+            s++;
+        }
+        else if (*s == '*')
+        {
+            s++;
+        }
+        else if (!(step->name = xml_path_parse_name(&s, &pool)))
+        {
+            break;
+        }
+
+        while (*s == '[' && step->axis != XML_PATH_SELF)
+        {
+            if (step->predicate_count == XML_PATH_MAX_PREDICATES || !xml_path_parse_predicate(&s, predicates, &pool))
+                break;
+
+            predicates++;
+            step->predicate_count++;
+        }
+
+        if (!*s)
+            return path;
+
+        if (*s != '/')
+            break;
+
+        axis = s[1] == '/' ? XML_PATH_DESCENDANT : XML_PATH_CHILD;
+        s += axis == XML_PATH_DESCENDANT ? 2 : 1;
+    }
+
+    free(path);
+    return NULL;
+}
+
+void xml_path_free(xml_path_t *path)
+{
+    free(path);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Evaluation                                                                */
+/* ------------------------------------------------------------------------- */
+
+static void xml_path_set_init(xml_path_set_t *set)
+{
+    set->nodes = set->inline_nodes;
+    set->count = 0;
+    set->capacity = XML_PATH_INLINE_SET;
+}
+
+static void xml_path_set_release(xml_path_set_t *set)
+{
+    if (set->nodes != set->inline_nodes)
+        free(set->nodes);
+}
+
+static bool xml_path_set_push(xml_path_set_t *set, xml_node_t *node)
+{
+    if (set->count == set->capacity)
+    {
+        size_t capacity = set->capacity * 2;
+        xml_node_t **nodes = (xml_node_t **)malloc(capacity * sizeof(xml_node_t *));
+        if (!nodes)
+            return false;
+
+        memcpy(nodes, set->nodes, set->count * sizeof(xml_node_t *));
+        xml_path_set_release(set);
+        set->nodes = nodes;
+        set->capacity = capacity;
+    }
+
+    set->nodes[set->count++] = node;
+    return true;
+}
+
+static int xml_path_compare_order(const void *a, const void *b)
+{
+    size_t x = xml_node_document_order(*(xml_node_t *const *)a);
+    size_t y = xml_node_document_order(*(xml_node_t *const *)b);
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* Restores document order and drops duplicates */
+static void xml_path_set_normalize(xml_path_set_t *set)
+{
+    size_t i = 1;
+
+    /* Usually the set is in order already */
+    while (i < set->count && xml_node_document_order(set->nodes[i - 1]) < xml_node_document_order(set->nodes[i]))
+        i++;
+
+    if (i >= set->count)
+        return;
+
+    qsort(set->nodes, set->count, sizeof(xml_node_t *), xml_path_compare_order);
+
+    size_t kept = 1;
+
+    for (size_t i = 1; i < set->count; i++)
+    {
+        if (set->nodes[i] != set->nodes[kept - 1])
+            set->nodes[kept++] = set->nodes[i];
+    }
+
+    set->count = kept;
+}
+
+static bool xml_path_test(const xml_path_predicate_t *pred, xml_node_t *node, size_t *counter)
+{
+    const char *value;
+
+    switch (pred->test)
+    {
+        case XML_PATH_POSITION:
+            return ++*counter == pred->position;
+
+        case XML_PATH_HAS_ATTR:
+            return xml_node_get_attr(node, pred->name) != NULL;
+
+        case XML_PATH_ATTR_EQUALS:
+            value = xml_node_get_attr(node, pred->name);
+            return value && strcmp(value, pred->value) == 0;
+
+        case XML_PATH_ATTR_DIFFERS:
+            value = xml_node_get_attr(node, pred->name);
+            return value && strcmp(value, pred->value) != 0;
+
+        case XML_PATH_TEXT_EQUALS:
+            value = xml_node_get_text(node);
+            return value && strcmp(value, pred->value) == 0;
+    }
+
+    return false;
+}
+
+/* Appends the matching children of 'parent'; stops once 'out' holds 'limit' */
+static bool xml_path_children(const xml_path_step_t *step, xml_node_t *parent, xml_path_set_t *out, size_t limit)
+{
+    size_t counters[XML_PATH_MAX_PREDICATES] = { 0 };
+
+    for (xml_node_t *c = xml_node_first_child_element(parent, step->name); c; c = xml_node_next_sibling_element(c, step->name))
+    {
+        size_t k = 0;
+
+        while (k < step->predicate_count && xml_path_test(&step->predicates[k], c, &counters[k]))
+            k++;
+
+        if (k < step->predicate_count)
+            continue;
+
+        if (!xml_path_set_push(out, c))
+            return false;
+
+        if (out->count >= limit)
+            return true;
+    }
+
+    return true;
+}
+
+static bool xml_path_has_position(const xml_path_step_t *step)
+{
+    for (size_t k = 0; k < step->predicate_count; k++)
+    {
+        if (step->predicates[k].test == XML_PATH_POSITION)
+            return true;
+    }
+
+    return false;
+}
+
+static bool xml_path_descendants(const xml_path_step_t *step, xml_node_t *top, xml_path_set_t *out)
+{
+    /* Positions count per parent, so those steps run once for every
+       parent; all others test each element once, in document order */
+    bool per_parent = xml_path_has_position(step);
+    xml_node_t *cur = top;
+
+    for (;;)
+    {
+        if (per_parent && !xml_path_children(step, cur, out, SIZE_MAX))
+            return false;
+
+        if (!per_parent && cur != top && (!step->name || strcmp(xml_node_name(cur), step->name) == 0))
+        {
+            size_t k = 0;
+
+            while (k < step->predicate_count && xml_path_test(&step->predicates[k], cur, NULL))
+                k++;
+
+            if (k == step->predicate_count && !xml_path_set_push(out, cur))
+                return false;
+        }
+
+        xml_node_t *next = xml_node_first_child_element(cur, NULL);
+
+        while (!next)
+        {
+            if (cur == top)
+                return true;
+
+            next = xml_node_next_sibling_element(cur, NULL);
+            cur = xml_node_parent(cur);
+        }
+
+        cur = next;
+    }
+}
+
+/* Returns the total number of matches, or SIZE_MAX when out of memory */
+static size_t xml_path_evaluate(const xml_path_t *path, xml_node_t *node, xml_node_t **results, size_t max, bool first_only)
+{
+    xml_path_set_t sets[2];
+    xml_path_set_t *cur = &sets[0];
+    xml_path_set_t *next = &sets[1];
+    bool nested = false;
+    bool ok = true;
+
+    if (path->absolute)
+    {
+        while (xml_node_parent(node))
+            node = xml_node_parent(node);
+    }
+
+    xml_path_set_init(cur);
+    xml_path_set_init(next);
+    cur->nodes[cur->count++] = node;
+
+    for (size_t i = 0; i < path->count && ok && cur->count > 0; i++)
+    {
+        const xml_path_step_t *step = &path->steps[i];
+
+        if (step->axis == XML_PATH_SELF)
+            continue;
+
+        /* Without descendant steps the contexts are disjoint siblings, so
+           the first match found is the first in document order */
+        size_t limit = first_only && !path->has_descendant && i + 1 == path->count ? 1 : SIZE_MAX;
+
+        next->count = 0;
+
+        for (size_t c = 0; c < cur->count && ok && next->count < limit; c++)
+        {
+            if (step->axis == XML_PATH_DESCENDANT)
+                ok = xml_path_descendants(step, cur->nodes[c], next);
+            else
+                ok = xml_path_children(step, cur->nodes[c], next, limit);
+        }
+
+        if (step->axis == XML_PATH_DESCENDANT)
+            nested = true;
+
+        if (nested)
+            xml_path_set_normalize(next);
+
+        xml_path_set_t *swap = cur;
+        cur = next;
+        next = swap;
+    }
+
+    size_t count = ok ? cur->count : SIZE_MAX;
+
+    if (ok && max > 0)
+        memcpy(results, cur->nodes, (count < max ? count : max) * sizeof(xml_node_t *));
+
+    xml_path_set_release(&sets[0]);
+    xml_path_set_release(&sets[1]);
+    return count;
+}
+
+xml_node_t *xml_path_find(const xml_path_t *path, xml_node_t *node)
+{
+    if (!path || !node)
+        return NULL;
+
+    xml_node_t *result = NULL;
+    size_t count = xml_path_evaluate(path, node, &result, 1, true);
+
+    return count == SIZE_MAX ? NULL : result;
+}
+
+size_t xml_path_find_all(const xml_path_t *path, xml_node_t *node, xml_node_t **results, size_t max)
+{
+    if (!path || !node)
+        return 0;
+
+    size_t count = xml_path_evaluate(path, node, results, results ? max : 0, false);
+
+    return count == SIZE_MAX ? 0 : count;
+}
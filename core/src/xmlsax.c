@@ -0,0 +1,1080 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "xmlsax.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define XML_SAX_MAX_DEPTH 1024
+#define XML_SAX_TOKEN_SIZE 256
+#define XML_SAX_FRAGMENT_SIZE (16 * 1024)
+#define XML_SAX_ENTITY_SIZE 12
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef enum
+{
+    XML_SAX_STATE_TEXT,             /* Character data between markup */
+    XML_SAX_STATE_ENTITY,           /* After '&' in character data */
+    XML_SAX_STATE_MARKUP,           /* After '<', kind not known yet */
+    XML_SAX_STATE_TAG,              /* Start or end tag spanning chunks */
+    XML_SAX_STATE_SECTION,          /* Comment, CDATA or processing instruction */
+    XML_SAX_STATE_DECL              /* <!DOCTYPE ...> and other declarations, skipped */
+} xml_sax_state_t;
+
+typedef enum
+{
+    XML_SAX_SECTION_COMMENT,
+    XML_SAX_SECTION_CDATA,
+    XML_SAX_SECTION_PI
+} xml_sax_section_t;
+
+static const char *const xml_sax_terminators[] = { "-->", "]]>", "?>" };
+static const char xml_sax_bom[] = "\xEF\xBB\xBF";
+
+struct xml_sax_parser_t
+{
+    xml_sax_handler_t handler;
+    void *context;
+
+    xml_sax_status_t status;
+    xml_sax_state_t state;
+    size_t offset;
+    size_t bom;                     /* Byte order mark bytes checked */
+    bool root_closed;
+
+    /* Character data, tags and sections that span chunks */
+    char *token;
+    size_t token_len;
+    size_t token_capacity;
+
+    bool run_content;               /* Current text run has non whitespace */
+    bool run_reported;              /* Part of the current text run or section was reported */
+
+    char entity[XML_SAX_ENTITY_SIZE];
+    size_t entity_len;
+    char quote;                     /* Open quote inside a tag or declaration */
+    int decl_depth;                 /* '[' nesting inside a declaration */
+    xml_sax_section_t section;
+    size_t matched;                 /* Terminator characters seen at the end of a section */
+
+    /* Names of the open elements, back to back */
+    char *names;
+    size_t names_len;
+    size_t names_capacity;
+    size_t depth;
+    size_t name_offsets[XML_SAX_MAX_DEPTH];
+
+    xml_sax_attribute_t *attrs;
+    size_t attr_capacity;
+    char *scratch;                  /* Decoded attribute values */
+    size_t scratch_capacity;
+};
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static const char *xml_sax_fail(xml_sax_parser_t *p, const char *s)
+{
+    p->status = XML_SAX_ERROR;
+    return s;
+}
+
+static bool xml_sax_check(xml_sax_parser_t *p, bool keep_going)
+{
+    if (!keep_going)
+        p->status = XML_SAX_ABORTED;
+
+    return keep_going;
+}
+
+static bool xml_sax_reserve(xml_sax_parser_t *p, char **buf, size_t *capacity, size_t need)
+{
+    if (need <= *capacity)
+        return true;
+
+    size_t cap = *capacity ? *capacity : XML_SAX_TOKEN_SIZE;
+
+    while (cap < need)
+        cap *= 2;
+
+    char *grown = (char *)realloc(*buf, cap);
+    if (!grown)
+    {
+        p->status = XML_SAX_ERROR;
+        return false;
+    }
+
+    *buf = grown;
+    *capacity = cap;
+    return true;
+}
+
+static bool xml_sax_token_append(xml_sax_parser_t *p, const char *data, size_t len)
+{
+    if (len == 0)
+        return true;
+
+    if (!xml_sax_reserve(p, &p->token, &p->token_capacity, p->token_len + len))
+        return false;
+
+    memcpy(p->token + p->token_len, data, len);
+    p->token_len += len;
+    return true;
+}
+
+static bool xml_sax_is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Same set as xml.c, plus any UTF-8 byte */
+static bool xml_sax_is_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == ':' || c == '-' || c == '.' || (unsigned char)c >= 0x80;
+}
+
+static bool xml_sax_has_content(const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!xml_sax_is_ws(s[i]))
+            return true;
+    }
+
+    return false;
+}
+
+static size_t xml_sax_utf8(unsigned long code, char *out)
+{
+    if (code <= 0x7F)
+    {
+        out[0] = (char)code;
+        return 1;
+    }
+
+    if (code <= 0x7FF)
+    {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+
+    if (code <= 0xFFFF)
+    {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+/* Decodes the entity 'name' (between '&' and ';') into at most 4 bytes of
+   'out'; returns 0 for an unknown or invalid reference */
+static size_t xml_sax_decode_entity(const char *name, size_t len, char *out)
+{
+    if (len == 2 && memcmp(name, "lt", 2) == 0) { out[0] = '<'; return 1; }
+    if (len == 2 && memcmp(name, "gt", 2) == 0) { out[0] = '>'; return 1; }
+    if (len == 3 && memcmp(name, "amp", 3) == 0) { out[0] = '&'; return 1; }
+    if (len == 4 && memcmp(name, "quot", 4) == 0) { out[0] = '"'; return 1; }
+    if (len == 4 && memcmp(name, "apos", 4) == 0) { out[0] = '\''; return 1; }
+
+    if (len < 2 || name[0] != '#')
+        return 0;
+
+    unsigned long code = 0;
+    size_t i = 1;
+    bool hex = name[1] == 'x';
+
+    if (hex)
+        i++;
+
+    if (i == len)
+        return 0;
+
+    for (; i < len; i++)
+    {
+        char c = name[i];
+        unsigned long digit;
+
+        if (c >= '0' && c <= '9')
+            digit = (unsigned long)(c - '0');
+        else if (hex && c >= 'a' && c <= 'f')
+            digit = (unsigned long)(c - 'a' + 10);
+        else if (hex && c >= 'A' && c <= 'F')
+            digit = (unsigned long)(c - 'A' + 10);
+        else
+            return 0;
+
+        code = code * (hex ? 16 : 10) + digit;
+        if (code > 0x10FFFF)
+            return 0;
+    }
+
+    if (code == 0 || (code >= 0xD800 && code <= 0xDFFF))
+        return 0;
+
+    return xml_sax_utf8(code, out);
+}
+
+/* Decodes entities of a complete string; the output is never longer */
+static size_t xml_sax_decode(const char *s, size_t len, char *out)
+{
+    size_t o = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (s[i] == '&')
+        {
+            size_t limit = len - i - 1 < XML_SAX_ENTITY_SIZE + 1 ? len - i - 1 : XML_SAX_ENTITY_SIZE + 1;
+            const char *semi = (const char *)memchr(s + i + 1, ';', limit);
+
+            if (semi)
+            {
+                size_t n = xml_sax_decode_entity(s + i + 1, (size_t)(semi - s - i - 1), out + o);
+                if (n)
+                {
+                    o += n;
+                    i = (size_t)(semi - s);
+                    continue;
+                }
+            }
+        }
+
+        out[o++] = s[i];
+    }
+
+    return o;
+}
+
+static const char *xml_sax_find(const char *s, const char *end, const char *term, size_t term_len)
+{
+    while (s < end)
+    {
+        const char *hit = (const char *)memchr(s, term[0], (size_t)(end - s));
+
+        if (!hit || (size_t)(end - hit) < term_len)
+            return NULL;
+
+        if (memcmp(hit, term, term_len) == 0)
+            return hit;
+
+        s = hit + 1;
+    }
+
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Character data                                                            */
+/* ------------------------------------------------------------------------- */
+
+static bool xml_sax_emit_text(xml_sax_parser_t *p, const char *text, size_t len)
+{
+    p->run_reported = true;
+
+    if (!p->handler.on_text)
+        return true;
+
+    return xml_sax_check(p, p->handler.on_text(p->context, text, len));
+}
+
+static bool xml_sax_text_append(xml_sax_parser_t *p, const char *data, size_t len)
+{
+    if (!p->run_content && xml_sax_has_content(data, len))
+    {
+        /* Only whitespace may surround the root element */
+        if (p->depth == 0)
+        {
+            p->status = XML_SAX_ERROR;
+            return false;
+        }
+
+        p->run_content = true;
+    }
+
+    if (!xml_sax_token_append(p, data, len))
+        return false;
+
+    if (p->token_len < XML_SAX_FRAGMENT_SIZE)
+        return true;
+
+    /* Report long text in parts; leading whitespace alone is dropped */
+    bool keep_going = true;
+
+    if (p->run_content)
+        keep_going = xml_sax_emit_text(p, p->token, p->token_len);
+
+    p->token_len = 0;
+    return keep_going;
+}
+
+static bool xml_sax_end_text(xml_sax_parser_t *p)
+{
+    bool keep_going = true;
+
+    if (p->token_len && (p->run_content || p->run_reported))
+        keep_going = xml_sax_emit_text(p, p->token, p->token_len);
+
+    p->token_len = 0;
+    p->run_content = false;
+    p->run_reported = false;
+    return keep_going;
+}
+
+static const char *xml_sax_scan_text(xml_sax_parser_t *p, const char *s, const char *end)
+{
+    const char *start = s;
+
+    while (s < end && *s != '<' && *s != '&')
+        s++;
+
+    if (s < end && *s == '<' && p->token_len == 0)
+    {
+        /* The rest of the run is in this chunk: report it in place */
+        size_t len = (size_t)(s - start);
+        bool content = p->run_content || xml_sax_has_content(start, len);
+
+        if (content && p->depth == 0)
+            return xml_sax_fail(p, start);
+
+        if (len && (content || p->run_reported) && !xml_sax_emit_text(p, start, len))
+            return s;
+
+        p->run_content = false;
+        p->run_reported = false;
+    }
+    else
+    {
+        if (!xml_sax_text_append(p, start, (size_t)(s - start)))
+            return s;
+
+        if (s < end && *s == '<' && !xml_sax_end_text(p))
+            return s;
+    }
+
+    if (s == end)
+        return s;
+
+    if (*s == '&')
+    {
+        p->state = XML_SAX_STATE_ENTITY;
+        p->entity_len = 0;
+    }
+    else
+    {
+        p->state = XML_SAX_STATE_MARKUP;
+    }
+
+    return s + 1;
+}
+
+/* Text that only looked like an entity is kept as written */
+static bool xml_sax_entity_literal(xml_sax_parser_t *p)
+{
+    p->state = XML_SAX_STATE_TEXT;
+    return xml_sax_text_append(p, "&", 1) && xml_sax_text_append(p, p->entity, p->entity_len);
+}
+
+static const char *xml_sax_scan_entity(xml_sax_parser_t *p, const char *s, const char *end)
+{
+    while (s < end)
+    {
+        char c = *s;
+
+        if (c == ';')
+        {
+            char out[4];
+            size_t n = xml_sax_decode_entity(p->entity, p->entity_len, out);
+
+            if (n)
+            {
+                p->state = XML_SAX_STATE_TEXT;
+                xml_sax_text_append(p, out, n);
+            }
+            else if (xml_sax_entity_literal(p))
+            {
+                xml_sax_text_append(p, ";", 1);
+            }
+
+            return s + 1;
+        }
+
+        if ((!isalnum((unsigned char)c) && c != '#') || p->entity_len == XML_SAX_ENTITY_SIZE)
+        {
+            xml_sax_entity_literal(p);
+            return s;
+        }
+
+        p->entity[p->entity_len++] = c;
+        s++;
+    }
+
+    return s;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Tags                                                                      */
+/* ------------------------------------------------------------------------- */
+
+static bool xml_sax_end_tag(xml_sax_parser_t *p, const char *t, size_t len)
+{
+    size_t i = 1;
+
+    while (i < len && xml_sax_is_name_char(t[i]))
+        i++;
+
+    size_t name_len = i - 1;
+
+    while (i < len && xml_sax_is_ws(t[i]))
+        i++;
+
+    if (name_len == 0 || i != len || p->depth == 0)
+        return false;
+
+    size_t open = p->name_offsets[p->depth - 1];
+
+    if (p->names_len - open != name_len || memcmp(p->names + open, t + 1, name_len) != 0)
+        return false;
+
+    p->depth--;
+    p->names_len = open;
+
+    if (p->depth == 0)
+        p->root_closed = true;
+
+    if (!p->handler.on_end_element)
+        return true;
+
+    return xml_sax_check(p, p->handler.on_end_element(p->context, t + 1, name_len));
+}
+
+static bool xml_sax_start_tag(xml_sax_parser_t *p, const char *t, size_t len)
+{
+    size_t i = 0;
+    size_t count = 0;
+    size_t used = 0;
+    bool empty = false;
+
+    if (p->depth == 0 && p->root_closed)
+        return false;
+
+    while (i < len && xml_sax_is_name_char(t[i]))
+        i++;
+
+    size_t name_len = i;
+    if (name_len == 0)
+        return false;
+
+    /* Decoded values are never longer than the tag */
+    if (!xml_sax_reserve(p, &p->scratch, &p->scratch_capacity, len))
+        return false;
+
+    for (;;)
+    {
+        size_t ws = i;
+
+        while (i < len && xml_sax_is_ws(t[i]))
+            i++;
+
+        if (i == len)
+            break;
+
+        if (t[i] == '/')
+        {
+            if (i + 1 != len)
+                return false;
+
+            empty = true;
+            break;
+        }
+
+        /* Attributes are separated by whitespace */
+        if (ws == i)
+            return false;
+
+        size_t name_start = i;
+
+        while (i < len && xml_sax_is_name_char(t[i]))
+            i++;
+
+        size_t attr_name_len = i - name_start;
+
+        while (i < len && xml_sax_is_ws(t[i]))
+            i++;
+
+        if (attr_name_len == 0 || i == len || t[i] != '=')
+            return false;
+
+        i++;
+
+        while (i < len && xml_sax_is_ws(t[i]))
+            i++;
+
+        if (i == len || (t[i] != '"' && t[i] != '\''))
+            return false;
+
+        const char *value = t + i + 1;
+        const char *close = (const char *)memchr(value, t[i], len - i - 1);
+        if (!close)
+            return false;
+
+        size_t value_len = (size_t)(close - value);
+        i = (size_t)(close - t) + 1;
+
+        if (count == p->attr_capacity)
+        {
+            size_t cap = p->attr_capacity ? p->attr_capacity * 2 : 8;
+            xml_sax_attribute_t *attrs = (xml_sax_attribute_t *)realloc(p->attrs, cap * sizeof(xml_sax_attribute_t));
+            if (!attrs)
+                return false;
+
+            p->attrs = attrs;
+            p->attr_capacity = cap;
+        }
+
+        xml_sax_attribute_t *attr = &p->attrs[count++];
+        attr->name = t + name_start;
+        attr->name_len = attr_name_len;
+
+        if (memchr(value, '&', value_len))
+        {
+            attr->value = p->scratch + used;
+            attr->value_len = xml_sax_decode(value, value_len, p->scratch + used);
+            used += attr->value_len;
+        }
+        else
+        {
+            attr->value = value;
+            attr->value_len = value_len;
+        }
+    }
+
+    if (!empty)
+    {
+        if (p->depth == XML_SAX_MAX_DEPTH)
+            return false;
+
+        if (!xml_sax_reserve(p, &p->names, &p->names_capacity, p->names_len + name_len))
+            return false;
+
+        p->name_offsets[p->depth++] = p->names_len;
+        memcpy(p->names + p->names_len, t, name_len);
+        p->names_len += name_len;
+    }
+
+    if (p->handler.on_start_element &&
+        !xml_sax_check(p, p->handler.on_start_element(p->context, t, name_len, p->attrs, count)))
+        return false;
+
+    if (!empty)
+        return true;
+
+    if (p->depth == 0)
+        p->root_closed = true;
+
+    if (!p->handler.on_end_element)
+        return true;
+
+    return xml_sax_check(p, p->handler.on_end_element(p->context, t, name_len));
+}
+
+/* 't' is the tag without its angle brackets */
+static bool xml_sax_tag(xml_sax_parser_t *p, const char *t, size_t len)
+{
+    bool ok = t[0] == '/' ? xml_sax_end_tag(p, t, len) : xml_sax_start_tag(p, t, len);
+
+    if (!ok && p->status == XML_SAX_OK)
+        p->status = XML_SAX_ERROR;
+
+    p->state = XML_SAX_STATE_TEXT;
+    return ok;
+}
+
+/* Finds the closing '>' outside quoted values, tracking the open quote */
+static const char *xml_sax_tag_end(const char *s, const char *end, char *quote)
+{
+    char q = *quote;
+
+    for (; s < end; s++)
+    {
+        char c = *s;
+
+        if (q)
+        {
+            if (c == q)
+                q = 0;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            q = c;
+        }
+        else if (c == '>')
+        {
+            *quote = 0;
+            return s;
+        }
+    }
+
+    *quote = q;
+    return NULL;
+}
+
+static const char *xml_sax_scan_tag(xml_sax_parser_t *p, const char *s, const char *end)
+{
+    const char *gt = xml_sax_tag_end(s, end, &p->quote);
+
+    if (!xml_sax_token_append(p, s, (size_t)((gt ? gt : end) - s)))
+        return s;
+
+    if (!gt)
+        return end;
+
+    size_t len = p->token_len;
+    p->token_len = 0;
+    xml_sax_tag(p, p->token, len);
+    return p->status == XML_SAX_OK ? gt + 1 : gt;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Comments, CDATA, processing instructions and declarations                */
+/* ------------------------------------------------------------------------- */
+
+static void xml_sax_start_section(xml_sax_parser_t *p, xml_sax_section_t section)
+{
+    p->state = XML_SAX_STATE_SECTION;
+    p->section = section;
+    p->matched = 0;
+    p->token_len = 0;
+    p->run_reported = false;
+}
+
+static bool xml_sax_emit_section(xml_sax_parser_t *p, const char *text, size_t len)
+{
+    bool (*callback)(void *, const char *, size_t) = NULL;
+
+    switch (p->section)
+    {
+        case XML_SAX_SECTION_COMMENT: callback = p->handler.on_comment; break;
+        case XML_SAX_SECTION_CDATA: callback = p->handler.on_cdata; break;
+        default: callback = p->handler.on_processing_instruction; break;
+    }
+
+    p->run_reported = true;
+
+    if (!callback)
+        return true;
+
+    return xml_sax_check(p, callback(p->context, text, len));
+}
+
+static bool xml_sax_section_append(xml_sax_parser_t *p, const char *data, size_t len)
+{
+    if (!xml_sax_token_append(p, data, len))
+        return false;
+
+    if (p->token_len < XML_SAX_FRAGMENT_SIZE)
+        return true;
+
+    size_t n = p->token_len;
+    p->token_len = 0;
+    return xml_sax_emit_section(p, p->token, n);
+}
+
+static bool xml_sax_end_section(xml_sax_parser_t *p)
+{
+    bool keep_going = true;
+
+    /* An empty section is still reported once */
+    if (p->token_len || !p->run_reported)
+        keep_going = xml_sax_emit_section(p, p->token, p->token_len);
+
+    p->token_len = 0;
+    p->run_reported = false;
+    p->state = XML_SAX_STATE_TEXT;
+    return keep_going;
+}
+
+static const char *xml_sax_scan_section(xml_sax_parser_t *p, const char *s, const char *end)
+{
+    const char *term = xml_sax_terminators[p->section];
+    size_t term_len = strlen(term);
+
+    /* The whole section is in this chunk: report it in place */
+    if (p->token_len == 0 && p->matched == 0 && !p->run_reported)
+    {
+        const char *hit = xml_sax_find(s, end, term, term_len);
+
+        if (hit)
+        {
+            xml_sax_emit_section(p, s, (size_t)(hit - s));
+            p->run_reported = false;
+            p->state = XML_SAX_STATE_TEXT;
+            return hit + term_len;
+        }
+    }
+
+    while (s < end && p->status == XML_SAX_OK)
+    {
+        char c = *s;
+
+        if (c == term[p->matched])
+        {
+            s++;
+
+            if (++p->matched == term_len)
+            {
+                xml_sax_end_section(p);
+                return s;
+            }
+
+            continue;
+        }
+
+        if (p->matched)
+        {
+            /* "]]]>": the extra bracket is content, the terminator is still open */
+            if (c == term[0] && p->matched == term_len - 1)
+            {
+                xml_sax_section_append(p, term, 1);
+                s++;
+                continue;
+            }
+
+            xml_sax_section_append(p, term, p->matched);
+            p->matched = 0;
+            continue;
+        }
+
+        const char *next = (const char *)memchr(s, term[0], (size_t)(end - s));
+        if (!next)
+            next = end;
+
+        xml_sax_section_append(p, s, (size_t)(next - s));
+        s = next;
+    }
+
+    return s;
+}
+
+static const char *xml_sax_scan_decl(xml_sax_parser_t *p, const char *s, const char *end)
+{
+    for (; s < end; s++)
+    {
+        char c = *s;
+
+        if (p->quote)
+        {
+            if (c == p->quote)
+                p->quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            p->quote = c;
+        }
+        else if (c == '[')
+        {
+            p->decl_depth++;
+        }
+        else if (c == ']' && p->decl_depth > 0)
+        {
+            p->decl_depth--;
+        }
+        else if (c == '>' && p->decl_depth == 0)
+        {
+            p->state = XML_SAX_STATE_TEXT;
+            return s + 1;
+        }
+    }
+
+    return s;
+}
+
+static bool xml_sax_is_prefix(const char *s, size_t len, const char *of)
+{
+    size_t of_len = strlen(of);
+    return len <= of_len && memcmp(s, of, len) == 0;
+}
+
+static const char *xml_sax_scan_markup(xml_sax_parser_t *p, const char *s, const char *end)
+{
+    if (p->token_len == 0)
+    {
+        char c = *s;
+
+        if (c == '?')
+        {
+            xml_sax_start_section(p, XML_SAX_SECTION_PI);
+            return s + 1;
+        }
+
+        if (c != '!')
+        {
+            if (c != '/' && !xml_sax_is_name_char(c))
+                return xml_sax_fail(p, s);
+
+            /* The whole tag is in this chunk: parse it in place */
+            p->quote = 0;
+            const char *gt = xml_sax_tag_end(s, end, &p->quote);
+
+            if (gt)
+            {
+                xml_sax_tag(p, s, (size_t)(gt - s));
+                return p->status == XML_SAX_OK ? gt + 1 : gt;
+            }
+
+            p->state = XML_SAX_STATE_TAG;
+            xml_sax_token_append(p, s, (size_t)(end - s));
+            return end;
+        }
+    }
+
+    /* "<!" forms, the prefix may span chunks */
+    while (s < end)
+    {
+        char prefix[9];
+        if (p->token_len)
+            memcpy(prefix, p->token, p->token_len);
+        prefix[p->token_len] = *s;
+
+        if (!xml_sax_is_prefix(prefix, p->token_len + 1, "!--") &&
+            !xml_sax_is_prefix(prefix, p->token_len + 1, "![CDATA["))
+        {
+            p->token_len = 0;
+            p->state = XML_SAX_STATE_DECL;
+            p->quote = 0;
+            p->decl_depth = 0;
+            return s;
+        }
+
+        xml_sax_token_append(p, s, 1);
+        s++;
+
+        if (p->token_len == 3 && memcmp(p->token, "!--", 3) == 0)
+        {
+            xml_sax_start_section(p, XML_SAX_SECTION_COMMENT);
+            return s;
+        }
+
+        if (p->token_len == 8)
+        {
+            xml_sax_start_section(p, XML_SAX_SECTION_CDATA);
+            return s;
+        }
+    }
+
+    return s;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+xml_sax_parser_t *xml_sax_parser_allocate(const xml_sax_handler_t *handler, void *context)
+{
+    xml_sax_parser_t *p = (xml_sax_parser_t *)malloc(sizeof(xml_sax_parser_t));
+    if (!p)
+        return NULL;
+
+    memset(&p->handler, 0, sizeof(p->handler));
+
+    if (handler)
+        p->handler = *handler;
+
+    p->context = context;
+    p->token = NULL;
+    p->token_capacity = 0;
+    p->names = NULL;
+    p->names_capacity = 0;
+    p->attrs = NULL;
+    p->attr_capacity = 0;
+    p->scratch = NULL;
+    p->scratch_capacity = 0;
+
+    xml_sax_parser_reset(p);
+    return p;
+}
+
+void xml_sax_parser_free(xml_sax_parser_t *parser)
+{
+    if (!parser)
+        return;
+
+    free(parser->token);
+    free(parser->names);
+    free(parser->attrs);
+    free(parser->scratch);
+    free(parser);
+}
+
+void xml_sax_parser_reset(xml_sax_parser_t *parser)
+{
+    if (!parser)
+        return;
+
+    parser->status = XML_SAX_OK;
+    parser->state = XML_SAX_STATE_TEXT;
+    parser->offset = 0;
+    parser->bom = 0;
+    parser->root_closed = false;
+    parser->token_len = 0;
+    parser->run_content = false;
+    parser->run_reported = false;
+    parser->entity_len = 0;
+    parser->quote = 0;
+    parser->decl_depth = 0;
+    parser->section = XML_SAX_SECTION_COMMENT;
+    parser->matched = 0;
+    parser->names_len = 0;
+    parser->depth = 0;
+}
+
+xml_sax_status_t xml_sax_parser_feed(xml_sax_parser_t *parser, const char *data, size_t len)
+{
+    if (!parser)
+        return XML_SAX_ERROR;
+
+    if (parser->status != XML_SAX_OK || !data)
+        return parser->status;
+
+    const char *s = data;
+    const char *end = data + len;
+
+    /* A UTF-8 byte order mark is skipped */
+    while (parser->bom < 3 && s < end)
+    {
+        if (*s != xml_sax_bom[parser->bom])
+        {
+            if (parser->bom > 0)
+                xml_sax_fail(parser, s);
+
+            parser->bom = 3;
+            break;
+        }
+
+        parser->bom++;
+        s++;
+    }
+
+    while (s < end && parser->status == XML_SAX_OK)
+    {
+        switch (parser->state)
+        {
+            case XML_SAX_STATE_ENTITY:
+                s = xml_sax_scan_entity(parser, s, end);
+                break;
+
+            case XML_SAX_STATE_MARKUP:
+                s = xml_sax_scan_markup(parser, s, end);
+                break;
+
+            case XML_SAX_STATE_TAG:
+                s = xml_sax_scan_tag(parser, s, end);
+                break;
+
+            case XML_SAX_STATE_SECTION:
+                s = xml_sax_scan_section(parser, s, end);
+                break;
+
+            case XML_SAX_STATE_DECL:
+                s = xml_sax_scan_decl(parser, s, end);
+                break;
+
+            default:
+                s = xml_sax_scan_text(parser, s, end);
+                break;
+        }
+    }
+
+    parser->offset += (size_t)(s - data);
+    return parser->status;
+}
+
+xml_sax_status_t xml_sax_parser_finish(xml_sax_parser_t *parser)
+{
+    if (!parser)
+        return XML_SAX_ERROR;
+
+    if (parser->status != XML_SAX_OK)
+        return parser->status;
+
+    if (parser->state == XML_SAX_STATE_ENTITY)
+        xml_sax_entity_literal(parser);
+
+    if (parser->status == XML_SAX_OK && parser->state == XML_SAX_STATE_TEXT)
+        xml_sax_end_text(parser);
+
+    if (parser->status != XML_SAX_OK)
+        return parser->status;
+
+    if (parser->state != XML_SAX_STATE_TEXT || parser->depth != 0 || !parser->root_closed)
+        parser->status = XML_SAX_ERROR;
+
+    return parser->status;
+}
+
+size_t xml_sax_parser_get_offset(const xml_sax_parser_t *parser)
+{
+    if (!parser)
+        return 0;
+
+    return parser->offset;
+}
+
+size_t xml_sax_parser_get_depth(const xml_sax_parser_t *parser)
+{
+    if (!parser)
+        return 0;
+
+    return parser->depth;
+}
+
+xml_sax_status_t xml_sax_parse(const char *input, size_t len, const xml_sax_handler_t *handler, void *context)
+{
+    xml_sax_parser_t *parser = xml_sax_parser_allocate(handler, context);
+    if (!parser)
+        return XML_SAX_ERROR;
+
+    xml_sax_status_t status = xml_sax_parser_feed(parser, input, len);
+
+    if (status == XML_SAX_OK)
+        status = xml_sax_parser_finish(parser);
+
+    xml_sax_parser_free(parser);
+    return status;
+}
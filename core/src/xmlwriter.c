@@ -0,0 +1,669 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "xmlwriter.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define XML_WRITER_MAX_DEPTH 1024
+#define XML_WRITER_STAGE_SIZE 4096
+#define XML_WRITER_INDENT 2
+
+/* ------------------------------------------------------------------------- */
+/* Structures                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef struct xml_writer_frame_t
+{
+    size_t name_offset;      /* Into the name stack */
+    size_t name_len;
+    bool has_children;       /* Elements or comments */
+    bool has_text;           /* Text or CDATA, which turns off indentation */
+} xml_writer_frame_t;
+
+struct xml_writer_t
+{
+    buffer_t *buffer;
+    size_t pos;
+    size_t length;
+
+    bool pretty;
+    bool error;
+    bool tag_open;           /* Start tag written up to its attributes */
+    bool has_root;
+
+    char *names;             /* Open element names, back to back */
+    size_t names_len;
+    size_t names_capacity;
+
+    size_t depth;
+    xml_writer_frame_t stack[XML_WRITER_MAX_DEPTH];
+    char stage[XML_WRITER_STAGE_SIZE];
+};
+
+#define XML_ESCAPE_TEXT 1
+#define XML_ESCAPE_ATTR 2
+#define XML_ESCAPE_INVALID 4
+
+/* Control characters other than tab, newline and carriage return cannot
+   appear in XML 1.0 at all */
+static const unsigned char escape_class[256] =
+{
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 2, 2, 4, 4, 3, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 3, 0
+};
+
+/* ------------------------------------------------------------------------- */
+/* Output                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static bool writer_drain(xml_writer_t *w)
+{
+    if (w->pos > 0 && !buffer_append(w->buffer, w->stage, w->pos))
+    {
+        w->error = true;
+        return false;
+    }
+
+    w->pos = 0;
+    return true;
+}
+
+static bool writer_put(xml_writer_t *w, const char *data, size_t len)
+{
+    w->length += len;
+
+    if (w->error)
+        return false;
+
+    if (sizeof(w->stage) - w->pos >= len)
+    {
+        memcpy(w->stage + w->pos, data, len);
+        w->pos += len;
+        return true;
+    }
+
+    if (!writer_drain(w))
+        return false;
+
+    /* Large pieces skip the stage */
+    if (len > sizeof(w->stage))
+    {
+        if (!buffer_append(w->buffer, data, len))
+        {
+            w->error = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    memcpy(w->stage, data, len);
+    w->pos = len;
+    return true;
+}
+
+static bool writer_putc(xml_writer_t *w, char c)
+{
+    w->length++;
+
+    if (w->error || (w->pos == sizeof(w->stage) && !writer_drain(w)))
+        return false;
+
+    w->stage[w->pos++] = c;
+    return true;
+}
+
+static bool writer_newline(xml_writer_t *w, size_t depth)
+{
+    static const char spaces[] = "                                ";
+    size_t n = depth * XML_WRITER_INDENT;
+
+    if (!writer_putc(w, '\n'))
+        return false;
+
+    while (n > 0)
+    {
+        size_t k = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+
+        if (!writer_put(w, spaces, k))
+            return false;
+
+        n -= k;
+    }
+
+    return true;
+}
+
+/* Length of the leading run that needs no escaping for 'stop' */
+static size_t writer_safe_run(const char *s, size_t len, unsigned char stop)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i control = _mm_set1_epi8(0x1F);
+#endif
+
+    while (i < len)
+    {
+#if defined(__SSE2__)
+        /* Candidates only; the table decides below */
+        while (i + 16 <= len)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_cmpeq_epi8(v, quote)));
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+            int mask = _mm_movemask_epi8(hit);
+
+            if (mask)
+            {
+                i += (size_t)__builtin_ctz((unsigned int)mask);
+                break;
+            }
+
+            i += 16;
+        }
+
+        if (i == len)
+            break;
+#endif
+
+        if (escape_class[(unsigned char)s[i]] & stop)
+            return i;
+
+        i++;
+    }
+
+    return len;
+}
+
+static bool writer_escaped(xml_writer_t *w, const char *s, size_t len, unsigned char mode)
+{
+    while (len > 0)
+    {
+        size_t run = writer_safe_run(s, len, mode | XML_ESCAPE_INVALID);
+
+        if (run > 0 && !writer_put(w, s, run))
+            return false;
+
+        if (run == len)
+            break;
+
+        const char *esc;
+
+        switch (s[run])
+        {
+            case '&': esc = "&amp;"; break;
+            case '<': esc = "&lt;"; break;
+            case '>': esc = "&gt;"; break;
+            case '"': esc = "&quot;"; break;
+            case '\r': esc = "&#13;"; break;
+            case '\n': esc = "&#10;"; break;
+            case '\t': esc = "&#9;"; break;
+            default:
+                w->error = true;
+                return false;
+        }
+
+        if (!writer_put(w, esc, strlen(esc)))
+            return false;
+
+        s += run + 1;
+        len -= run + 1;
+    }
+
+    return true;
+}
+
+static bool writer_valid_name(const char *name, size_t len)
+{
+    if (len == 0 || (name[0] >= '0' && name[0] <= '9') || name[0] == '-' || name[0] == '.')
+        return false;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)name[i];
+
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '_' || c == ':' || c == '-' || c == '.' || c >= 0x80))
+            return false;
+    }
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Structure                                                                 */
+/* ------------------------------------------------------------------------- */
+
+/* Finishes a pending start tag before content */
+static bool writer_close_tag(xml_writer_t *w)
+{
+    if (!w->tag_open)
+        return true;
+
+    w->tag_open = false;
+    return writer_putc(w, '>');
+}
+
+/* Prepares for an element or comment at the current depth */
+static bool writer_child_prefix(xml_writer_t *w)
+{
+    if (w->error || !writer_close_tag(w))
+        return false;
+
+    if (w->depth == 0)
+    {
+        if (w->pretty && w->length > 0)
+            return writer_newline(w, 0);
+
+        return true;
+    }
+
+    xml_writer_frame_t *frame = &w->stack[w->depth - 1];
+    frame->has_children = true;
+
+    if (w->pretty && !frame->has_text)
+        return writer_newline(w, w->depth);
+
+    return true;
+}
+
+static bool writer_text_prefix(xml_writer_t *w)
+{
+    if (w->error)
+        return false;
+
+    /* Text belongs inside the root element */
+    if (w->depth == 0)
+    {
+        w->error = true;
+        return false;
+    }
+
+    w->stack[w->depth - 1].has_text = true;
+    return writer_close_tag(w);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+xml_writer_t *xml_writer_allocate(buffer_t *buffer, bool pretty)
+{
+    if (!buffer)
+        return NULL;
+
+    xml_writer_t *w = (xml_writer_t *)malloc(sizeof(xml_writer_t));
+    if (!w)
+        return NULL;
+
+    w->buffer = buffer;
+    w->pretty = pretty;
+    w->names = NULL;
+    w->names_capacity = 0;
+
+    xml_writer_reset(w);
+    return w;
+}
+
+void xml_writer_free(xml_writer_t *writer)
+{
+    if (!writer)
+        return;
+
+    xml_writer_flush(writer);
+    free(writer->names);
+    free(writer);
+}
+
+void xml_writer_reset(xml_writer_t *writer)
+{
+    if (!writer)
+        return;
+
+    writer->pos = 0;
+    writer->length = 0;
+    writer->error = false;
+    writer->tag_open = false;
+    writer->has_root = false;
+    writer->names_len = 0;
+    writer->depth = 0;
+}
+
+bool xml_writer_declaration(xml_writer_t *writer)
+{
+    static const char decl[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+
+    if (!writer || writer->error)
+        return false;
+
+    if (writer->length > 0)
+    {
+        writer->error = true;
+        return false;
+    }
+
+    return writer_put(writer, decl, sizeof(decl) - 1);
+}
+
+bool xml_writer_begin_element(xml_writer_t *writer, const char *name)
+{
+    if (!writer || !name || writer->error)
+        return false;
+
+    size_t len = strlen(name);
+
+    if (!writer_valid_name(name, len) || writer->depth == XML_WRITER_MAX_DEPTH || (writer->depth == 0 && writer->has_root))
+    {
+        writer->error = true;
+        return false;
+    }
+
+    if (!writer_child_prefix(writer))
+        return false;
+
+    if (writer->names_capacity - writer->names_len < len)
+    {
+        size_t capacity = writer->names_capacity ? writer->names_capacity * 2 : 256;
+
+        while (capacity - writer->names_len < len)
+            capacity *= 2;
+
+        char *names = (char *)realloc(writer->names, capacity);
+        if (!names)
+        {
+            writer->error = true;
+            return false;
+        }
+
+        writer->names = names;
+        writer->names_capacity = capacity;
+    }
+
+    xml_writer_frame_t *frame = &writer->stack[writer->depth++];
+    frame->name_offset = writer->names_len;
+    frame->name_len = len;
+    frame->has_children = false;
+    frame->has_text = false;
+    memcpy(writer->names + writer->names_len, name, len);
+    writer->names_len += len;
+
+    writer->has_root = true;
+    writer->tag_open = true;
+
+    if (!writer_putc(writer, '<'))
+        return false;
+
+    return writer_put(writer, name, len);
+}
+
+bool xml_writer_end_element(xml_writer_t *writer)
+{
+    if (!writer || writer->error)
+        return false;
+
+    if (writer->depth == 0)
+    {
+        writer->error = true;
+        return false;
+    }
+
+    xml_writer_frame_t *frame = &writer->stack[--writer->depth];
+    writer->names_len = frame->name_offset;
+
+    if (writer->tag_open)
+    {
+        writer->tag_open = false;
+        return writer_put(writer, "/>", 2);
+    }
+
+    if (writer->pretty && frame->has_children && !frame->has_text && !writer_newline(writer, writer->depth))
+        return false;
+
+    if (!writer_put(writer, "</", 2) || !writer_put(writer, writer->names + frame->name_offset, frame->name_len))
+        return false;
+
+    return writer_putc(writer, '>');
+}
+
+bool xml_writer_attribute_length(xml_writer_t *writer, const char *name, const char *value, size_t len)
+{
+    if (!writer || !name || !value || writer->error)
+        return false;
+
+    size_t name_len = strlen(name);
+
+    if (!writer->tag_open || !writer_valid_name(name, name_len))
+    {
+        writer->error = true;
+        return false;
+    }
+
+    if (!writer_putc(writer, ' ') || !writer_put(writer, name, name_len) || !writer_put(writer, "=\"", 2))
+        return false;
+
+    if (!writer_escaped(writer, value, len, XML_ESCAPE_ATTR))
+        return false;
+
+    return writer_putc(writer, '"');
+}
+
+bool xml_writer_attribute(xml_writer_t *writer, const char *name, const char *value)
+{
+    if (!value)
+        return false;
+
+    return xml_writer_attribute_length(writer, name, value, strlen(value));
+}
+
+bool xml_writer_attribute_int64(xml_writer_t *writer, const char *name, int64_t value)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *start = end;
+    uint64_t u = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+
+    do
+    {
+        *--start = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+
+    if (value < 0)
+        *--start = '-';
+
+    return xml_writer_attribute_length(writer, name, start, (size_t)(end - start));
+}
+
+bool xml_writer_text_length(xml_writer_t *writer, const char *text, size_t len)
+{
+    if (!writer || !text || !writer_text_prefix(writer))
+        return false;
+
+    return writer_escaped(writer, text, len, XML_ESCAPE_TEXT);
+}
+
+bool xml_writer_text(xml_writer_t *writer, const char *text)
+{
+    if (!text)
+        return false;
+
+    return xml_writer_text_length(writer, text, strlen(text));
+}
+
+bool xml_writer_cdata(xml_writer_t *writer, const char *text, size_t len)
+{
+    if (!writer || !text || !writer_text_prefix(writer))
+        return false;
+
+    if (!writer_put(writer, "<![CDATA[", 9))
+        return false;
+
+    const char *start = text;
+
+    for (size_t i = 0; i + 2 < len; i++)
+    {
+        if (text[i] == ']' && text[i + 1] == ']' && text[i + 2] == '>')
+        {
+            /* End the section between "]]" and ">" */
+            if (!writer_put(writer, start, (size_t)(text + i + 2 - start)) || !writer_put(writer, "]]><![CDATA[", 12))
+                return false;
+
+            start = text + i + 2;
+        }
+    }
+
+    if (!writer_put(writer, start, (size_t)(text + len - start)))
+        return false;
+
+    return writer_put(writer, "]]>", 3);
+}
+
+bool xml_writer_comment(xml_writer_t *writer, const char *text)
+{
+    if (!writer || !text || writer->error)
+        return false;
+
+    size_t len = strlen(text);
+
+    if (strstr(text, "--") || (len > 0 && text[len - 1] == '-'))
+    {
+        writer->error = true;
+        return false;
+    }
+
+    if (!writer_child_prefix(writer) || !writer_put(writer, "<!--", 4) || !writer_put(writer, text, len))
+        return false;
+
+    return writer_put(writer, "-->", 3);
+}
+
+static bool writer_node_open(xml_writer_t *writer, xml_node_t *node)
+{
+    const char *text = xml_node_text(node);
+
+    switch (xml_node_type(node))
+    {
+        case XML_NODE_ELEMENT:
+            if (!xml_writer_begin_element(writer, xml_node_name(node)))
+                return false;
+
+            for (xml_attribute_t *a = xml_node_first_attr(node); a; a = xml_attr_next(a))
+            {
+                if (!xml_writer_attribute(writer, xml_attr_name(a), xml_attr_value(a)))
+                    return false;
+            }
+
+            return true;
+
+        case XML_NODE_TEXT:
+            return xml_writer_text(writer, text);
+
+        case XML_NODE_CDATA:
+            return xml_writer_cdata(writer, text, strlen(text));
+
+        case XML_NODE_COMMENT:
+            return xml_writer_comment(writer, text);
+
+        default:
+            return true;
+    }
+}
+
+bool xml_writer_node(xml_writer_t *writer, xml_node_t *node)
+{
+    if (!writer || !node)
+        return false;
+
+    /* Walks the subtree through parent links instead of recursing */
+    xml_node_t *top = node;
+    xml_node_t *cur = node;
+
+    for (;;)
+    {
+        if (!writer_node_open(writer, cur))
+            return false;
+
+        xml_node_t *child = xml_node_first_child(cur);
+
+        if (child)
+        {
+            cur = child;
+            continue;
+        }
+
+        for (;;)
+        {
+            if (xml_node_type(cur) == XML_NODE_ELEMENT && !xml_writer_end_element(writer))
+                return false;
+
+            if (cur == top)
+                return !writer->error;
+
+            xml_node_t *next = xml_node_next_sibling(cur);
+
+            if (next)
+            {
+                cur = next;
+                break;
+            }
+
+            cur = xml_node_parent(cur);
+        }
+    }
+}
+
+bool xml_writer_flush(xml_writer_t *writer)
+{
+    if (!writer || writer->error)
+        return false;
+
+    return writer_drain(writer);
+}
+
+size_t xml_writer_get_length(const xml_writer_t *writer)
+{
+    return writer ? writer->length : 0;
+}
+
+bool xml_writer_has_error(const xml_writer_t *writer)
+{
+    return !writer || writer->error;
+}
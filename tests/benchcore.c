@@ -0,0 +1,1189 @@
+#include <treonzlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <malloc.h>
+#include <memory.h>
+#include <time.h>
+#include "json.h"
+#include "jsonsax.h"
+#include "jsonwriter.h"
+#include "jsonpath.h"
+#include "jsonlines.h"
+#include "jsonbind.h"
+#include "cbor.h"
+#include "xml.h"
+#include "xmlsax.h"
+#include "xmlwriter.h"
+#include "xmlpath.h"
+#include "datetime.h"
+
+void bench_base64(void);
+void bench_json(void);
+void bench_xml(void);
+void bench_cbor(void);
+void bench_configuration(void);
+void bench_logger(void);
+void bench_datetime(void);
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_report(const char* name, double seconds, size_t bytes, size_t ops)
+{
+    printf("%-36s %10.1f MB/s %12.1f ns/op\n", name, ((double)bytes / (1024.0 * 1024.0)) / seconds, (seconds * 1e9) / (double)ops);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 2)
+    {
+        switch (argv[1][0])
+        {
+        case 'b':
+        {
+            //Base64
+            bench_base64();
+            break;
+        }
+        case 'y':
+        {
+            //Json
+            bench_json();
+            break;
+        }
+        case 'x':
+        {
+            //Xml
+            bench_xml();
+            break;
+        }
+        case 'c':
+        {
+            //Cbor
+            bench_cbor();
+            break;
+        }
+        case 'g':
+        {
+            //Configuration
+            bench_configuration();
+            break;
+        }
+        case 'l':
+        {
+            //Logger
+            bench_logger();
+            break;
+        }
+        case 't':
+        {
+            //Date and time
+            bench_datetime();
+            break;
+        }
+        default:
+        {
+            break;
+        }
+        }
+    }
+    else
+    {
+        printf("Usage : corebench <option>\nOptions are b(base64), y(json), x(xml), c(cbor), g(configuration), l(logger), t(datetime)\n");
+    }
+
+    return 0;
+}
+
+void bench_base64(void)
+{
+    const size_t payload_size = 1024 * 1024;
+    const int rounds = 200;
+    const char* kernel_names[] = { "scalar", "ssse3", "avx2" };
+    base64_kernel_t default_kernel = base64_get_kernel();
+    unsigned char* payload = (unsigned char*)malloc(payload_size);
+    unsigned char* decoded = (unsigned char*)malloc(payload_size);
+    char* encoded = (char*)malloc(base64_encoded_length(payload_size) + 1);
+    unsigned long encoded_len = 0;
+    unsigned long decoded_len = 0;
+    char label[64] = {0};
+
+    assert(payload != NULL && decoded != NULL && encoded != NULL);
+
+    for (size_t index = 0; index < payload_size; index++)
+    {
+        payload[index] = (unsigned char)(rand() & 0xFF);
+    }
+
+    for (int k = BASE64_KERNEL_SCALAR; k <= BASE64_KERNEL_AVX2; k++)
+    {
+        if (!base64_set_kernel((base64_kernel_t)k))
+        {
+            printf("base64 %-29s unsupported\n", kernel_names[k]);
+            continue;
+        }
+
+        double start = bench_now();
+        for (int r = 0; r < rounds; r++)
+        {
+            base64_encode(payload, payload_size, encoded, &encoded_len);
+        }
+        snprintf(label, sizeof(label), "base64 encode %s", kernel_names[k]);
+        bench_report(label, bench_now() - start, payload_size * rounds, rounds);
+
+        start = bench_now();
+        for (int r = 0; r < rounds; r++)
+        {
+            base64_decode(encoded, encoded_len, decoded, &decoded_len);
+        }
+        snprintf(label, sizeof(label), "base64 decode %s", kernel_names[k]);
+        bench_report(label, bench_now() - start, payload_size * rounds, rounds);
+
+        assert(decoded_len == payload_size);
+        assert(memcmp(decoded, payload, payload_size) == 0);
+    }
+
+    /* Legacy allocating mode, as used by the SMTP login path */
+    base64_set_kernel(default_kernel);
+    double start = bench_now();
+    for (int r = 0; r < rounds; r++)
+    {
+        char* allocated = base64_encode(payload, payload_size, NULL, &encoded_len);
+        free(allocated);
+    }
+    bench_report("base64 encode allocating", bench_now() - start, payload_size * rounds, rounds);
+
+    /* Streaming with 76 column MIME wrapping, fed in 64 KB chunks */
+    const unsigned long chunk = 64 * 1024;
+    base64_encoder_t* encoder = base64_encoder_allocate(76);
+    base64_decoder_t* decoder = base64_decoder_allocate();
+    char* wrapped = (char*)malloc(base64_encoder_max_output(encoder, payload_size));
+    unsigned long wrapped_len = 0;
+
+    assert(encoder != NULL && decoder != NULL && wrapped != NULL);
+
+    start = bench_now();
+    for (int r = 0; r < rounds; r++)
+    {
+        wrapped_len = 0;
+        for (unsigned long pos = 0; pos < payload_size; pos += chunk)
+        {
+            wrapped_len += base64_encoder_update(encoder, payload + pos, chunk, wrapped + wrapped_len);
+        }
+        wrapped_len += base64_encoder_finish(encoder, wrapped + wrapped_len);
+    }
+    bench_report("base64 encode stream mime", bench_now() - start, payload_size * rounds, rounds);
+
+    start = bench_now();
+    for (int r = 0; r < rounds; r++)
+    {
+        decoded_len = 0;
+        for (unsigned long pos = 0; pos < wrapped_len; pos += chunk)
+        {
+            unsigned long len = (wrapped_len - pos) < chunk ? (wrapped_len - pos) : chunk;
+            decoded_len += base64_decoder_update(decoder, wrapped + pos, len, decoded + decoded_len);
+        }
+    }
+    bench_report("base64 decode stream mime", bench_now() - start, payload_size * rounds, rounds);
+
+    assert(decoded_len == payload_size);
+    assert(memcmp(decoded, payload, payload_size) == 0);
+
+    base64_encoder_free(encoder);
+    base64_decoder_free(decoder);
+    free(wrapped);
+    free(encoded);
+    free(decoded);
+    free(payload);
+}
+
+typedef struct bench_telemetry_t
+{
+    char device[32];
+    uint64_t seq;
+    double temperature;
+    bool ok;
+} bench_telemetry_t;
+
+static const json_bind_field_t bench_telemetry_fields[] =
+{
+    JSON_BIND_STRING("device", bench_telemetry_t, device),
+    JSON_BIND_UINT64("seq", bench_telemetry_t, seq),
+    JSON_BIND_DOUBLE("temperature", bench_telemetry_t, temperature),
+    JSON_BIND_BOOL("ok", bench_telemetry_t, ok)
+};
+static const json_bind_schema_t bench_telemetry_schema = JSON_BIND_SCHEMA(bench_telemetry_t, bench_telemetry_fields);
+
+// Builds an array of small records, roughly the shape of typical API payloads
+static char* bench_json_make_document(size_t records, size_t* length)
+{
+    size_t capacity = records * 128 + 16;
+    char* doc = (char*)malloc(capacity);
+    size_t pos = 0;
+
+    doc[pos++] = '[';
+
+    for (size_t idx = 0; idx < records; idx++)
+    {
+        pos += (size_t)snprintf(doc + pos, capacity - pos,
+            "%s{\"id\":%zu,\"name\":\"record %zu\",\"score\":%zu.25,\"active\":%s,\"tags\":[\"a\",\"b\"]}",
+            idx ? "," : "", idx, idx, idx % 1000, (idx & 1) ? "true" : "false");
+    }
+
+    doc[pos++] = ']';
+    doc[pos] = 0;
+
+    *length = pos;
+    return doc;
+}
+
+void bench_json(void)
+{
+    const int rounds = 20;
+    size_t length = 0;
+    char* input = bench_json_make_document(100000, &length);
+    double start = 0;
+
+    const char* kernel_names[] = { "scalar", "avx2" };
+    json_kernel_t default_kernel = json_get_kernel();
+    char label[64] = {0};
+
+    for (int kernel = JSON_KERNEL_SCALAR; kernel <= JSON_KERNEL_AVX2; kernel++)
+    {
+        if (!json_set_kernel((json_kernel_t)kernel))
+        {
+            continue;
+        }
+
+        start = bench_now();
+        for (int round = 0; round < rounds; round++)
+        {
+            json_document_t* doc = json_parse_string(input);
+            assert(doc != NULL);
+            json_free_document(doc);
+        }
+        snprintf(label, sizeof(label), "json parse + free (DOM, %s)", kernel_names[kernel]);
+        bench_report(label, bench_now() - start, length * rounds, rounds);
+    }
+
+    json_set_kernel(default_kernel);
+
+    // In-situ parsing; the copy that restores the input each round is included
+    char* scratch = (char*)malloc(length);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        memcpy(scratch, input, length);
+        json_document_t* doc = json_parse_insitu(scratch, length, false);
+        assert(doc != NULL);
+        json_free_document(doc);
+    }
+    bench_report("json parse + free (DOM, in-situ)", bench_now() - start, length * rounds, rounds);
+    free(scratch);
+
+    // Event parser with no handlers, whole buffer and socket sized chunks
+    json_sax_handler_t handler;
+    memset(&handler, 0, sizeof(handler));
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        json_sax_status_t status = json_sax_parse(input, length, &handler, NULL);
+        assert(status == JSON_SAX_OK);
+    }
+    bench_report("json sax parse", bench_now() - start, length * rounds, rounds);
+
+    json_sax_parser_t* parser = json_sax_parser_allocate(&handler, NULL, false);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        json_sax_parser_reset(parser);
+        for (size_t pos = 0; pos < length; pos += 4096)
+        {
+            json_sax_parser_feed(parser, input + pos, length - pos < 4096 ? length - pos : 4096);
+        }
+        json_sax_status_t status = json_sax_parser_finish(parser);
+        assert(status == JSON_SAX_OK);
+    }
+    bench_report("json sax parse (4KB chunks)", bench_now() - start, length * rounds, rounds);
+    json_sax_parser_free(parser);
+
+    // Rules engine style access: named lookups on a 300 field object
+    char* wide = (char*)malloc(300 * 32 + 2);
+    size_t wide_len = 0;
+    char names[300][16];
+    wide[wide_len++] = '{';
+    for (int field = 0; field < 300; field++)
+    {
+        snprintf(names[field], sizeof(names[field]), "metric_%d", field);
+        wide_len += (size_t)sprintf(wide + wide_len, "%s\"%s\":%d.5", field ? "," : "", names[field], field);
+    }
+    wide[wide_len++] = '}';
+    wide[wide_len] = 0;
+
+    json_document_t* wide_doc = json_parse_string(wide);
+    json_node_t* wide_obj = json_node_first_child_element(json_document_root(wide_doc), NULL);
+    const size_t lookups = 2000000;
+    double sum = 0;
+    start = bench_now();
+    for (size_t idx = 0; idx < lookups; idx++)
+    {
+        double value = 0;
+        json_node_get_double(json_node_first_child_element(wide_obj, names[(idx * 7) % 300]), &value);
+        sum += value;
+    }
+    bench_report("json member lookup + double (300)", bench_now() - start, 0, lookups);
+    assert(sum > 0);
+    json_free_document(wide_doc);
+    free(wide);
+
+    // The same 200 compiled pointers evaluated against a telemetry document
+    char* telemetry = (char*)malloc(200 * 64 + 32);
+    size_t telemetry_len = (size_t)sprintf(telemetry, "{\"sensors\":[");
+    json_path_t* paths[200];
+    for (int sensor = 0; sensor < 200; sensor++)
+    {
+        char pointer[64];
+        telemetry_len += (size_t)sprintf(telemetry + telemetry_len, "%s{\"id\":%d,\"unit\":\"C\",\"value\":%d}", sensor ? "," : "", sensor, sensor);
+        snprintf(pointer, sizeof(pointer), "/sensors/%d/value", sensor);
+        paths[sensor] = json_path_compile(pointer, false);
+    }
+    sprintf(telemetry + telemetry_len, "]}");
+
+    json_document_t* telemetry_doc = json_parse_string(telemetry);
+    json_node_t* telemetry_root = json_document_root(telemetry_doc);
+    const size_t evaluations = 20000;
+    int64_t total = 0;
+    start = bench_now();
+    for (size_t round = 0; round < evaluations; round++)
+    {
+        for (int sensor = 0; sensor < 200; sensor++)
+        {
+            int64_t value = 0;
+            json_node_get_int64(json_path_find(paths[sensor], telemetry_root), &value);
+            total += value;
+        }
+    }
+    bench_report("json pointer find (200 paths)", bench_now() - start, 0, evaluations * 200);
+    assert(total == (int64_t)evaluations * 199 * 100);
+    for (int sensor = 0; sensor < 200; sensor++)
+    {
+        json_path_free(paths[sensor]);
+    }
+    json_free_document(telemetry_doc);
+    free(telemetry);
+
+    // Serialize the parsed document back into a growable buffer
+    json_document_t* doc = json_parse_string(input);
+    buffer_t* out = buffer_allocate_length(length + 1);
+    json_writer_t* writer = json_writer_allocate(out, false);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        buffer_clear(out);
+        json_writer_reset(writer);
+        json_writer_node(writer, json_document_root(doc));
+        json_writer_flush(writer);
+    }
+    bench_report("json write DOM (buffer)", bench_now() - start, buffer_get_size(out) * rounds, rounds);
+    json_writer_free(writer);
+    buffer_free(&out);
+    json_free_document(doc);
+
+    // Telemetry sized message into a fixed buffer, writer versus snprintf
+    const size_t messages = 1000000;
+    char message[256];
+    size_t message_bytes = 0;
+    writer = json_writer_allocate_fixed(message, sizeof(message), false);
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        json_writer_reset(writer);
+        json_writer_begin_object(writer);
+        json_writer_key(writer, "device");
+        json_writer_string(writer, "sensor-0042");
+        json_writer_key(writer, "seq");
+        json_writer_uint64(writer, idx);
+        json_writer_key(writer, "temperature");
+        json_writer_fixed(writer, 21.5 + (double)(idx % 100) / 100.0, 2);
+        json_writer_key(writer, "ok");
+        json_writer_boolean(writer, true);
+        json_writer_end_object(writer);
+        json_writer_flush(writer);
+        message_bytes += json_writer_get_length(writer);
+    }
+    bench_report("json write telemetry (fixed)", bench_now() - start, message_bytes, messages);
+    json_writer_free(writer);
+
+    message_bytes = 0;
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        message_bytes += (size_t)snprintf(message, sizeof(message), "{\"device\":\"%s\",\"seq\":%zu,\"temperature\":%.2f,\"ok\":%s}",
+            "sensor-0042", idx, 21.5 + (double)(idx % 100) / 100.0, "true");
+    }
+    bench_report("json write telemetry (snprintf)", bench_now() - start, message_bytes, messages);
+
+    // Telemetry into a struct: DOM plus lookups versus direct binding
+    const char* telemetry_message = "{\"device\":\"sensor-0042\",\"seq\":123456,\"temperature\":21.57,\"ok\":true}";
+    size_t telemetry_message_len = strlen(telemetry_message);
+    bench_telemetry_t bound;
+    memset(&bound, 0, sizeof(bound));
+
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        json_document_t* msg = json_parse_string_length(telemetry_message, telemetry_message_len);
+        json_node_t* obj = json_node_first_child_element(json_document_root(msg), NULL);
+        int64_t seq = 0;
+        snprintf(bound.device, sizeof(bound.device), "%s", json_node_get_attr(obj, "device"));
+        json_node_get_int64(json_node_first_child_element(obj, "seq"), &seq);
+        json_node_get_double(json_node_first_child_element(obj, "temperature"), &bound.temperature);
+        bound.seq = (uint64_t)seq;
+        bound.ok = strcmp(json_node_get_attr(obj, "ok"), "true") == 0;
+        json_free_document(msg);
+    }
+    bench_report("json read telemetry (DOM)", bench_now() - start, telemetry_message_len * messages, messages);
+
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        bool decoded = json_bind_decode(&bench_telemetry_schema, telemetry_message, telemetry_message_len, &bound);
+        assert(decoded);
+        (void)decoded;
+    }
+    bench_report("json read telemetry (bind)", bench_now() - start, telemetry_message_len * messages, messages);
+
+    message_bytes = 0;
+    writer = json_writer_allocate_fixed(message, sizeof(message), false);
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        bound.seq = idx;
+        json_writer_reset(writer);
+        json_bind_encode(&bench_telemetry_schema, &bound, writer);
+        json_writer_flush(writer);
+        message_bytes += json_writer_get_length(writer);
+    }
+    bench_report("json write telemetry (bind)", bench_now() - start, message_bytes, messages);
+    json_writer_free(writer);
+
+    // The same records as newline delimited JSON, one document each
+    size_t lines_capacity = 100000 * 128;
+    char* lines = (char*)malloc(lines_capacity);
+    size_t lines_len = 0;
+    for (size_t idx = 0; idx < 100000; idx++)
+    {
+        lines_len += (size_t)snprintf(lines + lines_len, lines_capacity - lines_len,
+            "{\"id\":%zu,\"name\":\"record %zu\",\"score\":%zu.25,\"active\":%s,\"tags\":[\"a\",\"b\"]}\n",
+            idx, idx, idx % 1000, (idx & 1) ? "true" : "false");
+    }
+
+    size_t thread_counts[] = { 1, 2, 4, 0 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)
+    {
+        start = bench_now();
+        for (int round = 0; round < rounds; round++)
+        {
+            size_t count = 0;
+            json_document_t** docs = json_lines_parse_all(lines, lines_len, thread_counts[t], &count);
+            assert(docs != NULL && count == 100000);
+            json_lines_free_all(docs, count);
+        }
+        if (thread_counts[t] == 0)
+        {
+            snprintf(label, sizeof(label), "json lines parse (%ld cpus)", sysconf(_SC_NPROCESSORS_ONLN));
+        }
+        else
+        {
+            snprintf(label, sizeof(label), "json lines parse (%zu threads)", thread_counts[t]);
+        }
+        bench_report(label, bench_now() - start, lines_len * rounds, rounds * 100000);
+    }
+    free(lines);
+
+    free(input);
+}
+
+// A device export: many small elements with attributes and text
+static char* bench_xml_make_document(size_t records, size_t* length)
+{
+    size_t capacity = records * 160 + 64;
+    char* doc = (char*)malloc(capacity);
+    size_t pos = (size_t)snprintf(doc, capacity, "<?xml version=\"1.0\"?>\n<export>\n");
+
+    for (size_t idx = 0; idx < records; idx++)
+    {
+        pos += (size_t)snprintf(doc + pos, capacity - pos,
+            "  <record id=\"%zu\" active=\"%s\"><name>record %zu</name><score>%zu.25</score><note>a &amp; b</note></record>\n",
+            idx, (idx & 1) ? "true" : "false", idx, idx % 1000);
+    }
+
+    pos += (size_t)snprintf(doc + pos, capacity - pos, "</export>\n");
+    *length = pos;
+    return doc;
+}
+
+static bool bench_xml_start(void* context, const char* name, size_t len, const xml_sax_attribute_t* attrs, size_t attr_count)
+{
+    (void)name;
+    (void)len;
+    (void)attrs;
+    *(size_t*)context += attr_count;
+    return true;
+}
+
+void bench_xml(void)
+{
+    const int rounds = 10;
+    size_t length = 0;
+    char* input = bench_xml_make_document(100000, &length);
+    double start = 0;
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        xml_document_t* doc = xml_parse_string(input);
+        assert(doc != NULL);
+        xml_free_document(doc);
+    }
+    bench_report("xml parse + free (DOM)", bench_now() - start, length * rounds, rounds);
+
+    xml_document_t* doc = xml_parse_string(input);
+    xml_node_t* root = xml_node_first_child_element(xml_document_root(doc), "export");
+    size_t lookups = 0;
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (xml_node_t* rec = xml_node_first_child_element(root, "record"); rec; rec = xml_node_next_sibling_element(rec, "record"))
+        {
+            lookups += xml_node_get_attr(rec, "active")[0] == 't';
+        }
+    }
+    bench_report("xml walk + attribute lookup", bench_now() - start, length * rounds, rounds * 100000);
+
+    // The same selections through compiled paths and hand written loops
+    xml_path_t* by_id = xml_path_compile("/export/record[@id='77777']");
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        lookups += xml_path_find(by_id, xml_document_root(doc)) != NULL;
+    }
+    bench_report("xml path find by attribute", bench_now() - start, length * rounds, rounds);
+    xml_path_free(by_id);
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        xml_node_t* export = xml_node_first_child_element(xml_document_root(doc), "export");
+        for (xml_node_t* rec = xml_node_first_child_element(export, "record"); rec; rec = xml_node_next_sibling_element(rec, "record"))
+        {
+            if (strcmp(xml_node_get_attr(rec, "id"), "77777") == 0)
+            {
+                lookups++;
+                break;
+            }
+        }
+    }
+    bench_report("xml loop find by attribute", bench_now() - start, length * rounds, rounds);
+
+    xml_node_t** matches = (xml_node_t**)malloc(100000 * sizeof(xml_node_t*));
+    xml_path_t* scores = xml_path_compile("//record/score");
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        lookups += xml_path_find_all(scores, xml_document_root(doc), matches, 100000);
+    }
+    bench_report("xml path find all (//record/score)", bench_now() - start, length * rounds, rounds);
+    xml_path_free(scores);
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        size_t count = 0;
+        xml_node_t* export = xml_node_first_child_element(xml_document_root(doc), "export");
+        for (xml_node_t* rec = xml_node_first_child_element(export, "record"); rec; rec = xml_node_next_sibling_element(rec, "record"))
+        {
+            for (xml_node_t* score = xml_node_first_child_element(rec, "score"); score; score = xml_node_next_sibling_element(score, "score"))
+            {
+                matches[count++] = score;
+            }
+        }
+        lookups += count;
+    }
+    bench_report("xml loop find all scores", bench_now() - start, length * rounds, rounds);
+    free(matches);
+
+    // Writing the export back out, from the DOM and field by field
+    buffer_t* out = buffer_allocate_length(length + 1024);
+    xml_writer_t* writer = xml_writer_allocate(out, false);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        buffer_clear(out);
+        xml_writer_reset(writer);
+        xml_writer_node(writer, xml_document_root(doc));
+        xml_writer_flush(writer);
+    }
+    bench_report("xml writer (from DOM)", bench_now() - start, buffer_get_size(out) * rounds, rounds);
+
+    char field[32];
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        buffer_clear(out);
+        xml_writer_reset(writer);
+        xml_writer_declaration(writer);
+        xml_writer_begin_element(writer, "export");
+        for (int idx = 0; idx < 100000; idx++)
+        {
+            xml_writer_begin_element(writer, "record");
+            xml_writer_attribute_int64(writer, "id", idx);
+            xml_writer_attribute(writer, "active", (idx & 1) ? "true" : "false");
+            xml_writer_begin_element(writer, "name");
+            xml_writer_text_length(writer, field, (size_t)snprintf(field, sizeof(field), "record %d", idx));
+            xml_writer_end_element(writer);
+            xml_writer_begin_element(writer, "score");
+            xml_writer_text_length(writer, field, (size_t)snprintf(field, sizeof(field), "%d.25", idx % 1000));
+            xml_writer_end_element(writer);
+            xml_writer_begin_element(writer, "note");
+            xml_writer_text(writer, "a & b");
+            xml_writer_end_element(writer);
+            xml_writer_end_element(writer);
+        }
+        xml_writer_end_element(writer);
+        xml_writer_flush(writer);
+    }
+    assert(!xml_writer_has_error(writer));
+    bench_report("xml writer (streamed)", bench_now() - start, buffer_get_size(out) * rounds, rounds * 100000);
+    xml_writer_free(writer);
+    buffer_free(&out);
+
+    xml_free_document(doc);
+
+    // One element with many attributes, looked up through the index
+    char wide[4096];
+    size_t wide_len = (size_t)snprintf(wide, sizeof(wide), "<device");
+    for (int idx = 0; idx < 64; idx++)
+    {
+        wide_len += (size_t)snprintf(wide + wide_len, sizeof(wide) - wide_len, " property%d=\"%d\"", idx, idx);
+    }
+    snprintf(wide + wide_len, sizeof(wide) - wide_len, "/>");
+    doc = xml_parse_string(wide);
+    xml_node_t* device = xml_node_first_child_element(xml_document_root(doc), "device");
+    char keys[64][16];
+    for (int idx = 0; idx < 64; idx++)
+    {
+        snprintf(keys[idx], sizeof(keys[idx]), "property%d", idx);
+    }
+    start = bench_now();
+    for (int round = 0; round < 100000; round++)
+    {
+        lookups += xml_node_get_attr(device, keys[round & 63]) != NULL;
+    }
+    bench_report("xml wide attribute lookup", bench_now() - start, 0, 100000);
+    assert(lookups > 0);
+    xml_free_document(doc);
+
+    xml_sax_handler_t handler;
+    memset(&handler, 0, sizeof(handler));
+    handler.on_start_element = bench_xml_start;
+    size_t attributes = 0;
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        xml_sax_status_t status = xml_sax_parse(input, length, &handler, &attributes);
+        assert(status == XML_SAX_OK);
+    }
+    bench_report("xml sax parse", bench_now() - start, length * rounds, rounds);
+
+    xml_sax_parser_t* parser = xml_sax_parser_allocate(&handler, &attributes);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        xml_sax_parser_reset(parser);
+        for (size_t pos = 0; pos < length; pos += 4096)
+        {
+            xml_sax_parser_feed(parser, input + pos, length - pos < 4096 ? length - pos : 4096);
+        }
+        xml_sax_status_t status = xml_sax_parser_finish(parser);
+        assert(status == XML_SAX_OK);
+    }
+    bench_report("xml sax parse (4KB chunks)", bench_now() - start, length * rounds, rounds);
+    xml_sax_parser_free(parser);
+
+    free(input);
+}
+
+static bool bench_cbor_number(void* context, const char* num, size_t len)
+{
+    (void)num;
+    *(size_t*)context += len;
+    return true;
+}
+
+// Reads the telemetry message field by field, the way a consumer would
+static bool bench_cbor_read_telemetry(const uint8_t* data, size_t len, bench_telemetry_t* out)
+{
+    cbor_reader_t reader;
+    cbor_item_t item;
+    cbor_item_t value;
+
+    cbor_reader_init(&reader, data, len);
+    if (!cbor_reader_next(&reader, &item) || item.type != CBOR_ITEM_MAP)
+    {
+        return false;
+    }
+
+    while (cbor_reader_next(&reader, &item) && item.type != CBOR_ITEM_END)
+    {
+        if (item.type != CBOR_ITEM_TEXT || !cbor_reader_next(&reader, &value))
+        {
+            return false;
+        }
+
+        if (item.length == 6 && memcmp(item.data, "device", 6) == 0 && value.type == CBOR_ITEM_TEXT && value.length < sizeof(out->device))
+        {
+            memcpy(out->device, value.data, value.length);
+            out->device[value.length] = 0;
+        }
+        else if (item.length == 3 && memcmp(item.data, "seq", 3) == 0 && value.type == CBOR_ITEM_UNSIGNED)
+        {
+            out->seq = value.value;
+        }
+        else if (item.length == 11 && memcmp(item.data, "temperature", 11) == 0 && value.type == CBOR_ITEM_FLOAT)
+        {
+            out->temperature = value.real;
+        }
+        else if (item.length == 2 && memcmp(item.data, "ok", 2) == 0)
+        {
+            out->ok = value.type == CBOR_ITEM_TRUE;
+        }
+        else if (!cbor_reader_skip(&reader, &value))
+        {
+            return false;
+        }
+    }
+
+    return !cbor_reader_has_error(&reader);
+}
+
+void bench_cbor(void)
+{
+    const size_t messages = 1000000;
+    char message[256];
+    uint8_t packed[256];
+    size_t json_bytes = 0;
+    size_t cbor_bytes = 0;
+    double start = 0;
+    bench_telemetry_t bound;
+    memset(&bound, 0, sizeof(bound));
+
+    // Telemetry message: JSON writer versus CBOR writer into fixed buffers
+    json_writer_t* jw = json_writer_allocate_fixed(message, sizeof(message), false);
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        json_writer_reset(jw);
+        json_writer_begin_object(jw);
+        json_writer_key(jw, "device");
+        json_writer_string(jw, "sensor-0042");
+        json_writer_key(jw, "seq");
+        json_writer_uint64(jw, idx);
+        json_writer_key(jw, "temperature");
+        json_writer_double(jw, 21.5 + (double)(idx % 100) / 100.0);
+        json_writer_key(jw, "ok");
+        json_writer_boolean(jw, true);
+        json_writer_end_object(jw);
+        json_writer_flush(jw);
+        json_bytes += json_writer_get_length(jw);
+    }
+    bench_report("json write telemetry", bench_now() - start, json_bytes, messages);
+    json_writer_free(jw);
+
+    cbor_writer_t* cw = cbor_writer_allocate_fixed(packed, sizeof(packed));
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        cbor_writer_reset(cw);
+        cbor_writer_begin_map(cw, 4);
+        cbor_writer_text_length(cw, "device", 6);
+        cbor_writer_text_length(cw, "sensor-0042", 11);
+        cbor_writer_text_length(cw, "seq", 3);
+        cbor_writer_uint64(cw, idx);
+        cbor_writer_text_length(cw, "temperature", 11);
+        cbor_writer_double(cw, 21.5 + (double)(idx % 100) / 100.0);
+        cbor_writer_text_length(cw, "ok", 2);
+        cbor_writer_boolean(cw, true);
+        cbor_bytes += cbor_writer_get_length(cw);
+    }
+    assert(!cbor_writer_has_error(cw));
+    bench_report("cbor write telemetry", bench_now() - start, cbor_bytes, messages);
+    printf("%-36s %10.1f bytes json %8.1f bytes cbor\n", "telemetry message size", (double)json_bytes / (double)messages, (double)cbor_bytes / (double)messages);
+
+    // Reading it back into a struct
+    const char* telemetry_message = "{\"device\":\"sensor-0042\",\"seq\":123456,\"temperature\":21.57,\"ok\":true}";
+    size_t telemetry_message_len = strlen(telemetry_message);
+    buffer_t* converted = buffer_allocate_default();
+    bool done = cbor_from_json(telemetry_message, telemetry_message_len, converted);
+    assert(done);
+    size_t packed_len = buffer_get_size(converted);
+    memcpy(packed, buffer_get_data(converted), packed_len);
+
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        done = json_bind_decode(&bench_telemetry_schema, telemetry_message, telemetry_message_len, &bound);
+        assert(done);
+    }
+    bench_report("json read telemetry (bind)", bench_now() - start, telemetry_message_len * messages, messages);
+
+    start = bench_now();
+    for (size_t idx = 0; idx < messages; idx++)
+    {
+        done = bench_cbor_read_telemetry(packed, packed_len, &bound);
+        assert(done);
+    }
+    bench_report("cbor read telemetry (reader)", bench_now() - start, packed_len * messages, messages);
+    assert(bound.seq == 123456 && bound.ok);
+    (void)done;
+    cbor_writer_free(cw);
+
+    // A larger document through both event interfaces
+    size_t length = 0;
+    char* input = bench_json_make_document(100000, &length);
+    const int rounds = 10;
+    buffer_clear(converted);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        buffer_clear(converted);
+        done = cbor_from_json(input, length, converted);
+        assert(done);
+    }
+    bench_report("json to cbor (100000 records)", bench_now() - start, length * rounds, rounds);
+    printf("%-36s %10zu bytes json %8zu bytes cbor\n", "document size", length, buffer_get_size(converted));
+
+    json_sax_handler_t handler;
+    memset(&handler, 0, sizeof(handler));
+    handler.on_number = bench_cbor_number;
+    size_t digits = 0;
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        json_sax_status_t status = json_sax_parse(input, length, &handler, &digits);
+        assert(status == JSON_SAX_OK);
+        (void)status;
+    }
+    bench_report("json sax parse", bench_now() - start, length * rounds, rounds);
+
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        json_sax_status_t status = cbor_parse_sax((const uint8_t*)buffer_get_data(converted), buffer_get_size(converted), &handler, &digits);
+        assert(status == JSON_SAX_OK);
+        (void)status;
+    }
+    bench_report("cbor sax parse", bench_now() - start, buffer_get_size(converted) * rounds, rounds);
+
+    size_t items = 0;
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        cbor_reader_t reader;
+        cbor_item_t item;
+        cbor_reader_init(&reader, (const uint8_t*)buffer_get_data(converted), buffer_get_size(converted));
+        while (cbor_reader_next(&reader, &item))
+        {
+            items++;
+        }
+        assert(!cbor_reader_has_error(&reader));
+    }
+    bench_report("cbor reader walk", bench_now() - start, buffer_get_size(converted) * rounds, items);
+
+    buffer_t* back = buffer_allocate_length(length + 1);
+    jw = json_writer_allocate(back, false);
+    start = bench_now();
+    for (int round = 0; round < rounds; round++)
+    {
+        buffer_clear(back);
+        json_writer_reset(jw);
+        done = cbor_to_json((const uint8_t*)buffer_get_data(converted), buffer_get_size(converted), jw);
+        json_writer_flush(jw);
+        assert(done);
+    }
+    bench_report("cbor to json", bench_now() - start, buffer_get_size(back) * rounds, rounds);
+    json_writer_free(jw);
+    buffer_free(&back);
+
+    buffer_free(&converted);
+    free(input);
+}
+
+void bench_configuration(void)
+{
+    const int section_count = 64;
+    const int key_count = 32;
+    const size_t lookups = 4000000;
+    char path[256];
+    char names[64][16];
+    char keys[32][16];
+    double start = 0;
+    size_t found = 0;
+
+    snprintf(path, sizeof(path), "/tmp/treonz_bench_%d.conf", (int)getpid());
+
+    FILE* fp = fopen(path, "w");
+    assert(fp != NULL);
+    for (int sec = 0; sec < section_count; sec++)
+    {
+        snprintf(names[sec], sizeof(names[sec]), "section_%d", sec);
+        fprintf(fp, "[%s]\n", names[sec]);
+        for (int key = 0; key < key_count; key++)
+        {
+            snprintf(keys[key], sizeof(keys[key]), "key_%d", key);
+            fprintf(fp, "%s = %d\n", keys[key], sec * key);
+        }
+    }
+    fclose(fp);
+
+    // Startup: parsing the file versus mapping its compiled image
+    const int startups = 2000;
+    char cache_path[272];
+    snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+    bool compiled = configuration_compile(path, cache_path);
+    assert(compiled);
+    (void)compiled;
+
+    start = bench_now();
+    for (int round = 0; round < startups; round++)
+    {
+        configuration_release(configuration_allocate(path));
+    }
+    bench_report("configuration parse startup", bench_now() - start, 0, startups);
+
+    start = bench_now();
+    for (int round = 0; round < startups; round++)
+    {
+        configuration_release(configuration_allocate_cached(path, cache_path));
+    }
+    bench_report("configuration cached startup", bench_now() - start, 0, startups);
+    unlink(cache_path);
+
+    configuration_t* conf = configuration_allocate(path);
+    assert(conf != NULL);
+
+    // Hot path lookups spread over the whole file
+    start = bench_now();
+    for (size_t idx = 0; idx < lookups; idx++)
+    {
+        const char* value = configuration_get_value_as_string(conf, names[idx % section_count], keys[(idx / section_count) % key_count]);
+        found += (value != NULL);
+    }
+    bench_report("configuration lookup", bench_now() - start, 0, lookups);
+    assert(found == lookups);
+
+    // Per message reads of typed values: string getters versus bound handles
+    long sum = 0;
+    start = bench_now();
+    for (size_t idx = 0; idx < lookups; idx++)
+    {
+        sum += configuration_get_value_as_integer(conf, "section_7", "key_3");
+    }
+    bench_report("configuration get integer", bench_now() - start, 0, lookups);
+
+    configuration_value_t* bound = configuration_bind(conf, "section_7", "key_3");
+    long bound_sum = 0;
+    start = bench_now();
+    for (size_t idx = 0; idx < lookups; idx++)
+    {
+        bound_sum += configuration_value_integer(bound, 0);
+    }
+    bench_report("configuration bound integer", bench_now() - start, 0, lookups);
+    assert(sum == bound_sum);
+
+    // Rewrite one value each round so every reload publishes a snapshot
+    const int reloads = 200;
+    start = bench_now();
+    for (int round = 0; round < reloads; round++)
+    {
+        fp = fopen(path, "a");
+        fprintf(fp, "[section_0]\nround = %d\n", round);
+        fclose(fp);
+        configuration_reload(conf);
+    }
+    bench_report("configuration reload", bench_now() - start, 0, reloads);
+    assert(configuration_get_generation(conf) == (uint64_t)reloads + 1);
+    assert(configuration_value_integer(bound, 0) == 21);
+    configuration_unbind(bound);
+
+    configuration_release(conf);
+    unlink(path);
+}
+
+void bench_logger(void)
+{
+    const size_t entries = 200000;
+    char path[256];
+    double start = 0;
+
+    snprintf(path, sizeof(path), "/tmp/treonz_bench_%d.log", (int)getpid());
+
+    // Synchronous: every call formats and writes its own line
+    logger_t* logger = logger_allocate_file(10, path);
+    assert(logger != NULL);
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        WriteLog(logger, "benchmark log entry with a typical message length", LOG_INFO);
+    }
+    bench_report("logger sync write", bench_now() - start, 0, entries);
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        logger_write(logger, "benchmark log entry with a typical message length", LOG_INFO, __PRETTY_FUNCTION__, __FILE__, __LINE__);
+    }
+    bench_report("logger sync write (no call site)", bench_now() - start, 0, entries);
+    logger_release(logger);
+    remove(path);
+
+    // Asynchronous: the caller only formats and queues the line
+    logger = logger_allocate_file(10, path);
+    assert(logger != NULL);
+    bool started = logger_start_async(logger, 32 * 1024 * 1024, LOGGER_OVERFLOW_BLOCK);
+    assert(started);
+    (void)started;
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        WriteLog(logger, "benchmark log entry with a typical message length", LOG_INFO);
+    }
+    bench_report("logger async write", bench_now() - start, 0, entries);
+
+    start = bench_now();
+    logger_flush(logger);
+    bench_report("logger async drain", bench_now() - start, 0, entries);
+
+    logger_release(logger);
+    remove(path);
+
+    // Binary: raw arguments, formatted later by the decoder
+    logger = logger_allocate_binary(10, path);
+    assert(logger != NULL);
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        WriteLogBinary(logger, LOG_INFO, "benchmark log entry %zu with value %d", index, 42);
+    }
+    bench_report("logger binary write", bench_now() - start, 0, entries);
+    logger_release(logger);
+    remove(path);
+
+    logger = logger_allocate_binary(10, path);
+    assert(logger != NULL);
+    started = logger_start_async(logger, 32 * 1024 * 1024, LOGGER_OVERFLOW_BLOCK);
+    assert(started);
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        WriteLogBinary(logger, LOG_INFO, "benchmark log entry %zu with value %d", index, 42);
+    }
+    bench_report("logger binary async write", bench_now() - start, 0, entries);
+
+    logger_release(logger);
+    remove(path);
+
+    // Limited: nearly every call is refused by the call site's bucket
+    logger = logger_allocate_file(10, path);
+    assert(logger != NULL);
+    logger_set_rate_limit(logger, LOG_ERROR, 10, 10);
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        WriteLog(logger, "benchmark log entry with a typical message length", LOG_ERROR);
+    }
+    bench_report("logger rate limited write", bench_now() - start, 0, entries);
+
+    logger_set_rate_limit(logger, LOG_ERROR, 0, 0);
+    logger_set_sampling(logger, LOG_ERROR, 1000);
+
+    start = bench_now();
+    for (size_t index = 0; index < entries; index++)
+    {
+        WriteLog(logger, "benchmark log entry with a typical message length", LOG_ERROR);
+    }
+    bench_report("logger sampled write (1 in 1000)", bench_now() - start, 0, entries);
+
+    logger_release(logger);
+    remove(path);
+}
+
+void bench_datetime(void)
+{
+    const size_t rounds = 1000000;
+    time_t base = 1792300000;
+    char text[64];
+    size_t total = 0;
+    double start = 0;
+
+    // libc: localtime_r plus strftime
+    start = bench_now();
+    for (size_t index = 0; index < rounds; index++)
+    {
+        time_t t = base + (time_t)index;
+        struct tm local_tm;
+        localtime_r(&t, &local_tm);
+        total += strftime(text, sizeof(text), "%a, %d %b %Y %H:%M:%S %z", &local_tm);
+    }
+    bench_report("strftime rfc2822", bench_now() - start, total, rounds);
+
+    total = 0;
+    start = bench_now();
+    for (size_t index = 0; index < rounds; index++)
+    {
+        time_t t = base + (time_t)index;
+        total += date_time_format_rfc2822(t, date_time_get_local_offset(t), text, sizeof(text));
+    }
+    bench_report("date_time_format_rfc2822", bench_now() - start, total, rounds);
+
+    const char* stamp = "2026-10-18T09:30:15Z";
+    size_t stamp_len = strlen(stamp);
+    time_t parsed = 0;
+    time_t sum = 0;
+
+    start = bench_now();
+    for (size_t index = 0; index < rounds; index++)
+    {
+        date_time_parse_rfc3339(stamp, stamp_len, &parsed, NULL);
+        sum += parsed;
+    }
+    bench_report("date_time_parse_rfc3339", bench_now() - start, stamp_len * rounds, rounds);
+
+    const char* header = "Sun, 18 Oct 2026 11:30:15 +0200";
+    size_t header_len = strlen(header);
+
+    start = bench_now();
+    for (size_t index = 0; index < rounds; index++)
+    {
+        date_time_parse_rfc2822(header, header_len, &parsed, NULL);
+        sum += parsed;
+    }
+    bench_report("date_time_parse_rfc2822", bench_now() - start, header_len * rounds, rounds);
+
+    if (sum == 0)
+    {
+        printf("%s\n", text);
+    }
+}
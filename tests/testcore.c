@@ -3,13 +3,26 @@
 #include <stdio.h>
 #include <malloc.h>
 #include <memory.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "listdoublelinked.h"
 #include "stringex.h"
 #include "variant.h"
 #include "datetime.h"
 #include "signalhandler.h"
 #include "json.h"
+#include "jsonsax.h"
+#include "jsonwriter.h"
+#include "jsonpath.h"
+#include "jsonlines.h"
+#include "jsonbind.h"
+#include "cbor.h"
 #include "xml.h"
+#include "xmlsax.h"
+#include "xmlwriter.h"
+#include "xmlpath.h"
 
 extern int raise(int sig);
 
@@ -18,15 +31,33 @@ void test_string_list(void);
 void test_string(void);
 void test_buffer(void);
 void test_logger(void);
+static void* test_logger_writer(void* arg);
+static void* test_logger_binary_writer(void* arg);
+static void* test_logger_limit_writer(void* arg);
 void test_configuration(void);
+static void* test_configuration_reader(void* arg);
 void test_dictionary(void);
 void test_variant(void);
 void test_keyvalue(void);
 void test_datetime(void);
 void test_signalhandler(void);
 void test_base64(void);
+static void* test_base64_decoder(void* arg);
+void test_quoted_printable(void);
+void test_gzip(void);
 void test_json(void);
+static void* test_json_reader(void* arg);
+void test_json_sax(void);
+void test_json_writer(void);
+void test_json_path(void);
+static void* test_json_path_reader(void* arg);
+void test_json_lines(void);
+void test_json_bind(void);
+void test_cbor(void);
 void test_xml(void);
+void test_xml_sax(void);
+void test_xml_writer(void);
+void test_xml_path(void);
 void test_file(void);
 void test_directory(void);
 void test_environment(void);
@@ -52,6 +83,18 @@ int main(int argc, char* argv[])
             test_base64();
             break;
         }
+        case 'p':
+        {
+            //QuotedPrintable
+            test_quoted_printable();
+            break;
+        }
+        case 'Z':
+        {
+            //Gzip
+            test_gzip();
+            break;
+        }
         case 'f':
         {
             //Buffer
@@ -82,6 +125,42 @@ int main(int argc, char* argv[])
             test_json();
             break;
         }
+        case 'j':
+        {
+            //Json SAX
+            test_json_sax();
+            break;
+        }
+        case 'o':
+        {
+            //Json writer
+            test_json_writer();
+            break;
+        }
+        case 'h':
+        {
+            //Json path
+            test_json_path();
+            break;
+        }
+        case 'a':
+        {
+            //Json lines
+            test_json_lines();
+            break;
+        }
+        case 'z':
+        {
+            //Json struct binding
+            test_json_bind();
+            break;
+        }
+        case 'C':
+        {
+            //Cbor
+            test_cbor();
+            break;
+        }
         case 'u':
         {
             //Directory
@@ -130,6 +209,24 @@ int main(int argc, char* argv[])
             test_xml();
             break;
         }
+        case 'R':
+        {
+            //Xml sax
+            test_xml_sax();
+            break;
+        }
+        case 'O':
+        {
+            //Xml writer
+            test_xml_writer();
+            break;
+        }
+        case 'H':
+        {
+            //Xml path
+            test_xml_path();
+            break;
+        }
         case 'i':
         {
             //SignalHandler
@@ -173,7 +270,7 @@ int main(int argc, char* argv[])
     }
     else
     {
-        printf("Usage : coretest <option>\nOptions are b, f, c, d, t, y(json), u(directory), w(environment), e, k, l, g, q, r, i, s, x, n, v\n");
+        printf("Usage : coretest <option>\nOptions are b, p, Z(gzip), f, c, d, t, y(json), j(json sax), o(json writer), h(json path), a(json lines), z(json bind), C(cbor), u(directory), w(environment), e, k, l, g, q, r(xml), R(xml sax), O(xml writer), H(xml path), i, s, x, n, v\n");
     }
 
     return 0;
@@ -406,235 +503,2782 @@ void test_logger(void)
     assert(logger_write(logger, "test", (LogLevel)99, __PRETTY_FUNCTION__, __FILE__, __LINE__) == false);
 
     logger_release(logger);
-}
-
-void test_json(void)
-{
-    const char* js = "{\"name\":\"treonz\",\"num\":123,\"flag\":true,\"arr\":[\"a\",\"b\"]}";
-    json_document_t* doc = NULL;
-    json_document_t* doc_file = NULL;
-    FILE* fp = NULL;
-    const char* tmp_json = "/tmp/treonz_json_test.json";
 
-    doc = json_parse_string(js);
-    assert(doc != NULL);
+    /* Line layout, with the function reduced to its name */
+    const char* layout_file = "/tmp/treonz_logger_layout.log";
+    char line[512];
 
-    assert(json_parse_string("{\"bad\": }") == NULL);
+    remove(layout_file);
+    logger = logger_allocate_file(1, layout_file);
+    assert(logger != NULL);
+    assert(logger_write(logger, "first", LOG_ERROR, "static unsigned int sample(int value)", "/src/dir\\module.c", -7));
+    for (int index = 0; index < 2; index++)
+    {
+        assert(WriteLog(logger, "second", LOG_PANIC));
+    }
+    logger_release(logger);
 
-    fp = fopen(tmp_json, "wb");
+    FILE* fp = fopen(layout_file, "r");
     assert(fp != NULL);
-    assert(fwrite(js, 1, strlen(js), fp) == strlen(js));
+    assert(fgets(line, sizeof(line), fp) != NULL);
+    assert(strlen(line) == 19 + strlen("\tError\tmodule.c\t-7\tsample\tfirst\n"));
+    assert(strcmp(line + 19, "\tError\tmodule.c\t-7\tsample\tfirst\n") == 0);
+    assert(line[2] == '-' && line[5] == '-' && line[10] == ' ' && line[13] == ':' && line[16] == ':');
+    for (int index = 0; index < 2; index++)
+    {
+        assert(fgets(line, sizeof(line), fp) != NULL);
+        assert(strstr(line + 19, "\tPanic\ttestcore.c\t") == line + 19);
+        assert(strstr(line, "\ttest_logger\tsecond\n") != NULL);
+    }
+    assert(fgets(line, sizeof(line), fp) == NULL);
     fclose(fp);
-    fp = NULL;
-
-    doc_file = json_load_file(tmp_json);
-    assert(doc_file != NULL);
-
-    remove(tmp_json);
+    remove(layout_file);
 
-    json_free_document(doc_file);
+    /* Asynchronous mode: concurrent writers, every line whole and present */
+    const char* async_file = "/tmp/treonz_logger_async.log";
+    pthread_t writers[4];
+    size_t line_count = 0;
+    size_t per_writer[4] = {0};
 
-    json_free_document(doc);
-}
+    remove(async_file);
+    logger = logger_allocate_file(10, async_file);
+    assert(logger != NULL);
+    assert(logger_start_async(logger, 64 * 1024, LOGGER_OVERFLOW_BLOCK));
+    assert(!logger_start_async(logger, 64 * 1024, LOGGER_OVERFLOW_BLOCK));
 
-void test_xml(void)
-{
-    const char* xs = "<?xml version=\"1.0\"?><root><item id=\"42\">hello</item><item>world</item></root>";
-    const char* malformed = "<root><item></root>";
-    xml_document_t* doc = NULL;
-    xml_document_t* malformed_doc = NULL;
-    xml_document_t* doc_file = NULL;
-    FILE* fp = NULL;
-    const char* tmp_xml = "/tmp/treonz_xml_test.xml";
+    for (size_t index = 0; index < 4; index++)
+    {
+        assert(pthread_create(&writers[index], NULL, test_logger_writer, logger) == 0);
+    }
 
-    doc = xml_parse_string(xs);
-    assert(doc != NULL);
+    for (size_t index = 0; index < 4; index++)
+    {
+        pthread_join(writers[index], NULL);
+    }
 
-    malformed_doc = xml_parse_string(malformed);
+    assert(logger_flush(logger));
+    assert(logger_get_dropped(logger) == 0);
 
-    fp = fopen(tmp_xml, "wb");
+    fp = fopen(async_file, "r");
     assert(fp != NULL);
-    assert(fwrite(xs, 1, strlen(xs), fp) == strlen(xs));
-    fclose(fp);
-    fp = NULL;
-
-    doc_file = xml_load_file(tmp_xml);
-    assert(doc_file != NULL);
 
-    remove(tmp_xml);
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        unsigned int writer = 0;
+        unsigned int sequence = 0;
+        const char* message = strstr(line, "writer ");
+
+        assert(line[strlen(line) - 1] == '\n');
+        assert(message != NULL);
+        assert(sscanf(message, "writer %u entry %u", &writer, &sequence) == 2);
+        assert(writer < 4 && sequence == per_writer[writer]);
+        per_writer[writer]++;
+        line_count++;
+    }
 
-    xml_free_document(malformed_doc);
-    xml_free_document(doc_file);
-    xml_free_document(doc);
-}
+    fclose(fp);
+    assert(line_count == 4 * 5000);
 
-void test_file(void)
-{
-    char* parent = NULL;
-    char* base = NULL;
-    char* ext = NULL;
+    /* A line longer than the ring allows still goes out, in order */
+    char* long_entry = (char*)malloc(40000);
+    assert(long_entry != NULL);
+    memset(long_entry, 'x', 39999);
+    long_entry[39999] = 0;
+    assert(WriteLog(logger, "before long", LOG_INFO));
+    assert(WriteLog(logger, long_entry, LOG_INFO));
+    free(long_entry);
 
-    assert(file_is_exists(NULL) == false);
-    assert(file_get_parent_directory(NULL) == NULL);
-    assert(file_get_basename(NULL) == NULL);
-    assert(file_get_extension(NULL) == NULL);
+    logger_release(logger);
 
-    parent = file_get_parent_directory("/tmp/abc.txt");
-    assert(parent != NULL);
-    assert(strcmp(parent, "/tmp") == 0);
-    free(parent);
+    fp = fopen(async_file, "r");
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    assert(ftell(fp) > 40000);
+    fclose(fp);
+    remove(async_file);
 
-    parent = file_get_parent_directory("abc.txt");
-    assert(parent == NULL);
+    /* A queued line larger than one write batch does not stall the writer */
+    logger = logger_allocate_file(10, async_file);
+    assert(logger != NULL);
+    assert(logger_start_async(logger, 1024 * 1024, LOGGER_OVERFLOW_BLOCK));
+
+    long_entry = (char*)malloc(100 * 1024);
+    assert(long_entry != NULL);
+    memset(long_entry, 'y', 100 * 1024 - 1);
+    long_entry[100 * 1024 - 1] = 0;
+    assert(WriteLog(logger, "before huge", LOG_INFO));
+    assert(WriteLog(logger, long_entry, LOG_INFO));
+    assert(WriteLog(logger, "after huge", LOG_INFO));
+    assert(logger_flush(logger));
+    free(long_entry);
+    logger_release(logger);
 
-    base = file_get_basename("stdin");
-    assert(base != NULL);
-    assert(strcmp(base, "stdin") == 0);
-    free(base);
+    fp = fopen(async_file, "r");
+    assert(fp != NULL);
+    char* huge_line = (char*)malloc(128 * 1024);
+    assert(huge_line != NULL);
+    assert(fgets(huge_line, 128 * 1024, fp) != NULL && strstr(huge_line, "before huge") != NULL);
+    assert(fgets(huge_line, 128 * 1024, fp) != NULL && strstr(huge_line, "yyyy") != NULL);
+    assert(huge_line[strlen(huge_line) - 1] == '\n');
+    assert(fgets(huge_line, 128 * 1024, fp) != NULL && strstr(huge_line, "after huge") != NULL);
+    free(huge_line);
+    fclose(fp);
+    remove(async_file);
 
-    base = file_get_basename("/tmp/abc.txt");
-    assert(base != NULL);
-    assert(strcmp(base, "abc.txt") == 0);
-    free(base);
+    /* Drop policies never block and account for every lost line */
+    logger = logger_allocate_file(10, async_file);
+    assert(logger != NULL);
+    assert(logger_start_async(logger, 0, LOGGER_OVERFLOW_COUNT));
 
-    ext = file_get_extension("noext");
-    assert(ext != NULL);
-    assert(strcmp(ext, "") == 0);
-    free(ext);
+    size_t accepted = 0;
+    for (size_t index = 0; index < 50000; index++)
+    {
+        if (WriteLog(logger, "burst", LOG_INFO))
+        {
+            accepted++;
+        }
+    }
 
-    ext = file_get_extension("/tmp/abc.txt");
-    assert(ext != NULL);
-    assert(strcmp(ext, "txt") == 0);
-    free(ext);
-}
+    assert(accepted + logger_get_dropped(logger) == 50000);
+    uint64_t dropped = logger_get_dropped(logger);
+    logger_release(logger);
 
-void test_directory(void)
-{
-    string_t* parent = NULL;
-    string_t* tmp = NULL;
-    string_t* logd = NULL;
-    string_t* cfg = NULL;
-    string_t* missing = NULL;
-    const char* old_user = getenv("USER");
+    fp = fopen(async_file, "r");
+    assert(fp != NULL);
+    line_count = 0;
+    bool reported = (dropped == 0);
 
-    assert(dir_is_exists(NULL) == false);
-    assert(dir_get_parent_directory(NULL) == NULL);
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (strstr(line, "log entries dropped") != NULL)
+        {
+            reported = true;
+        }
+        else
+        {
+            line_count++;
+        }
+    }
 
-    parent = string_allocate("/tmp/treonz/sub");
-    assert(parent != NULL);
-    string_t* parent_dir = dir_get_parent_directory(parent);
-    assert(parent_dir != NULL);
-    assert(strcmp(string_c_str(parent_dir), "/tmp/treonz") == 0);
-    string_free(&parent_dir);
-    string_free(&parent);
+    fclose(fp);
+    assert(line_count == accepted);
+    assert(reported);
+    remove(async_file);
 
-    missing = string_allocate("/path/that/does/not/exist");
-    assert(missing != NULL);
-    assert(dir_is_exists(missing) == false);
-    string_free(&missing);
+    /* Binary mode records raw arguments and decodes to the text layout */
+    const char* binary_file = "/tmp/treonz_logger_binary.log";
+    const char* decoded_file = "/tmp/treonz_logger_binary.txt";
 
-    unsetenv("USER");
-    tmp = dir_get_temp_directory();
-    logd = dir_get_log_directory();
-    cfg = dir_get_config_directory();
-    assert(tmp != NULL && logd != NULL && cfg != NULL);
-    assert(strcmp(string_c_str(tmp), "/tmp/") == 0);
-    assert(strcmp(string_c_str(logd), "/var/log/") == 0);
-    assert(strcmp(string_c_str(cfg), "/etc/") == 0);
-    string_free(&tmp);
-    string_free(&logd);
-    string_free(&cfg);
+    remove(binary_file);
+    logger = logger_allocate_binary(10, binary_file);
+    assert(logger != NULL);
 
-    if(old_user != NULL)
+    for (int index = 0; index < 3; index++)
     {
-        setenv("USER", old_user, 1);
+        WriteLogBinary(logger, LOG_WARNING, "int %d long %ld size %zu hex %#x", -index, 1234567890123L, (size_t)index, 255);
     }
-}
 
-void test_environment(void)
-{
-    string_t* user = NULL;
-    string_t* proc = NULL;
-    string_t* lock_name = NULL;
-    const char* old_user = getenv("USER");
-    char* old_user_copy = old_user ? strdup(old_user) : NULL;
+    WriteLogBinary(logger, LOG_ERROR, "real %.3f %e str [%s] [%-6s] [%.*s] 100%%", 3.14159, 1e-7, "abc", "ab", 3, "truncated");
+    WriteLogBinary(logger, LOG_INFO, "null %s char %c width [%*d]", (const char*)NULL, 'z', 5, 42);
+    WriteLogBinary(logger, LOG_INFO, "no arguments");
+    WriteLog(logger, "plain text entry", LOG_CRITICAL);
+    assert(!logger_write_binary(logger, NULL));
 
-    unsetenv("USER");
+    logger_set_log_level(logger, LOG_ERROR);
+    WriteLogBinary(logger, LOG_INFO, "filtered %d", 1);
+    logger_set_log_level(logger, LOG_INFO);
 
-    user = env_get_current_user_name();
-    assert(user != NULL);
-    assert(strcmp(string_c_str(user), "root") == 0);
-    string_free(&user);
+    /* Unrecordable conversions are refused */
+    static logger_site_t bad_site = {LOG_INFO, __LINE__, "count %n", __FILE__, __PRETTY_FUNCTION__, NULL, {0, 0, 0}};
+    int written_count = 0;
+    assert(!logger_write_binary(logger, &bad_site, &written_count));
 
-    proc = env_get_current_process_name();
-    assert(proc != NULL);
-    assert(string_get_length(proc) > 0);
-    string_free(&proc);
+    logger_release(logger);
 
-    lock_name = env_get_lock_filename();
-    assert(lock_name != NULL);
-    assert(string_get_length(lock_name) > 0);
-    string_free(&lock_name);
+    fp = fopen(decoded_file, "w");
+    assert(fp != NULL);
+    assert(logger_decode_binary(binary_file, fp));
+    fclose(fp);
 
-    if (env_lock_process())
+    const char* expected[] =
     {
-        assert(env_is_process_locked() == true);
-        assert(env_unlock_process() == true);
-    }
-
-    assert(env_is_process_locked() == false);
+        "Warning\ttestcore.c\t", "int 0 long 1234567890123 size 0 hex 0xff",
+        "Warning\ttestcore.c\t", "int -1 long 1234567890123 size 1 hex 0xff",
+        "Warning\ttestcore.c\t", "int -2 long 1234567890123 size 2 hex 0xff",
+        "Error\ttestcore.c\t", "real 3.142 1.000000e-07 str [abc] [ab    ] [tru] 100%",
+        "Information\ttestcore.c\t", "null (null) char z width [   42]",
+        "Information\ttestcore.c\t", "no arguments",
+        "Critical\ttestcore.c\t", "plain text entry"
+    };
+
+    fp = fopen(decoded_file, "r");
+    assert(fp != NULL);
+    line_count = 0;
 
-    if(old_user_copy != NULL)
+    while (fgets(line, sizeof(line), fp) != NULL)
     {
-        setenv("USER", old_user_copy, 1);
-        free(old_user_copy);
+        assert(line_count < 7);
+        assert(strstr(line, expected[line_count * 2]) != NULL);
+        assert(strstr(line, "\ttest_logger\t") != NULL);
+        line[strlen(line) - 1] = 0;
+        assert(strcmp(strrchr(line, '\t') + 1, expected[line_count * 2 + 1]) == 0);
+        line_count++;
     }
-}
 
-void test_configuration(void)
-{
-    configuration_t* conf = configuration_allocate_default();
+    fclose(fp);
+    assert(line_count == 7);
 
-    string_list_t* sections = configuration_get_all_sections(conf);
+    /* Corrupted files are rejected rather than printed with the wrong types */
+    const char* corrupt_file = "/tmp/treonz_logger_corrupt.log";
+    fp = fopen(binary_file, "rb");
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    long binary_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char* binary_data = (unsigned char*)malloc((size_t)binary_size);
+    assert(binary_data != NULL);
+    assert(fread(binary_data, 1, (size_t)binary_size, fp) == (size_t)binary_size);
+    fclose(fp);
 
-    string_t* sec_str = NULL;
-    sec_str = string_get_first_from_list(sections);
+    FILE* sink = fopen("/dev/null", "w");
+    assert(sink != NULL);
+    const unsigned char flips[] = {1, 2, 7, 9, 10, 0x7F, 0xFF};
 
-    while(sec_str)
+    for (long offset = 0; offset < binary_size; offset++)
     {
-        printf("Section %s\n", string_c_str(sec_str));
-        
-        string_list_t* keys = NULL;
-        keys = configuration_get_all_keys(conf, string_c_str(sec_str));
-
-        string_t* key_str = NULL;
-        key_str = string_get_first_from_list(keys);
+        unsigned char original = binary_data[offset];
 
-        while(key_str)
+        for (size_t flip = 0; flip < sizeof(flips); flip++)
         {
-            printf("Key %s Value %s\n", string_c_str(key_str), configuration_get_value_as_string(conf, string_c_str(sec_str), string_c_str(key_str)));
-            key_str = string_get_next_from_list(keys);
+            binary_data[offset] = flips[flip];
+            fp = fopen(corrupt_file, "wb");
+            assert(fp != NULL);
+            assert(fwrite(binary_data, 1, (size_t)binary_size, fp) == (size_t)binary_size);
+            fclose(fp);
+            logger_decode_binary(corrupt_file, sink);
         }
 
-        string_free_list(keys);
-
-        sec_str = string_get_next_from_list(sections);
+        binary_data[offset] = original;
     }
 
-    string_free_list(sections);
+    fclose(sink);
+    free(binary_data);
+    remove(corrupt_file);
 
-    configuration_release(conf);
-}
+    /* Asynchronous binary logging from several threads */
+    logger = logger_allocate_binary(10, binary_file);
+    assert(logger != NULL);
+    assert(logger_start_async(logger, 64 * 1024, LOGGER_OVERFLOW_BLOCK));
 
-void test_dictionary(void)
-{
-    dictionary_t* dict = dictionary_allocate();
-    int ref_value = 99;
+    for (size_t index = 0; index < 4; index++)
+    {
+        assert(pthread_create(&writers[index], NULL, test_logger_binary_writer, logger) == 0);
+    }
 
-    assert(dict != NULL);
+    for (size_t index = 0; index < 4; index++)
+    {
+        pthread_join(writers[index], NULL);
+    }
 
-    dictionary_set_value(dict, "123", strlen("123"), "ABCDEFGHIJKLMN", strlen("ABCDEFGHIJKLMN"));
-    dictionary_set_value(dict, "ABC", strlen("ABC"), "0123456789", strlen("0123456789"));
+    logger_release(logger);
+
+    fp = fopen(decoded_file, "w");
+    assert(fp != NULL);
+    assert(logger_decode_binary(binary_file, fp));
+    fclose(fp);
+
+    fp = fopen(decoded_file, "r");
+    assert(fp != NULL);
+    line_count = 0;
+    memset(per_writer, 0, sizeof(per_writer));
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        unsigned int writer = 0;
+        unsigned int sequence = 0;
+        const char* message = strstr(line, "binary writer ");
+
+        assert(message != NULL);
+        assert(sscanf(message, "binary writer %u entry %u", &writer, &sequence) == 2);
+        assert(writer < 4 && sequence == per_writer[writer]);
+        per_writer[writer]++;
+        line_count++;
+    }
+
+    fclose(fp);
+    assert(line_count == 4 * 5000);
+
+    remove(binary_file);
+    remove(decoded_file);
+
+    /* Size rotation keeps three compressed generations */
+    const char* rotate_file = "/tmp/treonz_logger_rotate.log";
+    char rotated_name[256];
+
+    remove(rotate_file);
+    for (int generation = 1; generation <= 4; generation++)
+    {
+        snprintf(rotated_name, sizeof(rotated_name), "%s.%d.gz", rotate_file, generation);
+        remove(rotated_name);
+    }
+
+    logger = logger_allocate_file(1, rotate_file);
+    assert(logger != NULL);
+    assert(logger_set_rotation(logger, 3, 4096, 0, true));
+    for (int index = 0; index < 600; index++)
+    {
+        snprintf(line, sizeof(line), "rotation entry %d", index);
+        assert(WriteLog(logger, line, LOG_INFO));
+    }
+    logger_release(logger);
+
+    for (int generation = 1; generation <= 3; generation++)
+    {
+        snprintf(rotated_name, sizeof(rotated_name), "%s.%d.gz", rotate_file, generation);
+        assert(access(rotated_name, F_OK) == 0);
+    }
+    snprintf(rotated_name, sizeof(rotated_name), "%s.4.gz", rotate_file);
+    assert(access(rotated_name, F_OK) != 0);
+
+    snprintf(rotated_name, sizeof(rotated_name), "%s.1.gz", rotate_file);
+    fp = fopen(rotated_name, "rb");
+    assert(fp != NULL);
+    unsigned char packed[8192];
+    size_t packed_len = fread(packed, 1, sizeof(packed), fp);
+    fclose(fp);
+    unsigned long unpacked_len = 0;
+    unsigned char* unpacked = gzip_decompress(packed, (unsigned long)packed_len, &unpacked_len);
+    assert(unpacked != NULL);
+    assert(unpacked_len >= 4096 && unpacked_len < 4096 + 512);
+    assert(memcmp(unpacked + 19, "\tInformation\ttestcore.c\t", 24) == 0);
+    assert(unpacked[unpacked_len - 1] == '\n');
+    free(unpacked);
+
+    for (int generation = 1; generation <= 3; generation++)
+    {
+        snprintf(rotated_name, sizeof(rotated_name), "%s.%d.gz", rotate_file, generation);
+        remove(rotated_name);
+    }
+    remove(rotate_file);
+
+    /* Time rotation without compression */
+    remove(rotate_file);
+    snprintf(rotated_name, sizeof(rotated_name), "%s.1", rotate_file);
+    remove(rotated_name);
+
+    logger = logger_allocate_file(1, rotate_file);
+    assert(logger != NULL);
+    assert(logger_set_rotation(logger, 2, 0, 1, false));
+    assert(WriteLog(logger, "before", LOG_INFO));
+    usleep(1100 * 1000);
+    assert(WriteLog(logger, "after", LOG_INFO));
+    logger_release(logger);
+
+    fp = fopen(rotated_name, "r");
+    assert(fp != NULL);
+    assert(fgets(line, sizeof(line), fp) != NULL);
+    assert(strstr(line, "\tbefore\n") != NULL);
+    fclose(fp);
+    fp = fopen(rotate_file, "r");
+    assert(fp != NULL);
+    assert(fgets(line, sizeof(line), fp) != NULL);
+    assert(strstr(line, "\tafter\n") != NULL);
+    fclose(fp);
+
+    remove(rotated_name);
+    remove(rotate_file);
+
+    /* A flapping call site is held to its token bucket */
+    const char* limit_file = "/tmp/treonz_logger_limit.log";
+    int admitted = 0;
+
+    remove(limit_file);
+    logger = logger_allocate_file(1, limit_file);
+    assert(logger != NULL);
+    assert(!logger_set_rate_limit(logger, (LogLevel)99, 1, 5));
+    assert(logger_set_rate_limit(logger, LOG_ERROR, 1, 5));
+    for (int round = 0; round < 2; round++)
+    {
+        for (int index = 0; index < 1000; index++)
+        {
+            if (WriteLog(logger, "flapping", LOG_ERROR))
+            {
+                admitted++;
+            }
+        }
+
+        if (round == 0)
+        {
+            assert(admitted == 5);
+            usleep(1100 * 1000);
+        }
+    }
+    assert(admitted == 6);
+    assert(logger_get_suppressed(logger) == 1994);
+
+    /* Sampling keeps one in N; other levels are untouched */
+    assert(logger_set_rate_limit(logger, LOG_ERROR, 0, 0));
+    assert(logger_set_sampling(logger, LOG_WARNING, 10));
+    admitted = 0;
+    for (int index = 0; index < 100; index++)
+    {
+        if (WriteLog(logger, "sampled", LOG_WARNING))
+        {
+            admitted++;
+        }
+        assert(WriteLog(logger, "kept", LOG_ERROR));
+    }
+    assert(admitted == 10);
+    assert(logger_get_suppressed(logger) == 1994 + 90);
+
+    /* Tiny rates and huge bursts saturate instead of overflowing */
+    assert(!logger_set_rate_limit(logger, LOG_CRITICAL, NAN, 1));
+    assert(logger_set_rate_limit(logger, LOG_CRITICAL, 1e-30, 1));
+    assert(logger_set_rate_limit(logger, LOG_PANIC, 1e-30, UINT32_MAX));
+    admitted = 0;
+    for (int index = 0; index < 3; index++)
+    {
+        if (WriteLog(logger, "rare", LOG_CRITICAL))
+        {
+            admitted++;
+        }
+        assert(WriteLog(logger, "bursty", LOG_PANIC));
+    }
+    assert(admitted == 1);
+    assert(logger_set_rate_limit(logger, LOG_CRITICAL, 0, 0));
+    assert(logger_set_rate_limit(logger, LOG_PANIC, 0, 0));
+
+    /* Limits may change while other threads log */
+    pthread_t limit_writers[2];
+    for (size_t index = 0; index < 2; index++)
+    {
+        assert(pthread_create(&limit_writers[index], NULL, test_logger_limit_writer, logger) == 0);
+    }
+    for (int index = 0; index < 200; index++)
+    {
+        assert(logger_set_sampling(logger, LOG_INFO, (uint32_t)(index % 3)));
+        assert(logger_set_rate_limit(logger, LOG_INFO, (index % 2) ? 1e6 : 0, 10));
+    }
+    for (size_t index = 0; index < 2; index++)
+    {
+        pthread_join(limit_writers[index], NULL);
+    }
+    assert(logger_set_sampling(logger, LOG_INFO, 0));
+    assert(logger_set_rate_limit(logger, LOG_INFO, 0, 0));
+    logger_release(logger);
+
+    fp = fopen(limit_file, "r");
+    assert(fp != NULL);
+    for (int index = 0; index < 7; index++)
+    {
+        assert(fgets(line, sizeof(line), fp) != NULL);
+        assert(strstr(line, "\tError\t") != NULL);
+        assert(strstr(line, index == 5 ? "\t995 log entries suppressed\n" : "\tflapping\n") != NULL);
+    }
+    fclose(fp);
+    remove(limit_file);
+
+    /* Binary call sites are limited the same way */
+    logger = logger_allocate_binary(1, binary_file);
+    assert(logger != NULL);
+    assert(logger_set_rate_limit(logger, LOG_CRITICAL, 1, 2));
+    for (int index = 0; index < 10; index++)
+    {
+        WriteLogBinary(logger, LOG_CRITICAL, "limited %d", index);
+    }
+    assert(logger_get_suppressed(logger) == 8);
+    logger_release(logger);
+
+    fp = fopen(decoded_file, "w");
+    assert(fp != NULL);
+    assert(logger_decode_binary(binary_file, fp));
+    fclose(fp);
+
+    fp = fopen(decoded_file, "r");
+    assert(fp != NULL);
+    assert(fgets(line, sizeof(line), fp) != NULL && strstr(line, "\tlimited 0\n") != NULL);
+    assert(fgets(line, sizeof(line), fp) != NULL && strstr(line, "\tlimited 1\n") != NULL);
+    assert(fgets(line, sizeof(line), fp) == NULL);
+    fclose(fp);
+
+    remove(binary_file);
+    remove(decoded_file);
+}
+
+static void* test_logger_binary_writer(void* arg)
+{
+    logger_t* logger = (logger_t*)arg;
+    static _Atomic unsigned int next_writer = 0;
+    unsigned int writer = atomic_fetch_add(&next_writer, 1);
+
+    for (unsigned int sequence = 0; sequence < 5000; sequence++)
+    {
+        WriteLogBinary(logger, LOG_INFO, "binary writer %u entry %u", writer, sequence);
+    }
+
+    return NULL;
+}
+
+static void* test_logger_limit_writer(void* arg)
+{
+    logger_t* logger = (logger_t*)arg;
+
+    for (int index = 0; index < 2000; index++)
+    {
+        WriteLog(logger, "churn", LOG_INFO);
+    }
+
+    return NULL;
+}
+
+static void* test_logger_writer(void* arg)
+{
+    logger_t* logger = (logger_t*)arg;
+    static _Atomic unsigned int next_writer = 0;
+    unsigned int writer = atomic_fetch_add(&next_writer, 1);
+    char entry[64];
+
+    for (unsigned int sequence = 0; sequence < 5000; sequence++)
+    {
+        snprintf(entry, sizeof(entry), "writer %u entry %u", writer, sequence);
+        assert(WriteLog(logger, entry, LOG_INFO));
+    }
+
+    return NULL;
+}
+
+static void* test_json_reader(void* arg)
+{
+    json_node_t* root = (json_node_t*)arg;
+    char fieldname[32];
+    int64_t ival = 0;
+
+    for (size_t idx = 0; idx < 500; idx++)
+    {
+        sprintf(fieldname, "field%zu", idx);
+        assert(json_node_get_int64(json_node_first_child_element(root, fieldname), &ival) && ival == (int64_t)idx);
+    }
+
+    return NULL;
+}
+
+void test_json(void)
+{
+    const char* js = "{\"name\":\"treonz\",\"num\":123,\"flag\":true,\"arr\":[\"a\",\"b\"]}";
+    json_document_t* doc = NULL;
+    json_document_t* doc_file = NULL;
+    FILE* fp = NULL;
+    const char* tmp_json = "/tmp/treonz_json_test.json";
+
+    doc = json_parse_string(js);
+    assert(doc != NULL);
+
+    assert(json_parse_string("{\"bad\": }") == NULL);
+
+    fp = fopen(tmp_json, "wb");
+    assert(fp != NULL);
+    assert(fwrite(js, 1, strlen(js), fp) == strlen(js));
+    fclose(fp);
+    fp = NULL;
+
+    doc_file = json_load_file(tmp_json);
+    assert(doc_file != NULL);
+
+    remove(tmp_json);
+
+    json_free_document(doc_file);
+
+    json_node_t* root = json_node_first_child_element(json_document_root(doc), NULL);
+    assert(root != NULL && json_node_type(root) == JSON_NODE_OBJECT);
+    json_node_t* arr = json_node_first_child_element(root, "arr");
+    assert(arr != NULL && json_node_type(arr) == JSON_NODE_ARRAY);
+    json_node_t* elem = json_node_first_child_element(arr, NULL);
+    assert(strcmp(json_node_get_text(elem), "a") == 0);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(strcmp(json_node_get_text(elem), "b") == 0);
+    assert(json_node_next_sibling_element(elem, NULL) == NULL);
+    assert(strcmp(json_node_get_text(json_node_first_child_element(root, "flag")), "true") == 0);
+
+    json_free_document(doc);
+
+    // Large array: children must come back in insertion order
+    size_t count = 100000;
+    char* big = (char*)calloc(1, count * 8 + 3);
+    size_t pos = 0;
+    big[pos++] = '[';
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        pos += (size_t)sprintf(big + pos, "%s%zu", idx ? "," : "", idx);
+    }
+    big[pos++] = ']';
+
+    doc = json_parse_string(big);
+    assert(doc != NULL);
+    arr = json_node_first_child_element(json_document_root(doc), NULL);
+    size_t idx = 0;
+    for (elem = json_node_first_child_element(arr, NULL); elem; elem = json_node_next_sibling_element(elem, NULL))
+    {
+        assert(strtoul(json_node_get_text(elem), NULL, 10) == idx);
+        idx++;
+    }
+    assert(idx == count);
+    json_free_document(doc);
+    free(big);
+
+    // Escapes, quotes and scalars straddling the 64 byte index blocks must
+    // parse identically on every structural index kernel
+    const char* pieces[] = { "\\\\", "\\\"", "\\\\\\\"x", "a\\\\\\\\", "\\u0041\\/", "plain" };
+    const char* unescaped[] = { "\\", "\"", "\\\"x", "a\\\\", "A/", "plain" };
+    json_kernel_t default_kernel = json_get_kernel();
+    json_kernel_t kernels[] = { JSON_KERNEL_SCALAR, JSON_KERNEL_AVX2 };
+
+    for (int k = 0; k < 2; k++)
+    {
+        if (!json_set_kernel(kernels[k]))
+        {
+            continue;
+        }
+
+        for (size_t pad = 0; pad < 70; pad++)
+        {
+            char text[512] = { 0 };
+            pos = 0;
+            text[pos++] = '{';
+            memset(text + pos, ' ', pad);
+            pos += pad;
+            pos += (size_t)sprintf(text + pos, "\"k\":[");
+            for (size_t piece = 0; piece < 6; piece++)
+            {
+                pos += (size_t)sprintf(text + pos, "%s\"%s\", -1.5e3 ,true", piece ? "," : "", pieces[piece]);
+            }
+            pos += (size_t)sprintf(text + pos, "],\"z\":null}");
+
+            doc = json_parse_string(text);
+            assert(doc != NULL);
+            root = json_node_first_child_element(json_document_root(doc), NULL);
+            elem = json_node_first_child_element(json_node_first_child_element(root, "k"), NULL);
+            for (size_t piece = 0; piece < 6; piece++)
+            {
+                assert(strcmp(json_node_get_text(elem), unescaped[piece]) == 0);
+                elem = json_node_next_sibling_element(elem, NULL);
+                assert(strcmp(json_node_get_text(elem), "-1.5e3") == 0);
+                elem = json_node_next_sibling_element(elem, NULL);
+                assert(json_node_type(elem) == JSON_NODE_BOOLEAN);
+                elem = json_node_next_sibling_element(elem, NULL);
+            }
+            assert(elem == NULL);
+            assert(json_node_type(json_node_first_child_element(root, "z")) == JSON_NODE_NULL);
+            json_free_document(doc);
+
+            // Breaking the string at the same offset must be rejected
+            text[pos - 1] = 0;
+            assert(json_parse_string(text) == NULL);
+            text[pad + 2] = 0;
+            assert(json_parse_string(text) == NULL);
+        }
+
+        assert(json_parse_string("[1 2]") == NULL);
+        assert(json_parse_string("[01]") == NULL);
+        assert(json_parse_string("[truex]") == NULL);
+        assert(json_parse_string("\"abc") == NULL);
+        assert(json_parse_string("{\"a\":1}x") == NULL);
+        doc = json_parse_string(" 42 ");
+        assert(doc != NULL);
+        json_free_document(doc);
+    }
+
+    json_set_kernel(default_kernel);
+
+    // In-situ: strings point into the caller's buffer, which need not be
+    // NUL terminated
+    char insitu[] = "{\"key\":\"va\\u0041l\\n\",\"n\":12.5,\"s\":\"plain\"}XXXX";
+    size_t insitu_len = strlen(insitu) - 4;
+    doc = json_parse_insitu(insitu, insitu_len, false);
+    assert(doc != NULL);
+    root = json_node_first_child_element(json_document_root(doc), NULL);
+    elem = json_node_first_child_element(root, "key");
+    assert(strcmp(json_node_get_text(elem), "vaAl\n") == 0);
+    assert(json_node_get_text(elem) > insitu && json_node_get_text(elem) < insitu + insitu_len);
+    assert(json_node_name(elem) > insitu && json_node_name(elem) < insitu + insitu_len);
+    assert(strcmp(json_node_get_text(json_node_first_child_element(root, "n")), "12.5") == 0);
+    assert(strcmp(json_node_get_attr(root, "s"), "plain") == 0);
+    json_free_document(doc);
+
+    char* owned = strdup("[\"a\",[true,\"b\\\"c\"]]");
+    doc = json_parse_insitu(owned, strlen(owned), true);
+    assert(doc != NULL);
+    arr = json_node_first_child_element(json_document_root(doc), NULL);
+    elem = json_node_first_child_element(json_node_next_sibling_element(json_node_first_child_element(arr, NULL), NULL), NULL);
+    assert(strcmp(json_node_get_text(json_node_next_sibling_element(elem, NULL)), "b\"c") == 0);
+    json_free_document(doc);
+
+    owned = strdup("[\"unterminated]");
+    assert(json_parse_insitu(owned, strlen(owned), true) == NULL);
+    char truncated[] = "[1,2]";
+    assert(json_parse_insitu(truncated, 4, false) == NULL);
+
+    // Typed numbers
+    doc = json_parse_string("[0,-7,9223372036854775807,-9223372036854775808,9223372036854775808,2.5,1e3,-0.0,\"1\"]");
+    assert(doc != NULL);
+    arr = json_node_first_child_element(json_document_root(doc), NULL);
+    assert(json_node_get_child_count(arr) == 9);
+    int64_t ival = 0;
+    double dval = 0;
+    elem = json_node_first_child_element(arr, NULL);
+    assert(json_node_is_integer(elem) && json_node_get_int64(elem, &ival) && ival == 0);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(json_node_get_int64(elem, &ival) && ival == -7);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(json_node_get_int64(elem, &ival) && ival == INT64_MAX);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(json_node_get_int64(elem, &ival) && ival == INT64_MIN);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(!json_node_is_integer(elem) && !json_node_get_int64(elem, &ival));
+    assert(json_node_get_double(elem, &dval) && dval == 9223372036854775808.0);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(!json_node_get_int64(elem, &ival) && json_node_get_double(elem, &dval) && dval == 2.5);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(!json_node_is_integer(elem) && json_node_get_int64(elem, &ival) && ival == 1000);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(json_node_get_double(elem, &dval) && dval == 0.0);
+    elem = json_node_next_sibling_element(elem, NULL);
+    assert(!json_node_get_double(elem, &dval));
+    json_free_document(doc);
+
+    // Reals convert by their text, not the rounded double
+    doc = json_parse_string("[-9223372036854775809,9223372036854775807.5,12345678901234567.5,-9223372036854775808.0,"
+                            "9.2e18,1e19,15e-1,100e-2,1.5e1,0.0e99,123456789012345678900000e-5]");
+    assert(doc != NULL);
+    arr = json_node_first_child_element(json_document_root(doc), NULL);
+    const bool int64_ok[] = {false, false, false, true, true, false, false, true, true, true, true};
+    const int64_t int64_values[] = {0, 0, 0, INT64_MIN, 9200000000000000000LL, 0, 0, 1, 15, 0, 1234567890123456789LL};
+    elem = json_node_first_child_element(arr, NULL);
+
+    for (size_t idx = 0; idx < sizeof(int64_ok) / sizeof(int64_ok[0]); idx++)
+    {
+        assert(elem != NULL && json_node_get_int64(elem, &ival) == int64_ok[idx]);
+        assert(!int64_ok[idx] || ival == int64_values[idx]);
+        elem = json_node_next_sibling_element(elem, NULL);
+    }
+
+    json_free_document(doc);
+
+    // Wide objects are looked up through the member index
+    big = (char*)calloc(1, 64 * 1024);
+    pos = 0;
+    big[pos++] = '{';
+    for (idx = 0; idx < 500; idx++)
+    {
+        pos += (size_t)sprintf(big + pos, "%s\"field%zu\":%zu", idx ? "," : "", idx, idx);
+    }
+    pos += (size_t)sprintf(big + pos, ",\"field7\":-1}");
+    doc = json_parse_string(big);
+    assert(doc != NULL);
+    root = json_node_first_child_element(json_document_root(doc), NULL);
+    assert(json_node_get_child_count(root) == 501);
+    // Lookups only read the document, so threads may share it
+    pthread_t json_readers[4];
+    for (idx = 0; idx < 4; idx++)
+    {
+        assert(pthread_create(&json_readers[idx], NULL, test_json_reader, root) == 0);
+    }
+    for (idx = 0; idx < 4; idx++)
+    {
+        pthread_join(json_readers[idx], NULL);
+    }
+    for (idx = 0; idx < 500; idx++)
+    {
+        char fieldname[32];
+        sprintf(fieldname, "field%zu", idx);
+        elem = json_node_first_child_element(root, fieldname);
+        assert(elem != NULL && json_node_get_int64(elem, &ival) && ival == (int64_t)idx);
+        assert(strtoul(json_node_get_attr(root, fieldname), NULL, 10) == idx);
+    }
+    assert(json_node_first_child_element(root, "missing") == NULL);
+    assert(json_node_get_attr(root, "field500") == NULL);
+    // Duplicate keys: first wins, the next one is still reachable
+    elem = json_node_next_sibling_element(json_node_first_child_element(root, "field7"), "field7");
+    assert(json_node_get_int64(elem, &ival) && ival == -1);
+    json_free_document(doc);
+    free(big);
+}
+
+typedef struct sax_log_t
+{
+    char text[4096];
+    size_t len;
+    int documents;
+    int abort_after;
+}sax_log_t;
+
+static bool sax_log_add(void* context, char tag, const char* str, size_t len)
+{
+    sax_log_t* log = (sax_log_t*)context;
+
+    log->text[log->len++] = tag;
+    memcpy(log->text + log->len, str, len);
+    log->len += len;
+    log->text[log->len++] = ' ';
+    log->text[log->len] = 0;
+
+    return log->abort_after < 0 || --log->abort_after > 0;
+}
+
+static bool sax_log_start_object(void* context) { return sax_log_add(context, '{', "", 0); }
+static bool sax_log_end_object(void* context) { return sax_log_add(context, '}', "", 0); }
+static bool sax_log_start_array(void* context) { return sax_log_add(context, '[', "", 0); }
+static bool sax_log_end_array(void* context) { return sax_log_add(context, ']', "", 0); }
+static bool sax_log_key(void* context, const char* key, size_t len) { return sax_log_add(context, 'k', key, len); }
+static bool sax_log_string(void* context, const char* str, size_t len) { return sax_log_add(context, 's', str, len); }
+static bool sax_log_number(void* context, const char* num, size_t len) { return sax_log_add(context, 'n', num, len); }
+static bool sax_log_boolean(void* context, bool value) { return sax_log_add(context, 'b', value ? "1" : "0", 1); }
+static bool sax_log_null(void* context) { return sax_log_add(context, 'z', "", 0); }
+static bool sax_log_document_end(void* context) { ((sax_log_t*)context)->documents++; return true; }
+
+static json_sax_status_t sax_run_chunked(const json_sax_handler_t* handler, sax_log_t* log, bool multiple, const char* input, size_t chunk)
+{
+    size_t total = strlen(input);
+    json_sax_parser_t* parser = json_sax_parser_allocate(handler, log, multiple);
+    json_sax_status_t status = JSON_SAX_OK;
+
+    memset(log, 0, sizeof(sax_log_t));
+    log->abort_after = -1;
+
+    for (size_t pos = 0; pos < total && status == JSON_SAX_OK; pos += chunk)
+    {
+        status = json_sax_parser_feed(parser, input + pos, total - pos < chunk ? total - pos : chunk);
+    }
+
+    if (status == JSON_SAX_OK)
+    {
+        status = json_sax_parser_finish(parser);
+    }
+
+    json_sax_parser_free(parser);
+    return status;
+}
+
+void test_json_sax(void)
+{
+    json_sax_handler_t handler = { sax_log_start_object, sax_log_end_object, sax_log_start_array, sax_log_end_array,
+        sax_log_key, sax_log_string, sax_log_number, sax_log_boolean, sax_log_null, sax_log_document_end };
+    const char* js = " {\"name\" : \"tre\\\"onz\", \"num\":-12.5e+3,\"ok\":true,\"no\":false,\"nil\":null,"
+        "\"arr\":[1,[],{},\"a\\u00e9\\ud83d\\ude00\\n\"],\"empty\":\"\"} ";
+    const char* expected = "{ kname stre\"onz knum n-12.5e+3 kok b1 kno b0 knil z karr [ n1 [ ] { } sa\xc3\xa9\xf0\x9f\x98\x80\n ] kempty s } ";
+    sax_log_t log;
+
+    // Every chunk size must produce the same events as one buffer
+    for (size_t chunk = 1; chunk <= strlen(js); chunk++)
+    {
+        assert(sax_run_chunked(&handler, &log, false, js, chunk) == JSON_SAX_OK);
+        assert(strcmp(log.text, expected) == 0);
+        assert(log.documents == 1);
+    }
+
+    // Top level scalars, including a number that ends with the input
+    assert(sax_run_chunked(&handler, &log, false, "42", 1) == JSON_SAX_OK);
+    assert(strcmp(log.text, "n42 ") == 0);
+    assert(sax_run_chunked(&handler, &log, false, "\"x\"", 1) == JSON_SAX_OK);
+
+    // Multiple values (NDJSON)
+    for (size_t chunk = 1; chunk < 8; chunk++)
+    {
+        assert(sax_run_chunked(&handler, &log, true, "{\"a\":1}\n{\"a\":2}\n3\n", chunk) == JSON_SAX_OK);
+        assert(strcmp(log.text, "{ ka n1 } { ka n2 } n3 ") == 0);
+        assert(log.documents == 3);
+    }
+    assert(sax_run_chunked(&handler, &log, true, "", 1) == JSON_SAX_OK);
+    assert(log.documents == 0);
+
+    // Malformed input
+    assert(sax_run_chunked(&handler, &log, false, "", 1) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "{\"a\":1} {}", 3) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "{\"a\":1", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[1,]", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[01]", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[1.]", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[tru]", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "{\"a\" 1}", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[\"\\q\"]", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[\"a\nb\"]", 2) == JSON_SAX_ERROR);
+    assert(sax_run_chunked(&handler, &log, false, "[1}", 2) == JSON_SAX_ERROR);
+
+    json_sax_parser_t* parser = json_sax_parser_allocate(&handler, &log, false);
+    assert(json_sax_parser_feed(parser, "[1, 2, x]", 9) == JSON_SAX_ERROR);
+    assert(json_sax_parser_get_offset(parser) == 7);
+    assert(json_sax_parser_get_depth(parser) == 1);
+    json_sax_parser_reset(parser);
+    assert(json_sax_parser_feed(parser, "[]", 2) == JSON_SAX_OK);
+    assert(json_sax_parser_finish(parser) == JSON_SAX_OK);
+    json_sax_parser_free(parser);
+
+    // A handler returning false stops the parser
+    memset(&log, 0, sizeof(log));
+    log.abort_after = 2;
+    assert(json_sax_parse("[1,2,3]", 7, &handler, &log) == JSON_SAX_ABORTED);
+    assert(strcmp(log.text, "[ n1 ") == 0);
+}
+
+void test_json_writer(void)
+{
+    buffer_t* buf = buffer_allocate_default();
+    json_writer_t* writer = json_writer_allocate(buf, false);
+    char fixed[64] = { 0 };
+
+    assert(json_writer_begin_object(writer));
+    assert(json_writer_key(writer, "name"));
+    assert(json_writer_string(writer, "tre\"onz\\\n\x01/\xc3\xa9"));
+    assert(json_writer_key(writer, "min"));
+    assert(json_writer_int64(writer, INT64_MIN));
+    assert(json_writer_key(writer, "max"));
+    assert(json_writer_uint64(writer, UINT64_MAX));
+    assert(json_writer_key(writer, "vals"));
+    assert(json_writer_begin_array(writer));
+    assert(json_writer_double(writer, 0.1));
+    assert(json_writer_double(writer, -21.57));
+    assert(json_writer_double(writer, 1e-7));
+    assert(json_writer_double(writer, -2.0));
+    assert(json_writer_double(writer, 1.0 / 3.0));
+    assert(json_writer_double(writer, 1e300));
+    assert(json_writer_double(writer, 0.0 / 0.0));
+    assert(json_writer_fixed(writer, 21.456, 2));
+    assert(json_writer_fixed(writer, -0.05, 1));
+    assert(json_writer_fixed(writer, -0.04, 1));
+    assert(json_writer_fixed(writer, 7.0, 0));
+    assert(json_writer_boolean(writer, true));
+    assert(json_writer_null(writer));
+    assert(json_writer_begin_object(writer));
+    assert(json_writer_end_object(writer));
+    assert(json_writer_begin_array(writer));
+    assert(json_writer_end_array(writer));
+    assert(json_writer_end_array(writer));
+    assert(json_writer_end_object(writer));
+    assert(json_writer_flush(writer));
+
+    const char* expected = "{\"name\":\"tre\\\"onz\\\\\\n\\u0001/\xc3\xa9\",\"min\":-9223372036854775808,"
+        "\"max\":18446744073709551615,\"vals\":[0.1,-21.57,0.0000001,-2,0.33333333333333331,1e+300,null,21.46,-0.1,0.0,7,true,null,{},[]]}";
+    assert(buffer_get_size(buf) == strlen(expected));
+    assert(memcmp(buffer_get_data(buf), expected, strlen(expected)) == 0);
+    assert(json_writer_get_length(writer) == strlen(expected));
+
+    // Misuse is reported and sticks
+    json_writer_reset(writer);
+    buffer_clear(buf);
+    assert(json_writer_begin_object(writer));
+    assert(!json_writer_string(writer, "no key"));
+    assert(json_writer_has_error(writer));
+    assert(!json_writer_end_object(writer));
+    json_writer_reset(writer);
+    assert(json_writer_begin_array(writer));
+    assert(!json_writer_key(writer, "k"));
+    json_writer_reset(writer);
+    assert(json_writer_begin_array(writer));
+    assert(!json_writer_end_object(writer));
+    json_writer_free(writer);
+    buffer_free(&buf);
+
+    // Output larger than the internal stage, plus DOM round trip
+    buf = buffer_allocate_default();
+    writer = json_writer_allocate(buf, false);
+    char* longtext = (char*)calloc(1, 20001);
+    memset(longtext, 'x', 20000);
+    longtext[9999] = '"';
+    assert(json_writer_begin_array(writer));
+    for (int idx = 0; idx < 1000; idx++)
+    {
+        assert(json_writer_int64(writer, idx * 1000003LL));
+    }
+    assert(json_writer_string(writer, longtext));
+    assert(json_writer_end_array(writer));
+    json_writer_free(writer);
+    string_t* text = buffer_convert_to_string(buf);
+    json_document_t* doc = json_parse_string(string_c_str(text));
+    assert(doc != NULL);
+    json_node_t* arr = json_node_first_child_element(json_document_root(doc), NULL);
+    json_node_t* elem = json_node_first_child_element(arr, NULL);
+    for (int idx = 0; idx < 1000; idx++)
+    {
+        assert(strtoll(json_node_get_text(elem), NULL, 10) == idx * 1000003LL);
+        elem = json_node_next_sibling_element(elem, NULL);
+    }
+    assert(strcmp(json_node_get_text(elem), longtext) == 0);
+    json_free_document(doc);
+    string_free(&text);
+    buffer_free(&buf);
+    free(longtext);
+
+    const char* js = "{\"a\":[1,-2.5e3,\"s\\\"\",true,null,{}],\"b\":{\"c\":[]}}";
+    doc = json_parse_string(js);
+    buf = buffer_allocate_default();
+    writer = json_writer_allocate(buf, false);
+    assert(json_writer_node(writer, json_document_root(doc)));
+    json_writer_free(writer);
+    assert(buffer_get_size(buf) == strlen(js));
+    assert(memcmp(buffer_get_data(buf), js, strlen(js)) == 0);
+    buffer_free(&buf);
+
+    // Pretty mode into a fixed buffer
+    writer = json_writer_allocate_fixed(fixed, sizeof(fixed), true);
+    assert(json_writer_node(writer, json_node_first_child_element(json_document_root(doc), NULL)) == false);
+    assert(json_writer_has_error(writer));
+    assert(json_writer_get_length(writer) > sizeof(fixed));
+    json_writer_reset(writer);
+    assert(json_writer_begin_object(writer));
+    assert(json_writer_key(writer, "a"));
+    assert(json_writer_begin_array(writer));
+    assert(json_writer_int64(writer, 1));
+    assert(json_writer_begin_object(writer));
+    assert(json_writer_end_object(writer));
+    assert(json_writer_end_array(writer));
+    assert(json_writer_end_object(writer));
+    assert(json_writer_flush(writer));
+    assert(strcmp(fixed, "{\n  \"a\": [\n    1,\n    {}\n  ]\n}") == 0);
+
+    // Timestamps are RFC 3339 strings
+    json_writer_reset(writer);
+    assert(json_writer_begin_array(writer));
+    assert(json_writer_timestamp(writer, 1792315815, 0));
+    assert(json_writer_timestamp(writer, 1792315815, -5 * 3600 - 30 * 60));
+    assert(json_writer_end_array(writer));
+    assert(json_writer_flush(writer));
+    assert(strcmp(fixed, "[\n  \"2026-10-18T09:30:15Z\",\n  \"2026-10-18T04:00:15-05:30\"\n]") == 0);
+    json_writer_free(writer);
+    json_free_document(doc);
+}
+
+static void* test_json_path_reader(void* arg)
+{
+    json_node_t* root = (json_node_t*)arg;
+    json_path_t* path = json_path_compile("/sensors/999/value", false);
+    int64_t ival = 0;
+
+    for (size_t idx = 0; idx < 100; idx++)
+    {
+        assert(json_node_get_int64(json_path_find(path, root), &ival) && ival == 999 * 3);
+    }
+
+    json_path_free(path);
+    return NULL;
+}
+
+void test_json_path(void)
+{
+    const char* js = "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"m~n\":8,\"*\":9,\"17\":\"key\","
+        "\"sensors\":[{\"id\":\"s0\",\"value\":10},{\"id\":\"s1\",\"value\":11},{\"id\":\"s2\"}]}";
+    json_document_t* doc = json_parse_string(js);
+    json_node_t* root = json_document_root(doc);
+    json_node_t* results[8];
+    json_path_t* path = NULL;
+    int64_t ival = 0;
+
+    // RFC 6901 examples
+    path = json_path_compile("", false);
+    assert(json_node_type(json_path_find(path, root)) == JSON_NODE_OBJECT);
+    json_path_free(path);
+
+    path = json_path_compile("/foo/1", false);
+    assert(strcmp(json_node_get_text(json_path_find(path, root)), "baz") == 0);
+    json_path_free(path);
+
+    path = json_path_compile("/a~1b", false);
+    assert(json_node_get_int64(json_path_find(path, root), &ival) && ival == 1);
+    json_path_free(path);
+
+    path = json_path_compile("/m~0n", false);
+    assert(json_node_get_int64(json_path_find(path, root), &ival) && ival == 8);
+    json_path_free(path);
+
+    path = json_path_compile("/", false);
+    assert(json_node_get_int64(json_path_find(path, root), &ival) && ival == 0);
+    json_path_free(path);
+
+    path = json_path_compile("/17", false);
+    assert(strcmp(json_node_get_text(json_path_find(path, root)), "key") == 0);
+    json_path_free(path);
+
+    // Without wildcards "*" is an ordinary key
+    path = json_path_compile("/*", false);
+    assert(json_node_get_int64(json_path_find(path, root), &ival) && ival == 9);
+    json_path_free(path);
+
+    // Misses
+    const char* misses[] = { "/foo/2", "/foo/-", "/foo/01", "/foo/x", "/nope", "/foo/0/x", "/sensors/2/value" };
+    for (size_t idx = 0; idx < sizeof(misses) / sizeof(misses[0]); idx++)
+    {
+        path = json_path_compile(misses[idx], false);
+        assert(path != NULL);
+        assert(json_path_find(path, root) == NULL);
+        assert(json_path_find_all(path, root, results, 8) == 0);
+        json_path_free(path);
+    }
+
+    assert(json_path_compile("foo", false) == NULL);
+    assert(json_path_compile("/a~2", false) == NULL);
+    assert(json_path_compile("/a~", false) == NULL);
+
+    // Wildcards
+    path = json_path_compile("/sensors/*/value", true);
+    assert(json_path_find_all(path, root, results, 8) == 2);
+    assert(json_node_get_int64(results[0], &ival) && ival == 10);
+    assert(json_node_get_int64(results[1], &ival) && ival == 11);
+    assert(json_path_find_all(path, root, results, 1) == 2);
+    assert(json_node_get_int64(json_path_find(path, root), &ival) && ival == 10);
+    json_path_free(path);
+
+    path = json_path_compile("/*/0", true);
+    assert(json_path_find_all(path, json_node_first_child_element(root, NULL), results, 8) == 2);
+    assert(strcmp(json_node_get_text(results[0]), "bar") == 0);
+    assert(json_node_type(results[1]) == JSON_NODE_OBJECT);
+    json_path_free(path);
+
+    json_free_document(doc);
+
+    // Positional steps on a large array go through its element index
+    char* big = (char*)calloc(1, 1024 * 1024);
+    size_t pos = 0;
+    pos += (size_t)sprintf(big, "{\"sensors\":[");
+    for (size_t idx = 0; idx < 1000; idx++)
+    {
+        pos += (size_t)sprintf(big + pos, "%s{\"value\":%zu}", idx ? "," : "", idx * 3);
+    }
+    sprintf(big + pos, "]}");
+    doc = json_parse_string(big);
+    assert(doc != NULL);
+    // Path queries only read the document, so threads may share it
+    pthread_t path_readers[4];
+    for (size_t idx = 0; idx < 4; idx++)
+    {
+        assert(pthread_create(&path_readers[idx], NULL, test_json_path_reader, json_document_root(doc)) == 0);
+    }
+    for (size_t idx = 0; idx < 4; idx++)
+    {
+        pthread_join(path_readers[idx], NULL);
+    }
+    json_node_t* sensors = json_node_first_child_element(json_node_first_child_element(json_document_root(doc), NULL), "sensors");
+    assert(json_node_get_child_count(sensors) == 1000);
+    assert(json_node_get_child_at(sensors, 1000) == NULL);
+    for (size_t idx = 0; idx < 1000; idx += 7)
+    {
+        char pointer[64];
+        sprintf(pointer, "/sensors/%zu/value", idx);
+        path = json_path_compile(pointer, false);
+        assert(json_node_get_int64(json_path_find(path, json_document_root(doc)), &ival) && ival == (int64_t)idx * 3);
+        json_path_free(path);
+    }
+    json_free_document(doc);
+    free(big);
+}
+
+typedef struct lines_log_t
+{
+    size_t records;
+    size_t malformed;
+    int64_t last_id;
+    bool ordered;
+    size_t stop_after;
+} lines_log_t;
+
+static bool lines_log_record(void* context, size_t record, json_document_t* doc)
+{
+    lines_log_t* log = (lines_log_t*)context;
+    int64_t id = -1;
+
+    if (record != log->records)
+    {
+        log->ordered = false;
+    }
+
+    log->records++;
+
+    if (doc == NULL)
+    {
+        log->malformed++;
+    }
+    else
+    {
+        json_node_t* value = json_node_first_child_element(json_document_root(doc), NULL);
+        if (json_node_get_int64(json_node_first_child_element(value, "id"), &id))
+        {
+            if (id != log->last_id + 1)
+            {
+                log->ordered = false;
+            }
+            log->last_id = id;
+        }
+        json_free_document(doc);
+    }
+
+    return log->stop_after == 0 || log->records < log->stop_after;
+}
+
+void test_json_lines(void)
+{
+    lines_log_t log;
+    size_t count = 0;
+
+    // Blank lines skipped, CRLF accepted, a broken record reported as NULL
+    const char* small = "{\"id\":0}\r\n\n   \n{\"id\":1}\n{\"id\":\n{\"id\":2}";
+    memset(&log, 0, sizeof(log));
+    log.last_id = -1;
+    log.ordered = true;
+    assert(json_lines_parse(small, strlen(small), 4, lines_log_record, &log));
+    assert(log.records == 4 && log.malformed == 1 && log.last_id == 2 && log.ordered);
+
+    json_document_t** docs = json_lines_parse_all(small, strlen(small), 1, &count);
+    assert(docs != NULL && count == 4);
+    assert(docs[0] != NULL && docs[2] == NULL && docs[3] != NULL);
+    json_lines_free_all(docs, count);
+
+    assert(json_lines_parse_all("\n\n", 2, 1, &count) == NULL && count == 0);
+
+    // Enough records for many chunks, with records of uneven size
+    size_t total = 40000;
+    size_t capacity = total * 96;
+    char* big = (char*)malloc(capacity);
+    size_t len = 0;
+    assert(big != NULL);
+
+    for (size_t i = 0; i < total; i++)
+    {
+        len += (size_t)snprintf(big + len, capacity - len, "{\"id\":%zu,\"pad\":\"%.*s\"}\n", i, (int)(i % 61), "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+    }
+
+    size_t thread_counts[] = { 0, 1, 2, 3, 8 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)
+    {
+        memset(&log, 0, sizeof(log));
+        log.last_id = -1;
+        log.ordered = true;
+        assert(json_lines_parse(big, len, thread_counts[t], lines_log_record, &log));
+        assert(log.records == total && log.malformed == 0 && log.ordered);
+        assert(log.last_id == (int64_t)total - 1);
+    }
+
+    // Stopping early frees whatever was parsed ahead
+    memset(&log, 0, sizeof(log));
+    log.last_id = -1;
+    log.ordered = true;
+    log.stop_after = 12345;
+    assert(!json_lines_parse(big, len, 4, lines_log_record, &log));
+    assert(log.records == 12345 && log.ordered);
+
+    docs = json_lines_parse_all(big, len, 4, &count);
+    assert(docs != NULL && count == total);
+    int64_t id = 0;
+    json_node_t* value = json_node_first_child_element(json_document_root(docs[total - 1]), NULL);
+    assert(json_node_get_int64(json_node_first_child_element(value, "id"), &id) && id == (int64_t)total - 1);
+    json_lines_free_all(docs, count);
+
+    const char* path = "/tmp/treonz_lines.ndjson";
+    FILE* fp = fopen(path, "wb");
+    assert(fp != NULL);
+    assert(fwrite(big, 1, len, fp) == len);
+    fclose(fp);
+
+    memset(&log, 0, sizeof(log));
+    log.last_id = -1;
+    log.ordered = true;
+    assert(json_lines_load_file(path, 2, lines_log_record, &log));
+    assert(log.records == total && log.ordered);
+    remove(path);
+
+    free(big);
+}
+
+typedef struct bind_location_t
+{
+    double lat;
+    double lon;
+} bind_location_t;
+
+typedef struct bind_sensor_t
+{
+    char id[8];
+    float value;
+} bind_sensor_t;
+
+typedef struct bind_telemetry_t
+{
+    char device[16];
+    uint64_t seq;
+    int32_t rssi;
+    bool ok;
+    bind_location_t location;
+    int64_t samples[4];
+    size_t sample_count;
+    char tags[3][8];
+    size_t tag_count;
+    bind_sensor_t sensors[2];
+    size_t sensor_count;
+} bind_telemetry_t;
+
+static const json_bind_field_t bind_location_fields[] =
+{
+    JSON_BIND_DOUBLE("lat", bind_location_t, lat),
+    JSON_BIND_DOUBLE("lon", bind_location_t, lon)
+};
+static const json_bind_schema_t bind_location_schema = JSON_BIND_SCHEMA(bind_location_t, bind_location_fields);
+
+static const json_bind_field_t bind_sensor_fields[] =
+{
+    JSON_BIND_STRING("id", bind_sensor_t, id),
+    JSON_BIND_FLOAT("value", bind_sensor_t, value)
+};
+static const json_bind_schema_t bind_sensor_schema = JSON_BIND_SCHEMA(bind_sensor_t, bind_sensor_fields);
+
+static const json_bind_field_t bind_telemetry_fields[] =
+{
+    JSON_BIND_STRING("device", bind_telemetry_t, device),
+    JSON_BIND_UINT64("seq", bind_telemetry_t, seq),
+    JSON_BIND_INT32("rssi", bind_telemetry_t, rssi),
+    JSON_BIND_BOOL("ok", bind_telemetry_t, ok),
+    JSON_BIND_OBJECT("location", bind_telemetry_t, location, bind_location_schema),
+    JSON_BIND_ARRAY("samples", bind_telemetry_t, samples, JSON_BIND_TYPE_INT64, sample_count),
+    JSON_BIND_ARRAY("tags", bind_telemetry_t, tags, JSON_BIND_TYPE_STRING, tag_count),
+    JSON_BIND_OBJECT_ARRAY("sensors", bind_telemetry_t, sensors, bind_sensor_schema, sensor_count)
+};
+static const json_bind_schema_t bind_telemetry_schema = JSON_BIND_SCHEMA(bind_telemetry_t, bind_telemetry_fields);
+
+typedef struct bind_event_t
+{
+    char name[8];
+    time_t at;
+} bind_event_t;
+
+static const json_bind_field_t bind_event_fields[] =
+{
+    JSON_BIND_STRING("name", bind_event_t, name),
+    JSON_BIND_TIMESTAMP("at", bind_event_t, at)
+};
+static const json_bind_schema_t bind_event_schema = JSON_BIND_SCHEMA(bind_event_t, bind_event_fields);
+
+static bool bind_decode_text(const char* js, bind_telemetry_t* out)
+{
+    memset(out, 0, sizeof(*out));
+    return json_bind_decode(&bind_telemetry_schema, js, strlen(js), out);
+}
+
+void test_json_bind(void)
+{
+    bind_telemetry_t t;
+
+    // Members out of order, unknown members of every shape skipped
+    const char* js = "{\"seq\":18446744073709551615,\"device\":\"pump-7\",\"extra\":{\"a\":[1,{\"b\":2}]},"
+        "\"rssi\":-71,\"ok\":true,\"location\":{\"lon\":-0.5,\"lat\":51.25,\"alt\":3},"
+        "\"samples\":[1,-2,3],\"tags\":[\"a\\u00e9\",\"b\"],\"more\":[[]],"
+        "\"sensors\":[{\"id\":\"t0\",\"value\":21.5},{\"value\":0.1,\"id\":\"t1\"}]}";
+    assert(bind_decode_text(js, &t));
+    assert(strcmp(t.device, "pump-7") == 0);
+    assert(t.seq == UINT64_MAX);
+    assert(t.rssi == -71);
+    assert(t.ok);
+    assert(t.location.lat == 51.25 && t.location.lon == -0.5);
+    assert(t.sample_count == 3 && t.samples[1] == -2 && t.samples[2] == 3);
+    assert(t.tag_count == 2 && strcmp(t.tags[0], "a\xc3\xa9") == 0 && strcmp(t.tags[1], "b") == 0);
+    assert(t.sensor_count == 2 && strcmp(t.sensors[1].id, "t1") == 0 && t.sensors[1].value == 0.1f);
+
+    // Absent and null members are left alone
+    memset(&t, 0, sizeof(t));
+    t.rssi = 5;
+    assert(json_bind_decode(&bind_telemetry_schema, "{\"rssi\":null,\"ok\":true}", 23, &t));
+    assert(t.rssi == 5 && t.ok);
+
+    // Numbers beyond the exact fast paths go through the C library
+    assert(bind_decode_text("{\"location\":{\"lat\":1.7976931348623157e308,\"lon\":0.30000000000000000001e1},"
+        "\"sensors\":[{\"value\":1e-30},{\"value\":-12.5e2}]}", &t));
+    assert(t.location.lat == 1.7976931348623157e308 && t.location.lon == 3.0);
+    assert(t.sensors[0].value == 1e-30f && t.sensors[1].value == -1250.0f);
+    assert(bind_decode_text("{\"rssi\":-0,\"seq\":-0}", &t));
+    assert(t.rssi == 0 && t.seq == 0);
+
+    // Type, range and capacity violations
+    assert(!bind_decode_text("{\"rssi\":\"x\"}", &t));
+    assert(!bind_decode_text("{\"rssi\":2147483648}", &t));
+    assert(bind_decode_text("{\"rssi\":-2147483648}", &t));
+    assert(!bind_decode_text("{\"rssi\":1.5}", &t));
+    assert(!bind_decode_text("{\"seq\":-1}", &t));
+    assert(!bind_decode_text("{\"seq\":18446744073709551616}", &t));
+    assert(!bind_decode_text("{\"ok\":1}", &t));
+    assert(!bind_decode_text("{\"device\":\"0123456789abcdef\"}", &t));
+    assert(bind_decode_text("{\"device\":\"0123456789abcde\"}", &t));
+    assert(!bind_decode_text("{\"samples\":[1,2,3,4,5]}", &t));
+    assert(!bind_decode_text("{\"location\":[1]}", &t));
+    assert(!bind_decode_text("{\"samples\":{}}", &t));
+    assert(!bind_decode_text("[]", &t));
+    assert(!bind_decode_text("{\"device\":\"x\"", &t));
+    assert(!bind_decode_text("{\"device\":\"x\"} {}", &t));
+
+    // Round trip through the writer
+    assert(bind_decode_text(js, &t));
+    char out[512];
+    json_writer_t* writer = json_writer_allocate_fixed(out, sizeof(out), false);
+    assert(json_bind_encode(&bind_telemetry_schema, &t, writer));
+    json_writer_flush(writer);
+    assert(strcmp(out, "{\"device\":\"pump-7\",\"seq\":18446744073709551615,\"rssi\":-71,\"ok\":true,"
+        "\"location\":{\"lat\":51.25,\"lon\":-0.5},\"samples\":[1,-2,3],\"tags\":[\"a\xc3\xa9\",\"b\"],"
+        "\"sensors\":[{\"id\":\"t0\",\"value\":21.5},{\"id\":\"t1\",\"value\":0.1}]}") == 0);
+    json_writer_free(writer);
+
+    bind_telemetry_t back;
+    assert(bind_decode_text(out, &back));
+    assert(memcmp(&back.location, &t.location, sizeof(t.location)) == 0);
+    assert(back.seq == t.seq && back.sensor_count == 2 && back.sensors[0].value == 21.5f);
+
+    // Timestamp members take any ISO 8601 zone and are written in UTC
+    bind_event_t event;
+    const char* event_js = "{\"name\":\"boot\",\"at\":\"2026-10-18T11:30:15.250+02:00\"}";
+    memset(&event, 0, sizeof(event));
+    assert(json_bind_decode(&bind_event_schema, event_js, strlen(event_js), &event));
+    assert(event.at == 1792315815);
+    assert(!json_bind_decode(&bind_event_schema, "{\"at\":\"2026-02-30T00:00:00Z\"}", 30, &event));
+    assert(!json_bind_decode(&bind_event_schema, "{\"at\":1792315815}", 17, &event));
+
+    writer = json_writer_allocate_fixed(out, sizeof(out), false);
+    assert(json_bind_encode(&bind_event_schema, &event, writer));
+    json_writer_flush(writer);
+    assert(strcmp(out, "{\"name\":\"boot\",\"at\":\"2026-10-18T09:30:15Z\"}") == 0);
+    json_writer_free(writer);
+}
+
+// Hex of everything written so far
+static const char* cbor_hex(buffer_t* buffer, char* out)
+{
+    const uint8_t* data = (const uint8_t*)buffer_get_data(buffer);
+    size_t len = buffer_get_size(buffer);
+
+    for (size_t idx = 0; idx < len; idx++)
+    {
+        sprintf(out + idx * 2, "%02x", data[idx]);
+    }
+    out[len * 2] = 0;
+    return out;
+}
+
+static size_t cbor_unhex(const char* hex, uint8_t* out)
+{
+    size_t len = strlen(hex) / 2;
+
+    for (size_t idx = 0; idx < len; idx++)
+    {
+        unsigned int byte = 0;
+        sscanf(hex + idx * 2, "%2x", &byte);
+        out[idx] = (uint8_t)byte;
+    }
+    return len;
+}
+
+static const char* cbor_json(const char* hex, char* out, size_t capacity)
+{
+    uint8_t data[256];
+    size_t len = cbor_unhex(hex, data);
+    json_writer_t* writer = json_writer_allocate_fixed(out, capacity, false);
+    bool ok = cbor_to_json(data, len, writer);
+
+    json_writer_free(writer);
+    return ok ? out : NULL;
+}
+
+void test_cbor(void)
+{
+    buffer_t* buffer = buffer_allocate_default();
+    cbor_writer_t* writer = cbor_writer_allocate(buffer);
+    char hex[1024];
+    char json[1024];
+
+    // RFC 8949 appendix A
+    struct
+    {
+        double value;
+        const char* hex;
+    } reals[] =
+    {
+        { 0.0, "f90000" }, { -0.0, "f98000" }, { 1.0, "f93c00" }, { 1.1, "fb3ff199999999999a" }, { 1.5, "f93e00" },
+        { 65504.0, "f97bff" }, { 100000.0, "fa47c35000" }, { 3.4028234663852886e+38, "fa7f7fffff" },
+        { 1.0e+300, "fb7e37e43c8800759c" }, { 5.960464477539063e-8, "f90001" }, { 0.00006103515625, "f90400" },
+        { -4.0, "f9c400" }, { -4.1, "fbc010666666666666" }, { INFINITY, "f97c00" }, { NAN, "f97e00" }, { -INFINITY, "f9fc00" },
+    };
+    for (size_t idx = 0; idx < sizeof(reals) / sizeof(reals[0]); idx++)
+    {
+        buffer_clear(buffer);
+        cbor_writer_reset(writer);
+        assert(cbor_writer_double(writer, reals[idx].value));
+        assert(cbor_writer_flush(writer));
+        assert(strcmp(cbor_hex(buffer, hex), reals[idx].hex) == 0);
+
+        uint8_t data[16];
+        cbor_reader_t reader;
+        cbor_item_t item;
+        cbor_reader_init(&reader, data, cbor_unhex(reals[idx].hex, data));
+        assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_FLOAT);
+        assert(isnan(reals[idx].value) ? isnan(item.real) : (item.real == reals[idx].value && signbit(item.real) == signbit(reals[idx].value)));
+        assert(!cbor_reader_next(&reader, &item) && !cbor_reader_has_error(&reader));
+    }
+
+    buffer_clear(buffer);
+    cbor_writer_reset(writer);
+    assert(cbor_writer_uint64(writer, 0));
+    assert(cbor_writer_uint64(writer, 23));
+    assert(cbor_writer_uint64(writer, 24));
+    assert(cbor_writer_uint64(writer, 1000));
+    assert(cbor_writer_uint64(writer, 1000000));
+    assert(cbor_writer_uint64(writer, 1000000000000ULL));
+    assert(cbor_writer_uint64(writer, UINT64_MAX));
+    assert(cbor_writer_int64(writer, -1));
+    assert(cbor_writer_int64(writer, -100));
+    assert(cbor_writer_int64(writer, -1000));
+    assert(cbor_writer_negative(writer, UINT64_MAX));
+    assert(cbor_writer_boolean(writer, false));
+    assert(cbor_writer_boolean(writer, true));
+    assert(cbor_writer_null(writer));
+    assert(cbor_writer_text(writer, ""));
+    assert(cbor_writer_text(writer, "IETF"));
+    assert(cbor_writer_bytes(writer, "\x01\x02\x03\x04", 4));
+    assert(cbor_writer_flush(writer));
+    assert(strcmp(cbor_hex(buffer, hex), "001718181903e81a000f42401b000000e8d4a510001bffffffffffffffff"
+        "2038633903e73bfffffffffffffffff4f5f660644945544644" "01020304") == 0);
+
+    // Containers, definite and streamed
+    buffer_clear(buffer);
+    cbor_writer_reset(writer);
+    assert(cbor_writer_begin_array(writer, 3));
+    assert(cbor_writer_uint64(writer, 1));
+    assert(cbor_writer_begin_array(writer, 2));
+    assert(cbor_writer_uint64(writer, 2));
+    assert(cbor_writer_uint64(writer, 3));
+    assert(cbor_writer_begin_array(writer, CBOR_INDEFINITE));
+    assert(cbor_writer_uint64(writer, 4));
+    assert(cbor_writer_uint64(writer, 5));
+    assert(cbor_writer_end(writer));
+    assert(cbor_writer_begin_map(writer, CBOR_INDEFINITE));
+    assert(cbor_writer_text(writer, "a"));
+    assert(!cbor_writer_end(writer));
+    assert(cbor_writer_has_error(writer));
+    assert(strcmp(cbor_hex(buffer, hex), "") == 0);
+
+    buffer_clear(buffer);
+    cbor_writer_reset(writer);
+    assert(cbor_writer_begin_map(writer, 2));
+    assert(cbor_writer_text(writer, "a"));
+    assert(cbor_writer_uint64(writer, 1));
+    assert(cbor_writer_text(writer, "b"));
+    assert(cbor_writer_begin_array(writer, 0));
+    assert(cbor_writer_begin_map(writer, 0));
+    assert(cbor_writer_tag(writer, 1));
+    assert(cbor_writer_uint64(writer, 1363896240));
+    assert(cbor_writer_flush(writer));
+    assert(strcmp(cbor_hex(buffer, hex), "a2616101616280a0c11a514b67b0") == 0);
+    cbor_writer_free(writer);
+
+    // Decoding to JSON
+    assert(strcmp(cbor_json("8301820203820405", json, sizeof(json)), "[1,[2,3],[4,5]]") == 0);
+    assert(strcmp(cbor_json("9f018202039f0405ffff", json, sizeof(json)), "[1,[2,3],[4,5]]") == 0);
+    assert(strcmp(cbor_json("bf61610161629f0203ffff", json, sizeof(json)), "{\"a\":1,\"b\":[2,3]}") == 0);
+    assert(strcmp(cbor_json("a201020304", json, sizeof(json)), "{\"1\":2,\"3\":4}") == 0);
+    assert(strcmp(cbor_json("3bffffffffffffffff", json, sizeof(json)), "-18446744073709551616") == 0);
+    assert(strcmp(cbor_json("c074323031332d30332d32315432303a30343a30305a", json, sizeof(json)), "\"2013-03-21T20:04:00Z\"") == 0);
+    assert(strcmp(cbor_json("4401020304", json, sizeof(json)), "\"AQIDBA\"") == 0);
+    assert(strcmp(cbor_json("83f4f6f7", json, sizeof(json)), "[false,null,null]") == 0);
+    assert(strcmp(cbor_json("f97e00", json, sizeof(json)), "null") == 0);
+
+    // Malformed input
+    const char* malformed[] = { "18", "1c", "5f4101ff", "7f6161ff", "f818", "ff", "8201", "a16161", "bf6161ff", "c0", "9fc0ff", "9b0000000000000010", "fc" };
+    for (size_t idx = 0; idx < sizeof(malformed) / sizeof(malformed[0]); idx++)
+    {
+        assert(cbor_json(malformed[idx], json, sizeof(json)) == NULL);
+    }
+    assert(cbor_json("a18201026161", json, sizeof(json)) == NULL);
+
+    // Reader views point into the input; skipping stops at the matching end
+    uint8_t data[256];
+    size_t len = cbor_unhex("a3616183010203616261786163f5", data);
+    cbor_reader_t reader;
+    cbor_item_t item;
+    int64_t ival = 0;
+    cbor_reader_init(&reader, data, len);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_MAP && item.value == 3);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_TEXT && item.data == data + 2 && item.length == 1);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_ARRAY);
+    assert(cbor_reader_skip(&reader, &item));
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_TEXT && memcmp(item.data, "b", 1) == 0);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_TEXT && memcmp(item.data, "x", 1) == 0);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_TEXT);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_TRUE);
+    assert(cbor_reader_next(&reader, &item) && item.type == CBOR_ITEM_END);
+    assert(!cbor_reader_next(&reader, &item) && !cbor_reader_has_error(&reader));
+
+    len = cbor_unhex("3903e7", data);
+    cbor_reader_init(&reader, data, len);
+    assert(cbor_reader_next(&reader, &item) && cbor_item_get_int64(&item, &ival) && ival == -1000);
+
+    // Nesting beyond the reader's depth
+    memset(data, 0x81, CBOR_MAX_DEPTH + 1);
+    data[CBOR_MAX_DEPTH + 1] = 0;
+    cbor_reader_init(&reader, data, CBOR_MAX_DEPTH + 2);
+    while (cbor_reader_next(&reader, &item));
+    assert(cbor_reader_has_error(&reader) && cbor_reader_get_offset(&reader) == CBOR_MAX_DEPTH);
+
+    // The JSON SAX handlers read CBOR unchanged
+    json_sax_handler_t handler = { sax_log_start_object, sax_log_end_object, sax_log_start_array, sax_log_end_array,
+        sax_log_key, sax_log_string, sax_log_number, sax_log_boolean, sax_log_null, sax_log_document_end };
+    sax_log_t log;
+    memset(&log, 0, sizeof(log));
+    log.abort_after = -1;
+    len = cbor_unhex("bf616101616282f9c4003a0001869f6163a0617af6ff8020", data);
+    assert(cbor_parse_sax(data, len, &handler, &log) == JSON_SAX_OK);
+    assert(strcmp(log.text, "{ ka n1 kb [ n-4 n-100000 ] kc { } kz z } [ ] n-1 ") == 0);
+    assert(log.documents == 3);
+    memset(&log, 0, sizeof(log));
+    log.abort_after = 2;
+    assert(cbor_parse_sax(data, len, &handler, &log) == JSON_SAX_ABORTED);
+    memset(&log, 0, sizeof(log));
+    log.abort_after = -1;
+    assert(cbor_parse_sax(data, len - 1, &handler, &log) == JSON_SAX_OK);
+    assert(cbor_parse_sax(data, len - 3, &handler, &log) == JSON_SAX_ERROR);
+
+    // JSON to CBOR and back
+    const char* telemetry = "{\"device\":\"sensor-0042\",\"seq\":123456,\"temperature\":21.57,\"ok\":true,"
+        "\"big\":18446744073709551615,\"low\":-18446744073709551616,\"list\":[1.5,-2,null,\"\\u00e9\"],\"none\":{}}";
+    buffer_clear(buffer);
+    assert(cbor_from_json(telemetry, strlen(telemetry), buffer));
+    assert(buffer_get_size(buffer) < strlen(telemetry));
+    json_writer_t* jw = json_writer_allocate_fixed(json, sizeof(json), false);
+    assert(cbor_to_json((const uint8_t*)buffer_get_data(buffer), buffer_get_size(buffer), jw));
+    json_writer_free(jw);
+    assert(strcmp(json, "{\"device\":\"sensor-0042\",\"seq\":123456,\"temperature\":21.57,\"ok\":true,"
+        "\"big\":18446744073709551615,\"low\":-18446744073709551616,\"list\":[1.5,-2,null,\"\xc3\xa9\"],\"none\":{}}") == 0);
+    assert(!cbor_from_json("{", 1, buffer));
+
+    // Fixed buffers report the size they would have needed
+    uint8_t small[4];
+    writer = cbor_writer_allocate_fixed(small, sizeof(small));
+    assert(cbor_writer_uint64(writer, 1000));
+    assert(!cbor_writer_text(writer, "abc"));
+    assert(cbor_writer_get_length(writer) == 7);
+    cbor_writer_free(writer);
+
+    buffer_free(&buffer);
+}
+
+void test_xml(void)
+{
+    const char* xs = "<?xml version=\"1.0\"?><root><item id=\"42\">hello</item><item>world</item></root>";
+    const char* malformed = "<root><item></root>";
+    xml_document_t* doc = NULL;
+    xml_document_t* malformed_doc = NULL;
+    xml_document_t* doc_file = NULL;
+    FILE* fp = NULL;
+    const char* tmp_xml = "/tmp/treonz_xml_test.xml";
+
+    doc = xml_parse_string(xs);
+    assert(doc != NULL);
+
+    malformed_doc = xml_parse_string(malformed);
+
+    fp = fopen(tmp_xml, "wb");
+    assert(fp != NULL);
+    assert(fwrite(xs, 1, strlen(xs), fp) == strlen(xs));
+    fclose(fp);
+    fp = NULL;
+
+    doc_file = xml_load_file(tmp_xml);
+    assert(doc_file != NULL);
+
+    remove(tmp_xml);
+
+    xml_node_t* root = xml_node_first_child_element(xml_document_root(doc), "root");
+    assert(root != NULL);
+    xml_node_t* item = xml_node_first_child_element(root, "item");
+    assert(item != NULL && strcmp(xml_node_get_attr(item, "id"), "42") == 0);
+    assert(strcmp(xml_node_get_text(item), "hello") == 0);
+    item = xml_node_next_sibling_element(item, "item");
+    assert(item != NULL && xml_node_get_attr(item, "id") == NULL);
+    assert(strcmp(xml_node_get_text(item), "world") == 0);
+    assert(xml_node_next_sibling_element(item, NULL) == NULL);
+
+    root = xml_node_first_child_element(xml_document_root(doc_file), "root");
+    assert(strcmp(xml_node_get_text(xml_node_first_child_element(root, "item")), "hello") == 0);
+
+    xml_free_document(malformed_doc);
+    xml_free_document(doc_file);
+    xml_free_document(doc);
+
+    /* Entities, comments, CDATA and a DOCTYPE with an internal subset */
+    const char* rich = "<!DOCTYPE note [<!ENTITY x \"y\">]>"
+        "<note a=\"1 &lt; 2\" b='&#65;&#x42;&amp;'><!-- c --><![CDATA[<raw>&amp;]]>"
+        "<t>caf&#233; &unknown; &quot;q&quot;</t></note>";
+    doc = xml_parse_string(rich);
+    assert(doc != NULL);
+    root = xml_node_first_child_element(xml_document_root(doc), "note");
+    assert(root != NULL);
+    assert(strcmp(xml_node_get_attr(root, "a"), "1 < 2") == 0);
+    assert(strcmp(xml_node_get_attr(root, "b"), "AB&") == 0);
+    assert(xml_node_type(xml_node_first_child(root)) == XML_NODE_COMMENT);
+    assert(strcmp(xml_node_get_text(root), "<raw>&amp;") == 0);
+    assert(strcmp(xml_node_get_text(xml_node_first_child_element(root, "t")), "caf\xc3\xa9 &unknown; \"q\"") == 0);
+    xml_free_document(doc);
+
+    /* Wide elements are looked up through the attribute index */
+    char wide[1024];
+    size_t wlen = (size_t)sprintf(wide, "<w");
+    for (int i = 0; i < 40; i++)
+    {
+        wlen += (size_t)sprintf(wide + wlen, " k%d=\"v%d\"", i, i);
+    }
+    sprintf(wide + wlen, " k3=\"dup\"/>");
+    doc = xml_parse_string(wide);
+    assert(doc != NULL);
+    root = xml_node_first_child_element(xml_document_root(doc), "w");
+    for (int i = 0; i < 40; i++)
+    {
+        char key[8], value[8];
+        sprintf(key, "k%d", i);
+        sprintf(value, "v%d", i);
+        assert(strcmp(xml_node_get_attr(root, key), value) == 0);
+    }
+    assert(xml_node_get_attr(root, "k40") == NULL);
+    xml_free_document(doc);
+
+    /* Many siblings append in constant time and keep their order */
+    size_t count = 100000;
+    char* big = (char*)malloc(count * 16 + 32);
+    size_t blen = (size_t)sprintf(big, "<list>");
+    for (size_t i = 0; i < count; i++)
+    {
+        blen += (size_t)sprintf(big + blen, "<i n=\"%zu\"/>", i);
+    }
+    blen += (size_t)sprintf(big + blen, "</list>");
+
+    /* In situ: the caller's buffer is not NUL terminated past 'blen' */
+    big[blen] = '<';
+    doc = xml_parse_insitu(big, blen, false);
+    assert(doc != NULL);
+    root = xml_node_first_child_element(xml_document_root(doc), "list");
+    size_t seen = 0;
+    for (item = xml_node_first_child_element(root, "i"); item; item = xml_node_next_sibling_element(item, "i"))
+    {
+        assert((size_t)atol(xml_node_get_attr(item, "n")) == seen);
+        seen++;
+    }
+    assert(seen == count);
+    assert(big[blen] == '<');
+    xml_free_document(doc);
+    free(big);
+
+    /* Trailing text with no byte left to terminate it in place */
+    char tail[] = {'<', 'a', '/', '>', 'x', 'y'};
+    doc = xml_parse_insitu(tail, sizeof(tail), false);
+    assert(doc != NULL);
+    assert(strcmp(xml_node_get_text(xml_document_root(doc)), "xy") == 0);
+    xml_free_document(doc);
+}
+
+typedef struct xml_sax_log_t
+{
+    char text[4096];
+    size_t len;
+    int abort_after;
+} xml_sax_log_t;
+
+static bool xml_sax_log_add(xml_sax_log_t* log, char tag, const char* str, size_t len)
+{
+    log->text[log->len++] = tag;
+    memcpy(log->text + log->len, str, len);
+    log->len += len;
+    log->text[log->len++] = ' ';
+    log->text[log->len] = 0;
+
+    if (log->abort_after > 0 && --log->abort_after == 0)
+    {
+        return false;
+    }
+    return true;
+}
+
+static bool xml_sax_log_start(void* context, const char* name, size_t len, const xml_sax_attribute_t* attrs, size_t attr_count)
+{
+    xml_sax_log_t* log = (xml_sax_log_t*)context;
+    bool ok = xml_sax_log_add(log, '<', name, len);
+
+    for (size_t i = 0; i < attr_count; i++)
+    {
+        log->len--;
+        log->text[log->len++] = '|';
+        memcpy(log->text + log->len, attrs[i].name, attrs[i].name_len);
+        log->len += attrs[i].name_len;
+        log->text[log->len++] = '=';
+        memcpy(log->text + log->len, attrs[i].value, attrs[i].value_len);
+        log->len += attrs[i].value_len;
+        log->text[log->len++] = ' ';
+        log->text[log->len] = 0;
+    }
+    return ok;
+}
+
+static bool xml_sax_log_end(void* context, const char* name, size_t len) { return xml_sax_log_add((xml_sax_log_t*)context, '>', name, len); }
+static bool xml_sax_log_text(void* context, const char* text, size_t len) { return xml_sax_log_add((xml_sax_log_t*)context, 't', text, len); }
+static bool xml_sax_log_cdata(void* context, const char* text, size_t len) { return xml_sax_log_add((xml_sax_log_t*)context, 'c', text, len); }
+static bool xml_sax_log_comment(void* context, const char* text, size_t len) { return xml_sax_log_add((xml_sax_log_t*)context, '#', text, len); }
+static bool xml_sax_log_pi(void* context, const char* text, size_t len) { return xml_sax_log_add((xml_sax_log_t*)context, '?', text, len); }
+
+static xml_sax_status_t xml_sax_run_chunked(const xml_sax_handler_t* handler, xml_sax_log_t* log, const char* input, size_t chunk)
+{
+    size_t len = strlen(input);
+    memset(log, 0, sizeof(*log));
+
+    xml_sax_parser_t* parser = xml_sax_parser_allocate(handler, log);
+    assert(parser != NULL);
+
+    xml_sax_status_t status = XML_SAX_OK;
+    for (size_t pos = 0; pos < len && status == XML_SAX_OK; pos += chunk)
+    {
+        status = xml_sax_parser_feed(parser, input + pos, len - pos < chunk ? len - pos : chunk);
+    }
+
+    if (status == XML_SAX_OK)
+    {
+        status = xml_sax_parser_finish(parser);
+    }
+
+    xml_sax_parser_free(parser);
+    return status;
+}
+
+static size_t xml_sax_count_text;
+
+static bool xml_sax_count(void* context, const char* text, size_t len)
+{
+    (void)context;
+    (void)text;
+    xml_sax_count_text += len;
+    return true;
+}
+
+void test_xml_sax(void)
+{
+    xml_sax_handler_t handler = { xml_sax_log_start, xml_sax_log_end, xml_sax_log_text, xml_sax_log_cdata,
+        xml_sax_log_comment, xml_sax_log_pi };
+    const char* xs = "\xEF\xBB\xBF<?xml version=\"1.0\"?>\n<!DOCTYPE cfg [<!ENTITY x \"y>\">]>\n"
+        "<cfg a=\"1\" b = 'x&amp;y&#x41;&bogus;'>\n  <!-- note -- ]] -->\n"
+        "  <item id=\"42\">a &lt;b&gt; &#233;&amp c</item><empty/>\n"
+        "  <![CDATA[<raw> ]]]]><x:y.z-w name=\"q>\"/><!---->\n</cfg>\n";
+    const char* expected = "?xml version=\"1.0\" <cfg|a=1|b=x&yA&bogus; # note -- ]]  "
+        "<item|id=42 ta <b> \xc3\xa9&amp c >item <empty >empty c<raw> ]] <x:y.z-w|name=q> >x:y.z-w # >cfg ";
+    xml_sax_log_t log;
+
+    // Every chunk size must produce the same events as one buffer
+    for (size_t chunk = 1; chunk <= strlen(xs); chunk++)
+    {
+        xml_sax_status_t status = xml_sax_run_chunked(&handler, &log, xs, chunk);
+        assert(status == XML_SAX_OK);
+        assert(strcmp(log.text, expected) == 0);
+    }
+
+    // Well-formedness errors
+    const char* bad[] = { "", "  ", "<a>", "<a></b>", "</a>", "<a></a><b/>", "x<a/>", "<a/>x", "<a b=1/>",
+        "<a b=\"1\"c=\"2\"/>", "<a b/>", "<a><!-- x</a>", "<a><![CDATA[x</a>", "<a b=\"1></a>", "<>", "<a/><?pi" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        for (size_t chunk = 1; chunk <= 3; chunk++)
+        {
+            assert(xml_sax_run_chunked(&handler, &log, bad[i], chunk) == XML_SAX_ERROR);
+        }
+    }
+
+    // Error offset points into the offending tag
+    xml_sax_parser_t* parser = xml_sax_parser_allocate(&handler, &log);
+    memset(&log, 0, sizeof(log));
+    assert(xml_sax_parser_feed(parser, "<a><b></c>", 10) == XML_SAX_ERROR);
+    assert(xml_sax_parser_get_offset(parser) == 9);
+    assert(xml_sax_parser_feed(parser, "</a>", 4) == XML_SAX_ERROR);
+
+    // Reset, depth and abort
+    xml_sax_parser_reset(parser);
+    memset(&log, 0, sizeof(log));
+    log.abort_after = 3;
+    assert(xml_sax_parser_feed(parser, "<a><b>x</b></a>", 6) == XML_SAX_OK);
+    assert(xml_sax_parser_get_depth(parser) == 2);
+    assert(xml_sax_parser_feed(parser, "x</b></a>", 9) == XML_SAX_ABORTED);
+    assert(strcmp(log.text, "<a <b tx ") == 0);
+    xml_sax_parser_free(parser);
+
+    // Long text is reported in parts without buffering the document
+    size_t big_len = 1024 * 1024;
+    char* big = (char*)malloc(big_len + 16);
+    assert(big != NULL);
+    memcpy(big, "<r>", 3);
+    memset(big + 3, 'v', big_len - 7);
+    memcpy(big + big_len - 4, "</r>", 5);
+    xml_sax_handler_t counter;
+    memset(&counter, 0, sizeof(counter));
+    counter.on_text = xml_sax_count;
+    parser = xml_sax_parser_allocate(&counter, NULL);
+    xml_sax_count_text = 0;
+    for (size_t pos = 0; pos < big_len; pos += 1000)
+    {
+        assert(xml_sax_parser_feed(parser, big + pos, big_len - pos < 1000 ? big_len - pos : 1000) == XML_SAX_OK);
+    }
+    assert(xml_sax_parser_finish(parser) == XML_SAX_OK);
+    assert(xml_sax_count_text == big_len - 7);
+    xml_sax_parser_free(parser);
+    assert(xml_sax_parse(big, big_len, &counter, NULL) == XML_SAX_OK);
+    free(big);
+}
+
+static const char* xml_writer_output(buffer_t* buffer)
+{
+    buffer_append(buffer, "", 1);
+    return (const char*)buffer_get_data(buffer);
+}
+
+void test_xml_writer(void)
+{
+    buffer_t* buffer = buffer_allocate_default();
+    xml_writer_t* writer = xml_writer_allocate(buffer, false);
+
+    assert(xml_writer_declaration(writer));
+    assert(xml_writer_begin_element(writer, "root"));
+    assert(xml_writer_attribute(writer, "q", "a\"b<c>&\n"));
+    assert(xml_writer_attribute_int64(writer, "n", -42));
+    assert(xml_writer_begin_element(writer, "empty"));
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_begin_element(writer, "t"));
+    assert(xml_writer_text(writer, "1 < 2 & \"ok\"\tdone"));
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_cdata(writer, "x]]>y", 5));
+    assert(xml_writer_comment(writer, " note "));
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_flush(writer));
+    assert(strcmp(xml_writer_output(buffer), "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<root q=\"a&quot;b&lt;c&gt;&amp;&#10;\" n=\"-42\"><empty/><t>1 &lt; 2 &amp; \"ok\"\tdone</t>"
+        "<![CDATA[x]]]]><![CDATA[>y]]><!-- note --></root>") == 0);
+    xml_writer_free(writer);
+
+    // Misuse
+    buffer_clear(buffer);
+    writer = xml_writer_allocate(buffer, false);
+    assert(!xml_writer_text(writer, "top level"));
+    assert(xml_writer_has_error(writer));
+    xml_writer_reset(writer);
+    assert(xml_writer_begin_element(writer, "a"));
+    assert(xml_writer_text(writer, "x"));
+    assert(!xml_writer_attribute(writer, "late", "1"));
+    xml_writer_reset(writer);
+    assert(!xml_writer_begin_element(writer, "1bad"));
+    xml_writer_reset(writer);
+    assert(xml_writer_begin_element(writer, "a"));
+    assert(!xml_writer_text(writer, "bell\a"));
+    xml_writer_reset(writer);
+    assert(xml_writer_begin_element(writer, "a"));
+    assert(!xml_writer_comment(writer, "a--b"));
+    xml_writer_reset(writer);
+    assert(xml_writer_begin_element(writer, "a"));
+    assert(xml_writer_end_element(writer));
+    assert(!xml_writer_begin_element(writer, "b"));
+    assert(!xml_writer_end_element(writer));
+    xml_writer_free(writer);
+
+    // Pretty printing leaves elements with text on one line
+    buffer_clear(buffer);
+    writer = xml_writer_allocate(buffer, true);
+    assert(xml_writer_begin_element(writer, "a"));
+    assert(xml_writer_begin_element(writer, "b"));
+    assert(xml_writer_text(writer, "x"));
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_begin_element(writer, "c"));
+    assert(xml_writer_begin_element(writer, "d"));
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_end_element(writer));
+    xml_writer_free(writer);
+    assert(strcmp(xml_writer_output(buffer), "<a>\n  <b>x</b>\n  <c>\n    <d/>\n  </c>\n</a>") == 0);
+
+    // A parsed document writes back to equivalent markup
+    const char* xs = "<?xml version=\"1.0\"?><list kind=\"a&amp;b\"><i n=\"1\">one</i><!--c--><i n=\"2\"/><![CDATA[<raw>]]></list>";
+    xml_document_t* doc = xml_parse_string(xs);
+    buffer_clear(buffer);
+    writer = xml_writer_allocate(buffer, false);
+    assert(xml_writer_node(writer, xml_document_root(doc)));
+    xml_writer_free(writer);
+    assert(strcmp(xml_writer_output(buffer), "<list kind=\"a&amp;b\"><i n=\"1\">one</i><!--c--><i n=\"2\"/><![CDATA[<raw>]]></list>") == 0);
+    xml_free_document(doc);
+
+    // Large output goes through the stage into the buffer
+    buffer_clear(buffer);
+    writer = xml_writer_allocate(buffer, false);
+    assert(xml_writer_begin_element(writer, "big"));
+    for (int idx = 0; idx < 10000; idx++)
+    {
+        assert(xml_writer_begin_element(writer, "v"));
+        assert(xml_writer_attribute_int64(writer, "i", idx));
+        assert(xml_writer_end_element(writer));
+    }
+    assert(xml_writer_end_element(writer));
+    assert(xml_writer_flush(writer));
+    assert(buffer_get_size(buffer) == xml_writer_get_length(writer));
+    doc = xml_parse_string(xml_writer_output(buffer));
+    assert(doc != NULL);
+    xml_free_document(doc);
+    xml_writer_free(writer);
+
+    buffer_free(&buffer);
+}
+
+void test_xml_path(void)
+{
+    const char* xs = "<lib><shelf id=\"s1\"><book id=\"b1\" lang=\"en\"><title>One</title></book>"
+        "<book id=\"b2\"><title>Two</title><book id=\"b3\" lang=\"de\"><title>Three</title></book></book></shelf>"
+        "<shelf id=\"s2\"><book id=\"b4\" lang=\"en\"><title>Four</title></book><note/></shelf></lib>";
+    xml_document_t* doc = xml_parse_string(xs);
+    xml_node_t* root = xml_document_root(doc);
+    xml_node_t* results[8];
+    xml_path_t* path = NULL;
+
+    struct
+    {
+        const char* expression;
+        const char* ids;
+    } cases[] =
+    {
+        { "/lib/shelf/book", "b1 b2 b4 " },
+        { "/lib/shelf[2]/book", "b4 " },
+        { "/lib/shelf/book[1]", "b1 b4 " },
+        { "//book", "b1 b2 b3 b4 " },
+        { "//book[@lang='en']", "b1 b4 " },
+        { "//book[@lang!=\"en\"]", "b3 " },
+        { "//book[@lang]", "b1 b3 b4 " },
+        { "//book[@lang][2]", "" },
+        { "/lib/shelf/book[@id][2]", "b2 " },
+        { "//book[2]", "b2 " },
+        { "//book/book", "b3 " },
+        { "//book//title/..", "" },
+        { "/lib/*[@id='s2']", "s2 " },
+        { "/lib/shelf/*", "b1 b2 b4 " },
+        { "//title[text()='Three']", "" },
+        { "/lib//book[ @id = 'b3' ]", "b3 " },
+        { "/lib/nope", "" },
+    };
+
+    for (size_t idx = 0; idx < sizeof(cases) / sizeof(cases[0]); idx++)
+    {
+        path = xml_path_compile(cases[idx].expression);
+        if (strstr(cases[idx].expression, ".."))
+        {
+            assert(path == NULL);
+            continue;
+        }
+        assert(path != NULL);
+
+        size_t count = xml_path_find_all(path, root, results, 8);
+        char ids[64] = { 0 };
+        for (size_t r = 0; r < count && r < 8; r++)
+        {
+            const char* id = xml_node_get_attr(results[r], "id");
+            if (id)
+            {
+                strcat(ids, id);
+                strcat(ids, " ");
+            }
+        }
+        if (strstr(cases[idx].expression, "text()"))
+        {
+            assert(count == 1 && strcmp(xml_node_get_text(results[0]), "Three") == 0);
+        }
+        else
+        {
+            assert(strcmp(ids, cases[idx].ids) == 0);
+        }
+
+        xml_node_t* first = xml_path_find(path, root);
+        assert(count ? first == results[0] : first == NULL);
+        xml_path_free(path);
+    }
+
+    // Relative paths start at the context node, absolute ones at its document
+    xml_node_t* shelf = xml_node_first_child_element(xml_node_first_child_element(root, "lib"), "shelf");
+    path = xml_path_compile("book/title");
+    assert(strcmp(xml_node_get_text(xml_path_find(path, shelf)), "One") == 0);
+    assert(xml_path_find_all(path, shelf, NULL, 0) == 2);
+    xml_path_free(path);
+
+    path = xml_path_compile(".//title");
+    assert(xml_path_find_all(path, shelf, results, 8) == 3);
+    assert(strcmp(xml_node_get_text(results[2]), "Three") == 0);
+    xml_path_free(path);
+
+    path = xml_path_compile("/lib/shelf[@id='s2']");
+    assert(strcmp(xml_node_get_attr(xml_path_find(path, shelf), "id"), "s2") == 0);
+    xml_path_free(path);
+
+    path = xml_path_compile("/");
+    assert(xml_path_find(path, shelf) == root);
+    xml_path_free(path);
+
+    // Nested matches are reported once and in document order
+    xml_document_t* nested = xml_parse_string("<a id=\"1\"><a id=\"2\"><b id=\"x\"/></a><b id=\"y\"/></a>");
+    path = xml_path_compile("//a//b");
+    assert(xml_path_find_all(path, xml_document_root(nested), results, 8) == 2);
+    assert(strcmp(xml_node_get_attr(results[0], "id"), "x") == 0);
+    xml_path_free(path);
+    path = xml_path_compile("//a/b");
+    assert(xml_path_find_all(path, xml_document_root(nested), results, 8) == 2);
+    assert(strcmp(xml_node_get_attr(results[0], "id"), "x") == 0);
+    assert(strcmp(xml_node_get_attr(xml_path_find(path, xml_document_root(nested)), "id"), "x") == 0);
+    xml_path_free(path);
+    xml_free_document(nested);
+
+    // Malformed expressions
+    const char* bad[] = { "", "a/", "a//", "a[", "a[0]", "a[@]", "a[@b=c]", "a[@b='c]", "a[x]", "a b", "//.", ".[1]", "a[1][1][1][1][1][1][1][1][1]" };
+    for (size_t idx = 0; idx < sizeof(bad) / sizeof(bad[0]); idx++)
+    {
+        assert(xml_path_compile(bad[idx]) == NULL);
+    }
+
+    assert(xml_path_find(NULL, root) == NULL);
+    xml_free_document(doc);
+}
+
+void test_file(void)
+{
+    char* parent = NULL;
+    char* base = NULL;
+    char* ext = NULL;
+
+    assert(file_is_exists(NULL) == false);
+    assert(file_get_parent_directory(NULL) == NULL);
+    assert(file_get_basename(NULL) == NULL);
+    assert(file_get_extension(NULL) == NULL);
+
+    parent = file_get_parent_directory("/tmp/abc.txt");
+    assert(parent != NULL);
+    assert(strcmp(parent, "/tmp") == 0);
+    free(parent);
+
+    parent = file_get_parent_directory("abc.txt");
+    assert(parent == NULL);
+
+    base = file_get_basename("stdin");
+    assert(base != NULL);
+    assert(strcmp(base, "stdin") == 0);
+    free(base);
+
+    base = file_get_basename("/tmp/abc.txt");
+    assert(base != NULL);
+    assert(strcmp(base, "abc.txt") == 0);
+    free(base);
+
+    ext = file_get_extension("noext");
+    assert(ext != NULL);
+    assert(strcmp(ext, "") == 0);
+    free(ext);
+
+    ext = file_get_extension("/tmp/abc.txt");
+    assert(ext != NULL);
+    assert(strcmp(ext, "txt") == 0);
+    free(ext);
+
+    assert(file_map_open(NULL) == NULL);
+    assert(file_map_open("/nonexistent/treonz_map.txt") == NULL);
+
+    // Regular file: mapped, NUL terminated past the end
+    const char* map_path = "/tmp/treonz_file_map.json";
+    FILE* fp = fopen(map_path, "wb");
+    assert(fp != NULL);
+    fputs("{\"mapped\": [1, 2, 3]}", fp);
+    fclose(fp);
+
+    file_map_t* map = file_map_open(map_path);
+    assert(map != NULL);
+    assert(file_map_is_mapped(map));
+    assert(file_map_get_size(map) == 21);
+    assert(memcmp(file_map_get_data(map), "{\"mapped\": [1, 2, 3]}", 21) == 0);
+    assert(file_map_get_data(map)[21] == 0);
+    file_map_close(map);
+
+    json_document_t* doc = json_load_file(map_path);
+    assert(doc != NULL);
+    json_node_t* value = json_node_first_child_element(json_document_root(doc), NULL);
+    json_node_t* arr = json_node_first_child_element(value, "mapped");
+    assert(arr != NULL && json_node_get_child_count(arr) == 3);
+    json_free_document(doc);
+
+    // A page sized file has no spare byte to terminate it, so it is read
+    long page = sysconf(_SC_PAGESIZE);
+    fp = fopen(map_path, "wb");
+    assert(fp != NULL);
+    fputc('[', fp);
+    for(long i = 1; i < page - 1; i++)
+    {
+        fputc(' ', fp);
+    }
+    fputc(']', fp);
+    fclose(fp);
+
+    map = file_map_open(map_path);
+    assert(map != NULL);
+    assert(!file_map_is_mapped(map));
+    assert(file_map_get_size(map) == (size_t)page);
+    assert(file_map_get_data(map)[page] == 0);
+    file_map_close(map);
+
+    doc = json_load_file(map_path);
+    assert(doc != NULL);
+    value = json_node_first_child_element(json_document_root(doc), NULL);
+    assert(value != NULL && json_node_get_child_count(value) == 0);
+    json_free_document(doc);
+
+    // Empty file
+    fp = fopen(map_path, "wb");
+    assert(fp != NULL);
+    fclose(fp);
+    map = file_map_open(map_path);
+    assert(map != NULL);
+    assert(file_map_get_size(map) == 0);
+    assert(file_map_get_data(map)[0] == 0);
+    file_map_close(map);
+    assert(json_load_file(map_path) == NULL);
+
+    remove(map_path);
+}
+
+void test_directory(void)
+{
+    string_t* parent = NULL;
+    string_t* tmp = NULL;
+    string_t* logd = NULL;
+    string_t* cfg = NULL;
+    string_t* missing = NULL;
+    const char* old_user = getenv("USER");
+
+    assert(dir_is_exists(NULL) == false);
+    assert(dir_get_parent_directory(NULL) == NULL);
+
+    parent = string_allocate("/tmp/treonz/sub");
+    assert(parent != NULL);
+    string_t* parent_dir = dir_get_parent_directory(parent);
+    assert(parent_dir != NULL);
+    assert(strcmp(string_c_str(parent_dir), "/tmp/treonz") == 0);
+    string_free(&parent_dir);
+    string_free(&parent);
+
+    missing = string_allocate("/path/that/does/not/exist");
+    assert(missing != NULL);
+    assert(dir_is_exists(missing) == false);
+    string_free(&missing);
+
+    unsetenv("USER");
+    tmp = dir_get_temp_directory();
+    logd = dir_get_log_directory();
+    cfg = dir_get_config_directory();
+    assert(tmp != NULL && logd != NULL && cfg != NULL);
+    assert(strcmp(string_c_str(tmp), "/tmp/") == 0);
+    assert(strcmp(string_c_str(logd), "/var/log/") == 0);
+    assert(strcmp(string_c_str(cfg), "/etc/") == 0);
+    string_free(&tmp);
+    string_free(&logd);
+    string_free(&cfg);
+
+    if(old_user != NULL)
+    {
+        setenv("USER", old_user, 1);
+    }
+}
+
+void test_environment(void)
+{
+    string_t* user = NULL;
+    string_t* proc = NULL;
+    string_t* lock_name = NULL;
+    const char* old_user = getenv("USER");
+    char* old_user_copy = old_user ? strdup(old_user) : NULL;
+
+    unsetenv("USER");
+
+    user = env_get_current_user_name();
+    assert(user != NULL);
+    assert(strcmp(string_c_str(user), "root") == 0);
+    string_free(&user);
+
+    proc = env_get_current_process_name();
+    assert(proc != NULL);
+    assert(string_get_length(proc) > 0);
+    string_free(&proc);
+
+    lock_name = env_get_lock_filename();
+    assert(lock_name != NULL);
+    assert(string_get_length(lock_name) > 0);
+    string_free(&lock_name);
+
+    if (env_lock_process())
+    {
+        assert(env_is_process_locked() == true);
+        assert(env_unlock_process() == true);
+    }
+
+    assert(env_is_process_locked() == false);
+
+    if(old_user_copy != NULL)
+    {
+        setenv("USER", old_user_copy, 1);
+        free(old_user_copy);
+    }
+}
+
+typedef struct test_config_reader_t
+{
+    configuration_t* conf;
+    configuration_value_t* value;
+    atomic_bool stop;
+}test_config_reader_t;
+
+static void* test_configuration_reader(void* arg)
+{
+    test_config_reader_t* reader = (test_config_reader_t*)arg;
+    long last = 0;
+
+    while(!atomic_load(&reader->stop))
+    {
+        long value = configuration_value_integer(reader->value, -1);
+        long plain = configuration_get_value_as_integer(reader->conf, "churn", "value");
+        const char* name = configuration_get_value_as_string(reader->conf, "churn", "name");
+
+        // Reloads only move forward
+        assert(value >= last && plain >= value);
+        assert(name != NULL && name[0] == 'v');
+        assert(configuration_has_key(reader->conf, "churn", "name"));
+        last = value;
+    }
+
+    return NULL;
+}
+
+void test_configuration(void)
+{
+    configuration_t* conf = configuration_allocate_default();
+
+    string_list_t* sections = configuration_get_all_sections(conf);
+
+    string_t* sec_str = NULL;
+    sec_str = string_get_first_from_list(sections);
+
+    while(sec_str)
+    {
+        printf("Section %s\n", string_c_str(sec_str));
+        
+        string_list_t* keys = NULL;
+        keys = configuration_get_all_keys(conf, string_c_str(sec_str));
+
+        string_t* key_str = NULL;
+        key_str = string_get_first_from_list(keys);
+
+        while(key_str)
+        {
+            printf("Key %s Value %s\n", string_c_str(key_str), configuration_get_value_as_string(conf, string_c_str(sec_str), string_c_str(key_str)));
+            key_str = string_get_next_from_list(keys);
+        }
+
+        string_free_list(keys);
+
+        sec_str = string_get_next_from_list(sections);
+    }
+
+    string_free_list(sections);
+
+    configuration_release(conf);
+
+    char path[256] = {0};
+    char temp_path[272] = {0};
+    snprintf(path, sizeof(path), "/tmp/treonz_test_%d.conf", (int)getpid());
+    snprintf(temp_path, sizeof(temp_path), "%s.new", path);
+
+    FILE* fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "orphan=ignored\n"
+                "; comment\n"
+                "# comment\n"
+                "[ network ]\n"
+                "  port = 8080  \r\n"
+                "host=example.org\n"
+                "ratio = 0.25\n"
+                "verbose = true\n"
+                "empty =\n"
+                "port = 9090\n"
+                "[limits]\n"
+                "max=10\n"
+                "[network]\n"
+                "retries = 3");
+
+    // Enough sections and keys to make both hash tables grow
+    for(int sec = 0; sec < 40; sec++)
+    {
+        fprintf(fp, "\n[s%d]\n", sec);
+
+        for(int key = 0; key < 25; key++)
+        {
+            fprintf(fp, "k%d=%d\n", key, sec * 100 + key);
+        }
+    }
+
+    fclose(fp);
+
+    conf = configuration_allocate(path);
+    assert(conf != NULL);
+    assert(configuration_get_generation(conf) == 1);
+
+    assert(configuration_has_section(conf, "network"));
+    assert(configuration_has_section(conf, "limits"));
+    assert(!configuration_has_section(conf, "missing"));
+    assert(!configuration_has_section(conf, ""));
+    assert(configuration_has_key(conf, "network", "port"));
+    assert(!configuration_has_key(conf, "network", "orphan"));
+    assert(!configuration_has_key(conf, "limits", "port"));
+
+    // The first occurrence wins; a repeated header continues the section
+    assert(configuration_get_value_as_integer(conf, "network", "port") == 8080);
+    assert(configuration_get_value_as_integer(conf, "network", "retries") == 3);
+    assert(strcmp(configuration_get_value_as_string(conf, "network", "host"), "example.org") == 0);
+    assert(configuration_get_value_as_real(conf, "network", "ratio") == 0.25);
+    assert(configuration_get_value_as_boolean(conf, "network", "verbose"));
+    assert(configuration_get_value_as_char(conf, "network", "host") == 'e');
+    assert(strcmp(configuration_get_value_as_string(conf, "network", "empty"), "") == 0);
+    assert(configuration_get_value_as_integer(conf, "network", "nothing") == LONG_MAX);
+    assert(configuration_get_value_as_string(conf, "nothing", "port") == NULL);
+
+    for(int sec = 0; sec < 40; sec++)
+    {
+        char sec_name[16];
+        snprintf(sec_name, sizeof(sec_name), "s%d", sec);
+
+        for(int key = 0; key < 25; key++)
+        {
+            char key_name[16];
+            snprintf(key_name, sizeof(key_name), "k%d", key);
+            assert(configuration_get_value_as_integer(conf, sec_name, key_name) == sec * 100 + key);
+        }
+    }
+
+    sections = configuration_get_all_sections(conf);
+    assert(strcmp(string_c_str(string_get_first_from_list(sections)), "network") == 0);
+    assert(strcmp(string_c_str(string_get_next_from_list(sections)), "limits") == 0);
+    assert(strcmp(string_c_str(string_get_next_from_list(sections)), "s0") == 0);
+    string_free_list(sections);
+
+    // Keys come in file order; keys with empty values are left out
+    string_list_t* keys = configuration_get_all_keys(conf, "network");
+    const char* expected_keys[] = {"port", "host", "ratio", "verbose", "port", "retries"};
+    string_t* key_str = string_get_first_from_list(keys);
+
+    for(size_t index = 0; index < sizeof(expected_keys) / sizeof(expected_keys[0]); index++)
+    {
+        assert(key_str != NULL && strcmp(string_c_str(key_str), expected_keys[index]) == 0);
+        key_str = string_get_next_from_list(keys);
+    }
+
+    assert(key_str == NULL);
+    string_free_list(keys);
+
+    // An unchanged file keeps the snapshot; strings stay valid across reloads
+    const char* old_host = configuration_get_value_as_string(conf, "network", "host");
+    assert(configuration_reload(conf));
+    assert(configuration_get_generation(conf) == 1);
+
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[network]\nport=7070\n");
+    fclose(fp);
+
+    assert(configuration_reload(conf));
+    assert(configuration_get_generation(conf) == 2);
+    assert(configuration_get_value_as_integer(conf, "network", "port") == 7070);
+    assert(!configuration_has_section(conf, "limits"));
+    assert(strcmp(old_host, "example.org") == 0);
+
+    // Replacing the file by rename is picked up by the watcher
+    if (configuration_watch(conf, NULL, NULL))
+    {
+        assert(!configuration_watch(conf, NULL, NULL));
+
+        fp = fopen(temp_path, "w");
+        assert(fp != NULL);
+        fprintf(fp, "[network]\nport=6060\n");
+        fclose(fp);
+        assert(rename(temp_path, path) == 0);
+
+        for(int wait = 0; wait < 500 && configuration_get_generation(conf) < 3; wait++)
+        {
+            usleep(10000);
+        }
+
+        assert(configuration_get_generation(conf) == 3);
+        assert(configuration_get_value_as_integer(conf, "network", "port") == 6060);
+
+        configuration_unwatch(conf);
+    }
+
+    // A missing file keeps the last good snapshot
+    unlink(path);
+    assert(!configuration_reload(conf));
+    assert(configuration_get_value_as_integer(conf, "network", "port") == 6060 || configuration_get_value_as_integer(conf, "network", "port") == 7070);
+
+    configuration_release(conf);
+    assert(configuration_allocate(path) == NULL);
+
+    // Bound, pre-converted values
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[server]\n"
+                "workers = 0x10\n"
+                "ratio = 2.5\n"
+                "enabled = Yes\n"
+                "buffer = 4MB\n"
+                "cache = 1.5 GiB\n"
+                "timeout = 10ms\n"
+                "linger = 1h30m\n"
+                "grace = 3\n"
+                "ports = 80, 443 ,8080\n"
+                "names = a,,b\n"
+                "empty =\n"
+                "bad = 12abc\n");
+    fclose(fp);
+
+    conf = configuration_allocate(path);
+    assert(conf != NULL);
+
+    configuration_value_t* workers = configuration_bind(conf, "server", "workers");
+    configuration_value_t* ratio = configuration_bind(conf, "server", "ratio");
+    configuration_value_t* enabled = configuration_bind(conf, "server", "enabled");
+    configuration_value_t* buffer_size = configuration_bind(conf, "server", "buffer");
+    configuration_value_t* cache = configuration_bind(conf, "server", "cache");
+    configuration_value_t* timeout = configuration_bind(conf, "server", "timeout");
+    configuration_value_t* linger = configuration_bind(conf, "server", "linger");
+    configuration_value_t* grace = configuration_bind(conf, "server", "grace");
+    configuration_value_t* ports = configuration_bind(conf, "server", "ports");
+    configuration_value_t* names = configuration_bind(conf, "server", "names");
+    configuration_value_t* empty = configuration_bind(conf, "server", "empty");
+    configuration_value_t* bad = configuration_bind(conf, "server", "bad");
+    configuration_value_t* absent = configuration_bind(conf, "server", "absent");
+
+    assert(configuration_value_integer(workers, -1) == 16);
+    assert(configuration_value_real(workers, -1) == 16);
+    assert(configuration_value_real(ratio, -1) == 2.5);
+    assert(configuration_value_integer(ratio, -1) == -1);
+    assert(configuration_value_boolean(enabled, false));
+    assert(configuration_value_size(buffer_size, 0) == 4 * 1024 * 1024);
+    assert(configuration_value_size(cache, 0) == 1536ULL * 1024 * 1024);
+    assert(configuration_value_duration(timeout, 0) == 10000000);
+    assert(configuration_value_duration(linger, 0) == 5400LL * 1000000000);
+    assert(configuration_value_duration(grace, 0) == 3000000000LL);
+    assert(configuration_value_size(grace, 0) == 3);
+    assert(configuration_value_duration(buffer_size, -1) == -1);
+
+    assert(configuration_value_array_count(ports) == 3);
+    assert(configuration_value_array_integer(ports, 1, 0) == 443);
+    assert(strcmp(configuration_value_array_string(ports, 2, NULL), "8080") == 0);
+    assert(configuration_value_array_integer(ports, 3, -1) == -1);
+    assert(strcmp(configuration_value_string(ports, NULL), "80, 443 ,8080") == 0);
+    assert(configuration_value_integer(ports, -1) == -1);
+    assert(configuration_value_array_count(names) == 3);
+    assert(strcmp(configuration_value_array_string(names, 1, NULL), "") == 0);
+    assert(configuration_value_array_count(grace) == 1);
+    assert(configuration_value_array_real(grace, 0, 0) == 3);
+    assert(configuration_value_array_count(empty) == 0);
+    assert(configuration_value_exists(empty));
+
+    assert(configuration_value_integer(bad, -1) == -1);
+    assert(configuration_value_boolean(bad, true));
+    assert(!configuration_value_exists(absent));
+    assert(configuration_value_integer(absent, 42) == 42);
+    assert(configuration_value_string(absent, NULL) == NULL);
+    assert(configuration_bind(conf, NULL, "workers") == NULL);
+
+    // Handles follow reloads, including keys that appear or disappear
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[server]\nworkers = 4\nabsent = 1s\n");
+    fclose(fp);
+
+    assert(configuration_reload(conf));
+    assert(configuration_value_integer(workers, -1) == 4);
+    assert(configuration_value_duration(absent, 0) == 1000000000);
+    assert(!configuration_value_exists(ratio));
+    assert(configuration_value_array_count(ports) == 0);
+
+    configuration_unbind(workers);
+    configuration_unbind(ratio);
+    configuration_unbind(enabled);
+    configuration_unbind(buffer_size);
+    configuration_unbind(cache);
+    configuration_unbind(timeout);
+    configuration_unbind(linger);
+    configuration_unbind(grace);
+    configuration_unbind(ports);
+    configuration_unbind(names);
+    configuration_unbind(empty);
+    configuration_unbind(bad);
+    configuration_unbind(absent);
+    configuration_release(conf);
+
+    // Frequent rewrites while getters keep reading; strings outlive reloads
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[churn]\nvalue = 0\nname = v0\n");
+    fclose(fp);
+
+    test_config_reader_t reader;
+    pthread_t readers[2];
+    reader.conf = configuration_allocate(path);
+    assert(reader.conf != NULL);
+    reader.value = configuration_bind(reader.conf, "churn", "value");
+    assert(reader.value != NULL);
+    atomic_init(&reader.stop, false);
+    const char* first_name = configuration_get_value_as_string(reader.conf, "churn", "name");
+    assert(first_name != NULL && strcmp(first_name, "v0") == 0);
+
+    for(size_t index = 0; index < 2; index++)
+    {
+        assert(pthread_create(&readers[index], NULL, test_configuration_reader, &reader) == 0);
+    }
+
+    for(int round = 1; round <= 300; round++)
+    {
+        fp = fopen(path, "w");
+        assert(fp != NULL);
+        fprintf(fp, "[churn]\nvalue = %d\nname = v%d\n", round, round);
+        fclose(fp);
+
+        assert(configuration_reload(reader.conf));
+        assert(configuration_value_integer(reader.value, -1) == round);
+    }
+
+    atomic_store(&reader.stop, true);
+
+    for(size_t index = 0; index < 2; index++)
+    {
+        pthread_join(readers[index], NULL);
+    }
+
+    assert(configuration_get_generation(reader.conf) == 301);
+    assert(strcmp(first_name, "v0") == 0);
+    configuration_unbind(reader.value);
+    configuration_release(reader.conf);
+
+    // Compiled image: used while the file keeps its size and modification time
+    char cache_path[272] = {0};
+    snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+    unlink(cache_path);
+
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[server]\nport = 8080\nhosts = a, b\ntimeout = 5s\n");
+    fclose(fp);
+
+    struct stat source_stat;
+    assert(stat(path, &source_stat) == 0);
+
+    conf = configuration_allocate_cached(path, cache_path);
+    assert(conf != NULL);
+    assert(access(cache_path, F_OK) == 0);
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 8080);
+    configuration_release(conf);
+
+    // Same size and time but different content: the image must win,
+    // which shows the file was not parsed
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[server]\nport = 9090\nhosts = a, b\ntimeout = 5s\n");
+    fclose(fp);
+    struct timespec times[2] = {source_stat.st_atim, source_stat.st_mtim};
+    assert(utimensat(AT_FDCWD, path, times, 0) == 0);
+
+    conf = configuration_allocate_cached(path, cache_path);
+    assert(conf != NULL);
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 8080);
+    assert(strcmp(configuration_get_value_as_string(conf, "server", "hosts"), "a, b") == 0);
+
+    configuration_value_t* hosts = configuration_bind(conf, "server", "hosts");
+    configuration_value_t* cached_timeout = configuration_bind(conf, "server", "timeout");
+    assert(configuration_value_array_count(hosts) == 2);
+    assert(strcmp(configuration_value_array_string(hosts, 1, NULL), "b") == 0);
+    assert(configuration_value_duration(cached_timeout, 0) == 5000000000LL);
+
+    // A reload parses the file and refreshes the image
+    assert(configuration_reload(conf));
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 9090);
+    configuration_unbind(hosts);
+    configuration_unbind(cached_timeout);
+    configuration_release(conf);
+
+    conf = configuration_allocate_cached(path, cache_path);
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 9090);
+    configuration_release(conf);
+
+    // A changed file makes the image stale
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    fprintf(fp, "[server]\nport = 70\n");
+    fclose(fp);
+
+    conf = configuration_allocate_cached(path, cache_path);
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 70);
+    configuration_release(conf);
+
+    // A damaged image is ignored
+    fp = fopen(cache_path, "r+");
+    assert(fp != NULL);
+    fputc('X', fp);
+    fclose(fp);
+
+    conf = configuration_allocate_cached(path, cache_path);
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 70);
+    configuration_release(conf);
+
+    assert(configuration_compile(path, cache_path));
+    conf = configuration_allocate_cached(path, cache_path);
+    assert(configuration_get_value_as_integer(conf, "server", "port") == 70);
+    configuration_release(conf);
+
+    // Damage anywhere in the body is caught before the records are used
+    fp = fopen(cache_path, "rb");
+    assert(fp != NULL);
+    unsigned char image[4096];
+    size_t image_size = fread(image, 1, sizeof(image), fp);
+    fclose(fp);
+    assert(image_size > 0 && image_size < sizeof(image));
+
+    for(size_t offset = 0; offset < image_size; offset++)
+    {
+        unsigned char original = image[offset];
+        image[offset] = 0xFF;
+
+        fp = fopen(cache_path, "wb");
+        assert(fp != NULL);
+        assert(fwrite(image, 1, image_size, fp) == image_size);
+        fclose(fp);
+
+        conf = configuration_allocate_cached(path, cache_path);
+        assert(conf != NULL);
+        configuration_get_value_as_integer(conf, "server", "port");
+        configuration_has_key(conf, "other", "port");
+        string_free_list(configuration_get_all_keys(conf, "server"));
+        string_free_list(configuration_get_all_sections(conf));
+        configuration_release(conf);
+
+        image[offset] = original;
+    }
+
+    unlink(cache_path);
+    unlink(path);
+    assert(configuration_allocate_cached(path, cache_path) == NULL);
+}
+
+void test_dictionary(void)
+{
+    dictionary_t* dict = dictionary_allocate();
+    int ref_value = 99;
+
+    assert(dict != NULL);
+
+    dictionary_set_value(dict, "123", strlen("123"), "ABCDEFGHIJKLMN", strlen("ABCDEFGHIJKLMN"));
+    dictionary_set_value(dict, "ABC", strlen("ABC"), "0123456789", strlen("0123456789"));
 
     char* val1 = (char*)dictionary_get_value(dict, "123", strlen("123"));
     char* val2 = (char*)dictionary_get_value(dict, "ABC", strlen("ABC"));
@@ -681,6 +3325,21 @@ void test_dictionary(void)
     dictionary_free(dict);
 }
 
+static void* test_base64_decoder(void* arg)
+{
+    (void)arg;
+    unsigned char decoded[16];
+
+    for (int round = 0; round < 1000; round++)
+    {
+        unsigned long decoded_len = 0;
+        assert(base64_decode("SGVsbG8sIEJhc2U2NCE=", 20, decoded, &decoded_len) != NULL);
+        assert(decoded_len == 14 && memcmp(decoded, "Hello, Base64!", 14) == 0);
+    }
+
+    return NULL;
+}
+
 void test_base64(void)
 {
     const unsigned char sample[] = "Hello, Base64!";
@@ -692,6 +3351,19 @@ void test_base64(void)
     unsigned long decoded_len = 0;
     unsigned long invalid_len = 123;
 
+    // First calls from several threads at once share the kernel setup
+    pthread_t decoders[4];
+
+    for (size_t index = 0; index < 4; index++)
+    {
+        assert(pthread_create(&decoders[index], NULL, test_base64_decoder, NULL) == 0);
+    }
+
+    for (size_t index = 0; index < 4; index++)
+    {
+        pthread_join(decoders[index], NULL);
+    }
+
     encoded = base64_encode(sample, sizeof(sample) - 1, NULL, &encoded_len);
     assert(encoded != NULL);
     assert(encoded_len == strlen(expected_encoded));
@@ -713,6 +3385,341 @@ void test_base64(void)
     free(empty_decoded);
     free(decoded);
     free(encoded);
+
+    /* Caller supplied output buffers are written in place. */
+    char out_text[64] = {0};
+    unsigned char out_data[64] = {0};
+
+    assert(base64_encoded_length(sizeof(sample) - 1) == strlen(expected_encoded));
+    assert(base64_encode(sample, sizeof(sample) - 1, out_text, &encoded_len) == out_text);
+    assert(strcmp(out_text, expected_encoded) == 0);
+    assert(base64_decode(out_text, encoded_len, out_data, &decoded_len) == out_data);
+    assert(decoded_len == sizeof(sample) - 1);
+    assert(memcmp(out_data, sample, decoded_len) == 0);
+
+    /* Every kernel must agree with the scalar one, including the tails. */
+    unsigned char raw[300] = {0};
+    char reference[512] = {0};
+    char text[512] = {0};
+    unsigned char back[400] = {0};
+    unsigned long reference_len = 0;
+    unsigned long text_len = 0;
+    unsigned long back_len = 0;
+    base64_kernel_t kernels[] = { BASE64_KERNEL_SCALAR, BASE64_KERNEL_SSSE3, BASE64_KERNEL_AVX2 };
+    base64_kernel_t default_kernel = base64_get_kernel();
+
+    for (size_t index = 0; index < sizeof(raw); index++)
+    {
+        raw[index] = (unsigned char)(index * 37 + 11);
+    }
+
+    for (unsigned long len = 0; len <= sizeof(raw); len++)
+    {
+        assert(base64_set_kernel(BASE64_KERNEL_SCALAR));
+        base64_encode(raw, len, reference, &reference_len);
+
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+        {
+            if (!base64_set_kernel(kernels[k]))
+            {
+                continue;
+            }
+
+            base64_encode(raw, len, text, &text_len);
+            assert(text_len == reference_len);
+            assert(memcmp(text, reference, text_len) == 0);
+
+            base64_decode(text, text_len, back, &back_len);
+            assert(back_len == len);
+            assert(memcmp(back, raw, len) == 0);
+        }
+    }
+
+    /* Characters outside the alphabet keep the legacy zero-bit behaviour on all kernels. */
+    memset(text, 'A', 64);
+    text[40] = '*';
+    assert(base64_set_kernel(BASE64_KERNEL_SCALAR));
+    base64_decode(text, 64, out_data, &reference_len);
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        if (base64_set_kernel(kernels[k]))
+        {
+            base64_decode(text, 64, back, &back_len);
+            assert(back_len == reference_len);
+            assert(memcmp(back, out_data, back_len) == 0);
+        }
+    }
+
+    base64_set_kernel(default_kernel);
+
+    /* Streaming codecs must match the one-shot result for any chunking. */
+    base64_encoder_t* encoder = base64_encoder_allocate(0);
+    base64_encoder_t* mime_encoder = base64_encoder_allocate(76);
+    base64_decoder_t* decoder = base64_decoder_allocate();
+    char stream_text[1024] = {0};
+    unsigned char stream_data[512] = {0};
+    unsigned long stream_len = 0;
+    unsigned long tail_len = 0;
+
+    assert(encoder != NULL && mime_encoder != NULL && decoder != NULL);
+    base64_encode(raw, sizeof(raw), reference, &reference_len);
+
+    for (unsigned long chunk = 1; chunk <= 40; chunk++)
+    {
+        stream_len = 0;
+
+        for (unsigned long pos = 0; pos < sizeof(raw); pos += chunk)
+        {
+            unsigned long len = (sizeof(raw) - pos) < chunk ? (sizeof(raw) - pos) : chunk;
+            assert(base64_encoder_max_output(encoder, len) + stream_len <= sizeof(stream_text));
+            stream_len += base64_encoder_update(encoder, raw + pos, len, stream_text + stream_len);
+        }
+
+        stream_len += base64_encoder_finish(encoder, stream_text + stream_len);
+        assert(stream_len == reference_len);
+        assert(memcmp(stream_text, reference, reference_len) == 0);
+
+        /* Wrapped output decodes back through the streaming decoder. */
+        stream_len = 0;
+
+        for (unsigned long pos = 0; pos < sizeof(raw); pos += chunk)
+        {
+            unsigned long len = (sizeof(raw) - pos) < chunk ? (sizeof(raw) - pos) : chunk;
+            stream_len += base64_encoder_update(mime_encoder, raw + pos, len, stream_text + stream_len);
+        }
+
+        stream_len += base64_encoder_finish(mime_encoder, stream_text + stream_len);
+        assert(stream_len == reference_len + ((reference_len + 75) / 76) * 2);
+        assert(memcmp(stream_text, reference, 76) == 0);
+        assert(stream_text[76] == '\r' && stream_text[77] == '\n');
+        assert(memcmp(stream_text + stream_len - 2, "\r\n", 2) == 0);
+
+        back_len = 0;
+
+        for (unsigned long pos = 0; pos < stream_len; pos += chunk)
+        {
+            unsigned long len = (stream_len - pos) < chunk ? (stream_len - pos) : chunk;
+            back_len += base64_decoder_update(decoder, stream_text + pos, len, stream_data + back_len);
+        }
+
+        assert(base64_decoder_finish(decoder, stream_data + back_len, &tail_len));
+        back_len += tail_len;
+        assert(back_len == sizeof(raw));
+        assert(memcmp(stream_data, raw, sizeof(raw)) == 0);
+    }
+
+    /* Unpadded input is flushed on finish, a dangling character is reported. */
+    back_len = base64_decoder_update(decoder, "SGk", 3, stream_data);
+    assert(base64_decoder_finish(decoder, stream_data + back_len, &tail_len));
+    assert(back_len + tail_len == 2 && memcmp(stream_data, "Hi", 2) == 0);
+
+    back_len = base64_decoder_update(decoder, "SGVsbG8x", 8, stream_data);
+    back_len += base64_decoder_update(decoder, "Q", 1, stream_data + back_len);
+    assert(base64_decoder_finish(decoder, stream_data + back_len, &tail_len) == false);
+
+    base64_encoder_free(encoder);
+    base64_encoder_free(mime_encoder);
+    base64_decoder_free(decoder);
+}
+
+static unsigned long test_qp_encode(const char* text, unsigned long chunk, bool binary, char* out)
+{
+    quoted_printable_encoder_t* encoder = quoted_printable_encoder_allocate(76, binary);
+    unsigned long len = strlen(text);
+    unsigned long o = 0;
+
+    assert(encoder != NULL);
+
+    for (unsigned long pos = 0; pos < len; pos += chunk)
+    {
+        unsigned long part = (len - pos) < chunk ? (len - pos) : chunk;
+        o += quoted_printable_encoder_update(encoder, (const unsigned char*)text + pos, part, out + o);
+    }
+
+    o += quoted_printable_encoder_finish(encoder, out + o);
+    out[o] = 0;
+    quoted_printable_encoder_free(encoder);
+
+    return o;
+}
+
+static unsigned long test_qp_decode(const char* text, unsigned long chunk, unsigned char* out, bool* valid)
+{
+    quoted_printable_decoder_t* decoder = quoted_printable_decoder_allocate();
+    unsigned long len = strlen(text);
+    unsigned long o = 0;
+    unsigned long tail = 0;
+
+    assert(decoder != NULL);
+
+    for (unsigned long pos = 0; pos < len; pos += chunk)
+    {
+        unsigned long part = (len - pos) < chunk ? (len - pos) : chunk;
+        o += quoted_printable_decoder_update(decoder, text + pos, part, out + o);
+    }
+
+    *valid = quoted_printable_decoder_finish(decoder, out + o, &tail);
+    o += tail;
+    out[o] = 0;
+    quoted_printable_decoder_free(decoder);
+
+    return o;
+}
+
+void test_gzip(void)
+{
+    /* gzip -n -9, a fixed Huffman block */
+    const unsigned char hello[] = { 0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0xcb,0x48,0xcd,0xc9,0xc9,0xe7,0x02,0x00,0x20,0x30,0x3a,0x36,0x06,0x00,0x00,0x00 };
+    /* gzip -n -9, a dynamic Huffman block */
+    const char skewed[] = "abcabbabababcaacaabaabaabaaababacababbbaababcaacaaaaaaababcbadbbadcaabbbabbabcabaaabbabaabaaabaaaaabaaaacbcabaaaacaaaaaa";
+    const unsigned char dynamic[] = { 0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x45,0x4c,0x01,0x0e,0x00,0x40,0x08,0x79,0x2b,0xfa,0xff,0x1b,0x2e,0x96,0x5d,0x99,0x2d,0x02,0x14,0x48,0x64,0x05,0x2c,0x58,0x44,0x94,0x99,0x11,0xce,0xcf,0xf8,0x22,0x66,0x8d,0x71,0xc4,0x0d,0x79,0x48,0x8c,0xbf,0x00,0x65,0x9d,0xd9,0x86,0x07,0x84,0xe8,0xe5,0xc5,0x78,0x00,0x00,0x00 };
+    unsigned char* packed = NULL;
+    unsigned char* unpacked = NULL;
+    unsigned long packed_len = 0;
+    unsigned long unpacked_len = 0;
+
+    assert(gzip_crc32(0, (const unsigned char*)"123456789", 9) == 0xCBF43926UL);
+
+    unpacked = gzip_decompress(hello, sizeof(hello), &unpacked_len);
+    assert(unpacked != NULL);
+    assert(unpacked_len == 6 && memcmp(unpacked, "hello\n", 6) == 0);
+    free(unpacked);
+
+    unpacked = gzip_decompress(dynamic, sizeof(dynamic), &unpacked_len);
+    assert(unpacked != NULL);
+    assert(unpacked_len == strlen(skewed) && memcmp(unpacked, skewed, unpacked_len) == 0);
+    free(unpacked);
+
+    /* Text, incompressible, empty, longer than the window and repetitive */
+    size_t sizes[] = { 2000, 3000, 0, 70000, 100000 };
+    unsigned int seed = 12345;
+
+    for (size_t pass = 0; pass < sizeof(sizes) / sizeof(sizes[0]); pass++)
+    {
+        unsigned char* data = (unsigned char*)malloc(sizes[pass] + 1);
+        assert(data != NULL);
+
+        for (size_t index = 0; index < sizes[pass]; index++)
+        {
+            seed = seed * 1103515245 + 12345;
+            if (pass == 0)
+            {
+                data[index] = (unsigned char)"2026-10-18 12:00:00\tInfo\tlogger\n"[index % 33];
+            }
+            else if (pass == 4)
+            {
+                data[index] = (unsigned char)('a' + index % 7);
+            }
+            else
+            {
+                data[index] = (unsigned char)(seed >> 16);
+            }
+        }
+
+        packed = gzip_compress(data, (unsigned long)sizes[pass], &packed_len);
+        assert(packed != NULL);
+        if (pass == 0 || pass == 4)
+        {
+            assert(packed_len < sizes[pass] / 4);
+        }
+        else
+        {
+            assert(packed_len <= sizes[pass] + 18 + 5 * (sizes[pass] / 65535 + 1));
+        }
+
+        unpacked = gzip_decompress(packed, packed_len, &unpacked_len);
+        assert(unpacked != NULL);
+        assert(unpacked_len == sizes[pass]);
+        assert(memcmp(unpacked, data, sizes[pass]) == 0);
+        free(unpacked);
+
+        if (sizes[pass] > 0)
+        {
+            /* A damaged trailer is rejected */
+            packed[packed_len - 8] ^= 0x01;
+            assert(gzip_decompress(packed, packed_len, &unpacked_len) == NULL);
+        }
+
+        free(packed);
+        free(data);
+    }
+
+    assert(gzip_decompress(hello, 10, &unpacked_len) == NULL);
+
+    /* File round trip */
+    const char* source = "/tmp/treonz_gzip_source.txt";
+    const char* destination = "/tmp/treonz_gzip_source.txt.gz";
+    const char content[] = "line one\nline two\nline one\nline two\n";
+    unsigned char stored[256];
+
+    FILE* fp = fopen(source, "w");
+    assert(fp != NULL);
+    fputs(content, fp);
+    fclose(fp);
+
+    assert(gzip_compress_file(source, destination));
+    fp = fopen(destination, "rb");
+    assert(fp != NULL);
+    packed_len = (unsigned long)fread(stored, 1, sizeof(stored), fp);
+    fclose(fp);
+
+    unpacked = gzip_decompress(stored, packed_len, &unpacked_len);
+    assert(unpacked != NULL);
+    assert(unpacked_len == strlen(content) && memcmp(unpacked, content, unpacked_len) == 0);
+    free(unpacked);
+
+    assert(!gzip_compress_file("/tmp/treonz_gzip_missing.txt", destination));
+
+    remove(source);
+    remove(destination);
+}
+
+void test_quoted_printable(void)
+{
+    const char* text = "Caf\xc3\xa9 = 100% \r\nTrailing tab\t\r\nbare\rcr and a line that is long enough to need a soft break somewhere past seventy six";
+    const char* expected = "Caf=C3=A9 =3D 100%=20\r\nTrailing tab=09\r\nbare=0Dcr and a line that is long enough to need a soft break somewhere pas=\r\nt seventy six";
+    char encoded[1024] = {0};
+    unsigned char decoded[1024] = {0};
+    bool valid = false;
+
+    for (unsigned long chunk = 1; chunk <= 16; chunk++)
+    {
+        unsigned long len = test_qp_encode(text, chunk, false, encoded);
+        assert(len == strlen(expected));
+        assert(strcmp(encoded, expected) == 0);
+
+        len = test_qp_decode(encoded, chunk, decoded, &valid);
+        assert(valid);
+        assert(len == strlen(text));
+        assert(strcmp((char*)decoded, text) == 0);
+    }
+
+    /* Lines never exceed 76 characters, including the soft break marker. */
+    char long_line[300] = {0};
+    memset(long_line, '=', 299);
+    test_qp_encode(long_line, 7, false, encoded);
+
+    for (char* line = encoded; line != NULL;)
+    {
+        char* next = strstr(line, "\r\n");
+        size_t line_len = next ? (size_t)(next - line) : strlen(line);
+        assert(line_len <= 76);
+        line = next ? next + 2 : NULL;
+    }
+
+    /* Binary mode escapes line breaks, and trailing whitespace at the end is escaped. */
+    test_qp_encode("a\r\nb ", 3, true, encoded);
+    assert(strcmp(encoded, "a=0D=0Ab=20") == 0);
+
+    /* Transport whitespace before a hard break is stripped, lowercase hex is accepted. */
+    test_qp_decode("one  \r\ntwo=3d=\nthree\n", 2, decoded, &valid);
+    assert(valid);
+    assert(strcmp((char*)decoded, "one\r\ntwo=three\r\n") == 0);
+
+    test_qp_decode("bad=G1 end=", 4, decoded, &valid);
+    assert(valid == false);
+    assert(strcmp((char*)decoded, "bad=G1 end=") == 0);
 }
 
 void test_email(void)
@@ -887,6 +3894,106 @@ void test_datetime(void)
         free(formatted);
     }
 
+    /* Token formatting into a caller buffer */
+    struct tm fixed_tm;
+    char out[64];
+    time_t t = 0;
+    long offset = 0;
+
+    memset(&fixed_tm, 0, sizeof(fixed_tm));
+    fixed_tm.tm_year = 126;
+    fixed_tm.tm_mon = 9;
+    fixed_tm.tm_mday = 8;
+    fixed_tm.tm_hour = 21;
+    fixed_tm.tm_min = 5;
+    fixed_tm.tm_sec = 9;
+    date_time_t* fixed = date_time_allocate_from_time_struct(&fixed_tm);
+    assert(fixed != NULL);
+    assert(date_time_format(fixed, "yyyy-MM-dd hh:mm:ss", out, sizeof(out)) == 19);
+    assert(strcmp(out, "2026-10-08 21:05:09") == 0);
+    assert(date_time_format(fixed, "dd MMMM yy, h:mm", out, sizeof(out)) == 23);
+    assert(strcmp(out, "08 October 26, 09:05 PM") == 0);
+    assert(date_time_format(fixed, "yyyy-MM-dd", out, 10) == 0);
+    formatted = date_time_get_formatted_string(fixed, "yyyyMMddhhmmss");
+    assert(formatted != NULL && strcmp(formatted, "20261008210509") == 0);
+    free(formatted);
+    date_time_release(fixed);
+
+    fixed = date_time_allocate_from_string("20261008210509", "yyyyMMddhhmmss");
+    assert(fixed != NULL);
+    assert(date_time_get_year(fixed) == 2026 && date_time_get_month(fixed) == 10 && date_time_get_day_of_month(fixed) == 8);
+    assert(date_time_get_hours(fixed) == 21 && date_time_get_minutes(fixed) == 5 && date_time_get_seconds(fixed) == 9);
+    date_time_release(fixed);
+
+    /* Protocol timestamps */
+    assert(date_time_format_rfc3339(1792315815, 0, out, sizeof(out)) == 20);
+    assert(strcmp(out, "2026-10-18T09:30:15Z") == 0);
+    assert(date_time_format_rfc3339(1792315815, 2 * 3600, out, sizeof(out)) == 25);
+    assert(strcmp(out, "2026-10-18T11:30:15+02:00") == 0);
+    assert(date_time_format_rfc3339(1792315815, 0, out, 20) == 0);
+    assert(date_time_format_rfc3339(-1, 0, out, sizeof(out)) == 20);
+    assert(strcmp(out, "1969-12-31T23:59:59Z") == 0);
+    assert(date_time_format_rfc2822(1792315815, -7 * 3600, out, sizeof(out)) == 31);
+    assert(strcmp(out, "Sun, 18 Oct 2026 02:30:15 -0700") == 0);
+    assert(date_time_format_rfc2822(951782400, 0, out, sizeof(out)) == 31);
+    assert(strcmp(out, "Tue, 29 Feb 2000 00:00:00 +0000") == 0);
+    assert(date_time_format_imap_date(1792315815, 0, out, sizeof(out)) == 11);
+    assert(strcmp(out, "18-Oct-2026") == 0);
+
+    const char* good_iso[] = { "2026-10-18T09:30:15Z", "2026-10-18t11:30:15.999+02:00", "2026-10-18 04:30:15-05",
+                               "20261018T093015Z", "20261018T0930+0000", "2026-10-18T09:30Z", "2026-10-18T09:30:15,25Z" };
+    for (size_t index = 0; index < sizeof(good_iso) / sizeof(good_iso[0]); index++)
+    {
+        assert(date_time_parse_iso8601(good_iso[index], strlen(good_iso[index]), &t, &offset));
+        assert(t == (index == 4 || index == 5 ? 1792315800 : 1792315815));
+    }
+    assert(date_time_parse_iso8601("2026-10-18", 10, &t, &offset));
+    assert(t + offset == 1792281600);
+    assert(date_time_parse_iso8601("2026-10-18T11:30:15+02:00", 25, &t, &offset) && offset == 7200);
+
+    const char* bad_iso[] = { "", "2026-13-01", "2026-02-29", "2026-10-18T25:00Z", "2026-10-18T09:30:15+2",
+                              "2026-10-18T09:30:15Zx", "2026-1018", "26-10-18", "2026-10-18T09:30:15." };
+    for (size_t index = 0; index < sizeof(bad_iso) / sizeof(bad_iso[0]); index++)
+    {
+        assert(!date_time_parse_iso8601(bad_iso[index], strlen(bad_iso[index]), &t, NULL));
+    }
+
+    assert(date_time_parse_rfc3339("2026-10-18T09:30:15.5Z", 22, &t, NULL) && t == 1792315815);
+    assert(date_time_parse_rfc3339("2024-02-29T23:59:60Z", 20, &t, NULL));
+    assert(date_time_parse_iso8601("2024-01-01T24:00:00Z", 20, &t, NULL) && t == 1704153600);
+    assert(!date_time_parse_iso8601("2024-01-01T24:00:01Z", 20, &t, NULL));
+    assert(!date_time_parse_rfc3339("2024-01-01T24:00:00Z", 20, &t, NULL));
+    assert(!date_time_parse_rfc3339("20261018T093015Z", 16, &t, NULL));
+    assert(!date_time_parse_rfc3339("2026-10-18T09:30Z", 17, &t, NULL));
+    assert(!date_time_parse_rfc3339("2026-10-18T09:30:15", 19, &t, NULL));
+    assert(!date_time_parse_rfc3339("2026-10-18T09:30:15+0200", 24, &t, NULL));
+
+    const char* good_rfc2822[] = { "Sun, 18 Oct 2026 11:30:15 +0200", "18 Oct 2026 09:30:15 GMT",
+                                   "sun , 18 oct 2026 04:30:15 -0500 (CDT)", " Sun, 18 Oct 26 05:30:15 EDT",
+                                   "Sun,\r\n 18 Oct 2026 (a (nested) comment) 09:30:15 Z" };
+    for (size_t index = 0; index < sizeof(good_rfc2822) / sizeof(good_rfc2822[0]); index++)
+    {
+        assert(date_time_parse_rfc2822(good_rfc2822[index], strlen(good_rfc2822[index]), &t, &offset));
+        assert(t == 1792315815);
+    }
+    assert(date_time_parse_rfc2822("8 Oct 1999 9:30 PST", 19, &t, &offset) == false);
+    assert(date_time_parse_rfc2822("8 Oct 99 09:30 PST", 18, &t, &offset) && t == 939403800 && offset == -8 * 3600);
+
+    const char* bad_rfc2822[] = { "", "Sun 18 Oct 2026 09:30:15 +0000", "18 Okt 2026 09:30:15 +0000",
+                                  "31 Apr 2026 09:30:15 +0000", "18 Oct 2026 09:30:15", "18 Oct 2026 09:30:15 +02",
+                                  "18 Oct 2026 24:00:00 +0000", "18 Oct 2026 09:30:15 XYZ" };
+    for (size_t index = 0; index < sizeof(bad_rfc2822) / sizeof(bad_rfc2822[0]); index++)
+    {
+        assert(!date_time_parse_rfc2822(bad_rfc2822[index], strlen(bad_rfc2822[index]), &t, NULL));
+    }
+
+    /* Local round trip through the cached offset */
+    time_t local_now = time(NULL);
+    offset = date_time_get_local_offset(local_now);
+    assert(offset == date_time_get_local_offset(local_now));
+    assert(date_time_format_rfc2822(local_now, offset, out, sizeof(out)) == 31);
+    assert(date_time_parse_rfc2822(out, strlen(out), &t, NULL) && t == local_now);
+
     date_time_release(later);
     date_time_release(from_epoch);
     date_time_release(now);
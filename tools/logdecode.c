@@ -0,0 +1,74 @@
+/*
+BSD 2-Clause License
+
+Copyright (c) 2017, Subrato Roy (subratoroy@hotmail.com)
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+  Renders a binary log written by a logger_allocate_binary logger in the
+  text log layout.
+
+  Usage : logdecode <binary log> [output file]
+*/
+
+#include <treonzlib.h>
+#include <stdio.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        printf("Usage : logdecode <binary log> [output file]\n");
+        return 1;
+    }
+
+    FILE* out = stdout;
+
+    if (argc == 3)
+    {
+        out = fopen(argv[2], "w");
+
+        if (out == NULL)
+        {
+            fprintf(stderr, "Could not open %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    bool decoded = logger_decode_binary(argv[1], out);
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    if (!decoded)
+    {
+        fprintf(stderr, "%s is not a complete binary log\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}